@@ -32,6 +32,7 @@ cocoa/CCAutoreleasePool.cpp \
 cocoa/CCDictionary.cpp \
 cocoa/CCNS.cpp \
 cocoa/CCObject.cpp \
+cocoa/CCObjectPool.cpp \
 cocoa/CCSet.cpp \
 cocoa/CCString.cpp \
 cocoa/CCZone.cpp \
@@ -39,6 +40,7 @@ cocoa/CCArray.cpp \
 cocoa/CCDataVisitor.cpp \
 cocos2d.cpp \
 CCDirector.cpp \
+CCRenderer.cpp \
 draw_nodes/CCDrawingPrimitives.cpp \
 draw_nodes/CCDrawNode.cpp \
 effects/CCGrabber.cpp \
@@ -47,6 +49,7 @@ kazmath/src/aabb.c \
 kazmath/src/mat3.c \
 kazmath/src/mat4.c \
 kazmath/src/neon_matrix_impl.c \
+kazmath/src/sse_matrix_impl.c \
 kazmath/src/plane.c \
 kazmath/src/quaternion.c \
 kazmath/src/ray2.c \
@@ -76,8 +79,11 @@ particle_nodes/CCParticleExamples.cpp \
 particle_nodes/CCParticleSystem.cpp \
 particle_nodes/CCParticleBatchNode.cpp \
 particle_nodes/CCParticleSystemQuad.cpp \
+particle_nodes/CCParticleSimulator.cpp \
 platform/CCImageCommonWebp.cpp \
 platform/CCSAXParser.cpp \
+platform/CCFileData.cpp \
+platform/CCAssetBundle.cpp \
 platform/CCThread.cpp \
 platform/CCFileUtils.cpp \
 platform/platform.cpp \
@@ -48,6 +48,7 @@ CCConfiguration::CCConfiguration(void)
 , m_bSupportsBGRA8888(false)
 , m_bSupportsDiscardFramebuffer(false)
 , m_bSupportsShareableVAO(false)
+, m_bSupportsProgramBinary(false)
 , m_nMaxSamplesAllowed(0)
 , m_nMaxTextureUnits(0)
 , m_pGlExtensions(NULL)
@@ -139,6 +140,17 @@ void CCConfiguration::gatherGPUInfo()
 
     m_bSupportsShareableVAO = checkForGLExtension("vertex_array_object");
 	m_pValueDict->setObject( CCBool::create(m_bSupportsShareableVAO), "gl.supports_vertex_array_object");
+
+#if CC_GL_PROGRAM_BINARY
+    // the functions are looked up at run time, and some drivers have the extension without any binary format
+    GLint nBinaryFormats = 0;
+    if (checkForGLExtension("get_program_binary") && glGetProgramBinary && glProgramBinary)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nBinaryFormats);
+    }
+    m_bSupportsProgramBinary = nBinaryFormats > 0;
+#endif
+	m_pValueDict->setObject( CCBool::create(m_bSupportsProgramBinary), "gl.supports_program_binary");
     
     CHECK_GL_ERROR_DEBUG();
 }
@@ -217,6 +229,11 @@ bool CCConfiguration::supportsShareableVAO(void) const
 	return m_bSupportsShareableVAO;
 }
 
+bool CCConfiguration::supportsProgramBinary(void) const
+{
+	return m_bSupportsProgramBinary;
+}
+
 //
 // generic getters for properties
 //
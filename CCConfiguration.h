@@ -101,6 +101,11 @@ public:
      */
 	bool supportsShareableVAO(void) const;
 
+    /** Whether or not the binaries of the linked programs can be saved and loaded again,
+     with GL_OES_get_program_binary or GL_ARB_get_program_binary.
+     */
+	bool supportsProgramBinary(void) const;
+
     /** returns whether or not an OpenGL is supported */
     bool checkForGLExtension(const std::string &searchName) const;
 
@@ -146,6 +151,7 @@ protected:
     bool            m_bSupportsBGRA8888;
     bool            m_bSupportsDiscardFramebuffer;
     bool            m_bSupportsShareableVAO;
+    bool            m_bSupportsProgramBinary;
     GLint           m_nMaxSamplesAllowed;
     GLint           m_nMaxTextureUnits;
     char *          m_pGlExtensions;
@@ -36,6 +36,8 @@ THE SOFTWARE.
 #include "layers_scenes_transitions_nodes/CCScene.h"
 #include "cocoa/CCArray.h"
 #include "CCScheduler.h"
+#include "CCRenderer.h"
+#include "particle_nodes/CCParticleSimulator.h"
 #include "ccMacros.h"
 #include "touch_dispatcher/CCTouchDispatcher.h"
 #include "support/CCPointExtension.h"
@@ -79,6 +81,10 @@ THE SOFTWARE.
 using namespace std;
 
 unsigned int g_uNumberOfDraws = 0;
+unsigned int g_uNumberOfTransforms = 0;
+unsigned int g_uNumberOfAutoreleases = 0;
+unsigned int g_uNumberOfUniformUploads = 0;
+unsigned int g_uNumberOfSkippedUniforms = 0;
 
 NS_CC_BEGIN
 // XXX it should be a Director ivar. Move it there once support for multiple directors is added
@@ -127,6 +133,10 @@ bool CCDirector::init(void)
     m_pFPSLabel = NULL;
     m_pSPFLabel = NULL;
     m_pDrawsLabel = NULL;
+    m_pTransformsLabel = NULL;
+    m_pAutoreleasesLabel = NULL;
+    m_pUniformsLabel = NULL;
+    m_pSkippedUniformsLabel = NULL;
     m_uTotalFrames = m_uFrames = 0;
     m_pszFPS = new char[10];
     m_pLastUpdate = new struct cc_timeval();
@@ -148,6 +158,9 @@ bool CCDirector::init(void)
     // action manager
     m_pActionManager = new CCActionManager();
     m_pScheduler->scheduleUpdateForTarget(m_pActionManager, kCCPrioritySystem, false);
+    // renderer
+    m_pRenderer = new CCRenderer();
+    m_pRenderer->init();
     // touchDispatcher
     m_pTouchDispatcher = new CCTouchDispatcher();
     m_pTouchDispatcher->init();
@@ -171,12 +184,17 @@ CCDirector::~CCDirector(void)
     CC_SAFE_RELEASE(m_pFPSLabel);
     CC_SAFE_RELEASE(m_pSPFLabel);
     CC_SAFE_RELEASE(m_pDrawsLabel);
+    CC_SAFE_RELEASE(m_pTransformsLabel);
+    CC_SAFE_RELEASE(m_pAutoreleasesLabel);
+    CC_SAFE_RELEASE(m_pUniformsLabel);
+    CC_SAFE_RELEASE(m_pSkippedUniformsLabel);
     
     CC_SAFE_RELEASE(m_pRunningScene);
     CC_SAFE_RELEASE(m_pNotificationNode);
     CC_SAFE_RELEASE(m_pobScenesStack);
     CC_SAFE_RELEASE(m_pScheduler);
     CC_SAFE_RELEASE(m_pActionManager);
+    CC_SAFE_RELEASE(m_pRenderer);
     CC_SAFE_RELEASE(m_pTouchDispatcher);
     CC_SAFE_RELEASE(m_pKeypadDispatcher);
     CC_SAFE_DELETE(m_pAccelerometer);
@@ -284,6 +302,9 @@ void CCDirector::drawScene(void)
         showStats();
     }
 
+    // draw the quads left in the queue
+    m_pRenderer->endFrame();
+
     kmGLPopMatrix();
 
     m_uTotalFrames++;
@@ -371,6 +392,9 @@ void CCDirector::setOpenGLView(CCEGLView *pobOpenGLView)
 
 void CCDirector::setViewport()
 {
+    // the recorded quads belong to the old viewport
+    m_pRenderer->flush();
+
     if (m_pobOpenGLView)
     {
         m_pobOpenGLView->setViewPortInPoints(0, 0, m_obWinSizeInPoints.width, m_obWinSizeInPoints.height);
@@ -696,10 +720,17 @@ void CCDirector::purgeDirector()
     CC_SAFE_RELEASE_NULL(m_pFPSLabel);
     CC_SAFE_RELEASE_NULL(m_pSPFLabel);
     CC_SAFE_RELEASE_NULL(m_pDrawsLabel);
+    CC_SAFE_RELEASE_NULL(m_pTransformsLabel);
+    CC_SAFE_RELEASE_NULL(m_pAutoreleasesLabel);
+    CC_SAFE_RELEASE_NULL(m_pUniformsLabel);
+    CC_SAFE_RELEASE_NULL(m_pSkippedUniformsLabel);
 
     // purge bitmap cache
     CCLabelBMFont::purgeCachedData();
 
+    // stop the particle threads
+    CCParticleSimulator::purgeSharedParticleSimulator();
+
     // purge all managed caches
     ccDrawFree();
     CCAnimationCache::purgeSharedAnimationCache();
@@ -803,7 +834,7 @@ void CCDirector::showStats(void)
     
     if (m_bDisplayStats)
     {
-        if (m_pFPSLabel && m_pSPFLabel && m_pDrawsLabel)
+        if (m_pFPSLabel && m_pSPFLabel && m_pDrawsLabel && m_pTransformsLabel && m_pAutoreleasesLabel && m_pUniformsLabel && m_pSkippedUniformsLabel)
         {
             if (m_fAccumDt > CC_DIRECTOR_STATS_INTERVAL)
             {
@@ -819,8 +850,24 @@ void CCDirector::showStats(void)
                 
                 sprintf(m_pszFPS, "%4lu", (unsigned long)g_uNumberOfDraws);
                 m_pDrawsLabel->setString(m_pszFPS);
+
+                sprintf(m_pszFPS, "%4lu", (unsigned long)g_uNumberOfTransforms);
+                m_pTransformsLabel->setString(m_pszFPS);
+
+                sprintf(m_pszFPS, "%4lu", (unsigned long)g_uNumberOfAutoreleases);
+                m_pAutoreleasesLabel->setString(m_pszFPS);
+
+                sprintf(m_pszFPS, "%4lu", (unsigned long)g_uNumberOfUniformUploads);
+                m_pUniformsLabel->setString(m_pszFPS);
+
+                sprintf(m_pszFPS, "%4lu", (unsigned long)g_uNumberOfSkippedUniforms);
+                m_pSkippedUniformsLabel->setString(m_pszFPS);
             }
             
+            m_pSkippedUniformsLabel->visit();
+            m_pUniformsLabel->visit();
+            m_pAutoreleasesLabel->visit();
+            m_pTransformsLabel->visit();
             m_pDrawsLabel->visit();
             m_pFPSLabel->visit();
             m_pSPFLabel->visit();
@@ -828,6 +875,10 @@ void CCDirector::showStats(void)
     }    
     
     g_uNumberOfDraws = 0;
+    g_uNumberOfTransforms = 0;
+    g_uNumberOfAutoreleases = 0;
+    g_uNumberOfUniformUploads = 0;
+    g_uNumberOfSkippedUniforms = 0;
 }
 
 void CCDirector::calculateMPF()
@@ -856,6 +907,10 @@ void CCDirector::createStatsLabel()
         CC_SAFE_RELEASE_NULL(m_pFPSLabel);
         CC_SAFE_RELEASE_NULL(m_pSPFLabel);
         CC_SAFE_RELEASE_NULL(m_pDrawsLabel);
+        CC_SAFE_RELEASE_NULL(m_pTransformsLabel);
+        CC_SAFE_RELEASE_NULL(m_pAutoreleasesLabel);
+        CC_SAFE_RELEASE_NULL(m_pUniformsLabel);
+        CC_SAFE_RELEASE_NULL(m_pSkippedUniformsLabel);
         textureCache->removeTextureForKey("cc_fps_images");
         CCFileUtils::sharedFileUtils()->purgeCachedEntries();
     }
@@ -906,8 +961,32 @@ void CCDirector::createStatsLabel()
     m_pDrawsLabel->initWithString("000", texture, 12, 32, '.');
     m_pDrawsLabel->setScale(factor);
 
+    m_pTransformsLabel = new CCLabelAtlas();
+    m_pTransformsLabel->setIgnoreContentScaleFactor(true);
+    m_pTransformsLabel->initWithString("000", texture, 12, 32, '.');
+    m_pTransformsLabel->setScale(factor);
+
+    m_pAutoreleasesLabel = new CCLabelAtlas();
+    m_pAutoreleasesLabel->setIgnoreContentScaleFactor(true);
+    m_pAutoreleasesLabel->initWithString("000", texture, 12, 32, '.');
+    m_pAutoreleasesLabel->setScale(factor);
+
+    m_pUniformsLabel = new CCLabelAtlas();
+    m_pUniformsLabel->setIgnoreContentScaleFactor(true);
+    m_pUniformsLabel->initWithString("000", texture, 12, 32, '.');
+    m_pUniformsLabel->setScale(factor);
+
+    m_pSkippedUniformsLabel = new CCLabelAtlas();
+    m_pSkippedUniformsLabel->setIgnoreContentScaleFactor(true);
+    m_pSkippedUniformsLabel->initWithString("000", texture, 12, 32, '.');
+    m_pSkippedUniformsLabel->setScale(factor);
+
     CCTexture2D::setDefaultAlphaPixelFormat(currentFormat);
 
+    m_pSkippedUniformsLabel->setPosition(ccpAdd(ccp(0, 102*factor), CC_DIRECTOR_STATS_POSITION));
+    m_pUniformsLabel->setPosition(ccpAdd(ccp(0, 85*factor), CC_DIRECTOR_STATS_POSITION));
+    m_pAutoreleasesLabel->setPosition(ccpAdd(ccp(0, 68*factor), CC_DIRECTOR_STATS_POSITION));
+    m_pTransformsLabel->setPosition(ccpAdd(ccp(0, 51*factor), CC_DIRECTOR_STATS_POSITION));
     m_pDrawsLabel->setPosition(ccpAdd(ccp(0, 34*factor), CC_DIRECTOR_STATS_POSITION));
     m_pSPFLabel->setPosition(ccpAdd(ccp(0, 17*factor), CC_DIRECTOR_STATS_POSITION));
     m_pFPSLabel->setPosition(CC_DIRECTOR_STATS_POSITION);
@@ -964,6 +1043,11 @@ CCScheduler* CCDirector::getScheduler()
     return m_pScheduler;
 }
 
+CCRenderer* CCDirector::getRenderer()
+{
+    return m_pRenderer;
+}
+
 void CCDirector::setActionManager(CCActionManager* pActionManager)
 {
     if (m_pActionManager != pActionManager)
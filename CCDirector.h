@@ -70,6 +70,7 @@ class CCDirectorDelegate;
 class CCNode;
 class CCScheduler;
 class CCActionManager;
+class CCRenderer;
 class CCTouchDispatcher;
 class CCKeypadDispatcher;
 class CCAccelerometer;
@@ -320,6 +321,10 @@ public:
      */
     CC_PROPERTY(CCActionManager*, m_pActionManager, ActionManager);
 
+    /** CCRenderer that batches the quads drawn by this director's scenes
+     */
+    CC_PROPERTY_READONLY(CCRenderer*, m_pRenderer, Renderer);
+
     /** CCTouchDispatcher associated with this director
      @since v2.0
      */
@@ -373,6 +378,10 @@ protected:
     CCLabelAtlas *m_pFPSLabel;
     CCLabelAtlas *m_pSPFLabel;
     CCLabelAtlas *m_pDrawsLabel;
+    CCLabelAtlas *m_pTransformsLabel;
+    CCLabelAtlas *m_pAutoreleasesLabel;
+    CCLabelAtlas *m_pUniformsLabel;
+    CCLabelAtlas *m_pSkippedUniformsLabel;
     
     /** Whether or not the Director is paused */
     bool m_bPaused;
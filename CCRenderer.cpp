@@ -0,0 +1,378 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "CCRenderer.h"
+#include "ccMacros.h"
+#include "shaders/CCGLProgram.h"
+#include "shaders/ccGLStateCache.h"
+#include "support/CCNotificationCenter.h"
+#include "CCEventType.h"
+#include "kazmath/GL/matrix.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+NS_CC_BEGIN
+
+CCRenderer* CCRenderer::s_pPendingRenderer = NULL;
+
+CCRenderer::CCRenderer()
+: m_pQuads(NULL)
+, m_pIndices(NULL)
+, m_uNumberOfQuads(0)
+, m_pCommands(NULL)
+, m_uNumberOfCommands(0)
+, m_bBatchingEnabled(CC_ENABLE_AUTO_BATCHING != 0)
+, m_bFlushing(false)
+, m_bCullingEnabled(false)
+, m_uCommandsRecorded(0)
+, m_uBatchesIssued(0)
+, m_uLastCommandsRecorded(0)
+, m_uLastBatchesIssued(0)
+, m_uQuadsCulled(0)
+, m_uQuadsVisible(0)
+, m_uLastQuadsCulled(0)
+, m_uLastQuadsVisible(0)
+{
+    m_pBuffersVBO[0] = m_pBuffersVBO[1] = 0;
+}
+
+CCRenderer::~CCRenderer()
+{
+    CCLOGINFO("cocos2d: deallocing CCRenderer %p", this);
+
+    CC_SAFE_FREE(m_pQuads);
+    CC_SAFE_FREE(m_pIndices);
+    CC_SAFE_FREE(m_pCommands);
+
+    if (s_pPendingRenderer == this)
+    {
+        s_pPendingRenderer = NULL;
+    }
+
+    if (m_pBuffersVBO[0])
+    {
+        glDeleteBuffers(2, m_pBuffersVBO);
+    }
+
+    CCNotificationCenter::sharedNotificationCenter()->removeObserver(this, EVNET_COME_TO_FOREGROUND);
+}
+
+bool CCRenderer::init()
+{
+    m_pQuads = (ccV3F_C4B_T2F_Quad*)malloc(kCCRendererMaxQuads * sizeof(ccV3F_C4B_T2F_Quad));
+    m_pIndices = (GLushort*)malloc(kCCRendererMaxQuads * 6 * sizeof(GLushort));
+    m_pCommands = (ccQuadCommand*)malloc(kCCRendererMaxQuads * sizeof(ccQuadCommand));
+
+    if (! (m_pQuads && m_pIndices && m_pCommands))
+    {
+        CC_SAFE_FREE(m_pQuads);
+        CC_SAFE_FREE(m_pIndices);
+        CC_SAFE_FREE(m_pCommands);
+        return false;
+    }
+
+    setupIndices();
+
+    // listen the event when app go to background
+    CCNotificationCenter::sharedNotificationCenter()->addObserver(this,
+                                                                  callfuncO_selector(CCRenderer::listenBackToForeground),
+                                                                  EVNET_COME_TO_FOREGROUND,
+                                                                  NULL);
+
+    // the VBOs are created by the first flush, the GL context might not exist yet
+    return true;
+}
+
+void CCRenderer::listenBackToForeground(CCObject *obj)
+{
+    // the old names belong to the lost context
+    m_pBuffersVBO[0] = m_pBuffersVBO[1] = 0;
+    m_uNumberOfQuads = 0;
+    m_uNumberOfCommands = 0;
+}
+
+void CCRenderer::setupIndices()
+{
+    for (unsigned int i = 0; i < kCCRendererMaxQuads; i++)
+    {
+        m_pIndices[i*6+0] = i*4+0;
+        m_pIndices[i*6+1] = i*4+1;
+        m_pIndices[i*6+2] = i*4+2;
+
+        // inverted index. issue #179
+        m_pIndices[i*6+3] = i*4+3;
+        m_pIndices[i*6+4] = i*4+2;
+        m_pIndices[i*6+5] = i*4+1;
+    }
+}
+
+void CCRenderer::setupVBO()
+{
+    glGenBuffers(2, &m_pBuffersVBO[0]);
+
+    // Avoid changing the element buffer for whatever VAO might be bound.
+    ccGLBindVAO(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * kCCRendererMaxQuads, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_pBuffersVBO[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_pIndices[0]) * kCCRendererMaxQuads * 6, m_pIndices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    CHECK_GL_ERROR_DEBUG();
+}
+
+void CCRenderer::setBatchingEnabled(bool bEnabled)
+{
+    if (m_bBatchingEnabled != bEnabled)
+    {
+        flush();
+        m_bBatchingEnabled = bEnabled;
+    }
+}
+
+bool CCRenderer::canRecord(CCGLProgram *pProgram)
+{
+    return m_bBatchingEnabled && pProgram && pProgram->usesOnlyBuiltinUniforms();
+}
+
+void CCRenderer::addQuads(GLuint uTextureName, CCGLProgram *pProgram, const ccBlendFunc& blendFunc, const ccV3F_C4B_T2F_Quad *pQuads, unsigned int uCount)
+{
+    CCAssert(pProgram, "No shader program set for this node");
+    CCAssert(pProgram->usesOnlyBuiltinUniforms(), "The uniforms of this program can't be shared, check canRecord()");
+
+    if (uCount > 0)
+    {
+        s_pPendingRenderer = this;
+    }
+
+    kmMat4 matrixMV;
+    kmGLGetMatrix(KM_GL_MODELVIEW, &matrixMV);
+    const float *m = matrixMV.mat;
+
+    while (uCount > 0)
+    {
+        if (m_uNumberOfQuads == kCCRendererMaxQuads)
+        {
+            flush();
+        }
+
+        unsigned int n = MIN(uCount, kCCRendererMaxQuads - m_uNumberOfQuads);
+
+        ccQuadCommand *cmd = &m_pCommands[m_uNumberOfCommands++];
+        cmd->textureName = uTextureName;
+        cmd->program = pProgram;
+        cmd->blendFunc = blendFunc;
+        cmd->quadStart = m_uNumberOfQuads;
+        cmd->quadCount = n;
+
+        // transform the vertices to eye space, the batch is drawn with an identity model-view
+        ccV3F_C4B_T2F *dst = (ccV3F_C4B_T2F*)&m_pQuads[m_uNumberOfQuads];
+        const ccV3F_C4B_T2F *src = (const ccV3F_C4B_T2F*)pQuads;
+        for (unsigned int i = 0; i < n * 4; i++)
+        {
+            const ccVertex3F &v = src[i].vertices;
+            dst[i].vertices.x = m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12];
+            dst[i].vertices.y = m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13];
+            dst[i].vertices.z = m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14];
+            dst[i].colors = src[i].colors;
+            dst[i].texCoords = src[i].texCoords;
+        }
+
+        m_uNumberOfQuads += n;
+        m_uCommandsRecorded++;
+        pQuads += n;
+        uCount -= n;
+    }
+}
+
+// a quad is outside the viewport if its 4 vertices are on the outer side of the same clip plane
+static bool quadIntersectsViewport(const float *m, const ccV3F_C4B_T2F_Quad *pQuad)
+{
+    const ccV3F_C4B_T2F *v = (const ccV3F_C4B_T2F*)pQuad;
+    int left = 0, right = 0, bottom = 0, top = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        const ccVertex3F &p = v[i].vertices;
+        float x = m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12];
+        float y = m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13];
+        float w = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15];
+
+        left += (x < -w);
+        right += (x > w);
+        bottom += (y < -w);
+        top += (y > w);
+    }
+
+    return left < 4 && right < 4 && bottom < 4 && top < 4;
+}
+
+bool CCRenderer::isQuadVisible(const ccV3F_C4B_T2F_Quad *pQuad)
+{
+    // kmGLGetMVPMatrix() multiplies the matrices only if the stacks changed since the previous call
+    if (quadIntersectsViewport(kmGLGetMVPMatrix()->mat, pQuad))
+    {
+        m_uQuadsVisible++;
+        return true;
+    }
+
+    m_uQuadsCulled++;
+    return false;
+}
+
+void CCRenderer::addVisibleQuads(GLuint uTextureName, CCGLProgram *pProgram, const ccBlendFunc& blendFunc, const ccV3F_C4B_T2F_Quad *pQuads, unsigned int uCount)
+{
+    const float *pMatrixMVP = kmGLGetMVPMatrix()->mat;
+
+    // record the runs of consecutive visible quads
+    unsigned int runStart = 0;
+    unsigned int runLength = 0;
+    unsigned int visible = 0;
+    for (unsigned int i = 0; i < uCount; i++)
+    {
+        if (quadIntersectsViewport(pMatrixMVP, &pQuads[i]))
+        {
+            visible++;
+            if (runLength == 0)
+            {
+                runStart = i;
+            }
+            runLength++;
+        }
+        else if (runLength > 0)
+        {
+            addQuads(uTextureName, pProgram, blendFunc, &pQuads[runStart], runLength);
+            runLength = 0;
+        }
+    }
+
+    if (runLength > 0)
+    {
+        addQuads(uTextureName, pProgram, blendFunc, &pQuads[runStart], runLength);
+    }
+
+    m_uQuadsVisible += visible;
+    m_uQuadsCulled += uCount - visible;
+}
+
+void CCRenderer::flush()
+{
+    if (m_uNumberOfCommands == 0 || m_bFlushing)
+    {
+        return;
+    }
+
+    // CCGLProgram::use() flushes the queue
+    m_bFlushing = true;
+
+    if (! m_pBuffersVBO[0])
+    {
+        setupVBO();
+    }
+
+    // the atlases might have left their VAO bound
+    ccGLBindVAO(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
+    ccGLStreamBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * kCCRendererMaxQuads, sizeof(m_pQuads[0]) * m_uNumberOfQuads, m_pQuads, GL_DYNAMIC_DRAW);
+
+    ccGLEnableVertexAttribs(kCCVertexAttribFlag_PosColorTex);
+
+#define kQuadSize sizeof(m_pQuads[0].bl)
+    // vertices
+    glVertexAttribPointer(kCCVertexAttrib_Position, 3, GL_FLOAT, GL_FALSE, kQuadSize, (GLvoid*) offsetof(ccV3F_C4B_T2F, vertices));
+    // colors
+    glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, kQuadSize, (GLvoid*) offsetof(ccV3F_C4B_T2F, colors));
+    // tex coords
+    glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, kQuadSize, (GLvoid*) offsetof(ccV3F_C4B_T2F, texCoords));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_pBuffersVBO[1]);
+
+    kmMat4 identity;
+    kmMat4Identity(&identity);
+
+    unsigned int i = 0;
+    while (i < m_uNumberOfCommands)
+    {
+        const ccQuadCommand &first = m_pCommands[i];
+        unsigned int quadCount = first.quadCount;
+
+        // merge the following commands while the state is the same
+        unsigned int j = i + 1;
+        for (; j < m_uNumberOfCommands; j++)
+        {
+            const ccQuadCommand &cmd = m_pCommands[j];
+            if (cmd.textureName != first.textureName || cmd.program != first.program ||
+                cmd.blendFunc.src != first.blendFunc.src || cmd.blendFunc.dst != first.blendFunc.dst)
+            {
+                break;
+            }
+            quadCount += cmd.quadCount;
+        }
+
+        first.program->use();
+        first.program->setUniformsForBuiltins(identity);
+        ccGLBlendFunc(first.blendFunc.src, first.blendFunc.dst);
+        ccGLBindTexture2D(first.textureName);
+
+        glDrawElements(GL_TRIANGLES, (GLsizei) quadCount*6, GL_UNSIGNED_SHORT, (GLvoid*) (first.quadStart*6*sizeof(m_pIndices[0])));
+
+        CC_INCREMENT_GL_DRAWS(1);
+        m_uBatchesIssued++;
+        i = j;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    CHECK_GL_ERROR_DEBUG();
+
+    m_uNumberOfQuads = 0;
+    m_uNumberOfCommands = 0;
+    m_bFlushing = false;
+
+    if (s_pPendingRenderer == this)
+    {
+        s_pPendingRenderer = NULL;
+    }
+}
+
+void CCRenderer::endFrame()
+{
+    flush();
+
+    m_uLastCommandsRecorded = m_uCommandsRecorded;
+    m_uLastBatchesIssued = m_uBatchesIssued;
+    m_uLastQuadsCulled = m_uQuadsCulled;
+    m_uLastQuadsVisible = m_uQuadsVisible;
+    m_uCommandsRecorded = 0;
+    m_uBatchesIssued = 0;
+    m_uQuadsCulled = 0;
+    m_uQuadsVisible = 0;
+}
+
+NS_CC_END
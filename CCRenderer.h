@@ -0,0 +1,168 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CCRENDERER_H__
+#define __CCRENDERER_H__
+
+#include "cocoa/CCObject.h"
+#include "ccTypes.h"
+#include "ccConfig.h"
+#include "CCGL.h"
+#include "kazmath/mat4.h"
+
+NS_CC_BEGIN
+
+class CCGLProgram;
+
+/**
+ * @addtogroup global
+ * @{
+ */
+
+/** Maximum number of quads the renderer can hold before it flushes.
+ The indices are GLushort, so it can't be bigger than 65536 / 4.
+ */
+#define kCCRendererMaxQuads 4096
+
+/** CCSpriteBatchNode (and so CCLabelBMFont) with more quads than this draw their own atlas
+ instead of being recorded, since transforming them on the CPU every frame costs more than the draw call.
+ */
+#define kCCRendererMaxBatchNodeQuads 256
+
+/** @brief A queue of textured quads that merges consecutive draws sharing the same GL state.
+
+ CCSprite, CCSpriteBatchNode (CCLabelBMFont) and CCParticleSystemQuad don't draw in draw(). They record
+ their quads, already transformed by the current model-view matrix, with addQuads().
+ flush() uploads all the recorded quads in one VBO and issues one glDrawElements for every run of commands
+ that share the texture, the shader program and the blend function.
+
+ flush() only sets the built-in uniforms (setUniformsForBuiltins()), so only the quads drawn with a program
+ that has no other uniform are recorded, see canRecord() and CCGLProgram::usesOnlyBuiltinUniforms().
+ The nodes using a program with uniforms of their own, like u_color or CC_alpha_value, draw immediately.
+
+ The queue is flushed automatically:
+ - when a shader program is used (CCGLProgram::use()), which is what every node drawing by itself does
+ - when the projection or the viewport changes, and by the nodes that change the framebuffer or the stencil state
+ - by CCDirector::drawScene() before the buffers are swapped
+
+ Nodes that change some GL state without using a shader program should call flush() first.
+ */
+class CC_DLL CCRenderer : public CCObject
+{
+public:
+    CCRenderer();
+    virtual ~CCRenderer();
+
+    bool init();
+
+    /** records uCount quads, transformed by the current model-view matrix. */
+    void addQuads(GLuint uTextureName, CCGLProgram *pProgram, const ccBlendFunc& blendFunc, const ccV3F_C4B_T2F_Quad *pQuads, unsigned int uCount);
+
+    /** draws all the recorded quads. */
+    void flush();
+
+    /** flushes the renderer that has quads recorded, if any. Cheap when the queue is empty */
+    static void flushPending() { if (s_pPendingRenderer) s_pPendingRenderer->flush(); }
+
+    /** flushes the queue and resets the per frame counters. Called by CCDirector at the end of every frame. */
+    void endFrame();
+
+    /** whether or not the nodes record their quads in the renderer. If disabled they draw immediately */
+    bool isBatchingEnabled() { return m_bBatchingEnabled; }
+    void setBatchingEnabled(bool bEnabled);
+
+    /** whether or not the quads drawn with pProgram can be recorded: the batching is enabled and
+     the program has no uniform besides the built-in ones
+     */
+    bool canRecord(CCGLProgram *pProgram);
+
+    /** number of commands recorded in the previous frame */
+    unsigned int getCommandsRecorded() { return m_uLastCommandsRecorded; }
+
+    /** number of glDrawElements issued by the renderer in the previous frame */
+    unsigned int getBatchesIssued() { return m_uLastBatchesIssued; }
+
+    /** records the quads that are, at least partially, inside the viewport. The others are dropped. */
+    void addVisibleQuads(GLuint uTextureName, CCGLProgram *pProgram, const ccBlendFunc& blendFunc, const ccV3F_C4B_T2F_Quad *pQuads, unsigned int uCount);
+
+    /** returns whether or not the quad, transformed by the current model-view and projection matrices, is inside the viewport */
+    bool isQuadVisible(const ccV3F_C4B_T2F_Quad *pQuad);
+
+    /** whether or not CCSprite, CCSpriteBatchNode (CCLabelBMFont, CCTMXLayer) skip the quads outside the viewport. Disabled by default */
+    bool isCullingEnabled() { return m_bCullingEnabled; }
+    void setCullingEnabled(bool bEnabled) { m_bCullingEnabled = bEnabled; }
+
+    /** number of quads skipped by the culling in the previous frame */
+    unsigned int getQuadsCulled() { return m_uLastQuadsCulled; }
+
+    /** number of quads that passed the culling in the previous frame */
+    unsigned int getQuadsVisible() { return m_uLastQuadsVisible; }
+
+    /** recreates the VBOs when the GL context comes back */
+    void listenBackToForeground(CCObject *obj);
+
+private:
+    void setupIndices();
+    void setupVBO();
+
+    typedef struct _ccQuadCommand
+    {
+        GLuint          textureName;
+        CCGLProgram     *program;
+        ccBlendFunc     blendFunc;
+        unsigned int    quadStart;
+        unsigned int    quadCount;
+    } ccQuadCommand;
+
+    ccV3F_C4B_T2F_Quad  *m_pQuads;
+    GLushort            *m_pIndices;
+    GLuint              m_pBuffersVBO[2]; //0: vertex  1: indices
+    unsigned int        m_uNumberOfQuads;
+
+    ccQuadCommand       *m_pCommands;
+    unsigned int        m_uNumberOfCommands;
+
+    bool                m_bBatchingEnabled;
+    bool                m_bFlushing;
+    bool                m_bCullingEnabled;
+
+    unsigned int        m_uCommandsRecorded;
+    unsigned int        m_uBatchesIssued;
+    unsigned int        m_uLastCommandsRecorded;
+    unsigned int        m_uLastBatchesIssued;
+    unsigned int        m_uQuadsCulled;
+    unsigned int        m_uQuadsVisible;
+    unsigned int        m_uLastQuadsCulled;
+    unsigned int        m_uLastQuadsVisible;
+
+    // the renderer whose queue isn't empty
+    static CCRenderer   *s_pPendingRenderer;
+};
+
+// end of global group
+/// @}
+
+NS_CC_END
+
+#endif // __CCRENDERER_H__
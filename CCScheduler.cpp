@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "support/data_support/ccCArray.h"
 #include "cocoa/CCArray.h"
 #include "script_support/CCScriptSupport.h"
+#include <float.h>
 
 using namespace std;
 
@@ -65,6 +66,11 @@ typedef struct _hashSelectorEntry
     CCTimer             *currentTimer;
     bool                currentTimerSalvaged;
     bool                paused;
+    double              lastTick;       // clock of the last time the timers were updated
+    double              nextTick;       // clock of the next time one of the timers is due
+    double              pausedTick;     // clock of the time the target was paused
+    unsigned int        visitedTick;    // tick of the last time the timers were updated
+    int                 heapIndex;      // index in the timers heap, -1 if it isn't in the heap (paused or being updated)
     UT_hash_handle      hh;
 } tHashTimerEntry;
 
@@ -232,6 +238,17 @@ SEL_SCHEDULE CCTimer::getSelector() const
     return m_pfnSelector;
 }
 
+float CCTimer::getTimeToNextFire() const
+{
+    if (m_fElapsed == -1)
+    {
+        return 0;
+    }
+
+    float fRemaining = (m_bUseDelay ? m_fDelay : m_fInterval) - m_fElapsed;
+    return fRemaining > 0 ? fRemaining : 0;
+}
+
 // implementation of CCScheduler
 
 CCScheduler::CCScheduler(void)
@@ -243,6 +260,11 @@ CCScheduler::CCScheduler(void)
 , m_pHashForTimers(NULL)
 , m_pCurrentTarget(NULL)
 , m_bCurrentTargetSalvaged(false)
+, m_pTimersHeap(NULL)
+, m_uTimersHeapCount(0)
+, m_uTimersHeapCapacity(0)
+, m_dTimersClock(0.0)
+, m_uTimersTick(0)
 , m_bUpdateHashLocked(false)
 , m_pScriptHandlerEntries(NULL)
 {
@@ -253,6 +275,7 @@ CCScheduler::~CCScheduler(void)
 {
     unscheduleAll();
     CC_SAFE_RELEASE(m_pScriptHandlerEntries);
+    free(m_pTimersHeap);
 }
 
 void CCScheduler::removeHashElement(_hashSelectorEntry *pElement)
@@ -260,6 +283,11 @@ void CCScheduler::removeHashElement(_hashSelectorEntry *pElement)
 
 	cocos2d::CCObject *target = pElement->target;
 
+    if (pElement->heapIndex >= 0)
+    {
+        removeTimerElement(pElement);
+    }
+
     ccArrayFree(pElement->timers);
     HASH_DEL(m_pHashForTimers, pElement);
     free(pElement);
@@ -296,6 +324,17 @@ void CCScheduler::scheduleSelector(SEL_SCHEDULE pfnSelector, CCObject *pTarget,
 
         // Is this the 1st element ? Then set the pause level to all the selectors of this target
         pElement->paused = bPaused;
+
+        // the new timer is initialized the next time the scheduler is updated
+        pElement->lastTick = m_dTimersClock;
+        pElement->nextTick = m_dTimersClock;
+        pElement->pausedTick = m_dTimersClock;
+        pElement->visitedTick = m_uTimersTick - 1;
+        pElement->heapIndex = -1;
+        if (! bPaused)
+        {
+            pushTimerElement(pElement);
+        }
     }
     else
     {
@@ -316,6 +355,7 @@ void CCScheduler::scheduleSelector(SEL_SCHEDULE pfnSelector, CCObject *pTarget,
             {
                 CCLOG("CCScheduler#scheduleSelector. Selector already scheduled. Updating interval from: %.4f to %.4f", timer->getInterval(), fInterval);
                 timer->setInterval(fInterval);
+                visitTimerElementSoon(pElement);
                 return;
             }        
         }
@@ -326,6 +366,155 @@ void CCScheduler::scheduleSelector(SEL_SCHEDULE pfnSelector, CCObject *pTarget,
     pTimer->initWithTarget(pTarget, pfnSelector, fInterval, repeat, delay);
     ccArrayAppendObject(pElement->timers, pTimer);
     pTimer->release();    
+
+    visitTimerElementSoon(pElement);
+}
+
+bool CCScheduler::isTimerElementBefore(tHashTimerEntry *pElement, tHashTimerEntry *pOther)
+{
+    if (pElement->nextTick != pOther->nextTick)
+    {
+        return pElement->nextTick < pOther->nextTick;
+    }
+
+    // the targets already updated in this tick go after the others, so they can't be updated twice
+    return pElement->visitedTick != m_uTimersTick && pOther->visitedTick == m_uTimersTick;
+}
+
+void CCScheduler::siftTimerElementUp(unsigned int uIndex)
+{
+    tHashTimerEntry *pElement = m_pTimersHeap[uIndex];
+
+    while (uIndex > 0)
+    {
+        unsigned int uParent = (uIndex - 1) / 2;
+        if (! isTimerElementBefore(pElement, m_pTimersHeap[uParent]))
+        {
+            break;
+        }
+
+        m_pTimersHeap[uIndex] = m_pTimersHeap[uParent];
+        m_pTimersHeap[uIndex]->heapIndex = uIndex;
+        uIndex = uParent;
+    }
+
+    m_pTimersHeap[uIndex] = pElement;
+    pElement->heapIndex = uIndex;
+}
+
+void CCScheduler::siftTimerElementDown(unsigned int uIndex)
+{
+    tHashTimerEntry *pElement = m_pTimersHeap[uIndex];
+
+    while (true)
+    {
+        unsigned int uChild = uIndex * 2 + 1;
+        if (uChild >= m_uTimersHeapCount)
+        {
+            break;
+        }
+
+        if (uChild + 1 < m_uTimersHeapCount && isTimerElementBefore(m_pTimersHeap[uChild + 1], m_pTimersHeap[uChild]))
+        {
+            ++uChild;
+        }
+
+        if (! isTimerElementBefore(m_pTimersHeap[uChild], pElement))
+        {
+            break;
+        }
+
+        m_pTimersHeap[uIndex] = m_pTimersHeap[uChild];
+        m_pTimersHeap[uIndex]->heapIndex = uIndex;
+        uIndex = uChild;
+    }
+
+    m_pTimersHeap[uIndex] = pElement;
+    pElement->heapIndex = uIndex;
+}
+
+void CCScheduler::pushTimerElement(tHashTimerEntry *pElement)
+{
+    CCAssert(pElement->heapIndex < 0, "The target is already in the timers heap");
+
+    if (m_uTimersHeapCount == m_uTimersHeapCapacity)
+    {
+        m_uTimersHeapCapacity = m_uTimersHeapCapacity ? m_uTimersHeapCapacity * 2 : 64;
+        m_pTimersHeap = (tHashTimerEntry **)realloc(m_pTimersHeap, m_uTimersHeapCapacity * sizeof(*m_pTimersHeap));
+    }
+
+    m_pTimersHeap[m_uTimersHeapCount] = pElement;
+    siftTimerElementUp(m_uTimersHeapCount++);
+}
+
+void CCScheduler::removeTimerElement(tHashTimerEntry *pElement)
+{
+    CCAssert(pElement->heapIndex >= 0 && (unsigned int)pElement->heapIndex < m_uTimersHeapCount, "The target isn't in the timers heap");
+
+    unsigned int uIndex = pElement->heapIndex;
+    pElement->heapIndex = -1;
+
+    tHashTimerEntry *pLast = m_pTimersHeap[--m_uTimersHeapCount];
+    if (uIndex == m_uTimersHeapCount)
+    {
+        return;
+    }
+
+    // move the last element to the hole and restore the heap order in whatever direction it's broken
+    m_pTimersHeap[uIndex] = pLast;
+    pLast->heapIndex = uIndex;
+    siftTimerElementUp(uIndex);
+    siftTimerElementDown(pLast->heapIndex);
+}
+
+void CCScheduler::pauseTimerElement(tHashTimerEntry *pElement)
+{
+    if (pElement->paused)
+    {
+        return;
+    }
+
+    pElement->paused = true;
+    pElement->pausedTick = m_dTimersClock;
+
+    if (pElement->heapIndex >= 0)
+    {
+        removeTimerElement(pElement);
+    }
+}
+
+void CCScheduler::resumeTimerElement(tHashTimerEntry *pElement)
+{
+    if (! pElement->paused)
+    {
+        return;
+    }
+
+    pElement->paused = false;
+
+    // the target being updated goes back to the heap once its timers are done
+    if (pElement != m_pCurrentTarget)
+    {
+        // the timers don't run while paused: shift them by the time spent paused
+        double dPausedTime = m_dTimersClock - pElement->pausedTick;
+        pElement->lastTick += dPausedTime;
+        pElement->nextTick += dPausedTime;
+        pushTimerElement(pElement);
+    }
+}
+
+void CCScheduler::visitTimerElementSoon(tHashTimerEntry *pElement)
+{
+    // a timer was added or its interval changed: update the timers of the target in the next tick,
+    // which computes again when they are due
+    if (pElement->nextTick > pElement->lastTick)
+    {
+        pElement->nextTick = pElement->lastTick;
+        if (pElement->heapIndex >= 0)
+        {
+            siftTimerElementUp(pElement->heapIndex);
+        }
+    }
 }
 
 void CCScheduler::unscheduleSelector(SEL_SCHEDULE pfnSelector, CCObject *pTarget)
@@ -659,7 +848,7 @@ void CCScheduler::resumeTarget(CCObject *pTarget)
     HASH_FIND_INT(m_pHashForTimers, &pTarget, pElement);
     if (pElement)
     {
-        pElement->paused = false;
+        resumeTimerElement(pElement);
     }
 
     // update selector
@@ -681,7 +870,7 @@ void CCScheduler::pauseTarget(CCObject *pTarget)
     HASH_FIND_INT(m_pHashForTimers, &pTarget, pElement);
     if (pElement)
     {
-        pElement->paused = true;
+        pauseTimerElement(pElement);
     }
 
     // update selector
@@ -731,7 +920,7 @@ CCSet* CCScheduler::pauseAllTargetsWithMinPriority(int nMinPriority)
     for(tHashTimerEntry *element = m_pHashForTimers; element != NULL;
         element = (tHashTimerEntry*)element->hh.next)
     {
-        element->paused = true;
+        pauseTimerElement(element);
         idsWithSelectors->addObject(element->target);
     }
 
@@ -819,42 +1008,65 @@ void CCScheduler::update(float dt)
         }
     }
 
-    // Iterate over all the custom selectors
-    for (tHashTimerEntry *elt = m_pHashForTimers; elt != NULL; )
+    // Iterate over the custom selectors of the targets that have a timer due
+    m_dTimersClock += dt;
+    ++m_uTimersTick;
+
+    while (m_uTimersHeapCount > 0
+           && m_pTimersHeap[0]->nextTick <= m_dTimersClock
+           && m_pTimersHeap[0]->visitedTick != m_uTimersTick)
     {
+        tHashTimerEntry *elt = m_pTimersHeap[0];
+        removeTimerElement(elt);
+
         m_pCurrentTarget = elt;
         m_bCurrentTargetSalvaged = false;
 
-        if (! m_pCurrentTarget->paused)
+        // the timers of the target get all the time elapsed since they were last updated
+        float fDelta = (float)(m_dTimersClock - elt->lastTick);
+        elt->lastTick = m_dTimersClock;
+        elt->visitedTick = m_uTimersTick;
+
+        // The 'timers' array may change while inside this loop
+        for (elt->timerIndex = 0; elt->timerIndex < elt->timers->num; ++(elt->timerIndex))
         {
-            // The 'timers' array may change while inside this loop
-            for (elt->timerIndex = 0; elt->timerIndex < elt->timers->num; ++(elt->timerIndex))
+            elt->currentTimer = (CCTimer*)(elt->timers->arr[elt->timerIndex]);
+            elt->currentTimerSalvaged = false;
+
+            elt->currentTimer->update(fDelta);
+
+            if (elt->currentTimerSalvaged)
             {
-                elt->currentTimer = (CCTimer*)(elt->timers->arr[elt->timerIndex]);
-                elt->currentTimerSalvaged = false;
+                // The currentTimer told the remove itself. To prevent the timer from
+                // accidentally deallocating itself before finishing its step, we retained
+                // it. Now that step is done, it's safe to release it.
+                elt->currentTimer->release();
+            }
 
-                elt->currentTimer->update(dt);
+            elt->currentTimer = NULL;
+        }
 
-                if (elt->currentTimerSalvaged)
-                {
-                    // The currentTimer told the remove itself. To prevent the timer from
-                    // accidentally deallocating itself before finishing its step, we retained
-                    // it. Now that step is done, it's safe to release it.
-                    elt->currentTimer->release();
-                }
+        // only delete currentTarget if no actions were scheduled during the cycle (issue #481)
+        if (m_bCurrentTargetSalvaged && elt->timers->num == 0)
+        {
+            m_pCurrentTarget = NULL;
+            removeHashElement(elt);
+            continue;
+        }
 
-                elt->currentTimer = NULL;
-            }
+        float fNextFire = FLT_MAX;
+        for (unsigned int i = 0; i < elt->timers->num; ++i)
+        {
+            fNextFire = MIN(fNextFire, ((CCTimer*)elt->timers->arr[i])->getTimeToNextFire());
         }
+        elt->nextTick = m_dTimersClock + fNextFire;
 
-        // elt, at this moment, is still valid
-        // so it is safe to ask this here (issue #490)
-        elt = (tHashTimerEntry *)elt->hh.next;
+        m_pCurrentTarget = NULL;
 
-        // only delete currentTarget if no actions were scheduled during the cycle (issue #481)
-        if (m_bCurrentTargetSalvaged && m_pCurrentTarget->timers->num == 0)
+        // a target paused by its own selectors stays out of the heap until it's resumed
+        if (! elt->paused)
         {
-            removeHashElement(m_pCurrentTarget);
+            pushTimerElement(elt);
         }
     }
 
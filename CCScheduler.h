@@ -60,6 +60,9 @@ public:
     void setInterval(float fInterval);
     
     SEL_SCHEDULE getSelector() const;
+
+    /** seconds of update() left before the selector is called again. 0 if the timer was never updated */
+    float getTimeToNextFire(void) const;
     
     /** Initializes a timer with a target and a selector. */
     bool initWithTarget(CCObject *pTarget, SEL_SCHEDULE pfnSelector);
@@ -116,6 +119,9 @@ There are 2 different types of callbacks (selectors):
 - update selector: the 'update' selector will be called every frame. You can customize the priority.
 - custom selector: A custom selector will be called every frame, or with a custom interval of time
 
+The targets with custom selectors are kept in a min-heap ordered by the time their next timer is due,
+so every frame only the targets that have a timer to fire are visited, no matter how many selectors are scheduled.
+
 The 'custom selectors' should be avoided when possible. It is faster, and consumes less memory to use the 'update selector'.
 
 */
@@ -246,6 +252,17 @@ private:
     void priorityIn(struct _listEntry **ppList, CCObject *pTarget, int nPriority, bool bPaused);
     void appendIn(struct _listEntry **ppList, CCObject *pTarget, bool bPaused);
 
+    // custom selectors specific
+
+    void pushTimerElement(struct _hashSelectorEntry *pElement);
+    void removeTimerElement(struct _hashSelectorEntry *pElement);
+    void siftTimerElementUp(unsigned int uIndex);
+    void siftTimerElementDown(unsigned int uIndex);
+    bool isTimerElementBefore(struct _hashSelectorEntry *pElement, struct _hashSelectorEntry *pOther);
+    void pauseTimerElement(struct _hashSelectorEntry *pElement);
+    void resumeTimerElement(struct _hashSelectorEntry *pElement);
+    void visitTimerElementSoon(struct _hashSelectorEntry *pElement);
+
 protected:
     float m_fTimeScale;
 
@@ -261,6 +278,14 @@ protected:
     struct _hashSelectorEntry *m_pHashForTimers;
     struct _hashSelectorEntry *m_pCurrentTarget;
     bool m_bCurrentTargetSalvaged;
+    // unpaused "selectors with interval" targets, ordered by the time their next timer is due
+    struct _hashSelectorEntry **m_pTimersHeap;
+    unsigned int m_uTimersHeapCount;
+    unsigned int m_uTimersHeapCapacity;
+    // sum of the (scaled) delta times given to update()
+    double m_dTimersClock;
+    // number of calls to update()
+    unsigned int m_uTimersTick;
     // If true unschedule will not remove anything from a hash. Elements will only be marked for deletion.
     bool m_bUpdateHashLocked;
     CCArray* m_pScriptHandlerEntries;
@@ -31,6 +31,9 @@
 #include "cocoa/CCZone.h"
 
 NS_CC_BEGIN
+
+CC_IMPLEMENT_OBJECT_POOL(CCCallFunc)
+CC_IMPLEMENT_OBJECT_POOL(CCCallFuncN)
 //
 // InstantAction
 //
@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include <string>
 #include "ccTypeInfo.h"
 #include "CCAction.h"
+#include "cocoa/CCObjectPool.h"
 
 NS_CC_BEGIN
 
@@ -263,6 +264,8 @@ protected:
         SEL_CallFuncND    m_pCallFuncND;
         SEL_CallFuncO   m_pCallFuncO;
     };
+
+    CC_DECLARE_OBJECT_POOL(CCCallFunc)
 };
 
 /** 
@@ -296,6 +299,8 @@ public:
     // super methods
     virtual CCObject* copyWithZone(CCZone *pZone);
     virtual void execute();
+
+    CC_DECLARE_OBJECT_POOL(CCCallFuncN)
 };
 
 
@@ -35,6 +35,11 @@ THE SOFTWARE.
 
 NS_CC_BEGIN
 
+CC_IMPLEMENT_OBJECT_POOL(CCSequence)
+CC_IMPLEMENT_OBJECT_POOL(CCMoveBy)
+CC_IMPLEMENT_OBJECT_POOL(CCMoveTo)
+CC_IMPLEMENT_OBJECT_POOL(CCDelayTime)
+
 // Extra action for making a CCSequence or CCSpawn when only adding one action to it.
 class ExtraAction : public CCFiniteTimeAction
 {
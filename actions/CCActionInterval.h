@@ -32,6 +32,7 @@ THE SOFTWARE.
 #include "CCProtocols.h"
 #include "sprite_nodes/CCSpriteFrame.h"
 #include "sprite_nodes/CCAnimation.h"
+#include "cocoa/CCObjectPool.h"
 #include <vector>
 
 NS_CC_BEGIN
@@ -122,6 +123,8 @@ protected:
     CCFiniteTimeAction *m_pActions[2];
     float m_split;
     int m_last;
+
+    CC_DECLARE_OBJECT_POOL(CCSequence)
 };
 
 /** @brief Repeats an action a number of times.
@@ -328,6 +331,8 @@ protected:
     CCPoint m_positionDelta;
     CCPoint m_startPosition;
     CCPoint m_previousPosition;
+
+    CC_DECLARE_OBJECT_POOL(CCMoveBy)
 };
 
 /** Moves a CCNode object to the position x,y. x and y are absolute coordinates by modifying it's position attribute.
@@ -349,6 +354,8 @@ public:
     static CCMoveTo* create(float duration, const CCPoint& position);
 protected:
     CCPoint m_endPosition;
+
+    CC_DECLARE_OBJECT_POOL(CCMoveTo)
 };
 
 /** Skews a CCNode object to given angles by modifying it's skewX and skewY attributes
@@ -674,6 +681,8 @@ public:
 
     /** creates the action */
     static CCDelayTime* create(float d);
+
+    CC_DECLARE_OBJECT_POOL(CCDelayTime)
 };
 
 /** @brief Executes an action in reverse order, from time=duration to time=0
@@ -40,6 +40,9 @@ THE SOFTWARE.
 #include "kazmath/GL/matrix.h"
 #include "support/component/CCComponent.h"
 #include "support/component/CCComponentContainer.h"
+#include "support/data_support/uthash.h"
+#include <stdlib.h>
+#include <algorithm>
 
 #if CC_NODE_RENDER_SUBPIXEL
 #define RENDER_IN_SUBPIXEL
@@ -52,6 +55,19 @@ NS_CC_BEGIN
 // XXX: Yes, nodes might have a sort problem once every 15 days if the game runs at 60 FPS and each frame sprites are reordered.
 static int s_globalOrderOfArrival = 1;
 
+// average number of moves per node the insertion sort of sortNodesByZOrder() can do before it switches to a merge sort
+#define kCCNodeSortMovesPerNode 8
+
+// entry of the index of the children by tag
+typedef struct _ccChildTagEntry
+{
+    int             tag;
+    // the child with this tag, NULL if several children have it
+    CCNode          *child;
+    unsigned int    count;
+    UT_hash_handle  hh;
+} ccChildTagEntry;
+
 CCNode::CCNode(void)
 : m_fRotationX(0.0f)
 , m_fRotationY(0.0f)
@@ -65,6 +81,9 @@ CCNode::CCNode(void)
 , m_obAnchorPoint(CCPointZero)
 , m_obContentSize(CCSizeZero)
 , m_sAdditionalTransform(CCAffineTransformMakeIdentity())
+, m_sModelViewAffine(CCAffineTransformMakeIdentity())
+, m_uModelViewVersion(0)
+, m_uParentModelViewVersion(0)
 , m_pCamera(NULL)
 // children (lazy allocs)
 // lazy alloc
@@ -74,6 +93,8 @@ CCNode::CCNode(void)
 , m_pParent(NULL)
 // "whole screen" objects. like Scenes and Layers, should set m_bIgnoreAnchorPointForPosition to true
 , m_nTag(kCCNodeTagInvalid)
+, m_pChildrenByTag(NULL)
+, m_bChildTagIndexEnabled(false)
 // userData is always inited as nil
 , m_pUserData(NULL)
 , m_pUserObject(NULL)
@@ -84,6 +105,7 @@ CCNode::CCNode(void)
 , m_bTransformDirty(true)
 , m_bInverseDirty(true)
 , m_bAdditionalTransformDirty(false)
+, m_bModelViewDirty(true)
 , m_bVisible(true)
 , m_bIgnoreAnchorPointForPosition(false)
 , m_bReorderChildDirty(false)
@@ -136,6 +158,7 @@ CCNode::~CCNode(void)
     }
 
     // children
+    clearChildTagIndex();
     CC_SAFE_RELEASE(m_pChildren);
     
           // m_pComsContainer
@@ -156,7 +179,7 @@ float CCNode::getSkewX()
 void CCNode::setSkewX(float newSkewX)
 {
     m_fSkewX = newSkewX;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 float CCNode::getSkewY()
@@ -168,7 +191,7 @@ void CCNode::setSkewY(float newSkewY)
 {
     m_fSkewY = newSkewY;
 
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 /// zOrder getter
@@ -204,6 +227,7 @@ float CCNode::getVertexZ()
 void CCNode::setVertexZ(float var)
 {
     m_fVertexZ = var;
+    m_bModelViewDirty = true;
 }
 
 
@@ -218,7 +242,7 @@ float CCNode::getRotation()
 void CCNode::setRotation(float newRotation)
 {
     m_fRotationX = m_fRotationY = newRotation;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 float CCNode::getRotationX()
@@ -229,7 +253,7 @@ float CCNode::getRotationX()
 void CCNode::setRotationX(float fRotationX)
 {
     m_fRotationX = fRotationX;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 float CCNode::getRotationY()
@@ -240,7 +264,7 @@ float CCNode::getRotationY()
 void CCNode::setRotationY(float fRotationY)
 {
     m_fRotationY = fRotationY;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 /// scale getter
@@ -254,7 +278,7 @@ float CCNode::getScale(void)
 void CCNode::setScale(float scale)
 {
     m_fScaleX = m_fScaleY = scale;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 /// scaleX getter
@@ -267,7 +291,7 @@ float CCNode::getScaleX()
 void CCNode::setScaleX(float newScaleX)
 {
     m_fScaleX = newScaleX;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 /// scaleY getter
@@ -280,7 +304,7 @@ float CCNode::getScaleY()
 void CCNode::setScaleY(float newScaleY)
 {
     m_fScaleY = newScaleY;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 /// position getter
@@ -293,7 +317,7 @@ const CCPoint& CCNode::getPosition()
 void CCNode::setPosition(const CCPoint& newPosition)
 {
     m_obPosition = newPosition;
-    m_bTransformDirty = m_bInverseDirty = true;
+    m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 }
 
 void CCNode::getPosition(float* x, float* y)
@@ -394,7 +418,7 @@ void CCNode::setAnchorPoint(const CCPoint& point)
     {
         m_obAnchorPoint = point;
         m_obAnchorPointInPoints = ccp(m_obContentSize.width * m_obAnchorPoint.x, m_obContentSize.height * m_obAnchorPoint.y );
-        m_bTransformDirty = m_bInverseDirty = true;
+        m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
     }
 }
 
@@ -411,7 +435,7 @@ void CCNode::setContentSize(const CCSize & size)
         m_obContentSize = size;
 
         m_obAnchorPointInPoints = ccp(m_obContentSize.width * m_obAnchorPoint.x, m_obContentSize.height * m_obAnchorPoint.y );
-        m_bTransformDirty = m_bInverseDirty = true;
+        m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
     }
 }
 
@@ -443,7 +467,7 @@ void CCNode::ignoreAnchorPointForPosition(bool newValue)
     if (newValue != m_bIgnoreAnchorPointForPosition) 
     {
 		m_bIgnoreAnchorPointForPosition = newValue;
-		m_bTransformDirty = m_bInverseDirty = true;
+		m_bTransformDirty = m_bInverseDirty = m_bModelViewDirty = true;
 	}
 }
 
@@ -456,7 +480,17 @@ int CCNode::getTag() const
 /// tag setter
 void CCNode::setTag(int var)
 {
-    m_nTag = var;
+    if (m_pParent && var != m_nTag)
+    {
+        int nOldTag = m_nTag;
+        m_nTag = var;
+        m_pParent->removeChildFromTagIndex(this, nOldTag);
+        m_pParent->addChildToTagIndex(this);
+    }
+    else
+    {
+        m_nTag = var;
+    }
 }
 
 /// userData getter
@@ -567,6 +601,21 @@ CCNode* CCNode::getChildByTag(int aTag)
 {
     CCAssert( aTag != kCCNodeTagInvalid, "Invalid tag");
 
+    if (m_bChildTagIndexEnabled)
+    {
+        ccChildTagEntry *pEntry = NULL;
+        HASH_FIND_INT(m_pChildrenByTag, &aTag, pEntry);
+        if (pEntry == NULL)
+        {
+            return NULL;
+        }
+        if (pEntry->child)
+        {
+            return pEntry->child;
+        }
+        // several children have this tag, return the first one as the scan below does
+    }
+
     if(m_pChildren && m_pChildren->count() > 0)
     {
         CCObject* child;
@@ -601,6 +650,8 @@ void CCNode::addChild(CCNode *child, int zOrder, int tag)
     child->setParent(this);
     child->setOrderOfArrival(s_globalOrderOfArrival++);
 
+    this->addChildToTagIndex(child);
+
     if( m_bRunning )
     {
         child->onEnter();
@@ -714,6 +765,7 @@ void CCNode::removeAllChildrenWithCleanup(bool cleanup)
         m_pChildren->removeAllObjects();
     }
     
+    clearChildTagIndex();
 }
 
 void CCNode::detachChild(CCNode *child, bool doCleanup)
@@ -737,9 +789,103 @@ void CCNode::detachChild(CCNode *child, bool doCleanup)
     // set parent nil at the end
     child->setParent(NULL);
 
+    this->removeChildFromTagIndex(child, child->m_nTag);
     m_pChildren->removeObject(child);
 }
 
+void CCNode::setChildTagIndexEnabled(bool bEnabled)
+{
+    if (bEnabled == m_bChildTagIndexEnabled)
+    {
+        return;
+    }
+
+    clearChildTagIndex();
+    m_bChildTagIndexEnabled = bEnabled;
+
+    if (m_bChildTagIndexEnabled && m_pChildren)
+    {
+        CCObject* child;
+        CCARRAY_FOREACH(m_pChildren, child)
+        {
+            addChildToTagIndex((CCNode*)child);
+        }
+    }
+}
+
+bool CCNode::isChildTagIndexEnabled()
+{
+    return m_bChildTagIndexEnabled;
+}
+
+void CCNode::clearChildTagIndex()
+{
+    ccChildTagEntry *pEntry = NULL, *pTmp = NULL;
+    HASH_ITER(hh, m_pChildrenByTag, pEntry, pTmp)
+    {
+        HASH_DEL(m_pChildrenByTag, pEntry);
+        free(pEntry);
+    }
+    m_pChildrenByTag = NULL;
+}
+
+void CCNode::addChildToTagIndex(CCNode *child)
+{
+    if (! m_bChildTagIndexEnabled || child->m_nTag == kCCNodeTagInvalid)
+    {
+        return;
+    }
+
+    int nTag = child->m_nTag;
+    ccChildTagEntry *pEntry = NULL;
+    HASH_FIND_INT(m_pChildrenByTag, &nTag, pEntry);
+    if (pEntry == NULL)
+    {
+        pEntry = (ccChildTagEntry*)calloc(1, sizeof(ccChildTagEntry));
+        pEntry->tag = nTag;
+        HASH_ADD_INT(m_pChildrenByTag, tag, pEntry);
+    }
+
+    pEntry->child = (pEntry->count == 0) ? child : NULL;
+    ++pEntry->count;
+}
+
+void CCNode::removeChildFromTagIndex(CCNode *child, int nTag)
+{
+    if (! m_bChildTagIndexEnabled || nTag == kCCNodeTagInvalid)
+    {
+        return;
+    }
+
+    ccChildTagEntry *pEntry = NULL;
+    HASH_FIND_INT(m_pChildrenByTag, &nTag, pEntry);
+    if (pEntry == NULL)
+    {
+        return;
+    }
+
+    --pEntry->count;
+    if (pEntry->count == 0)
+    {
+        HASH_DEL(m_pChildrenByTag, pEntry);
+        free(pEntry);
+    }
+    else if (pEntry->count == 1)
+    {
+        // find the only child left with this tag
+        CCObject* pObject;
+        CCARRAY_FOREACH(m_pChildren, pObject)
+        {
+            CCNode* pNode = (CCNode*)pObject;
+            if (pNode != child && pNode->m_nTag == nTag)
+            {
+                pEntry->child = pNode;
+                break;
+            }
+        }
+    }
+}
+
 
 // helper used by reorderChild & add
 void CCNode::insertChild(CCNode* child, int z)
@@ -761,24 +907,7 @@ void CCNode::sortAllChildren()
 {
     if (m_bReorderChildDirty)
     {
-        int i,j,length = m_pChildren->data->num;
-        CCNode ** x = (CCNode**)m_pChildren->data->arr;
-        CCNode *tempItem;
-
-        // insertion sort
-        for(i=1; i<length; i++)
-        {
-            tempItem = x[i];
-            j = i-1;
-
-            //continue moving element downwards while zOrder is smaller or when zOrder is the same but mutatedIndex is smaller
-            while(j>=0 && ( tempItem->m_nZOrder < x[j]->m_nZOrder || ( tempItem->m_nZOrder== x[j]->m_nZOrder && tempItem->m_uOrderOfArrival < x[j]->m_uOrderOfArrival ) ) )
-            {
-                x[j+1] = x[j];
-                j = j-1;
-            }
-            x[j+1] = tempItem;
-        }
+        sortNodesByZOrder(m_pChildren);
 
         //don't need to check children recursively, that's done in visit of each child
 
@@ -786,6 +915,43 @@ void CCNode::sortAllChildren()
     }
 }
 
+bool CCNode::compareNodesByZOrder(CCNode *pNode1, CCNode *pNode2)
+{
+    return pNode1->m_nZOrder < pNode2->m_nZOrder || ( pNode1->m_nZOrder == pNode2->m_nZOrder && pNode1->m_uOrderOfArrival < pNode2->m_uOrderOfArrival );
+}
+
+void CCNode::sortNodesByZOrder(CCArray *pNodes)
+{
+    int i,j,length = pNodes->data->num;
+    CCNode ** x = (CCNode**)pNodes->data->arr;
+    CCNode *tempItem;
+
+    // insertion sort: linear when the nodes are almost sorted, which is the common case.
+    // Once it has moved more than kCCNodeSortMovesPerNode nodes per node the order is too far from sorted,
+    // and a merge sort finishes the job. Both are stable, so is the result.
+    int moves = length * kCCNodeSortMovesPerNode;
+    for(i=1; i<length; i++)
+    {
+        tempItem = x[i];
+        j = i-1;
+
+        //continue moving element downwards while zOrder is smaller or when zOrder is the same but mutatedIndex is smaller
+        while(j>=0 && compareNodesByZOrder(tempItem, x[j]))
+        {
+            x[j+1] = x[j];
+            j = j-1;
+            --moves;
+        }
+        x[j+1] = tempItem;
+
+        if (moves < 0)
+        {
+            std::stable_sort(x, x + length, compareNodesByZOrder);
+            break;
+        }
+    }
+}
+
 
  void CCNode::draw()
  {
@@ -809,6 +975,8 @@ void CCNode::visit()
          m_pGrid->beforeDraw();
      }
 
+    km_mat4_version uModelViewVersion = m_uModelViewVersion;
+
     this->transform();
 
     CCNode* pNode = NULL;
@@ -817,8 +985,18 @@ void CCNode::visit()
     if(m_pChildren && m_pChildren->count() > 0)
     {
         sortAllChildren();
-        // draw children zOrder < 0
         ccArray *arrayData = m_pChildren->data;
+
+        // a new model-view matrix moves the whole subtree, clean subtrees keep their cached matrices
+        if (m_uModelViewVersion != uModelViewVersion)
+        {
+            for (unsigned int j = 0; j < arrayData->num; j++)
+            {
+                ((CCNode*) arrayData->arr[j])->m_bModelViewDirty = true;
+            }
+        }
+
+        // draw children zOrder < 0
         for( ; i < arrayData->num; i++ )
         {
             pNode = (CCNode*) arrayData->arr[i];
@@ -871,16 +1049,37 @@ void CCNode::transformAncestors()
 
 void CCNode::transform()
 {    
-    kmMat4 transfrom4x4;
-
-    // Convert 3x3 into 4x4 matrix
+    // the setters and the parent's visit() mark the cached matrix dirty. The version of the parent model-view
+    // also catches the nodes visited from outside their parent (CCRenderTexture, CCClippingNode stencil, grids).
+    // The subclasses may override nodeToParentTransform() without the setters, so its result is compared too
+    km_mat4_version uParentModelViewVersion = kmGLGetMatrixVersion(KM_GL_MODELVIEW);
     CCAffineTransform tmpAffine = this->nodeToParentTransform();
-    CGAffineToGL(&tmpAffine, transfrom4x4.mat);
 
-    // Update Z vertex manually
-    transfrom4x4.mat[14] = m_fVertexZ;
+    if (m_bModelViewDirty || uParentModelViewVersion != m_uParentModelViewVersion
+        || ! CCAffineTransformEqualToTransform(tmpAffine, m_sModelViewAffine))
+    {
+        // the top of the stack is read in place, it is replaced below
+        const kmMat4 *pParentModelView = kmGLGetTopMatrix(KM_GL_MODELVIEW);
+        kmMat4 transfrom4x4;
+
+        // Convert 3x3 into 4x4 matrix
+        CGAffineToGL(&tmpAffine, transfrom4x4.mat);
+
+        // Update Z vertex manually
+        transfrom4x4.mat[14] = m_fVertexZ;
+
+        kmMat4Multiply(&m_sModelViewTransform, pParentModelView, &transfrom4x4);
+
+        m_sModelViewAffine = tmpAffine;
+        m_uParentModelViewVersion = uParentModelViewVersion;
+        m_uModelViewVersion = 0;
+        m_bModelViewDirty = false;
+
+        CC_INCREMENT_TRANSFORMS(1);
+    }
 
-    kmGLMultMatrix( &transfrom4x4 );
+    // loading the cached matrix with its own version lets the children see that it did not change
+    m_uModelViewVersion = kmGLLoadMatrixWithVersion(&m_sModelViewTransform, m_uModelViewVersion);
 
 
     // XXX: Expensive calls. Camera should be integrated into the cached affine matrix
@@ -1201,6 +1400,7 @@ void CCNode::setAdditionalTransform(const CCAffineTransform& additionalTransform
 {
     m_sAdditionalTransform = additionalTransform;
     m_bTransformDirty = true;
+    m_bModelViewDirty = true;
     m_bAdditionalTransformDirty = true;
 }
 
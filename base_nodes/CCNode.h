@@ -52,6 +52,7 @@ class CCActionManager;
 class CCComponent;
 class CCDictionary;
 class CCComponentContainer;
+struct _ccChildTagEntry;
 
 /**
  * @addtogroup base_nodes
@@ -588,6 +589,22 @@ public:
      * @return a CCNode object whose tag equals to the input parameter
      */
     CCNode * getChildByTag(int tag);
+    /**
+     * Enables or disables the index of the children by tag.
+     *
+     * When it is enabled, getChildByTag() and removeChildByTag() look the tag up in a hash table
+     * maintained by addChild(), removeChild() and setTag(), instead of scanning the children.
+     * It is worth enabling on nodes with many children that are looked up every frame. Disabled by default.
+     *
+     * @param bEnabled  true to index the children by tag.
+     */
+    void setChildTagIndexEnabled(bool bEnabled);
+    /**
+     * Returns whether or not the children are indexed by tag.
+     *
+     * @see setChildTagIndexEnabled(bool)
+     */
+    bool isChildTagIndexEnabled();
     /**
      * Return an array of children
      *
@@ -1175,6 +1192,8 @@ public:
     
     /**
      * Performs OpenGL view-matrix transformation based on position, scale, rotation and other attributes.
+     * The resulting model-view matrix is cached, it's only recomputed when the node transform,
+     * its vertexZ or the model-view matrix of the parent changed since the last call.
      */
     void transform(void);
     /**
@@ -1195,6 +1214,7 @@ public:
     /** 
      * Returns the matrix that transform the node's (local) space coordinates into the parent's space coordinates.
      * The matrix is in Pixels.
+     * transform() calls it on every visit and only recomputes the model-view matrix when the result changes.
      */
     virtual CCAffineTransform nodeToParentTransform(void);
 
@@ -1339,6 +1359,22 @@ private:
     
     /// Convert cocos2d coordinates to UI windows coordinate.
     CCPoint convertToWindowSpace(const CCPoint& nodePoint);
+    
+    /// Empties the index of the children by tag.
+    void clearChildTagIndex();
+
+protected:
+    /// Adds a child to the index of the children by tag, if it is enabled. Called once the child is in m_pChildren.
+    void addChildToTagIndex(CCNode *child);
+    
+    /// Removes a child, that had the tag nTag, from the index of the children by tag, if it is enabled.
+    void removeChildFromTagIndex(CCNode *child, int nTag);
+    
+    /// Sorts an array of nodes by z-order, then by order of arrival. The nodes that compare equal keep their relative order.
+    static void sortNodesByZOrder(CCArray *pNodes);
+    
+    /// Returns whether or not pNode1 is drawn before pNode2, the order used by sortNodesByZOrder()
+    static bool compareNodesByZOrder(CCNode *pNode1, CCNode *pNode2);
 
 protected:
     float m_fRotationX;                 ///< rotation angle on x-axis
@@ -1364,6 +1400,11 @@ protected:
     CCAffineTransform m_sTransform;     ///< transform
     CCAffineTransform m_sInverse;       ///< transform
     
+    kmMat4 m_sModelViewTransform;       ///< cached model-view matrix: parent model-view * transform
+    CCAffineTransform m_sModelViewAffine; ///< nodeToParentTransform() m_sModelViewTransform was computed with
+    km_mat4_version m_uModelViewVersion; ///< kazmath version of m_sModelViewTransform, 0 until it is loaded
+    km_mat4_version m_uParentModelViewVersion; ///< kazmath version of the parent model-view m_sModelViewTransform was computed with
+    
     CCCamera *m_pCamera;                ///< a camera
     
     CCGridBase *m_pGrid;                ///< a grid
@@ -1375,6 +1416,9 @@ protected:
     
     int m_nTag;                         ///< a tag. Can be any number you assigned just to identify this node
     
+    struct _ccChildTagEntry *m_pChildrenByTag; ///< children by tag, when m_bChildTagIndexEnabled
+    bool m_bChildTagIndexEnabled;       ///< whether or not the children are indexed by tag
+    
     void *m_pUserData;                  ///< A user assingned void pointer, Can be point to any cpp object
     CCObject *m_pUserObject;            ///< A user assigned CCObject
     
@@ -1393,6 +1437,7 @@ protected:
     bool m_bTransformDirty;             ///< transform dirty flag
     bool m_bInverseDirty;               ///< transform dirty flag
     bool m_bAdditionalTransformDirty;   ///< The flag to check whether the additional transform is dirty
+    bool m_bModelViewDirty;             ///< whether or not m_sModelViewTransform has to be recomputed, set with m_bTransformDirty and by the parent
     bool m_bVisible;                    ///< is this node visible
     
     bool m_bIgnoreAnchorPointForPosition; ///< true if the Anchor Point will be (0,0) when you position the CCNode, false otherwise.
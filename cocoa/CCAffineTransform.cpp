@@ -25,6 +25,14 @@ THE SOFTWARE.
 #include <algorithm>
 #include <math.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CC_AFFINE_TRANSFORM_USE_SSE 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CC_AFFINE_TRANSFORM_USE_NEON 1
+#endif
+
 using namespace std;
 
 
@@ -129,4 +137,152 @@ CCAffineTransform CCAffineTransformInvert(const CCAffineTransform& t)
                             determinant * (t.c * t.ty - t.d * t.tx), determinant * (t.b * t.tx - t.a * t.ty) );
 }
 
+static inline void ccQuadSetVertices(ccV3F_C4B_T2F_Quad *pQuad, float ax, float ay, float bx, float by, float cx, float cy, float dx, float dy)
+{
+    pQuad->bl.vertices.x = ax;
+    pQuad->bl.vertices.y = ay;
+    pQuad->br.vertices.x = bx;
+    pQuad->br.vertices.y = by;
+    pQuad->tr.vertices.x = cx;
+    pQuad->tr.vertices.y = cy;
+    pQuad->tl.vertices.x = dx;
+    pQuad->tl.vertices.y = dy;
+}
+
+#if CC_AFFINE_TRANSFORM_USE_SSE
+// stores the corners of 2 quads, every register holds (x, y) of the first quad then (x, y) of the second one
+static inline void ccQuadStoreCorners(ccV3F_C4B_T2F_Quad **ppQuads, __m128 bl, __m128 br, __m128 tr, __m128 tl)
+{
+    _mm_storel_pi((__m64*)&ppQuads[0]->bl.vertices.x, bl);
+    _mm_storel_pi((__m64*)&ppQuads[0]->br.vertices.x, br);
+    _mm_storel_pi((__m64*)&ppQuads[0]->tr.vertices.x, tr);
+    _mm_storel_pi((__m64*)&ppQuads[0]->tl.vertices.x, tl);
+    _mm_storeh_pi((__m64*)&ppQuads[1]->bl.vertices.x, bl);
+    _mm_storeh_pi((__m64*)&ppQuads[1]->br.vertices.x, br);
+    _mm_storeh_pi((__m64*)&ppQuads[1]->tr.vertices.x, tr);
+    _mm_storeh_pi((__m64*)&ppQuads[1]->tl.vertices.x, tl);
+}
+#endif // CC_AFFINE_TRANSFORM_USE_SSE
+
+void CCAffineTransformApplyToQuads(const CCAffineTransform *pTransforms, const CCRect *pRects, ccV3F_C4B_T2F_Quad **ppQuads, unsigned int count)
+{
+    unsigned int i = 0;
+
+    // the corners are computed in the order of CCSprite::updateTransform(): x * a - y * -c + tx, x * b + y * d + ty
+#if CC_AFFINE_TRANSFORM_USE_SSE
+    const __m128 vSign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        const CCAffineTransform *t = pTransforms + i;
+        const CCRect *r = pRects + i;
+
+        // a, b, c, d of the 4 transforms, then x, y, width, height of the 4 rectangles
+        __m128 a = _mm_loadu_ps(&t[0].a);
+        __m128 b = _mm_loadu_ps(&t[1].a);
+        __m128 c = _mm_loadu_ps(&t[2].a);
+        __m128 d = _mm_loadu_ps(&t[3].a);
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        __m128 tx = _mm_setr_ps(t[0].tx, t[1].tx, t[2].tx, t[3].tx);
+        __m128 ty = _mm_setr_ps(t[0].ty, t[1].ty, t[2].ty, t[3].ty);
+
+        __m128 x1 = _mm_loadu_ps(&r[0].origin.x);
+        __m128 y1 = _mm_loadu_ps(&r[1].origin.x);
+        __m128 x2 = _mm_loadu_ps(&r[2].origin.x);
+        __m128 y2 = _mm_loadu_ps(&r[3].origin.x);
+        _MM_TRANSPOSE4_PS(x1, y1, x2, y2);
+        x2 = _mm_add_ps(x1, x2);
+        y2 = _mm_add_ps(y1, y2);
+
+        __m128 negC = _mm_xor_ps(c, vSign);
+        __m128 x1a = _mm_mul_ps(x1, a);
+        __m128 x2a = _mm_mul_ps(x2, a);
+        __m128 x1b = _mm_mul_ps(x1, b);
+        __m128 x2b = _mm_mul_ps(x2, b);
+        __m128 y1c = _mm_mul_ps(y1, negC);
+        __m128 y2c = _mm_mul_ps(y2, negC);
+        __m128 y1d = _mm_mul_ps(y1, d);
+        __m128 y2d = _mm_mul_ps(y2, d);
+
+        __m128 ax = _mm_add_ps(_mm_sub_ps(x1a, y1c), tx);
+        __m128 ay = _mm_add_ps(_mm_add_ps(x1b, y1d), ty);
+        __m128 bx = _mm_add_ps(_mm_sub_ps(x2a, y1c), tx);
+        __m128 by = _mm_add_ps(_mm_add_ps(x2b, y1d), ty);
+        __m128 cx = _mm_add_ps(_mm_sub_ps(x2a, y2c), tx);
+        __m128 cy = _mm_add_ps(_mm_add_ps(x2b, y2d), ty);
+        __m128 dx = _mm_add_ps(_mm_sub_ps(x1a, y2c), tx);
+        __m128 dy = _mm_add_ps(_mm_add_ps(x1b, y2d), ty);
+
+        // x and y of a corner are next to each other in the vertex: the pairs are interleaved then stored 8 bytes at a time
+        ccQuadStoreCorners(ppQuads + i, _mm_unpacklo_ps(ax, ay), _mm_unpacklo_ps(bx, by), _mm_unpacklo_ps(cx, cy), _mm_unpacklo_ps(dx, dy));
+        ccQuadStoreCorners(ppQuads + i + 2, _mm_unpackhi_ps(ax, ay), _mm_unpackhi_ps(bx, by), _mm_unpackhi_ps(cx, cy), _mm_unpackhi_ps(dx, dy));
+    }
+#elif CC_AFFINE_TRANSFORM_USE_NEON
+    for (; i + 4 <= count; i += 4)
+    {
+        const CCAffineTransform *t = pTransforms + i;
+
+        // the rectangles are 4 floats each, vld4q splits them in x, y, width, height
+        float32x4x4_t rects = vld4q_f32(&pRects[i].origin.x);
+        float32x4_t x1 = rects.val[0];
+        float32x4_t y1 = rects.val[1];
+        float32x4_t x2 = vaddq_f32(x1, rects.val[2]);
+        float32x4_t y2 = vaddq_f32(y1, rects.val[3]);
+
+        float ta[4] = { t[0].a, t[1].a, t[2].a, t[3].a };
+        float tb[4] = { t[0].b, t[1].b, t[2].b, t[3].b };
+        float tc[4] = { t[0].c, t[1].c, t[2].c, t[3].c };
+        float td[4] = { t[0].d, t[1].d, t[2].d, t[3].d };
+        float ttx[4] = { t[0].tx, t[1].tx, t[2].tx, t[3].tx };
+        float tty[4] = { t[0].ty, t[1].ty, t[2].ty, t[3].ty };
+        float32x4_t a = vld1q_f32(ta);
+        float32x4_t b = vld1q_f32(tb);
+        float32x4_t negC = vnegq_f32(vld1q_f32(tc));
+        float32x4_t d = vld1q_f32(td);
+        float32x4_t tx = vld1q_f32(ttx);
+        float32x4_t ty = vld1q_f32(tty);
+
+        // vmul then vadd, not vmla, which would round differently on the fused units
+        float32x4_t x1a = vmulq_f32(x1, a);
+        float32x4_t x2a = vmulq_f32(x2, a);
+        float32x4_t x1b = vmulq_f32(x1, b);
+        float32x4_t x2b = vmulq_f32(x2, b);
+        float32x4_t y1c = vmulq_f32(y1, negC);
+        float32x4_t y2c = vmulq_f32(y2, negC);
+        float32x4_t y1d = vmulq_f32(y1, d);
+        float32x4_t y2d = vmulq_f32(y2, d);
+
+        float ax[4], ay[4], bx[4], by[4], cx[4], cy[4], dx[4], dy[4];
+        vst1q_f32(ax, vaddq_f32(vsubq_f32(x1a, y1c), tx));
+        vst1q_f32(ay, vaddq_f32(vaddq_f32(x1b, y1d), ty));
+        vst1q_f32(bx, vaddq_f32(vsubq_f32(x2a, y1c), tx));
+        vst1q_f32(by, vaddq_f32(vaddq_f32(x2b, y1d), ty));
+        vst1q_f32(cx, vaddq_f32(vsubq_f32(x2a, y2c), tx));
+        vst1q_f32(cy, vaddq_f32(vaddq_f32(x2b, y2d), ty));
+        vst1q_f32(dx, vaddq_f32(vsubq_f32(x1a, y2c), tx));
+        vst1q_f32(dy, vaddq_f32(vaddq_f32(x1b, y2d), ty));
+
+        for (unsigned int j = 0; j < 4; j++)
+        {
+            ccQuadSetVertices(ppQuads[i + j], ax[j], ay[j], bx[j], by[j], cx[j], cy[j], dx[j], dy[j]);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const CCAffineTransform& t = pTransforms[i];
+        float x1 = pRects[i].origin.x;
+        float y1 = pRects[i].origin.y;
+        float x2 = x1 + pRects[i].size.width;
+        float y2 = y1 + pRects[i].size.height;
+        float negC = -t.c;
+
+        ccQuadSetVertices(ppQuads[i],
+                          x1 * t.a - y1 * negC + t.tx, x1 * t.b + y1 * t.d + t.ty,
+                          x2 * t.a - y1 * negC + t.tx, x2 * t.b + y1 * t.d + t.ty,
+                          x2 * t.a - y2 * negC + t.tx, x2 * t.b + y2 * t.d + t.ty,
+                          x1 * t.a - y2 * negC + t.tx, x1 * t.b + y2 * t.d + t.ty);
+    }
+}
+
 NS_CC_END
@@ -27,6 +27,7 @@ THE SOFTWARE.
 
 #include "CCGeometry.h"
 #include "platform/CCPlatformMacros.h"
+#include "ccTypes.h"
 
 NS_CC_BEGIN
 
@@ -54,6 +55,14 @@ CC_DLL CCAffineTransform CCAffineTransformConcat(const CCAffineTransform& t1, co
 CC_DLL bool CCAffineTransformEqualToTransform(const CCAffineTransform& t1, const CCAffineTransform& t2);
 CC_DLL CCAffineTransform CCAffineTransformInvert(const CCAffineTransform& t);
 
+/** Transforms the corners of count rectangles by count transforms, the rectangle i by the transform i,
+ and writes them in the vertices of the quad *ppQuads[i]: the corner (minX, minY) in bl, (maxX, minY) in br,
+ (minX, maxY) in tl and (maxX, maxY) in tr. Only x and y of the vertices are written.
+ The quads are passed by pointers, since the quads of a batch node aren't in the order of its children.
+ The vertices are the same as CCSprite computed them one by one, they are computed 4 at a time with SSE or NEON.
+ */
+CC_DLL void CCAffineTransformApplyToQuads(const CCAffineTransform *pTransforms, const CCRect *pRects, ccV3F_C4B_T2F_Quad **ppQuads, unsigned int count);
+
 extern CC_DLL const CCAffineTransform CCAffineTransformIdentity;
 
 NS_CC_END
@@ -23,63 +23,134 @@ THE SOFTWARE.
 ****************************************************************************/
 #include "CCAutoreleasePool.h"
 #include "ccMacros.h"
+#include <stdlib.h>
 
 NS_CC_BEGIN
 
 static CCPoolManager* s_pPoolManager = NULL;
 
 CCAutoreleasePool::CCAutoreleasePool(void)
+: m_pCurrentChunk(NULL)
+, m_pSpareChunks(NULL)
+, m_uSpareChunks(0)
+, m_uCount(0)
 {
-    m_pManagedObjectArray = new CCArray();
-    m_pManagedObjectArray->init();
 }
 
 CCAutoreleasePool::~CCAutoreleasePool(void)
 {
-    CC_SAFE_DELETE(m_pManagedObjectArray);
+    clear();
+
+    while (m_pSpareChunks)
+    {
+        ccAutoreleaseChunk *pChunk = m_pSpareChunks;
+        m_pSpareChunks = pChunk->pPrevious;
+        free(pChunk);
+    }
 }
 
 void CCAutoreleasePool::addObject(CCObject* pObject)
 {
-    m_pManagedObjectArray->addObject(pObject);
+    CCAssert(pObject->m_uReference > 0, "reference count should be greater than 0");
+
+    if (m_pCurrentChunk == NULL || m_pCurrentChunk->uCount == kCCAutoreleasePoolChunkSize)
+    {
+        ccAutoreleaseChunk *pChunk = m_pSpareChunks;
+        if (pChunk)
+        {
+            m_pSpareChunks = pChunk->pPrevious;
+            --m_uSpareChunks;
+        }
+        else
+        {
+            pChunk = (ccAutoreleaseChunk*)malloc(sizeof(ccAutoreleaseChunk));
+        }
 
-    CCAssert(pObject->m_uReference > 1, "reference count should be greater than 1");
+        pChunk->pPrevious = m_pCurrentChunk;
+        pChunk->uCount = 0;
+        m_pCurrentChunk = pChunk;
+    }
+
+    // the pool takes over the reference of the caller, clear() releases it
+    m_pCurrentChunk->pObjects[m_pCurrentChunk->uCount++] = pObject;
+    ++m_uCount;
     ++(pObject->m_uAutoReleaseCount);
-    pObject->release(); // no ref count, in this case autorelease pool added.
+
+    CC_INCREMENT_AUTORELEASES(1);
 }
 
 void CCAutoreleasePool::removeObject(CCObject* pObject)
 {
-    for (unsigned int i = 0; i < pObject->m_uAutoReleaseCount; ++i)
+    // only called for an object deleted while it is still in the pool, forget all its references
+    unsigned int uRemaining = pObject->m_uAutoReleaseCount;
+    for (ccAutoreleaseChunk *pChunk = m_pCurrentChunk; pChunk && uRemaining > 0; pChunk = pChunk->pPrevious)
     {
-        m_pManagedObjectArray->removeObject(pObject, false);
+        for (unsigned int i = pChunk->uCount; i > 0 && uRemaining > 0; --i)
+        {
+            if (pChunk->pObjects[i - 1] == pObject)
+            {
+                pChunk->pObjects[i - 1] = NULL;
+                --uRemaining;
+            }
+        }
     }
 }
 
 void CCAutoreleasePool::clear()
 {
-    if(m_pManagedObjectArray->count() > 0)
+    if (m_pCurrentChunk == NULL)
     {
-        //CCAutoreleasePool* pReleasePool;
-#ifdef _DEBUG
-        int nIndex = m_pManagedObjectArray->count() - 1;
-#endif
+        return;
+    }
 
-        CCObject* pObj = NULL;
-        CCARRAY_FOREACH_REVERSE(m_pManagedObjectArray, pObj)
+    // detach the objects, the ones deleted now may autorelease new objects in this pool
+    ccAutoreleaseChunk *pChunks = m_pCurrentChunk;
+    m_pCurrentChunk = NULL;
+    m_uCount = 0;
+
+    ccAutoreleaseChunk *pChunk = NULL;
+    unsigned int i = 0;
+
+    // update all the counts first, so the objects deleted by the release of another one don't look for themselves in the pool
+    for (pChunk = pChunks; pChunk; pChunk = pChunk->pPrevious)
+    {
+        for (i = 0; i < pChunk->uCount; ++i)
         {
-            if(!pObj)
-                break;
+            if (pChunk->pObjects[i])
+            {
+                --(pChunk->pObjects[i]->m_uAutoReleaseCount);
+            }
+        }
+    }
 
-            --(pObj->m_uAutoReleaseCount);
-            //(*it)->release();
-            //delete (*it);
-#ifdef _DEBUG
-            nIndex--;
-#endif
+    // release them, the last added first
+    for (pChunk = pChunks; pChunk; pChunk = pChunk->pPrevious)
+    {
+        for (i = pChunk->uCount; i > 0; --i)
+        {
+            if (pChunk->pObjects[i - 1])
+            {
+                pChunk->pObjects[i - 1]->release();
+            }
         }
+    }
+
+    // keep a few chunks for the next frame
+    while (pChunks)
+    {
+        pChunk = pChunks;
+        pChunks = pChunk->pPrevious;
 
-        m_pManagedObjectArray->removeAllObjects();
+        if (m_uSpareChunks < kCCAutoreleasePoolSpareChunks)
+        {
+            pChunk->pPrevious = m_pSpareChunks;
+            m_pSpareChunks = pChunk;
+            ++m_uSpareChunks;
+        }
+        else
+        {
+            free(pChunk);
+        }
     }
 }
 
@@ -34,9 +34,32 @@ NS_CC_BEGIN
  * @{
  */
 
+/** Number of objects stored in each chunk of a CCAutoreleasePool */
+#define kCCAutoreleasePoolChunkSize 1024
+
+/** Number of emptied chunks a CCAutoreleasePool keeps to reuse them */
+#define kCCAutoreleasePoolSpareChunks 8
+
+/** @brief Holds the references of the autoreleased objects until it is cleared.
+
+ The objects are appended to chunks of kCCAutoreleasePoolChunkSize pointers, so adding one is O(1) and doesn't
+ touch its reference count. clear() releases them all, the last added first, and keeps the chunks for the next frame.
+ */
 class CC_DLL CCAutoreleasePool : public CCObject
 {
-    CCArray*    m_pManagedObjectArray;    
+    typedef struct _ccAutoreleaseChunk
+    {
+        struct _ccAutoreleaseChunk  *pPrevious;
+        unsigned int                uCount;
+        CCObject                    *pObjects[kCCAutoreleasePoolChunkSize];
+    } ccAutoreleaseChunk;
+
+    // the chunk the objects are added to, linked to the full ones
+    ccAutoreleaseChunk* m_pCurrentChunk;
+    // emptied chunks, reused before allocating new ones
+    ccAutoreleaseChunk* m_pSpareChunks;
+    unsigned int        m_uSpareChunks;
+    unsigned int        m_uCount;
 public:
     CCAutoreleasePool(void);
     ~CCAutoreleasePool(void);
@@ -45,6 +68,9 @@ public:
     void removeObject(CCObject *pObject);
 
     void clear();
+
+    /** number of objects added since the pool was last cleared */
+    unsigned int count() { return m_uCount; }
 };
 
 class CC_DLL CCPoolManager
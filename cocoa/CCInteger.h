@@ -2,6 +2,7 @@
 #define __CCINTEGER_H__
 
 #include "CCObject.h"
+#include "CCObjectPool.h"
 
 NS_CC_BEGIN
 
@@ -29,6 +30,8 @@ public:
 
 private:
     int m_nValue;
+
+    CC_DECLARE_OBJECT_POOL(CCInteger)
 };
 
 // end of data_structure group
@@ -0,0 +1,176 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "CCObjectPool.h"
+#include "CCInteger.h"
+#include "ccMacros.h"
+#include <stdlib.h>
+
+NS_CC_BEGIN
+
+// the slots are aligned for any type the objects may contain
+#define CC_OBJECT_POOL_ALIGNMENT 16
+
+static CCObjectPool *s_pFirstPool = NULL;
+
+// CCInteger is declared in its header only
+CC_IMPLEMENT_OBJECT_POOL(CCInteger)
+
+CCObjectPool::CCObjectPool(const char *pszName, size_t uObjectSize)
+: m_pszName(pszName)
+, m_pFreeList(NULL)
+, m_pSlabs(NULL)
+, m_uLiveObjects(0)
+, m_uPeakObjects(0)
+, m_uTotalAllocations(0)
+, m_uFallbackAllocations(0)
+, m_uSlabs(0)
+{
+    m_uSlotSize = (uObjectSize + CC_OBJECT_POOL_ALIGNMENT - 1) & ~(size_t)(CC_OBJECT_POOL_ALIGNMENT - 1);
+    pthread_mutex_init(&m_mutex, NULL);
+
+    m_pNext = s_pFirstPool;
+    s_pFirstPool = this;
+}
+
+CCObjectPool::~CCObjectPool()
+{
+    CCObjectPool **ppPool = &s_pFirstPool;
+    while (*ppPool != this)
+    {
+        ppPool = &(*ppPool)->m_pNext;
+    }
+    *ppPool = m_pNext;
+
+    while (m_pSlabs)
+    {
+        void *pSlab = m_pSlabs;
+        m_pSlabs = *(void**)pSlab;
+        free(pSlab);
+    }
+
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool CCObjectPool::addSlab()
+{
+    char *pSlab = (char*)malloc(CC_OBJECT_POOL_ALIGNMENT + m_uSlotSize * kCCObjectPoolSlabObjects);
+    if (! pSlab)
+    {
+        return false;
+    }
+
+    *(void**)pSlab = m_pSlabs;
+    m_pSlabs = pSlab;
+    ++m_uSlabs;
+
+    // chain the slots in memory order, the first one at the head of the free list
+    char *pSlot = pSlab + CC_OBJECT_POOL_ALIGNMENT + m_uSlotSize * (kCCObjectPoolSlabObjects - 1);
+    for (unsigned int i = 0; i < kCCObjectPoolSlabObjects; ++i, pSlot -= m_uSlotSize)
+    {
+        *(void**)pSlot = m_pFreeList;
+        m_pFreeList = pSlot;
+    }
+
+    return true;
+}
+
+void* CCObjectPool::allocate(size_t uSize)
+{
+    if (uSize > m_uSlotSize)
+    {
+        pthread_mutex_lock(&m_mutex);
+        ++m_uFallbackAllocations;
+        pthread_mutex_unlock(&m_mutex);
+        return malloc(uSize);
+    }
+
+    void *ptr = NULL;
+
+    pthread_mutex_lock(&m_mutex);
+    if (m_pFreeList || addSlab())
+    {
+        ptr = m_pFreeList;
+        m_pFreeList = *(void**)ptr;
+
+        ++m_uTotalAllocations;
+        ++m_uLiveObjects;
+        m_uPeakObjects = MAX(m_uPeakObjects, m_uLiveObjects);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    return ptr;
+}
+
+void* CCObjectPool::allocateObject(size_t uSize)
+{
+    void *ptr = allocate(uSize);
+    if (! ptr)
+    {
+#if defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+        throw std::bad_alloc();
+#else
+        CCLOGERROR("cocos2d: \"%s\" pool: out of memory", m_pszName);
+        abort();
+#endif
+    }
+    return ptr;
+}
+
+void CCObjectPool::deallocate(void *ptr, size_t uSize)
+{
+    if (! ptr)
+    {
+        return;
+    }
+
+    if (uSize > m_uSlotSize)
+    {
+        free(ptr);
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    *(void**)ptr = m_pFreeList;
+    m_pFreeList = ptr;
+    --m_uLiveObjects;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void CCObjectPool::dumpAllPools()
+{
+    for (CCObjectPool *pPool = s_pFirstPool; pPool; pPool = pPool->m_pNext)
+    {
+        CCLOG("cocos2d: \"%s\" pool: live=%u peak=%u allocations=%u fallbacks=%u slabs=%u (%lu KB)",
+               pPool->m_pszName,
+               pPool->m_uLiveObjects,
+               pPool->m_uPeakObjects,
+               pPool->m_uTotalAllocations,
+               pPool->m_uFallbackAllocations,
+               pPool->m_uSlabs,
+               (long)(pPool->m_uSlabs * (CC_OBJECT_POOL_ALIGNMENT + pPool->m_uSlotSize * kCCObjectPoolSlabObjects) / 1024));
+    }
+}
+
+NS_CC_END
@@ -0,0 +1,153 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CCOBJECT_POOL_H__
+#define __CCOBJECT_POOL_H__
+
+#include "platform/CCPlatformMacros.h"
+#include "ccConfig.h"
+#include <stddef.h>
+#include <new>
+#include <pthread.h>
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup data_structures
+ * @{
+ */
+
+/** Number of objects allocated at once by a CCObjectPool */
+#define kCCObjectPoolSlabObjects 64
+
+/** @brief Allocator of the objects of one type.
+ 
+ The memory is taken from the system by slabs of kCCObjectPoolSlabObjects objects, and the freed objects are
+ kept in a free list to be reused, so the objects created and released every frame (actions, strings, touches)
+ don't go through malloc. The slabs are never given back to the system.
+ Objects bigger than the pool's slots (instances of a subclass that doesn't have its own pool) use malloc.
+
+ The pools are declared in the classes with CC_DECLARE_OBJECT_POOL and defined with CC_IMPLEMENT_OBJECT_POOL.
+ They are disabled if CC_ENABLE_OBJECT_POOLS is 0.
+ */
+class CC_DLL CCObjectPool
+{
+public:
+    CCObjectPool(const char *pszName, size_t uObjectSize);
+    ~CCObjectPool();
+
+    /** returns NULL if the memory is exhausted */
+    void* allocate(size_t uSize);
+    void deallocate(void *ptr, size_t uSize);
+
+    /** same as allocate(), for operator new: throws std::bad_alloc, or aborts if the exceptions are disabled */
+    void* allocateObject(size_t uSize);
+
+    const char* getName() { return m_pszName; }
+
+    /** number of objects allocated and not freed yet */
+    unsigned int getLiveObjects() { return m_uLiveObjects; }
+
+    /** maximum number of objects alive at the same time */
+    unsigned int getPeakObjects() { return m_uPeakObjects; }
+
+    /** number of objects allocated since the pool was created */
+    unsigned int getTotalAllocations() { return m_uTotalAllocations; }
+
+    /** number of objects too big for the pool, allocated with malloc */
+    unsigned int getFallbackAllocations() { return m_uFallbackAllocations; }
+
+    /** number of slabs taken from the system */
+    unsigned int getSlabs() { return m_uSlabs; }
+
+    /** Output to CCLOG the statistics of all the pools */
+    static void dumpAllPools();
+
+private:
+    bool addSlab();
+
+    const char *m_pszName;
+    size_t m_uSlotSize;
+    // the first word of a free slot points to the next free slot
+    void *m_pFreeList;
+    // the first word of a slab points to the previous slab
+    void *m_pSlabs;
+    pthread_mutex_t m_mutex;
+
+    unsigned int m_uLiveObjects;
+    unsigned int m_uPeakObjects;
+    unsigned int m_uTotalAllocations;
+    unsigned int m_uFallbackAllocations;
+    unsigned int m_uSlabs;
+
+    // all the pools, for dumpAllPools()
+    CCObjectPool *m_pNext;
+};
+
+#if CC_ENABLE_OBJECT_POOLS
+
+/** declares the pool of a class, and its operator new and delete. Put it at the end of the class declaration.
+ The placement and nothrow forms are declared too, since the class operator new hides the global ones.
+ The nothrow delete is only called if a constructor throws, without the size: it assumes an object of __TYPE__.
+ */
+#define CC_DECLARE_OBJECT_POOL(__TYPE__) \
+public: \
+    static void* operator new(size_t uSize) { return __TYPE__::objectPool()->allocateObject(uSize); } \
+    static void operator delete(void *ptr, size_t uSize) { __TYPE__::objectPool()->deallocate(ptr, uSize); } \
+    static void* operator new(size_t uSize, const std::nothrow_t&) { return __TYPE__::objectPool()->allocate(uSize); } \
+    static void operator delete(void *ptr, const std::nothrow_t&) { __TYPE__::objectPool()->deallocate(ptr, sizeof(__TYPE__)); } \
+    static void* operator new(size_t uSize, void *ptr) { return ptr; } \
+    static void operator delete(void *ptr, void *place) {} \
+    static cocos2d::CCObjectPool* objectPool();
+
+/** defines the pool of a class declared with CC_DECLARE_OBJECT_POOL. Put it in the .cpp of the class.
+ The pool is created while the statics are initialized, before any thread can be started, or by the
+ first object created by an earlier static initializer. It is never deleted, objects can be released
+ until the very end of the program.
+ */
+#define CC_IMPLEMENT_OBJECT_POOL(__TYPE__) \
+static cocos2d::CCObjectPool *s_p##__TYPE__##Pool = NULL; \
+cocos2d::CCObjectPool* __TYPE__::objectPool() \
+{ \
+    if (! s_p##__TYPE__##Pool) \
+    { \
+        s_p##__TYPE__##Pool = new cocos2d::CCObjectPool(#__TYPE__, sizeof(__TYPE__)); \
+    } \
+    return s_p##__TYPE__##Pool; \
+} \
+static cocos2d::CCObjectPool *s_p##__TYPE__##PoolCreated = __TYPE__::objectPool();
+
+#else
+
+#define CC_DECLARE_OBJECT_POOL(__TYPE__)
+#define CC_IMPLEMENT_OBJECT_POOL(__TYPE__)
+
+#endif // CC_ENABLE_OBJECT_POOLS
+
+// end of data_structures group
+/// @}
+
+NS_CC_END
+
+#endif // __CCOBJECT_POOL_H__
@@ -6,6 +6,8 @@
 
 NS_CC_BEGIN
 
+CC_IMPLEMENT_OBJECT_POOL(CCString)
+
 #define kMaxStringLen (1024*100)
 
 CCString::CCString()
@@ -32,6 +32,7 @@ THE SOFTWARE.
 #include <string>
 #include <functional>
 #include "CCObject.h"
+#include "CCObjectPool.h"
 
 NS_CC_BEGIN
 
@@ -143,6 +144,8 @@ private:
 
 public:
     std::string m_sString;
+
+    CC_DECLARE_OBJECT_POOL(CCString)
 };
 
 struct CCStringCompare : public std::binary_function<CCString *, CCString *, bool> {
@@ -189,7 +189,10 @@ void CCDrawNode::render()
     if (m_bDirty)
     {
         glBindBuffer(GL_ARRAY_BUFFER, m_uVbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(ccV2F_C4B_T2F)*m_uBufferCapacity, m_pBuffer, GL_STREAM_DRAW);
+        // Always new storage, since m_pBuffer may have grown since the last upload. It's the size of the whole
+        // buffer, so the driver can recycle it, but only the vertices that are drawn are copied.
+        glBufferData(GL_ARRAY_BUFFER, sizeof(ccV2F_C4B_T2F)*m_uBufferCapacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(ccV2F_C4B_T2F)*m_nBufferCount, m_pBuffer);
         m_bDirty = false;
     }
 #if CC_TEXTURE_ATLAS_USE_VAO     
@@ -25,6 +25,7 @@ THE SOFTWARE.
 #include "ccMacros.h"
 #include "effects/CCGrid.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "effects/CCGrabber.h"
 #include "support/ccUtils.h"
 #include "shaders/CCGLProgram.h"
@@ -201,6 +202,8 @@ void CCGridBase::beforeDraw(void)
 {
     // save projection
     CCDirector *director = CCDirector::sharedDirector();
+    // what was recorded before belongs to the screen, not to the grabbed texture
+    director->getRenderer()->flush();
     m_directorProjection = director->getProjection();
 
     // 2d projection
@@ -211,6 +214,7 @@ void CCGridBase::beforeDraw(void)
 
 void CCGridBase::afterDraw(cocos2d::CCNode *pTarget)
 {
+    CCDirector::sharedDirector()->getRenderer()->flush();
     m_pGrabber->afterRender(m_pTexture);
 
     // restore projection
@@ -191,6 +191,132 @@ Only valid for cocos2d-mac. Not supported on cocos2d-ios.
 #endif
 
 
+/** @def CC_USE_VBO_ORPHANING
+ If enabled, the vertex buffers that are rewritten every frame (CCTextureAtlas, CCParticleSystemQuad and CCRenderer)
+ are orphaned before they are updated: glBufferData() with NULL gives the buffer new storage, so the driver doesn't
+ have to wait until the GPU has finished the draws that still read the previous contents.
+ Only the quads that are going to be drawn are uploaded. CCTextureAtlas still updates small dirty ranges in place.
+
+ To disable it set it to 0. Enabled by default.
+ */
+#ifndef CC_USE_VBO_ORPHANING
+#define CC_USE_VBO_ORPHANING 1
+#endif
+
+/** @def CC_ENABLE_PROGRAM_BINARY_CACHE
+ If enabled, CCShaderCache saves the binaries of the default shader programs in the writable path, and loads them
+ with glProgramBinary() at the next launch or after the GL context is lost instead of compiling the shaders again.
+ A binary is used only if it was made from the same sources by the same driver, otherwise the program is compiled and saved again.
+ Only supported by the drivers having GL_OES_get_program_binary or GL_ARB_get_program_binary, on Android, Linux and Win32.
+
+ To disable it set it to 0. Enabled by default.
+ */
+#ifndef CC_ENABLE_PROGRAM_BINARY_CACHE
+#define CC_ENABLE_PROGRAM_BINARY_CACHE 1
+#endif
+
+/** @def CC_ENABLE_AUTO_BATCHING
+ If enabled, CCSprite, CCLabelBMFont and CCParticleSystemQuad record their quads in the director's CCRenderer
+ instead of drawing them, and consecutive quads that share the same texture, shader program and blend function
+ are drawn with a single draw call.
+ It can also be changed at runtime with CCRenderer::setBatchingEnabled().
+
+ To disable it set it to 0. Enabled by default.
+ */
+#ifndef CC_ENABLE_AUTO_BATCHING
+#define CC_ENABLE_AUTO_BATCHING 1
+#endif
+
+/** @def CC_TEXTURE_ASYNC_LOADING_THREADS
+ Number of threads used by CCTextureCache::addImageAsync() to decode the images.
+ It can also be changed with CCTextureCache::setAsyncLoadingThreads() before the first asynchronous load.
+
+ 2 by default.
+ */
+#ifndef CC_TEXTURE_ASYNC_LOADING_THREADS
+#define CC_TEXTURE_ASYNC_LOADING_THREADS 2
+#endif
+
+/** @def CC_TEXTURE_ASYNC_UPLOAD_BUDGET
+ Time, in milliseconds, CCTextureCache spends every frame creating the textures of the images decoded by
+ CCTextureCache::addImageAsync(). At least one texture is created every frame, whatever the budget is.
+ It can also be changed with CCTextureCache::setAsyncUploadBudget().
+
+ 4 by default.
+ */
+#ifndef CC_TEXTURE_ASYNC_UPLOAD_BUDGET
+#define CC_TEXTURE_ASYNC_UPLOAD_BUDGET 4
+#endif
+
+/** @def CC_TEXTURE_INCREMENTAL_UPLOAD_PIXELS
+ The images loaded by CCTextureCache::addImageAsync() with at least this number of pixels are not uploaded
+ with a single glTexImage2D: CCTextureCache uploads them a few rows every frame with glTexSubImage2D,
+ and the callback is called when the texture is ready.
+ It can also be changed with CCTextureCache::setIncrementalUploadPixels().
+
+ To disable it set it to 0. 512 x 512 by default.
+ */
+#ifndef CC_TEXTURE_INCREMENTAL_UPLOAD_PIXELS
+#define CC_TEXTURE_INCREMENTAL_UPLOAD_PIXELS (512 * 512)
+#endif
+
+/** @def CC_TEXTURE_INCREMENTAL_UPLOAD_BUDGET
+ Time, in milliseconds, CCTextureCache spends every frame uploading the rows of the textures that are uploaded
+ incrementally. At least one strip of rows is uploaded every frame, whatever the budget is.
+ It can also be changed with CCTextureCache::setIncrementalUploadBudget().
+
+ 2 by default.
+ */
+#ifndef CC_TEXTURE_INCREMENTAL_UPLOAD_BUDGET
+#define CC_TEXTURE_INCREMENTAL_UPLOAD_BUDGET 2
+#endif
+
+/** @def CC_ENABLE_OBJECT_POOLS
+ If enabled, the objects created and released many times per frame (CCString, CCInteger, CCTouch,
+ CCSequence, CCMoveBy, CCMoveTo, CCDelayTime, CCCallFunc, CCCallFuncN) are allocated from a pool per class
+ instead of malloc. See CCObjectPool.
+
+ To disable it set it to 0. Enabled by default.
+ */
+#ifndef CC_ENABLE_OBJECT_POOLS
+#define CC_ENABLE_OBJECT_POOLS 1
+#endif
+
+/** @def CC_USE_PARTICLE_SIMD
+ If enabled, CCParticleSystem integrates its particles 4 at a time with SSE or NEON instructions,
+ when the compiler targets them. Otherwise, or if it is disabled, plain C loops are used.
+
+ To disable it set it to 0. Enabled by default.
+ */
+#ifndef CC_USE_PARTICLE_SIMD
+#define CC_USE_PARTICLE_SIMD 1
+#endif
+
+/** @def CC_PARTICLE_SIMULATION_THREADS
+ Number of worker threads CCParticleSimulator updates the particle systems on, when it is enabled.
+ The main thread updates systems too. It can also be changed with CCParticleSimulator::setThreads().
+
+ 2 by default.
+ */
+#ifndef CC_PARTICLE_SIMULATION_THREADS
+#define CC_PARTICLE_SIMULATION_THREADS 2
+#endif
+
+/** @def CC_TMX_LAYER_CHUNK_SIZE
+ If not 0, the orthogonal CCTMXLayer objects are built in square chunks of that many tiles per side,
+ and only the chunks near the screen have quads. A layer can choose its own size with its
+ "cc_chunk_size" property, 0 building the whole layer at once.
+ The layers whose tiles are bigger than the tiles of the map are always built at once: the quads of the chunks aren't
+ in the order of the tiles, and the overlapping tiles would be drawn in the wrong order.
+ CCTMXLayer::tileAt() and CCTMXLayer::releaseMap() assert on the chunked layers, so only enable it
+ for the games that don't use them.
+
+ 0 (disabled) by default.
+ */
+#ifndef CC_TMX_LAYER_CHUNK_SIZE
+#define CC_TMX_LAYER_CHUNK_SIZE 0
+#endif
+
 /** @def CC_USE_LA88_LABELS
  If enabled, it will use LA88 (Luminance Alpha 16-bit textures) for CCLabelTTF objects.
  If it is disabled, it will use A8 (Alpha 8-bit textures).
@@ -70,6 +70,16 @@ simple macro that swaps 2 variables
  */
 #define CCRANDOM_0_1() ((float)rand()/RAND_MAX)
 
+/** @def CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL
+ rounds a coordinate of a quad drawn by a CCSpriteBatchNode up to an integer pixel,
+ unless CC_SPRITEBATCHNODE_RENDER_SUBPIXEL is enabled
+ */
+#if CC_SPRITEBATCHNODE_RENDER_SUBPIXEL
+#define CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(__ARGS__) (__ARGS__)
+#else
+#define CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(__ARGS__) (ceil(__ARGS__))
+#endif
+
 /** @def CC_DEGREES_TO_RADIANS
  converts degrees to radians
  */
@@ -248,6 +258,34 @@ It should work same as apples CFSwapInt32LittleToHost(..)
 extern unsigned int CC_DLL g_uNumberOfDraws;
 #define CC_INCREMENT_GL_DRAWS(__n__) g_uNumberOfDraws += __n__
 
+/** @def CC_INCREMENT_TRANSFORMS
+ Increments the count of model-view matrices recomputed by CCNode::transform().
+ The number of matrices recomputed per frame is displayed on the screen when the CCDirector's stats are enabled.
+ */
+extern unsigned int CC_DLL g_uNumberOfTransforms;
+#define CC_INCREMENT_TRANSFORMS(__n__) g_uNumberOfTransforms += __n__
+
+/** @def CC_INCREMENT_AUTORELEASES
+ Increments the count of objects added to the autorelease pool.
+ The number of objects autoreleased per frame is displayed on the screen when the CCDirector's stats are enabled.
+ */
+extern unsigned int CC_DLL g_uNumberOfAutoreleases;
+#define CC_INCREMENT_AUTORELEASES(__n__) g_uNumberOfAutoreleases += __n__
+
+/** @def CC_INCREMENT_UNIFORM_UPLOADS
+ Increments the count of glUniform calls issued by CCGLProgram.
+ The number of uniforms uploaded per frame is displayed on the screen when the CCDirector's stats are enabled.
+ */
+extern unsigned int CC_DLL g_uNumberOfUniformUploads;
+#define CC_INCREMENT_UNIFORM_UPLOADS(__n__) g_uNumberOfUniformUploads += __n__
+
+/** @def CC_INCREMENT_SKIPPED_UNIFORMS
+ Increments the count of glUniform calls skipped by CCGLProgram, because the uniform already had the value.
+ The number of uniforms skipped per frame is displayed on the screen when the CCDirector's stats are enabled.
+ */
+extern unsigned int CC_DLL g_uNumberOfSkippedUniforms;
+#define CC_INCREMENT_SKIPPED_UNIFORMS(__n__) g_uNumberOfSkippedUniforms += __n__
+
 /*******************/
 /** Notifications **/
 /*******************/
@@ -59,6 +59,7 @@ THE SOFTWARE.
 #include "cocoa/CCAffineTransform.h"
 #include "cocoa/CCDictionary.h"
 #include "cocoa/CCObject.h"
+#include "cocoa/CCObjectPool.h"
 #include "cocoa/CCArray.h"
 #include "cocoa/CCGeometry.h"
 #include "cocoa/CCSet.h"
@@ -121,11 +122,14 @@ THE SOFTWARE.
 #include "particle_nodes/CCParticleSystem.h"
 #include "particle_nodes/CCParticleExamples.h"
 #include "particle_nodes/CCParticleSystemQuad.h"
+#include "particle_nodes/CCParticleSimulator.h"
 
 // platform
 #include "platform/CCDevice.h"
 #include "platform/CCCommon.h"
 #include "platform/CCFileUtils.h"
+#include "platform/CCFileData.h"
+#include "platform/CCAssetBundle.h"
 #include "platform/CCImage.h"
 #include "platform/CCSAXParser.h"
 #include "platform/CCThread.h"
@@ -270,6 +274,7 @@ THE SOFTWARE.
 #include "CCCamera.h"
 #include "CCConfiguration.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "CCScheduler.h"
 
 // component
@@ -28,11 +28,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../mat4.h"
 
+//64 bits, so that the versions never wrap: a program or a node that keeps an old version can't see it come back
+typedef unsigned long long km_mat4_version;
+
 typedef struct km_mat4_stack {
     int capacity; //The total item capacity
     int item_count; //The number of items
     kmMat4* top;
     kmMat4* stack;
+    km_mat4_version* top_version; //The version of the top item
+    km_mat4_version* versions; //The version of each item: it changes with the item, and is unique to its value
+    int heap; //Whether stack and versions were allocated, or are given by the owner of the stack
 } km_mat4_stack;
 
 #ifdef __cplusplus
@@ -41,8 +47,11 @@ extern "C" {
 
 void km_mat4_stack_initialize(km_mat4_stack* stack);
 void km_mat4_stack_push(km_mat4_stack* stack, const kmMat4* item);
+void km_mat4_stack_push_top(km_mat4_stack* stack);
 void km_mat4_stack_pop(km_mat4_stack* stack, kmMat4* pOut);
+void km_mat4_stack_top_changed(km_mat4_stack* stack);
 void km_mat4_stack_release(km_mat4_stack* stack);
+km_mat4_version km_mat4_stack_new_version(void);
 
 #ifdef __cplusplus
 }
@@ -36,6 +36,7 @@ typedef unsigned int kmGLEnum;
 
 #include "../mat4.h"
 #include "../vec3.h"
+#include "mat4stack.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,6 +54,21 @@ void CC_DLL kmGLRotatef(float angle, float x, float y, float z);
 void CC_DLL kmGLScalef(float x, float y, float z);
 void CC_DLL kmGLGetMatrix(kmGLEnum mode, kmMat4* pOut);
 
+/* The matrix on top of the stack of mode, without copying it. It is valid until the stack is pushed */
+CC_DLL const kmMat4* kmGLGetTopMatrix(kmGLEnum mode);
+
+/* A number that changes every time the matrix on top of the stack of mode changes.
+   kmGLPushMatrix() keeps it and kmGLPopMatrix() restores the one of the previous matrix,
+   so two equal versions of a stack mean equal matrices. */
+km_mat4_version CC_DLL kmGLGetMatrixVersion(kmGLEnum mode);
+
+/* Replaces the top of the current stack with pIn and gives it version, which the caller keeps with its own copy
+   of pIn while it doesn't change. A version of 0 asks for a new one. Returns the version of the new top. */
+km_mat4_version CC_DLL kmGLLoadMatrixWithVersion(const kmMat4* pIn, km_mat4_version version);
+
+/* projection x modelview, only computed again after one of them changed */
+CC_DLL const kmMat4* kmGLGetMVPMatrix(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,69 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __SSE_MATRIX_IMPL_H__
+#define __SSE_MATRIX_IMPL_H__
+
+// SSE versions of the hot kazmath functions, used by mat4.c, vec2.c and vec3.c on x86.
+// They are selected at compile time: SSE is part of every x86-64 target, so they are always used there.
+// Define KM_NO_SSE to build the scalar versions instead.
+// kmMat4Multiply and kmMat4Transpose have no SSE version: the compilers vectorize the scalar code as well.
+//
+// The transforms add the products in the same order as the scalar versions and don't fuse them,
+// so their results are the same to the bit, as long as the compiler isn't allowed to fuse them (-mfma). The inverse uses the cofactors instead of the Gauss-Jordan elimination
+// of kmMat4Inverse, its results differ in the last bits.
+
+#if !defined(KM_NO_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define KM_USE_SSE 1
+#else
+#define KM_USE_SSE 0
+#endif
+
+#if KM_USE_SSE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Matrices are assumed to be stored in column major format according to OpenGL
+// specification. None of the pointers has to be aligned.
+
+// Inverts a 4x4 matrix (m) into (output), which can be m. Returns 0 and doesn't touch output if m can't be inverted
+int SSE_Matrix4Inverse(const float* m, float* output);
+
+// Transforms count vectors 3 (v, packed x,y,z), assuming w=1, by a 4x4 matrix (m), outputting count vectors 3.
+// output can be v
+void SSE_Matrix4Vector3TransformArray(const float* m, const float* v, float* output, unsigned int count);
+
+// Transforms count vectors 2 (v, packed x,y), assuming w=1, by a 3x3 matrix (m), outputting count vectors 2.
+// output can be v
+void SSE_Matrix3Vector2TransformArray(const float* m, const float* v, float* output, unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KM_USE_SSE
+
+#endif // __SSE_MATRIX_IMPL_H__
@@ -28,34 +28,84 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <assert.h>
 #include <stdio.h>
 
-#define INITIAL_SIZE 30
-#define INCREMENT 50
+#define INITIAL_SIZE 32
 
 #include "kazmath/GL/mat4stack.h"
 
+static km_mat4_version last_version = 0;
+
+km_mat4_version km_mat4_stack_new_version(void)
+{
+    return ++last_version;
+}
+
 void km_mat4_stack_initialize(km_mat4_stack* stack) {
     stack->stack = (kmMat4*) malloc(sizeof(kmMat4) * INITIAL_SIZE); //allocate the memory
-    stack->capacity = INITIAL_SIZE; //Set the capacity to 10
+    stack->versions = (km_mat4_version*) malloc(sizeof(km_mat4_version) * INITIAL_SIZE);
+    stack->capacity = INITIAL_SIZE;
     stack->top = NULL; //Set the top to NULL
+    stack->top_version = NULL;
     stack->item_count = 0;
+    stack->heap = 1;
 };
 
+//Doubles the capacity, so that deep trees of nodes only grow the stack a few times
+static void km_mat4_stack_grow(km_mat4_stack* stack)
+{
+    int capacity = stack->capacity * 2;
+
+    if (stack->heap) {
+        stack->stack = (kmMat4*) realloc(stack->stack, capacity * sizeof(kmMat4));
+        stack->versions = (km_mat4_version*) realloc(stack->versions, capacity * sizeof(km_mat4_version));
+    } else {
+        kmMat4* matrices = (kmMat4*) malloc(capacity * sizeof(kmMat4));
+        km_mat4_version* versions = (km_mat4_version*) malloc(capacity * sizeof(km_mat4_version));
+        memcpy(matrices, stack->stack, stack->item_count * sizeof(kmMat4));
+        memcpy(versions, stack->versions, stack->item_count * sizeof(km_mat4_version));
+        stack->stack = matrices;
+        stack->versions = versions;
+        stack->heap = 1;
+    }
+    stack->capacity = capacity;
+
+    if (stack->item_count) {
+        stack->top = &stack->stack[stack->item_count - 1];
+        stack->top_version = &stack->versions[stack->item_count - 1];
+    }
+}
+
 void km_mat4_stack_push(km_mat4_stack* stack, const kmMat4* item)
 {
+    kmMat4 copy;
+
+    if (stack->item_count == stack->capacity) {
+        //item may be in the stack, which is going to move
+        memcpy(&copy, item, sizeof(kmMat4));
+        item = &copy;
+        km_mat4_stack_grow(stack);
+    }
+
     stack->top = &stack->stack[stack->item_count];
-    kmMat4Assign(stack->top, item);
+    stack->top_version = &stack->versions[stack->item_count];
+    memcpy(stack->top, item, sizeof(kmMat4));
+    *stack->top_version = km_mat4_stack_new_version();
     stack->item_count++;
+}
 
-    if(stack->item_count >= stack->capacity)
-    {
-        kmMat4* temp = NULL;
-        stack->capacity += INCREMENT;
-        temp = stack->stack;
-        stack->stack = (kmMat4*) malloc(stack->capacity*sizeof(kmMat4));
-        memcpy(stack->stack, temp, sizeof(kmMat4)*(stack->capacity - INCREMENT));
-        free(temp);
-        stack->top = &stack->stack[stack->item_count - 1];
+void km_mat4_stack_push_top(km_mat4_stack* stack)
+{
+    assert(stack->item_count && "Cannot duplicate the top of an empty stack");
+
+    if (stack->item_count == stack->capacity) {
+        km_mat4_stack_grow(stack);
     }
+
+    //Same matrix, same version
+    memcpy(stack->top + 1, stack->top, sizeof(kmMat4));
+    stack->top_version[1] = stack->top_version[0];
+    stack->top++;
+    stack->top_version++;
+    stack->item_count++;
 }
 
 void km_mat4_stack_pop(km_mat4_stack* stack, kmMat4* pOut)
@@ -64,11 +114,24 @@ void km_mat4_stack_pop(km_mat4_stack* stack, kmMat4* pOut)
 
     stack->item_count--;
     stack->top = &stack->stack[stack->item_count - 1];
+    stack->top_version = &stack->versions[stack->item_count - 1];
+}
+
+void km_mat4_stack_top_changed(km_mat4_stack* stack)
+{
+    *stack->top_version = km_mat4_stack_new_version();
 }
 
 void km_mat4_stack_release(km_mat4_stack* stack) {
-    free(stack->stack);
+    if (stack->heap) {
+        free(stack->stack);
+        free(stack->versions);
+    }
+    stack->stack = NULL;
+    stack->versions = NULL;
     stack->top = NULL;
+    stack->top_version = NULL;
     stack->item_count = 0;
     stack->capacity = 0;
+    stack->heap = 1;
 }
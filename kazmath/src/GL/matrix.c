@@ -25,136 +25,156 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 
 #include "kazmath/GL/matrix.h"
 #include "kazmath/GL/mat4stack.h"
 
-km_mat4_stack modelview_matrix_stack;
-km_mat4_stack projection_matrix_stack;
-km_mat4_stack texture_matrix_stack;
+#define KM_GL_STACK_INITIAL_SIZE 32
 
-km_mat4_stack* current_stack = NULL;
+#define KM_GL_IDENTITY { { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } }
 
-static unsigned char initialized = 0;
+//The stacks start in static storage with the identity on top, version 0: there is nothing to initialize,
+//and they are only allocated if a tree of nodes is deeper than KM_GL_STACK_INITIAL_SIZE
+static kmMat4 modelview_matrices[KM_GL_STACK_INITIAL_SIZE] = { KM_GL_IDENTITY };
+static kmMat4 projection_matrices[KM_GL_STACK_INITIAL_SIZE] = { KM_GL_IDENTITY };
+static kmMat4 texture_matrices[KM_GL_STACK_INITIAL_SIZE] = { KM_GL_IDENTITY };
+static km_mat4_version modelview_versions[KM_GL_STACK_INITIAL_SIZE];
+static km_mat4_version projection_versions[KM_GL_STACK_INITIAL_SIZE];
+static km_mat4_version texture_versions[KM_GL_STACK_INITIAL_SIZE];
 
-void lazyInitialize()
-{
-
-    if (!initialized) {
-        kmMat4 identity; //Temporary identity matrix
-
-        //Initialize all 3 stacks
-        //modelview_matrix_stack = (km_mat4_stack*) malloc(sizeof(km_mat4_stack));
-        km_mat4_stack_initialize(&modelview_matrix_stack);
-
-        //projection_matrix_stack = (km_mat4_stack*) malloc(sizeof(km_mat4_stack));
-        km_mat4_stack_initialize(&projection_matrix_stack);
-
-        //texture_matrix_stack = (km_mat4_stack*) malloc(sizeof(km_mat4_stack));
-        km_mat4_stack_initialize(&texture_matrix_stack);
-
-        current_stack = &modelview_matrix_stack;
-        initialized = 1;
+km_mat4_stack modelview_matrix_stack = { KM_GL_STACK_INITIAL_SIZE, 1, modelview_matrices, modelview_matrices, modelview_versions, modelview_versions, 0 };
+km_mat4_stack projection_matrix_stack = { KM_GL_STACK_INITIAL_SIZE, 1, projection_matrices, projection_matrices, projection_versions, projection_versions, 0 };
+km_mat4_stack texture_matrix_stack = { KM_GL_STACK_INITIAL_SIZE, 1, texture_matrices, texture_matrices, texture_versions, texture_versions, 0 };
 
-        kmMat4Identity(&identity);
+km_mat4_stack* current_stack = &modelview_matrix_stack;
 
-        //Make sure that each stack has the identity matrix
-        km_mat4_stack_push(&modelview_matrix_stack, &identity);
-        km_mat4_stack_push(&projection_matrix_stack, &identity);
-        km_mat4_stack_push(&texture_matrix_stack, &identity);
-    }
-}
+//projection x modelview, computed from the versions of the matrices
+static kmMat4 mvp_matrix = KM_GL_IDENTITY;
+static km_mat4_version mvp_projection_version = 0;
+static km_mat4_version mvp_modelview_version = 0;
 
-void kmGLMatrixMode(kmGLEnum mode)
+static km_mat4_stack* stackForMode(kmGLEnum mode)
 {
-    lazyInitialize();
-
     switch(mode)
     {
         case KM_GL_MODELVIEW:
-            current_stack = &modelview_matrix_stack;
-        break;
+            return &modelview_matrix_stack;
         case KM_GL_PROJECTION:
-            current_stack = &projection_matrix_stack;
-        break;
+            return &projection_matrix_stack;
         case KM_GL_TEXTURE:
-            current_stack = &texture_matrix_stack;
-        break;
+            return &texture_matrix_stack;
         default:
             assert(0 && "Invalid matrix mode specified"); //TODO: Proper error handling
-        break;
+            return &modelview_matrix_stack;
     }
 }
 
-void kmGLPushMatrix(void)
+static void resetStack(km_mat4_stack* stack, kmMat4* matrices, km_mat4_version* versions)
 {
-    kmMat4 top;
+    km_mat4_stack_release(stack);
 
-    lazyInitialize(); //Initialize the stacks if they haven't been already
+    stack->capacity = KM_GL_STACK_INITIAL_SIZE;
+    stack->item_count = 1;
+    stack->top = stack->stack = matrices;
+    stack->top_version = stack->versions = versions;
+    stack->heap = 0;
 
-    //Duplicate the top of the stack (i.e the current matrix)
-    kmMat4Assign(&top, current_stack->top);
-    km_mat4_stack_push(current_stack, &top);
+    kmMat4Identity(stack->top);
+    km_mat4_stack_top_changed(stack);
+}
+
+void kmGLMatrixMode(kmGLEnum mode)
+{
+    current_stack = stackForMode(mode);
+}
+
+void kmGLPushMatrix(void)
+{
+    //Duplicate the top of the stack (i.e the current matrix), it keeps its version
+    km_mat4_stack_push_top(current_stack);
 }
 
 void kmGLPopMatrix(void)
 {
-    assert(initialized && "Cannot Pop empty matrix stack");
-    //No need to lazy initialize, you shouldn't be popping first anyway!
     km_mat4_stack_pop(current_stack, NULL);
 }
 
 void kmGLLoadIdentity()
 {
-    lazyInitialize();
-
-    kmMat4Identity(current_stack->top); //Replace the top matrix with the identity matrix
+    if (!kmMat4IsIdentity(current_stack->top)) {
+        kmMat4Identity(current_stack->top); //Replace the top matrix with the identity matrix
+        km_mat4_stack_top_changed(current_stack);
+    }
 }
 
 void kmGLFreeAll()
 {
-    //Clear the matrix stacks
-    km_mat4_stack_release(&modelview_matrix_stack);
-    km_mat4_stack_release(&projection_matrix_stack);
-    km_mat4_stack_release(&texture_matrix_stack);
+    //Clear the matrix stacks, back to their static storage
+    resetStack(&modelview_matrix_stack, modelview_matrices, modelview_versions);
+    resetStack(&projection_matrix_stack, projection_matrices, projection_versions);
+    resetStack(&texture_matrix_stack, texture_matrices, texture_versions);
 
-    //Delete the matrices
-    initialized = 0; //Set to uninitialized
-
-    current_stack = NULL; //Set the current stack to point nowhere
+    current_stack = &modelview_matrix_stack;
 }
 
 void kmGLMultMatrix(const kmMat4* pIn)
 {
-    lazyInitialize();
     kmMat4Multiply(current_stack->top, current_stack->top, pIn);
+    km_mat4_stack_top_changed(current_stack);
 }
 
 void kmGLLoadMatrix(const kmMat4* pIn)
 {
-    lazyInitialize();
-    kmMat4Assign(current_stack->top, pIn);
+    //The nodes load their cached matrix in every frame, it often didn't change
+    if (memcmp(current_stack->top, pIn, sizeof(kmMat4)) != 0) {
+        memcpy(current_stack->top, pIn, sizeof(kmMat4));
+        km_mat4_stack_top_changed(current_stack);
+    }
+}
+
+km_mat4_version kmGLLoadMatrixWithVersion(const kmMat4* pIn, km_mat4_version version)
+{
+    if (version == 0) {
+        version = km_mat4_stack_new_version();
+    }
+
+    //Equal versions mean equal matrices
+    if (*current_stack->top_version != version) {
+        memcpy(current_stack->top, pIn, sizeof(kmMat4));
+        *current_stack->top_version = version;
+    }
+
+    return version;
 }
 
 void kmGLGetMatrix(kmGLEnum mode, kmMat4* pOut)
 {
-    lazyInitialize();
+    kmMat4Assign(pOut, stackForMode(mode)->top);
+}
 
-    switch(mode)
-    {
-        case KM_GL_MODELVIEW:
-            kmMat4Assign(pOut, modelview_matrix_stack.top);
-        break;
-        case KM_GL_PROJECTION:
-            kmMat4Assign(pOut, projection_matrix_stack.top);
-        break;
-        case KM_GL_TEXTURE:
-            kmMat4Assign(pOut, texture_matrix_stack.top);
-        break;
-        default:
-            assert(1 && "Invalid matrix mode specified"); //TODO: Proper error handling
-        break;
+const kmMat4* kmGLGetTopMatrix(kmGLEnum mode)
+{
+    return stackForMode(mode)->top;
+}
+
+km_mat4_version kmGLGetMatrixVersion(kmGLEnum mode)
+{
+    return *stackForMode(mode)->top_version;
+}
+
+const kmMat4* kmGLGetMVPMatrix(void)
+{
+    km_mat4_version projection_version = *projection_matrix_stack.top_version;
+    km_mat4_version modelview_version = *modelview_matrix_stack.top_version;
+
+    if (projection_version != mvp_projection_version || modelview_version != mvp_modelview_version) {
+        kmMat4Multiply(&mvp_matrix, projection_matrix_stack.top, modelview_matrix_stack.top);
+        mvp_projection_version = projection_version;
+        mvp_modelview_version = modelview_version;
     }
+
+    return &mvp_matrix;
 }
 
 void kmGLTranslatef(float x, float y, float z)
@@ -166,6 +186,7 @@ void kmGLTranslatef(float x, float y, float z)
 
     //Multiply the rotation matrix by the current matrix
     kmMat4Multiply(current_stack->top, current_stack->top, &translation);
+    km_mat4_stack_top_changed(current_stack);
 }
 
 void kmGLRotatef(float angle, float x, float y, float z)
@@ -181,6 +202,7 @@ void kmGLRotatef(float angle, float x, float y, float z)
 
     //Multiply the rotation matrix by the current matrix
     kmMat4Multiply(current_stack->top, current_stack->top, &rotation);
+    km_mat4_stack_top_changed(current_stack);
 }
 
 void kmGLScalef(float x, float y, float z)
@@ -188,4 +210,5 @@ void kmGLScalef(float x, float y, float z)
     kmMat4 scaling;
     kmMat4Scaling(&scaling, x, y, z);
     kmMat4Multiply(current_stack->top, current_stack->top, &scaling);
+    km_mat4_stack_top_changed(current_stack);
 }
@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "kazmath/plane.h"
 
 #include "kazmath/neon_matrix_impl.h"
+#include "kazmath/sse_matrix_impl.h"
 
 /**
  * Fills a kmMat4 structure with the values from a 16
@@ -166,6 +167,12 @@ int gaussj(kmMat4 *a, kmMat4 *b)
  */
 kmMat4* const kmMat4Inverse(kmMat4* pOut, const kmMat4* pM)
 {
+#if KM_USE_SSE
+    if (!SSE_Matrix4Inverse(pM->mat, pOut->mat)) {
+        return NULL;
+    }
+    return pOut;
+#else
     kmMat4 inv;
     kmMat4 tmp;
 
@@ -179,6 +186,7 @@ kmMat4* const kmMat4Inverse(kmMat4* pOut, const kmMat4* pM)
 
     kmMat4Assign(pOut, &inv);
     return pOut;
+#endif
 }
 /**
  * Returns KM_TRUE if pIn is an identity matrix
@@ -0,0 +1,165 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "kazmath/sse_matrix_impl.h"
+
+#if KM_USE_SSE
+
+#include <xmmintrin.h>
+
+#define KM_SHUFFLE(v1, v2, x, y, z, w) _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(w, z, y, x))
+#define KM_SWIZZLE(v, x, y, z, w) KM_SHUFFLE(v, v, x, y, z, w)
+
+// 2x2 matrices held in a register as (m00, m01, m10, m11)
+
+// a x b
+static __m128 km_mat2_mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, KM_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(KM_SWIZZLE(a, 1, 0, 3, 2), KM_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adjugate(a) x b
+static __m128 km_mat2_adj_mul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(KM_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(KM_SWIZZLE(a, 1, 1, 2, 2), KM_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// a x adjugate(b)
+static __m128 km_mat2_mul_adj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, KM_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(KM_SWIZZLE(a, 1, 0, 3, 2), KM_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+int SSE_Matrix4Inverse(const float* m, float* output)
+{
+    // inverse(transpose(M)) = transpose(inverse(M)): the columns can be handled as the rows of the blockwise inversion
+    __m128 r0 = _mm_loadu_ps(m);
+    __m128 r1 = _mm_loadu_ps(m + 4);
+    __m128 r2 = _mm_loadu_ps(m + 8);
+    __m128 r3 = _mm_loadu_ps(m + 12);
+
+    // M = | A B |
+    //     | C D |
+    __m128 A = _mm_movelh_ps(r0, r1);
+    __m128 B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3);
+    __m128 D = _mm_movehl_ps(r3, r2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(_mm_mul_ps(KM_SHUFFLE(r0, r2, 0, 2, 0, 2), KM_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+                               _mm_mul_ps(KM_SHUFFLE(r0, r2, 1, 3, 1, 3), KM_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+    __m128 detA = KM_SWIZZLE(detSub, 0, 0, 0, 0);
+    __m128 detB = KM_SWIZZLE(detSub, 1, 1, 1, 1);
+    __m128 detC = KM_SWIZZLE(detSub, 2, 2, 2, 2);
+    __m128 detD = KM_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    __m128 D_C = km_mat2_adj_mul(D, C);
+    __m128 A_B = km_mat2_adj_mul(A, B);
+
+    // adjugates of the blocks of the inverse
+    __m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), km_mat2_mul(B, D_C));
+    __m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), km_mat2_mul(C, A_B));
+    __m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), km_mat2_mul_adj(D, A_B));
+    __m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), km_mat2_mul_adj(A, D_C));
+
+    // |M| = |A| |D| + |B| |C| - trace(adjugate(A) B adjugate(D) C)
+    __m128 detM = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+    __m128 tr = _mm_mul_ps(A_B, KM_SWIZZLE(D_C, 0, 2, 1, 3));
+    __m128 rDetM;
+    tr = _mm_add_ps(tr, KM_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, KM_SWIZZLE(tr, 1, 0, 3, 2));
+    detM = _mm_sub_ps(detM, tr);
+
+    if (_mm_cvtss_f32(detM) == 0.0f)
+    {
+        return 0;
+    }
+
+    // (1/|M|, -1/|M|, -1/|M|, 1/|M|) gives the signs of the adjugates
+    rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X_ = _mm_mul_ps(X_, rDetM);
+    Y_ = _mm_mul_ps(Y_, rDetM);
+    Z_ = _mm_mul_ps(Z_, rDetM);
+    W_ = _mm_mul_ps(W_, rDetM);
+
+    _mm_storeu_ps(output, KM_SHUFFLE(X_, Y_, 3, 1, 3, 1));
+    _mm_storeu_ps(output + 4, KM_SHUFFLE(X_, Y_, 2, 0, 2, 0));
+    _mm_storeu_ps(output + 8, KM_SHUFFLE(Z_, W_, 3, 1, 3, 1));
+    _mm_storeu_ps(output + 12, KM_SHUFFLE(Z_, W_, 2, 0, 2, 0));
+    return 1;
+}
+
+void SSE_Matrix4Vector3TransformArray(const float* m, const float* v, float* output, unsigned int count)
+{
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+    unsigned int i;
+
+    for (i = 0; i < count; ++i, v += 3, output += 3)
+    {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+        r = _mm_add_ps(r, c3);
+
+        // x, y then z: the vectors are packed, writing 4 floats would overwrite the next one
+        _mm_storel_pi((__m64*)output, r);
+        _mm_store_ss(output + 2, _mm_movehl_ps(r, r));
+    }
+}
+
+void SSE_Matrix3Vector2TransformArray(const float* m, const float* v, float* output, unsigned int count)
+{
+    // two vectors at a time
+    __m128 c0 = _mm_setr_ps(m[0], m[1], m[0], m[1]);
+    __m128 c1 = _mm_setr_ps(m[3], m[4], m[3], m[4]);
+    __m128 c2 = _mm_setr_ps(m[6], m[7], m[6], m[7]);
+    __m128 xy, r;
+    unsigned int i;
+
+    for (i = 0; i + 1 < count; i += 2, v += 4, output += 4)
+    {
+        xy = _mm_loadu_ps(v);
+        r = _mm_mul_ps(c0, KM_SWIZZLE(xy, 0, 0, 2, 2));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, KM_SWIZZLE(xy, 1, 1, 3, 3)));
+        r = _mm_add_ps(r, c2);
+        _mm_storeu_ps(output, r);
+    }
+
+    if (i < count)
+    {
+        xy = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)v);
+        r = _mm_mul_ps(c0, KM_SWIZZLE(xy, 0, 0, 2, 2));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, KM_SWIZZLE(xy, 1, 1, 3, 3)));
+        r = _mm_add_ps(r, c2);
+        _mm_storel_pi((__m64*)output, r);
+    }
+}
+
+#endif // KM_USE_SSE
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "kazmath/mat3.h"
 #include "kazmath/vec2.h"
 #include "kazmath/utility.h"
+#include "kazmath/sse_matrix_impl.h"
 
 kmVec2* kmVec2Fill(kmVec2* pOut, kmScalar x, kmScalar y)
 {
@@ -95,6 +96,21 @@ kmVec2* kmVec2Transform(kmVec2* pOut, const kmVec2* pV, const kmMat3* pM)
     return pOut;
 }
 
+kmVec2* kmVec2TransformArray(kmVec2* pOut, const kmVec2* pV, const kmMat3* pM, unsigned int count)
+{
+#if KM_USE_SSE
+    SSE_Matrix3Vector2TransformArray(pM->mat, &pV->x, &pOut->x, count);
+#else
+    unsigned int i;
+
+    for (i = 0; i < count; ++i) {
+        kmVec2Transform(&pOut[i], &pV[i], pM);
+    }
+#endif
+
+    return pOut;
+}
+
 kmVec2* kmVec2TransformCoord(kmVec2* pOut, const kmVec2* pV, const kmMat3* pM)
 {
     assert(0);
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "kazmath/utility.h"
 #include "kazmath/vec4.h"
 #include "kazmath/mat4.h"
+#include "kazmath/sse_matrix_impl.h"
 #include "kazmath/vec3.h"
 
 /**
@@ -164,6 +165,9 @@ kmVec3* kmVec3Transform(kmVec3* pOut, const kmVec3* pV, const kmMat4* pM)
         Out = (bx, by, bz)
     */
 
+#if KM_USE_SSE
+    SSE_Matrix4Vector3TransformArray(pM->mat, &pV->x, &pOut->x, 1);
+#else
     kmVec3 v;
 
     v.x = pV->x * pM->mat[0] + pV->y * pM->mat[4] + pV->z * pM->mat[8] + pM->mat[12];
@@ -173,6 +177,25 @@ kmVec3* kmVec3Transform(kmVec3* pOut, const kmVec3* pV, const kmMat4* pM)
     pOut->x = v.x;
     pOut->y = v.y;
     pOut->z = v.z;
+#endif
+
+    return pOut;
+}
+
+/**
+ * Transforms count vectors (assuming w=1) by a given matrix, pOut can be pV
+ */
+kmVec3* kmVec3TransformArray(kmVec3* pOut, const kmVec3* pV, const kmMat4* pM, unsigned int count)
+{
+#if KM_USE_SSE
+    SSE_Matrix4Vector3TransformArray(pM->mat, &pV->x, &pOut->x, count);
+#else
+    unsigned int i;
+
+    for (i = 0; i < count; ++i) {
+        kmVec3Transform(&pOut[i], &pV[i], pM);
+    }
+#endif
 
     return pOut;
 }
@@ -42,6 +42,9 @@ http://www.angelcode.com/products/bmfont/ (Free, Windows only)
 #include "CCDirector.h"
 #include "textures/CCTextureCache.h"
 #include "support/ccUTF8.h"
+#include "platform/CCFileData.h"
+#include <algorithm>
+#include <string.h>
 
 using namespace std;
 
@@ -113,154 +116,300 @@ CCBMFontConfiguration * CCBMFontConfiguration::create(const char *FNTfile)
 
 bool CCBMFontConfiguration::initWithFNTfile(const char *FNTfile)
 {
-    m_pKerningDictionary = NULL;
-    m_pFontDefDictionary = NULL;
-    
-    m_pCharacterSet = this->parseConfigFile(FNTfile);
-    
-    if (! m_pCharacterSet)
-    {
-        return false;
-    }
-
-    return true;
+    return this->parseConfigFile(FNTfile);
 }
 
 std::set<unsigned int>* CCBMFontConfiguration::getCharacterSet() const
 {
+    if (! m_pCharacterSet)
+    {
+        m_pCharacterSet = new set<unsigned int>();
+        for (unsigned int i = 0; i < m_uFontDefCount; ++i)
+        {
+            m_pCharacterSet->insert(m_pCharacterSet->end(), m_pFontDefs[i].charID);
+        }
+    }
     return m_pCharacterSet;
 }
 
 CCBMFontConfiguration::CCBMFontConfiguration()
-: m_pFontDefDictionary(NULL)
-, m_nCommonHeight(0)
-, m_pKerningDictionary(NULL)
+: m_nCommonHeight(0)
+, m_pFontDefs(NULL)
+, m_uFontDefCount(0)
+, m_pKernings(NULL)
+, m_uKerningCount(0)
 , m_pCharacterSet(NULL)
 {
-
+    memset(&m_tPadding, 0, sizeof(m_tPadding));
+    memset(m_pGlyphPages, 0, sizeof(m_pGlyphPages));
 }
 
 CCBMFontConfiguration::~CCBMFontConfiguration()
 {
     CCLOGINFO( "cocos2d: deallocing CCBMFontConfiguration" );
-    this->purgeFontDefDictionary();
-    this->purgeKerningDictionary();
+    this->purgeTables();
     m_sAtlasName.clear();
-    CC_SAFE_DELETE(m_pCharacterSet);
 }
 
 const char* CCBMFontConfiguration::description(void)
 {
     return CCString::createWithFormat(
-        "<CCBMFontConfiguration = " CC_FORMAT_PRINTF_SIZE_T " | Glphys:%d Kernings:%d | Image = %s>",
+        "<CCBMFontConfiguration = " CC_FORMAT_PRINTF_SIZE_T " | Glphys:%u Kernings:%u | Image = %s>",
         (size_t)this,
-        HASH_COUNT(m_pFontDefDictionary),
-        HASH_COUNT(m_pKerningDictionary),
+        m_uFontDefCount,
+        m_uKerningCount,
         m_sAtlasName.c_str()
     )->getCString();
 }
 
-void CCBMFontConfiguration::purgeKerningDictionary()
+void CCBMFontConfiguration::purgeTables()
 {
-    tCCKerningHashElement *current;
-    while(m_pKerningDictionary) 
+    for (unsigned int i = 0; i < 256; ++i)
     {
-        current = m_pKerningDictionary; 
-        HASH_DEL(m_pKerningDictionary,current);
-        free(current);
+        CC_SAFE_DELETE_ARRAY(m_pGlyphPages[i]);
     }
+    CC_SAFE_DELETE_ARRAY(m_pFontDefs);
+    CC_SAFE_DELETE_ARRAY(m_pKernings);
+    CC_SAFE_DELETE(m_pCharacterSet);
+    m_uFontDefCount = 0;
+    m_uKerningCount = 0;
 }
 
-void CCBMFontConfiguration::purgeFontDefDictionary()
-{    
-    tCCFontDefHashElement *current, *tmp;
+static bool ccBMFontDefLess(const ccBMFontDef& a, const ccBMFontDef& b)
+{
+    return a.charID < b.charID;
+}
+
+static bool ccBMFontDefEqual(const ccBMFontDef& a, const ccBMFontDef& b)
+{
+    return a.charID == b.charID;
+}
+
+static bool ccBMFontKerningLess(const ccBMFontKerning& a, const ccBMFontKerning& b)
+{
+    return a.key < b.key;
+}
+
+static bool ccBMFontKerningEqual(const ccBMFontKerning& a, const ccBMFontKerning& b)
+{
+    return a.key == b.key;
+}
+
+void CCBMFontConfiguration::setTables(std::vector<ccBMFontDef>& fontDefs, std::vector<ccBMFontKerning>& kernings)
+{
+    this->purgeTables();
+
+    // the first definition of a character wins
+    std::stable_sort(fontDefs.begin(), fontDefs.end(), ccBMFontDefLess);
+    fontDefs.erase(std::unique(fontDefs.begin(), fontDefs.end(), ccBMFontDefEqual), fontDefs.end());
+    std::stable_sort(kernings.begin(), kernings.end(), ccBMFontKerningLess);
+    kernings.erase(std::unique(kernings.begin(), kernings.end(), ccBMFontKerningEqual), kernings.end());
+
+    m_uFontDefCount = (unsigned int)fontDefs.size();
+    if (m_uFontDefCount)
+    {
+        m_pFontDefs = new ccBMFontDef[m_uFontDefCount];
+        std::copy(fontDefs.begin(), fontDefs.end(), m_pFontDefs);
+    }
+
+    m_uKerningCount = (unsigned int)kernings.size();
+    if (m_uKerningCount)
+    {
+        m_pKernings = new ccBMFontKerning[m_uKerningCount];
+        std::copy(kernings.begin(), kernings.end(), m_pKernings);
+    }
+
+    // the characters of the BMP come first, there are less than 0xffff of them
+    for (unsigned int i = 0; i < m_uFontDefCount && m_pFontDefs[i].charID <= 0xffff; ++i)
+    {
+        unsigned int charID = m_pFontDefs[i].charID;
+        unsigned short *pPage = m_pGlyphPages[charID >> 8];
+        if (! pPage)
+        {
+            pPage = new unsigned short[256];
+            memset(pPage, 0, 256 * sizeof(unsigned short));
+            m_pGlyphPages[charID >> 8] = pPage;
+        }
+        pPage[charID & 0xff] = (unsigned short)(i + 1);
+    }
+}
+
+const ccBMFontDef* CCBMFontConfiguration::findFontDef(unsigned int charID) const
+{
+    ccBMFontDef key;
+    key.charID = charID;
+    const ccBMFontDef *pEnd = m_pFontDefs + m_uFontDefCount;
+    const ccBMFontDef *pFound = std::lower_bound((const ccBMFontDef*)m_pFontDefs, pEnd, key, ccBMFontDefLess);
+    return (pFound != pEnd && pFound->charID == charID) ? pFound : NULL;
+}
 
-    HASH_ITER(hh, m_pFontDefDictionary, current, tmp) {
-        HASH_DEL(m_pFontDefDictionary, current);
-        free(current);
+int CCBMFontConfiguration::getKerningAmount(unsigned short first, unsigned short second) const
+{
+    if (! m_uKerningCount)
+    {
+        return 0;
     }
+
+    ccBMFontKerning key;
+    key.key = (first<<16) | (second & 0xffff);
+    const ccBMFontKerning *pEnd = m_pKernings + m_uKerningCount;
+    const ccBMFontKerning *pFound = std::lower_bound((const ccBMFontKerning*)m_pKernings, pEnd, key, ccBMFontKerningLess);
+    return (pFound != pEnd && pFound->key == key.key) ? pFound->amount : 0;
 }
 
-std::set<unsigned int>* CCBMFontConfiguration::parseConfigFile(const char *controlFile)
+bool CCBMFontConfiguration::parseConfigFile(const char *controlFile)
 {    
-    std::string fullpath = CCFileUtils::sharedFileUtils()->fullPathForFilename(controlFile);
-    CCString *contents = CCString::createWithContentsOfFile(fullpath.c_str());
+    CCFileData *pData = CCFileUtils::sharedFileUtils()->getFileDataView(controlFile);
 
-    CCAssert(contents, "CCBMFontConfiguration::parseConfigFile | Open file error.");
-    
-    set<unsigned int> *validCharsString = new set<unsigned int>();
+    CCAssert(pData, "CCBMFontConfiguration::parseConfigFile | Open file error.");
 
-    if (!contents)
+    if (!pData)
     {
         CCLOG("cocos2d: Error parsing FNTfile %s", controlFile);
-        return NULL;
+        return false;
     }
 
-    // parse spacing / padding
-    std::string line;
-    std::string strLeft = contents->getCString();
-    while (strLeft.length() > 0)
+    bool bRet = false;
+    const unsigned char *pBytes = pData->getBytes();
+    unsigned long uSize = pData->getSize();
+    if (uSize >= 4 && memcmp(pBytes, "BMF", 3) == 0)
     {
-        int pos = strLeft.find('\n');
+        bRet = this->parseBinaryConfigFile(pBytes, uSize, controlFile);
+    }
+    else
+    {
+        bRet = this->parseTextConfigFile((const char*)pBytes, uSize, controlFile);
+    }
+    pData->release();
+
+    if (!bRet)
+    {
+        CCLOG("cocos2d: Error parsing FNTfile %s", controlFile);
+    }
+    return bRet;
+}
 
-        if (pos != (int)std::string::npos)
+//
+// text format
+//
+
+// The lines aren't null-terminated: the parsing stops at pszEnd.
+
+// returns the value of "key=value" in the line, or NULL
+static const char* ccBMFontFindValue(const char *pszLine, const char *pszEnd, const char *pszKey)
+{
+    size_t keyLength = strlen(pszKey);
+    for (const char *p = pszLine; p + keyLength < pszEnd; ++p)
+    {
+        if ((p == pszLine || p[-1] == ' ' || p[-1] == '\t') && p[keyLength] == '=' && memcmp(p, pszKey, keyLength) == 0)
         {
-            // the data is more than a line.get one line
-            line = strLeft.substr(0, pos);
-            strLeft = strLeft.substr(pos + 1);
+            return p + keyLength + 1;
         }
-        else
+    }
+    return NULL;
+}
+
+static int ccBMFontParseInt(const char **ppValue, const char *pszEnd)
+{
+    const char *p = *ppValue;
+    bool bNegative = false;
+    if (p < pszEnd && (*p == '-' || *p == '+'))
+    {
+        bNegative = (*p == '-');
+        ++p;
+    }
+    int value = 0;
+    for (; p < pszEnd && *p >= '0' && *p <= '9'; ++p)
+    {
+        value = value * 10 + (*p - '0');
+    }
+    *ppValue = p;
+    return bNegative ? -value : value;
+}
+
+static int ccBMFontIntValue(const char *pszLine, const char *pszEnd, const char *pszKey)
+{
+    const char *pszValue = ccBMFontFindValue(pszLine, pszEnd, pszKey);
+    return pszValue ? ccBMFontParseInt(&pszValue, pszEnd) : 0;
+}
+
+// whether the first word of the line is pszTag
+static bool ccBMFontLineHasTag(const char *pszLine, const char *pszEnd, const char *pszTag)
+{
+    size_t tagLength = strlen(pszTag);
+    return pszLine + tagLength < pszEnd && memcmp(pszLine, pszTag, tagLength) == 0
+        && (pszLine[tagLength] == ' ' || pszLine[tagLength] == '\t');
+}
+
+bool CCBMFontConfiguration::parseTextConfigFile(const char *pData, unsigned long uSize, const char *controlFile)
+{
+    std::vector<ccBMFontDef> fontDefs;
+    std::vector<ccBMFontKerning> kernings;
+
+    const char *pDataEnd = pData + uSize;
+    const char *pszLine = pData;
+    while (pszLine < pDataEnd)
+    {
+        const char *pszEnd = (const char*)memchr(pszLine, '\n', pDataEnd - pszLine);
+        if (! pszEnd)
         {
-            // get the left data
-            line = strLeft;
-            strLeft.erase();
+            pszEnd = pDataEnd;
         }
 
-        if(line.substr(0,strlen("info face")) == "info face") 
+        if (ccBMFontLineHasTag(pszLine, pszEnd, "info")) 
         {
             // XXX: info parsing is incomplete
             // Not needed for the Hiero editors, but needed for the AngelCode editor
-            //            [self parseInfoArguments:line];
-            this->parseInfoArguments(line);
+            this->parseInfoArguments(pszLine, pszEnd);
         }
         // Check to see if the start of the line is something we are interested in
-        else if(line.substr(0,strlen("common lineHeight")) == "common lineHeight")
+        else if (ccBMFontLineHasTag(pszLine, pszEnd, "common"))
         {
-            this->parseCommonArguments(line);
+            this->parseCommonArguments(pszLine, pszEnd);
         }
-        else if(line.substr(0,strlen("page id")) == "page id")
+        else if (ccBMFontLineHasTag(pszLine, pszEnd, "page"))
         {
-            this->parseImageFileName(line, controlFile);
+            this->parseImageFileName(pszLine, pszEnd, controlFile);
         }
-        else if(line.substr(0,strlen("chars c")) == "chars c")
+        else if (ccBMFontLineHasTag(pszLine, pszEnd, "chars"))
         {
-            // Ignore this line
+            // the count is only a hint
+            int count = ccBMFontIntValue(pszLine, pszEnd, "count");
+            if (count > 0)
+            {
+                fontDefs.reserve(count);
+            }
         }
-        else if(line.substr(0,strlen("char")) == "char")
+        else if (ccBMFontLineHasTag(pszLine, pszEnd, "char"))
         {
             // Parse the current line and create a new CharDef
-            tCCFontDefHashElement* element = (tCCFontDefHashElement*)malloc( sizeof(*element) );
-            this->parseCharacterDefinition(line, &element->fontDef);
-
-            element->key = element->fontDef.charID;
-            HASH_ADD_INT(m_pFontDefDictionary, key, element);
-            
-            validCharsString->insert(element->fontDef.charID);
+            ccBMFontDef fontDef;
+            this->parseCharacterDefinition(pszLine, pszEnd, &fontDef);
+            fontDefs.push_back(fontDef);
         }
-//        else if(line.substr(0,strlen("kernings count")) == "kernings count")
-//        {
-//            this->parseKerningCapacity(line);
-//        }
-        else if(line.substr(0,strlen("kerning first")) == "kerning first")
+        else if (ccBMFontLineHasTag(pszLine, pszEnd, "kernings"))
         {
-            this->parseKerningEntry(line);
+            int count = ccBMFontIntValue(pszLine, pszEnd, "count");
+            if (count > 0)
+            {
+                kernings.reserve(count);
+            }
         }
+        else if (ccBMFontLineHasTag(pszLine, pszEnd, "kerning"))
+        {
+            ccBMFontKerning kerning;
+            this->parseKerningEntry(pszLine, pszEnd, &kerning);
+            kernings.push_back(kerning);
+        }
+
+        pszLine = pszEnd + 1;
     }
-    
-    return validCharsString;
+
+    this->setTables(fontDefs, kernings);
+    return true;
 }
 
-void CCBMFontConfiguration::parseImageFileName(std::string line, const char *fntFile)
+void CCBMFontConfiguration::parseImageFileName(const char *pszLine, const char *pszEnd, const char *fntFile)
 {
     //////////////////////////////////////////////////////////////////////////
     // line to parse:
@@ -268,19 +417,33 @@ void CCBMFontConfiguration::parseImageFileName(std::string line, const char *fnt
     //////////////////////////////////////////////////////////////////////////
 
     // page ID. Sanity check
-    int index = line.find('=')+1;
-    int index2 = line.find(' ', index);
-    std::string value = line.substr(index, index2-index);
-    CCAssert(atoi(value.c_str()) == 0, "LabelBMFont file could not be found");
+    CCAssert(ccBMFontIntValue(pszLine, pszEnd, "id") == 0, "LabelBMFont file could not be found");
     // file 
-    index = line.find('"')+1;
-    index2 = line.find('"', index);
-    value = line.substr(index, index2-index);
+    const char *pszValue = ccBMFontFindValue(pszLine, pszEnd, "file");
+    if (! pszValue)
+    {
+        return;
+    }
+    const char *pszValueEnd = NULL;
+    if (*pszValue == '"')
+    {
+        ++pszValue;
+        pszValueEnd = (const char*)memchr(pszValue, '"', pszEnd - pszValue);
+    }
+    if (! pszValueEnd)
+    {
+        pszValueEnd = pszValue;
+        while (pszValueEnd < pszEnd && *pszValueEnd != ' ' && *pszValueEnd != '\r')
+        {
+            ++pszValueEnd;
+        }
+    }
+    std::string value(pszValue, pszValueEnd - pszValue);
 
     m_sAtlasName = CCFileUtils::sharedFileUtils()->fullPathFromRelativeFile(value.c_str(), fntFile);
 }
 
-void CCBMFontConfiguration::parseInfoArguments(std::string line)
+void CCBMFontConfiguration::parseInfoArguments(const char *pszLine, const char *pszEnd)
 {
     //////////////////////////////////////////////////////////////////////////
     // possible lines to parse:
@@ -289,14 +452,24 @@ void CCBMFontConfiguration::parseInfoArguments(std::string line)
     //////////////////////////////////////////////////////////////////////////
 
     // padding
-    int index = line.find("padding=");
-    int index2 = line.find(' ', index);
-    std::string value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "padding=%d,%d,%d,%d", &m_tPadding.top, &m_tPadding.right, &m_tPadding.bottom, &m_tPadding.left);
+    const char *pszValue = ccBMFontFindValue(pszLine, pszEnd, "padding");
+    if (pszValue)
+    {
+        int *padding[4] = { &m_tPadding.top, &m_tPadding.right, &m_tPadding.bottom, &m_tPadding.left };
+        for (int i = 0; i < 4 && pszValue < pszEnd; ++i)
+        {
+            *padding[i] = ccBMFontParseInt(&pszValue, pszEnd);
+            if (pszValue >= pszEnd || *pszValue != ',')
+            {
+                break;
+            }
+            ++pszValue;
+        }
+    }
     CCLOG("cocos2d: padding: %d,%d,%d,%d", m_tPadding.left, m_tPadding.top, m_tPadding.right, m_tPadding.bottom);
 }
 
-void CCBMFontConfiguration::parseCommonArguments(std::string line)
+void CCBMFontConfiguration::parseCommonArguments(const char *pszLine, const char *pszEnd)
 {
     //////////////////////////////////////////////////////////////////////////
     // line to parse:
@@ -304,30 +477,28 @@ void CCBMFontConfiguration::parseCommonArguments(std::string line)
     //////////////////////////////////////////////////////////////////////////
 
     // Height
-    int index = line.find("lineHeight=");
-    int index2 = line.find(' ', index);
-    std::string value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "lineHeight=%d", &m_nCommonHeight);
+    m_nCommonHeight = ccBMFontIntValue(pszLine, pszEnd, "lineHeight");
+    this->checkCommonArguments(ccBMFontIntValue(pszLine, pszEnd, "scaleW"),
+                               ccBMFontIntValue(pszLine, pszEnd, "scaleH"),
+                               ccBMFontIntValue(pszLine, pszEnd, "pages"));
+
+    // packed (ignore) What does this mean ??
+}
+
+void CCBMFontConfiguration::checkCommonArguments(int scaleW, int scaleH, int pages)
+{
     // scaleW. sanity check
-    index = line.find("scaleW=") + strlen("scaleW=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    CCAssert(atoi(value.c_str()) <= CCConfiguration::sharedConfiguration()->getMaxTextureSize(), "CCLabelBMFont: page can't be larger than supported");
+    CCAssert(scaleW <= CCConfiguration::sharedConfiguration()->getMaxTextureSize(), "CCLabelBMFont: page can't be larger than supported");
     // scaleH. sanity check
-    index = line.find("scaleH=") + strlen("scaleH=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    CCAssert(atoi(value.c_str()) <= CCConfiguration::sharedConfiguration()->getMaxTextureSize(), "CCLabelBMFont: page can't be larger than supported");
+    CCAssert(scaleH <= CCConfiguration::sharedConfiguration()->getMaxTextureSize(), "CCLabelBMFont: page can't be larger than supported");
     // pages. sanity check
-    index = line.find("pages=") + strlen("pages=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    CCAssert(atoi(value.c_str()) == 1, "CCBitfontAtlas: only supports 1 page");
-
-    // packed (ignore) What does this mean ??
+    CCAssert(pages == 1, "CCBitfontAtlas: only supports 1 page");
+    CC_UNUSED_PARAM(scaleW);
+    CC_UNUSED_PARAM(scaleH);
+    CC_UNUSED_PARAM(pages);
 }
 
-void CCBMFontConfiguration::parseCharacterDefinition(std::string line, ccBMFontDef *characterDefinition)
+void CCBMFontConfiguration::parseCharacterDefinition(const char *pszLine, const char *pszEnd, ccBMFontDef *characterDefinition)
 {    
     //////////////////////////////////////////////////////////////////////////
     // line to parse:
@@ -335,81 +506,237 @@ void CCBMFontConfiguration::parseCharacterDefinition(std::string line, ccBMFontD
     //////////////////////////////////////////////////////////////////////////
 
     // Character ID
-    int index = line.find("id=");
-    int index2 = line.find(' ', index);
-    std::string value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "id=%u", &characterDefinition->charID);
-
-    // Character x
-    index = line.find("x=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "x=%f", &characterDefinition->rect.origin.x);
-    // Character y
-    index = line.find("y=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "y=%f", &characterDefinition->rect.origin.y);
-    // Character width
-    index = line.find("width=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "width=%f", &characterDefinition->rect.size.width);
-    // Character height
-    index = line.find("height=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "height=%f", &characterDefinition->rect.size.height);
-    // Character xoffset
-    index = line.find("xoffset=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "xoffset=%hd", &characterDefinition->xOffset);
-    // Character yoffset
-    index = line.find("yoffset=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "yoffset=%hd", &characterDefinition->yOffset);
-    // Character xadvance
-    index = line.find("xadvance=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "xadvance=%hd", &characterDefinition->xAdvance);
-}
-
-void CCBMFontConfiguration::parseKerningEntry(std::string line)
+    characterDefinition->charID = (unsigned int)ccBMFontIntValue(pszLine, pszEnd, "id");
+    // Character x, y, width, height
+    characterDefinition->rect.origin.x = (float)ccBMFontIntValue(pszLine, pszEnd, "x");
+    characterDefinition->rect.origin.y = (float)ccBMFontIntValue(pszLine, pszEnd, "y");
+    characterDefinition->rect.size.width = (float)ccBMFontIntValue(pszLine, pszEnd, "width");
+    characterDefinition->rect.size.height = (float)ccBMFontIntValue(pszLine, pszEnd, "height");
+    // Character xoffset, yoffset, xadvance
+    characterDefinition->xOffset = (short)ccBMFontIntValue(pszLine, pszEnd, "xoffset");
+    characterDefinition->yOffset = (short)ccBMFontIntValue(pszLine, pszEnd, "yoffset");
+    characterDefinition->xAdvance = (short)ccBMFontIntValue(pszLine, pszEnd, "xadvance");
+}
+
+void CCBMFontConfiguration::parseKerningEntry(const char *pszLine, const char *pszEnd, ccBMFontKerning *kerning)
 {        
     //////////////////////////////////////////////////////////////////////////
     // line to parse:
     // kerning first=121  second=44  amount=-7
     //////////////////////////////////////////////////////////////////////////
 
-    // first
-    int first;
-    int index = line.find("first=");
-    int index2 = line.find(' ', index);
-    std::string value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "first=%d", &first);
-
-    // second
-    int second;
-    index = line.find("second=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "second=%d", &second);
-
-    // amount
-    int amount;
-    index = line.find("amount=");
-    index2 = line.find(' ', index);
-    value = line.substr(index, index2-index);
-    sscanf(value.c_str(), "amount=%d", &amount);
-
-    tCCKerningHashElement *element = (tCCKerningHashElement *)calloc( sizeof( *element ), 1 );
-    element->amount = amount;
-    element->key = (first<<16) | (second&0xffff);
-    HASH_ADD_INT(m_pKerningDictionary,key, element);
+    int first = ccBMFontIntValue(pszLine, pszEnd, "first");
+    int second = ccBMFontIntValue(pszLine, pszEnd, "second");
+    kerning->amount = ccBMFontIntValue(pszLine, pszEnd, "amount");
+    kerning->key = (first<<16) | (second&0xffff);
 }
+
+//
+// binary format, version 3:
+// "BMF" 3, then blocks made of a u8 type, a u32 size and the data. All the numbers are little endian.
+//
+
+enum {
+    kCCBMFontBlockInfo = 1,
+    kCCBMFontBlockCommon = 2,
+    kCCBMFontBlockPages = 3,
+    kCCBMFontBlockChars = 4,
+    kCCBMFontBlockKerningPairs = 5,
+};
+
+#define kCCBMFontBinaryVersion      3
+#define kCCBMFontInfoSize           14
+#define kCCBMFontCommonSize         15
+#define kCCBMFontCharSize           20
+#define kCCBMFontKerningPairSize    10
+
+static unsigned int ccBMFontReadUInt16(const unsigned char *pData)
+{
+    return pData[0] | (pData[1] << 8);
+}
+
+static unsigned int ccBMFontReadUInt32(const unsigned char *pData)
+{
+    return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((unsigned int)pData[3] << 24);
+}
+
+bool CCBMFontConfiguration::parseBinaryConfigFile(const unsigned char *pData, unsigned long uSize, const char *controlFile)
+{
+    if (pData[3] != kCCBMFontBinaryVersion)
+    {
+        CCLOG("cocos2d: CCBMFontConfiguration: version %d of the binary format isn't supported", pData[3]);
+        return false;
+    }
+
+    std::vector<ccBMFontDef> fontDefs;
+    std::vector<ccBMFontKerning> kernings;
+
+    unsigned long uOffset = 4;
+    while (uOffset < uSize)
+    {
+        if (uSize - uOffset < 5)
+        {
+            return false;
+        }
+        unsigned int uType = pData[uOffset];
+        unsigned long uBlockSize = ccBMFontReadUInt32(pData + uOffset + 1);
+        const unsigned char *pBlock = pData + uOffset + 5;
+        uOffset += 5;
+        if (uBlockSize > uSize - uOffset)
+        {
+            return false;
+        }
+        uOffset += uBlockSize;
+
+        if (uType == kCCBMFontBlockInfo && uBlockSize >= kCCBMFontInfoSize)
+        {
+            m_tPadding.top = pBlock[7];
+            m_tPadding.right = pBlock[8];
+            m_tPadding.bottom = pBlock[9];
+            m_tPadding.left = pBlock[10];
+        }
+        else if (uType == kCCBMFontBlockCommon && uBlockSize >= kCCBMFontCommonSize)
+        {
+            m_nCommonHeight = ccBMFontReadUInt16(pBlock);
+            this->checkCommonArguments(ccBMFontReadUInt16(pBlock + 4), ccBMFontReadUInt16(pBlock + 6), ccBMFontReadUInt16(pBlock + 8));
+        }
+        else if (uType == kCCBMFontBlockPages)
+        {
+            // only the first page is used
+            const unsigned char *pNameEnd = (const unsigned char*)memchr(pBlock, 0, uBlockSize);
+            std::string value((const char*)pBlock, pNameEnd ? pNameEnd - pBlock : uBlockSize);
+            m_sAtlasName = CCFileUtils::sharedFileUtils()->fullPathFromRelativeFile(value.c_str(), controlFile);
+        }
+        else if (uType == kCCBMFontBlockChars)
+        {
+            unsigned long uCount = uBlockSize / kCCBMFontCharSize;
+            fontDefs.resize(uCount);
+            for (unsigned long i = 0; i < uCount; ++i, pBlock += kCCBMFontCharSize)
+            {
+                ccBMFontDef& fontDef = fontDefs[i];
+                fontDef.charID = ccBMFontReadUInt32(pBlock);
+                fontDef.rect.origin.x = (float)ccBMFontReadUInt16(pBlock + 4);
+                fontDef.rect.origin.y = (float)ccBMFontReadUInt16(pBlock + 6);
+                fontDef.rect.size.width = (float)ccBMFontReadUInt16(pBlock + 8);
+                fontDef.rect.size.height = (float)ccBMFontReadUInt16(pBlock + 10);
+                fontDef.xOffset = (short)ccBMFontReadUInt16(pBlock + 12);
+                fontDef.yOffset = (short)ccBMFontReadUInt16(pBlock + 14);
+                fontDef.xAdvance = (short)ccBMFontReadUInt16(pBlock + 16);
+            }
+        }
+        else if (uType == kCCBMFontBlockKerningPairs)
+        {
+            unsigned long uCount = uBlockSize / kCCBMFontKerningPairSize;
+            kernings.resize(uCount);
+            for (unsigned long i = 0; i < uCount; ++i, pBlock += kCCBMFontKerningPairSize)
+            {
+                kernings[i].key = (ccBMFontReadUInt32(pBlock) << 16) | (ccBMFontReadUInt32(pBlock + 4) & 0xffff);
+                kernings[i].amount = (short)ccBMFontReadUInt16(pBlock + 8);
+            }
+        }
+    }
+
+    this->setTables(fontDefs, kernings);
+    return true;
+}
+
+static void ccBMFontWriteUInt16(std::vector<unsigned char>& data, unsigned int value)
+{
+    data.push_back(value & 0xff);
+    data.push_back((value >> 8) & 0xff);
+}
+
+static void ccBMFontWriteUInt32(std::vector<unsigned char>& data, unsigned int value)
+{
+    ccBMFontWriteUInt16(data, value & 0xffff);
+    ccBMFontWriteUInt16(data, value >> 16);
+}
+
+static void ccBMFontWriteBlock(std::vector<unsigned char>& data, unsigned int uType, unsigned int uSize)
+{
+    data.push_back(uType);
+    ccBMFontWriteUInt32(data, uSize);
+}
+
+bool CCBMFontConfiguration::writeBinaryFile(const char *pszFullPath)
+{
+    std::vector<unsigned char> data;
+    data.reserve(64 + m_sAtlasName.length() + m_uFontDefCount * kCCBMFontCharSize + m_uKerningCount * kCCBMFontKerningPairSize);
+    data.push_back('B');
+    data.push_back('M');
+    data.push_back('F');
+    data.push_back(kCCBMFontBinaryVersion);
+
+    // font size, flags (unicode), charset, stretchH, aa, padding, spacing, outline, empty name
+    ccBMFontWriteBlock(data, kCCBMFontBlockInfo, kCCBMFontInfoSize + 1);
+    ccBMFontWriteUInt16(data, 0);
+    data.push_back(0x02);
+    data.push_back(0);
+    ccBMFontWriteUInt16(data, 100);
+    data.push_back(1);
+    data.push_back(m_tPadding.top);
+    data.push_back(m_tPadding.right);
+    data.push_back(m_tPadding.bottom);
+    data.push_back(m_tPadding.left);
+    data.push_back(0);
+    data.push_back(0);
+    data.push_back(0);
+    data.push_back(0);
+
+    // line height, base, scaleW, scaleH, pages, flags, channels
+    ccBMFontWriteBlock(data, kCCBMFontBlockCommon, kCCBMFontCommonSize);
+    ccBMFontWriteUInt16(data, m_nCommonHeight);
+    ccBMFontWriteUInt16(data, 0);
+    ccBMFontWriteUInt16(data, 0);
+    ccBMFontWriteUInt16(data, 0);
+    ccBMFontWriteUInt16(data, 1);
+    data.insert(data.end(), 5, 0);
+
+    size_t separator = m_sAtlasName.find_last_of("/\\");
+    std::string atlasFile = (separator == std::string::npos) ? m_sAtlasName : m_sAtlasName.substr(separator + 1);
+    ccBMFontWriteBlock(data, kCCBMFontBlockPages, atlasFile.length() + 1);
+    data.insert(data.end(), atlasFile.begin(), atlasFile.end());
+    data.push_back(0);
+
+    ccBMFontWriteBlock(data, kCCBMFontBlockChars, m_uFontDefCount * kCCBMFontCharSize);
+    for (unsigned int i = 0; i < m_uFontDefCount; ++i)
+    {
+        const ccBMFontDef& fontDef = m_pFontDefs[i];
+        ccBMFontWriteUInt32(data, fontDef.charID);
+        ccBMFontWriteUInt16(data, (unsigned int)fontDef.rect.origin.x);
+        ccBMFontWriteUInt16(data, (unsigned int)fontDef.rect.origin.y);
+        ccBMFontWriteUInt16(data, (unsigned int)fontDef.rect.size.width);
+        ccBMFontWriteUInt16(data, (unsigned int)fontDef.rect.size.height);
+        ccBMFontWriteUInt16(data, (unsigned short)fontDef.xOffset);
+        ccBMFontWriteUInt16(data, (unsigned short)fontDef.yOffset);
+        ccBMFontWriteUInt16(data, (unsigned short)fontDef.xAdvance);
+        // page, channels
+        data.push_back(0);
+        data.push_back(15);
+    }
+
+    if (m_uKerningCount)
+    {
+        ccBMFontWriteBlock(data, kCCBMFontBlockKerningPairs, m_uKerningCount * kCCBMFontKerningPairSize);
+        for (unsigned int i = 0; i < m_uKerningCount; ++i)
+        {
+            ccBMFontWriteUInt32(data, m_pKernings[i].key >> 16);
+            ccBMFontWriteUInt32(data, m_pKernings[i].key & 0xffff);
+            ccBMFontWriteUInt16(data, (unsigned short)m_pKernings[i].amount);
+        }
+    }
+
+    FILE *fp = fopen(pszFullPath, "wb");
+    if (! fp)
+    {
+        CCLOG("cocos2d: CCBMFontConfiguration: can't write %s", pszFullPath);
+        return false;
+    }
+    bool bRet = fwrite(&data[0], 1, data.size(), fp) == data.size();
+    fclose(fp);
+    return bRet;
+}
+
 //
 //CCLabelBMFont
 //
@@ -518,10 +845,6 @@ bool CCLabelBMFont::initWithString(const char *theString, const char *fntFile, f
         
         m_tImageOffset = imageOffset;
         
-        m_pReusedChar = new CCSprite();
-        m_pReusedChar->initWithTexture(m_pobTextureAtlas->getTexture(), CCRectMake(0, 0, 0, 0), false);
-        m_pReusedChar->setBatchNode(this);
-        
         this->setString(theString, true);
         
         return true;
@@ -537,7 +860,7 @@ CCLabelBMFont::CCLabelBMFont()
 , m_pConfiguration(NULL)
 , m_bLineBreakWithoutSpaces(false)
 , m_tImageOffset(CCPointZero)
-, m_pReusedChar(NULL)
+, m_bLetterSpritesEnabled(true)
 , m_cDisplayedOpacity(255)
 , m_cRealOpacity(255)
 , m_tDisplayedColor(ccWHITE)
@@ -551,7 +874,6 @@ CCLabelBMFont::CCLabelBMFont()
 
 CCLabelBMFont::~CCLabelBMFont()
 {
-    CC_SAFE_RELEASE(m_pReusedChar);
     CC_SAFE_DELETE_ARRAY(m_sString);
     CC_SAFE_DELETE_ARRAY(m_sInitialString);
     CC_SAFE_RELEASE(m_pConfiguration);
@@ -560,19 +882,16 @@ CCLabelBMFont::~CCLabelBMFont()
 // LabelBMFont - Atlas generation
 int CCLabelBMFont::kerningAmountForFirst(unsigned short first, unsigned short second)
 {
-    int ret = 0;
-    unsigned int key = (first<<16) | (second & 0xffff);
-
-    if( m_pConfiguration->m_pKerningDictionary ) {
-        tCCKerningHashElement *element = NULL;
-        HASH_FIND_INT(m_pConfiguration->m_pKerningDictionary, &key, element);        
-        if(element)
-            ret = element->amount;
-    }
-    return ret;
+    return m_pConfiguration->getKerningAmount(first, second);
 }
 
 void CCLabelBMFont::createFontChars()
+{
+    this->layoutFontChars();
+    this->updateFontChars();
+}
+
+void CCLabelBMFont::layoutFontChars()
 {
     int nextFontPositionX = 0;
     int nextFontPositionY = 0;
@@ -586,13 +905,12 @@ void CCLabelBMFont::createFontChars()
 
     unsigned int quantityOfLines = 1;
     unsigned int stringLen = m_sString ? cc_wcslen(m_sString) : 0;
+    m_tLetters.resize(stringLen);
     if (stringLen == 0)
     {
         return;
     }
 
-    set<unsigned int> *charSet = m_pConfiguration->getCharacterSet();
-
     for (unsigned int i = 0; i < stringLen - 1; ++i)
     {
         unsigned short c = m_sString[i];
@@ -606,11 +924,16 @@ void CCLabelBMFont::createFontChars()
     nextFontPositionY = 0-(m_pConfiguration->m_nCommonHeight - m_pConfiguration->m_nCommonHeight * quantityOfLines);
     
     CCRect rect;
+    // no character may be defined in the font
     ccBMFontDef fontDef;
+    fontDef.charID = 0;
+    fontDef.xOffset = fontDef.yOffset = fontDef.xAdvance = 0;
 
     for (unsigned int i= 0; i < stringLen; i++)
     {
         unsigned short c = m_sString[i];
+        ccBMFontLetter& letter = m_tLetters[i];
+        letter.visible = false;
 
         if (c == '\n')
         {
@@ -619,26 +942,16 @@ void CCLabelBMFont::createFontChars()
             continue;
         }
         
-        if (charSet->find(c) == charSet->end())
+        const ccBMFontDef *pFontDef = m_pConfiguration->getFontDef(c);
+        if (! pFontDef)
         {
             CCLOGWARN("cocos2d::CCLabelBMFont: Attempted to use character not defined in this bitmap: %d", c);
             continue;      
         }
 
         kerningAmount = this->kerningAmountForFirst(prev, c);
-        
-        tCCFontDefHashElement *element = NULL;
 
-        // unichar is a short, and an int is needed on HASH_FIND_INT
-        unsigned int key = c;
-        HASH_FIND_INT(m_pConfiguration->m_pFontDefDictionary, &key, element);
-        if (! element)
-        {
-            CCLOGWARN("cocos2d::CCLabelBMFont: characer not found %d", c);
-            continue;
-        }
-
-        fontDef = element->fontDef;
+        fontDef = *pFontDef;
 
         rect = fontDef.rect;
         rect = CC_RECT_PIXELS_TO_POINTS(rect);
@@ -646,52 +959,14 @@ void CCLabelBMFont::createFontChars()
         rect.origin.x += m_tImageOffset.x;
         rect.origin.y += m_tImageOffset.y;
 
-        CCSprite *fontChar;
-
-        bool hasSprite = true;
-        fontChar = (CCSprite*)(this->getChildByTag(i));
-        if(fontChar )
-        {
-            // Reusing previous Sprite
-			fontChar->setVisible(true);
-        }
-        else
-        {
-            // New Sprite ? Set correct color, opacity, etc...
-            if( 0 )
-            {
-				/* WIP: Doesn't support many features yet.
-				 But this code is super fast. It doesn't create any sprite.
-				 Ideal for big labels.
-				 */
-				fontChar = m_pReusedChar;
-				fontChar->setBatchNode(NULL);
-				hasSprite = false;
-			}
-            else
-            {
-                fontChar = new CCSprite();
-                fontChar->initWithTexture(m_pobTextureAtlas->getTexture(), rect);
-                addChild(fontChar, i, i);
-                fontChar->release();
-			}
-            
-            // Apply label properties
-			fontChar->setOpacityModifyRGB(m_bIsOpacityModifyRGB);
-            
-			// Color MUST be set before opacity, since opacity might change color if OpacityModifyRGB is on
-			fontChar->updateDisplayedColor(m_tDisplayedColor);
-			fontChar->updateDisplayedOpacity(m_cDisplayedOpacity);
-        }
-
-        // updating previous sprite
-        fontChar->setTextureRect(rect, false, rect.size);
-
         // See issue 1343. cast( signed short + unsigned integer ) == unsigned integer (sign is lost!)
         int yOffset = m_pConfiguration->m_nCommonHeight - fontDef.yOffset;
         CCPoint fontPos = ccp( (float)nextFontPositionX + fontDef.xOffset + fontDef.rect.size.width*0.5f + kerningAmount,
             (float)nextFontPositionY + yOffset - rect.size.height*0.5f * CC_CONTENT_SCALE_FACTOR() );
-        fontChar->setPosition(CC_POINT_PIXELS_TO_POINTS(fontPos));
+
+        letter.rect = rect;
+        letter.position = CC_POINT_PIXELS_TO_POINTS(fontPos);
+        letter.visible = true;
 
         // update kerning
         nextFontPositionX += fontDef.xAdvance + kerningAmount;
@@ -701,11 +976,6 @@ void CCLabelBMFont::createFontChars()
         {
             longestLine = nextFontPositionX;
         }
-        
-        if (! hasSprite)
-        {
-            updateQuadFromSprite(fontChar, i);
-        }
     }
 
     // If the last character processed has an xAdvance which is less that the width of the characters image, then we need
@@ -724,6 +994,164 @@ void CCLabelBMFont::createFontChars()
     this->setContentSize(CC_SIZE_PIXELS_TO_POINTS(tmpSize));
 }
 
+void CCLabelBMFont::updateFontChars()
+{
+    if (m_bLetterSpritesEnabled)
+    {
+        this->updateLetterSprites();
+    }
+    else
+    {
+        this->updateLetterQuads();
+    }
+}
+
+void CCLabelBMFont::updateLetterSprites()
+{
+    unsigned int letterCount = m_tLetters.size();
+
+    // the sprites are reused by index; the others are hidden
+    vector<CCSprite*> sprites(letterCount, (CCSprite*)NULL);
+    if (m_pChildren && m_pChildren->count() != 0)
+    {
+        CCObject* child;
+        CCARRAY_FOREACH(m_pChildren, child)
+        {
+            CCSprite* pSprite = (CCSprite*) child;
+            int tag = pSprite->getTag();
+            if (tag >= 0 && (unsigned int)tag < letterCount && m_tLetters[tag].visible && ! sprites[tag])
+            {
+                sprites[tag] = pSprite;
+            }
+            else if (pSprite->isVisible())
+            {
+                pSprite->setVisible(false);
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < letterCount; i++)
+    {
+        const ccBMFontLetter& letter = m_tLetters[i];
+        if (! letter.visible)
+        {
+            continue;
+        }
+
+        CCSprite *fontChar = sprites[i];
+        if (fontChar)
+        {
+            // Reusing previous Sprite, only what changed is updated so the unchanged letters stay clean
+            if (! fontChar->isVisible())
+            {
+                fontChar->setVisible(true);
+            }
+            if (! fontChar->getTextureRect().equals(letter.rect) || fontChar->isTextureRectRotated()
+                || ! fontChar->getContentSize().equals(letter.rect.size))
+            {
+                fontChar->setTextureRect(letter.rect, false, letter.rect.size);
+            }
+        }
+        else
+        {
+            // New Sprite ? Set correct color, opacity, etc...
+            fontChar = new CCSprite();
+            fontChar->initWithTexture(m_pobTextureAtlas->getTexture(), letter.rect);
+            addChild(fontChar, i, i);
+            fontChar->release();
+
+            // Apply label properties
+            fontChar->setOpacityModifyRGB(m_bIsOpacityModifyRGB);
+
+            // Color MUST be set before opacity, since opacity might change color if OpacityModifyRGB is on
+            fontChar->updateDisplayedColor(m_tDisplayedColor);
+            fontChar->updateDisplayedOpacity(m_cDisplayedOpacity);
+        }
+
+        if (! fontChar->getPosition().equals(letter.position))
+        {
+            fontChar->setPosition(letter.position);
+        }
+    }
+}
+
+void CCLabelBMFont::updateLetterQuads()
+{
+    CCTexture2D *texture = m_pobTextureAtlas->getTexture();
+    float atlasWidth = (float)texture->getPixelsWide();
+    float atlasHeight = (float)texture->getPixelsHigh();
+
+    ccColor4B color4 = { m_tDisplayedColor.r, m_tDisplayedColor.g, m_tDisplayedColor.b, m_cDisplayedOpacity };
+    // special opacity for premultiplied textures
+    if (m_bIsOpacityModifyRGB)
+    {
+        color4.r *= m_cDisplayedOpacity/255.0f;
+        color4.g *= m_cDisplayedOpacity/255.0f;
+        color4.b *= m_cDisplayedOpacity/255.0f;
+    }
+
+    unsigned int letterCount = m_tLetters.size();
+    if (m_pobTextureAtlas->getCapacity() < letterCount)
+    {
+        m_pobTextureAtlas->resizeCapacity(letterCount);
+    }
+
+    // same quads as the letter sprites would write, see CCSprite::setTextureCoords() and CCSprite::updateTransform()
+    ccV3F_C4B_T2F_Quad *quads = m_pobTextureAtlas->getQuads();
+    unsigned int totalQuads = m_pobTextureAtlas->getTotalQuads();
+    unsigned int quadCount = 0;
+    for (unsigned int i = 0; i < letterCount; i++)
+    {
+        const ccBMFontLetter& letter = m_tLetters[i];
+        if (! letter.visible)
+        {
+            continue;
+        }
+
+        CCRect rect = CC_RECT_POINTS_TO_PIXELS(letter.rect);
+#if CC_FIX_ARTIFACTS_BY_STRECHING_TEXEL
+        float left    = (2*rect.origin.x+1)/(2*atlasWidth);
+        float right   = left + (rect.size.width*2-2)/(2*atlasWidth);
+        float top     = (2*rect.origin.y+1)/(2*atlasHeight);
+        float bottom  = top + (rect.size.height*2-2)/(2*atlasHeight);
+#else
+        float left    = rect.origin.x/atlasWidth;
+        float right   = (rect.origin.x + rect.size.width) / atlasWidth;
+        float top     = rect.origin.y/atlasHeight;
+        float bottom  = (rect.origin.y + rect.size.height) / atlasHeight;
+#endif // ! CC_FIX_ARTIFACTS_BY_STRECHING_TEXEL
+
+        float x1 = letter.position.x - letter.rect.size.width * 0.5f;
+        float y1 = letter.position.y - letter.rect.size.height * 0.5f;
+        float x2 = x1 + letter.rect.size.width;
+        float y2 = y1 + letter.rect.size.height;
+
+        ccV3F_C4B_T2F_Quad quad;
+        quad.bl.vertices = vertex3( CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(x1), CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(y1), 0 );
+        quad.br.vertices = vertex3( CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(x2), CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(y1), 0 );
+        quad.tl.vertices = vertex3( CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(x1), CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(y2), 0 );
+        quad.tr.vertices = vertex3( CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(x2), CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(y2), 0 );
+        quad.bl.texCoords = tex2(left, bottom);
+        quad.br.texCoords = tex2(right, bottom);
+        quad.tl.texCoords = tex2(left, top);
+        quad.tr.texCoords = tex2(right, top);
+        quad.bl.colors = quad.br.colors = quad.tl.colors = quad.tr.colors = color4;
+
+        // only the quads that changed are uploaded
+        if (quadCount >= totalQuads || memcmp(&quads[quadCount], &quad, sizeof(quad)) != 0)
+        {
+            m_pobTextureAtlas->updateQuad(&quad, quadCount);
+        }
+        quadCount++;
+    }
+
+    totalQuads = m_pobTextureAtlas->getTotalQuads();
+    if (totalQuads > quadCount)
+    {
+        m_pobTextureAtlas->removeQuadsAtIndex(quadCount, totalQuads - quadCount);
+    }
+}
+
 //LabelBMFont - CCLabelProtocol protocol
 void CCLabelBMFont::setString(const char *newString)
 {
@@ -736,6 +1164,11 @@ void CCLabelBMFont::setString(const char *newString, bool needUpdateLabel)
         newString = "";
     }
     if (needUpdateLabel) {
+        // labels showing a score or a timer are often set to the same string every frame.
+        // The letter sprites can have been changed through getChildByTag(), setting the string again resets them
+        if (! m_bLetterSpritesEnabled && m_sInitialString && m_sInitialStringUTF8 == newString) {
+            return;
+        }
         m_sInitialStringUTF8 = newString;
     }
     unsigned short* utf16String = cc_utf8_to_utf16(newString);
@@ -758,23 +1191,13 @@ void CCLabelBMFont::setString(unsigned short *newString, bool needUpdateLabel)
         CC_SAFE_DELETE_ARRAY(tmp);
     }
     
-    if (m_pChildren && m_pChildren->count() != 0)
-    {
-        CCObject* child;
-        CCARRAY_FOREACH(m_pChildren, child)
-        {
-            CCNode* pNode = (CCNode*) child;
-            if (pNode)
-            {
-                pNode->setVisible(false);
-            }
-        }
-    }
-    this->createFontChars();
-    
+    // updateLabel() lays the new string out itself
     if (needUpdateLabel) {
         updateLabel();
     }
+    else {
+        this->createFontChars();
+    }
 }
 
 const char* CCLabelBMFont::getString(void)
@@ -858,6 +1281,10 @@ void CCLabelBMFont::setOpacityModifyRGB(bool var)
             }
         }
     }
+    if (! m_bLetterSpritesEnabled)
+    {
+        this->updateLetterQuads();
+    }
 }
 bool CCLabelBMFont::isOpacityModifyRGB()
 {
@@ -874,6 +1301,10 @@ void CCLabelBMFont::updateDisplayedOpacity(GLubyte parentOpacity)
         CCSprite *item = (CCSprite*)pObj;
 		item->updateDisplayedOpacity(m_cDisplayedOpacity);
 	}
+    if (! m_bLetterSpritesEnabled)
+    {
+        this->updateLetterQuads();
+    }
 }
 
 void CCLabelBMFont::updateDisplayedColor(const ccColor3B& parentColor)
@@ -888,6 +1319,10 @@ void CCLabelBMFont::updateDisplayedColor(const ccColor3B& parentColor)
         CCSprite *item = (CCSprite*)pObj;
 		item->updateDisplayedColor(m_tDisplayedColor);
 	}
+    if (! m_bLetterSpritesEnabled)
+    {
+        this->updateLetterQuads();
+    }
 }
 
 bool CCLabelBMFont::isCascadeColorEnabled()
@@ -923,7 +1358,11 @@ void CCLabelBMFont::setAnchorPoint(const CCPoint& point)
 // LabelBMFont - Alignment
 void CCLabelBMFont::updateLabel()
 {
-    this->setString(m_sInitialString, false);
+    // the lines are broken and aligned on the layout, the letters are updated once at the end
+    unsigned short* tmp = m_sString;
+    m_sString = copyUTF16StringN(m_sInitialString);
+    CC_SAFE_DELETE_ARRAY(tmp);
+    this->layoutFontChars();
 
     if (m_fWidth > 0)
     {
@@ -940,21 +1379,25 @@ void CCLabelBMFont::updateLabel()
         float startOfLine = -1, startOfWord = -1;
         int skip = 0;
 
-        CCArray* children = getChildren();
-        for (unsigned int j = 0; j < children->count(); j++)
+        unsigned int letterCount = 0;
+        for (unsigned int k = 0; k < m_tLetters.size(); k++)
+        {
+            if (m_tLetters[k].visible)
+                letterCount++;
+        }
+
+        for (unsigned int j = 0; j < letterCount; j++)
         {
-            CCSprite* characterSprite;
             unsigned int justSkipped = 0;
             
-            while (!(characterSprite = (CCSprite*)this->getChildByTag(j + skip + justSkipped)))
+            while (!m_tLetters[j + skip + justSkipped].visible)
             {
                 justSkipped++;
             }
             
             skip += justSkipped;
-            
-            if (!characterSprite->isVisible())
-                continue;
+
+            const ccBMFontLetter& letter = m_tLetters[j + skip];
 
             if (i >= stringLength)
                 break;
@@ -963,7 +1406,7 @@ void CCLabelBMFont::updateLabel()
 
             if (!start_word)
             {
-                startOfWord = getLetterPosXLeft( characterSprite );
+                startOfWord = getLetterPosXLeft( letter );
                 start_word = true;
             }
             if (!start_line)
@@ -994,7 +1437,7 @@ void CCLabelBMFont::updateLabel()
 
                 if (!startOfWord)
                 {
-                    startOfWord = getLetterPosXLeft( characterSprite );
+                    startOfWord = getLetterPosXLeft( letter );
                     start_word = true;
                 }
                 if (!startOfLine)
@@ -1017,7 +1460,7 @@ void CCLabelBMFont::updateLabel()
             }
 
             // Out of bounds.
-            if ( getLetterPosXRight( characterSprite ) - startOfLine > m_fWidth )
+            if ( getLetterPosXRight( letter ) - startOfLine > m_fWidth )
             {
                 if (!m_bLineBreakWithoutSpaces)
                 {
@@ -1055,7 +1498,7 @@ void CCLabelBMFont::updateLabel()
 
                     if (!startOfWord)
                     {
-                        startOfWord = getLetterPosXLeft( characterSprite );
+                        startOfWord = getLetterPosXLeft( letter );
                         start_word = true;
                     }
                     if (!startOfLine)
@@ -1090,9 +1533,10 @@ void CCLabelBMFont::updateLabel()
 
         str_new[size] = '\0';
 
-        this->setString(str_new, false);
-        
-        CC_SAFE_DELETE_ARRAY(str_new);
+        tmp = m_sString;
+        m_sString = str_new;
+        CC_SAFE_DELETE_ARRAY(tmp);
+        this->layoutFontChars();
     }
 
     // Step 2: Make alignment
@@ -1118,11 +1562,11 @@ void CCLabelBMFont::updateLabel()
                 int index = i + line_length - 1 + lineNumber;
                 if (index < 0) continue;
 
-                CCSprite* lastChar = (CCSprite*)getChildByTag(index);
-                if ( lastChar == NULL )
+                if ( (unsigned int)index >= m_tLetters.size() || !m_tLetters[index].visible )
                     continue;
 
-                lineWidth = lastChar->getPosition().x + lastChar->getContentSize().width/2.0f;
+                const ccBMFontLetter& lastChar = m_tLetters[index];
+                lineWidth = lastChar.position.x + lastChar.rect.size.width/2.0f;
 
                 float shift = 0;
                 switch (m_pAlignment)
@@ -1142,10 +1586,9 @@ void CCLabelBMFont::updateLabel()
                     for (unsigned j = 0; j < line_length; j++)
                     {
                         index = i + j + lineNumber;
-                        if (index < 0) continue;
+                        if (index < 0 || (unsigned int)index >= m_tLetters.size()) continue;
 
-                        CCSprite* characterSprite = (CCSprite*)getChildByTag(index);
-                        characterSprite->setPosition(ccpAdd(characterSprite->getPosition(), ccp(shift, 0.0f)));
+                        m_tLetters[index].position.x += shift;
                     }
                 }
 
@@ -1159,6 +1602,8 @@ void CCLabelBMFont::updateLabel()
             last_line.push_back(m_sString[ctr]);
         }
     }
+
+    this->updateFontChars();
 }
 
 // LabelBMFont - Alignment
@@ -1198,14 +1643,15 @@ void CCLabelBMFont::setScaleY(float scaleY)
     updateLabel();
 }
 
-float CCLabelBMFont::getLetterPosXLeft( CCSprite* sp )
+// the letters are anchored at their center
+float CCLabelBMFont::getLetterPosXLeft( const ccBMFontLetter& letter )
 {
-    return sp->getPosition().x * m_fScaleX - (sp->getContentSize().width * m_fScaleX * sp->getAnchorPoint().x);
+    return letter.position.x * m_fScaleX - (letter.rect.size.width * m_fScaleX * 0.5f);
 }
 
-float CCLabelBMFont::getLetterPosXRight( CCSprite* sp )
+float CCLabelBMFont::getLetterPosXRight( const ccBMFontLetter& letter )
 {
-    return sp->getPosition().x * m_fScaleX + (sp->getContentSize().width * m_fScaleX * sp->getAnchorPoint().x);
+    return letter.position.x * m_fScaleX + (letter.rect.size.width * m_fScaleX * 0.5f);
 }
 
 // LabelBMFont - FntFile
@@ -1233,6 +1679,19 @@ const char* CCLabelBMFont::getFntFile()
     return m_sFntFile.c_str();
 }
 
+void CCLabelBMFont::setLetterSpritesEnabled(bool bEnabled)
+{
+    if (m_bLetterSpritesEnabled != bEnabled)
+    {
+        m_bLetterSpritesEnabled = bEnabled;
+
+        // the letter sprites and the quads written by the label would share the texture atlas
+        this->removeAllChildrenWithCleanup(true);
+        m_pobTextureAtlas->removeAllQuads();
+        this->updateLabel();
+    }
+}
+
 
 //LabelBMFont - Debug draw
 #if CC_LABELBMFONT_DEBUG_DRAW
@@ -34,8 +34,8 @@ Use any of these editors to generate BMFonts:
 #define __CCBITMAP_FONT_ATLAS_H__
 
 #include "sprite_nodes/CCSpriteBatchNode.h"
-#include "support/data_support/uthash.h"
 #include <map>
+#include <set>
 #include <sstream>
 #include <iostream>
 #include <vector>
@@ -53,8 +53,6 @@ enum {
     kCCLabelAutomaticWidth = -1,
 };
 
-struct _FontDefHashElement;
-
 /**
 @struct ccBMFontDef
 BMFont definition
@@ -87,42 +85,46 @@ typedef struct _BMFontPadding {
     int bottom;
 } ccBMFontPadding;
 
-typedef struct _FontDefHashElement
-{
-	unsigned int	key;		// key. Font Unicode value
-	ccBMFontDef		fontDef;	// font definition
-	UT_hash_handle	hh;
-} tCCFontDefHashElement;
-
-// Equal function for targetSet.
-typedef struct _KerningHashElement
-{
-	int				key;		// key for the hash. 16-bit for 1st element, 16-bit for 2nd element
-	int				amount;
-	UT_hash_handle	hh;
-} tCCKerningHashElement;
+/** @struct ccBMFontKerning
+BMFont kerning pair
+*/
+typedef struct _BMFontKerning {
+    //! 16-bit for the first character, 16-bit for the second one
+    unsigned int key;
+    //! amount added to the advance of the first character
+    int amount;
+} ccBMFontKerning;
+
+/** @struct ccBMFontLetter
+Layout of a letter of a CCLabelBMFont
+*/
+typedef struct _BMFontLetter {
+    //! rect of the letter in the texture, in points
+    CCRect rect;
+    //! center of the letter, in points
+    CCPoint position;
+    //! whether or not the letter is drawn. Line breaks and characters missing in the font aren't
+    bool visible;
+} ccBMFontLetter;
 
 /** @brief CCBMFontConfiguration has parsed configuration of the the .fnt file
+
+The text and the binary (version 3) formats of AngelCode's BMFont are supported.
+The glyphs are kept in an array sorted by character, with a page table indexing the characters of the BMP,
+so the lookups done while laying out a label don't hash anything.
+A text .fnt file can be converted to the binary format, which loads much faster, with writeBinaryFile().
 @since v0.8
 */
 class CC_DLL CCBMFontConfiguration : public CCObject
 {
     // XXX: Creating a public interface so that the bitmapFontArray[] is accessible
 public://@public
-    // BMFont definitions
-    tCCFontDefHashElement *m_pFontDefDictionary;
-
     //! FNTConfig: Common Height Should be signed (issue #1343)
     int m_nCommonHeight;
     //! Padding
     ccBMFontPadding    m_tPadding;
     //! atlas name
     std::string m_sAtlasName;
-    //! values for kerning
-    tCCKerningHashElement *m_pKerningDictionary;
-    
-    // Character Set defines the letters that actually exist in the font
-    std::set<unsigned int> *m_pCharacterSet;
 public:
     CCBMFontConfiguration();
     virtual ~CCBMFontConfiguration();
@@ -137,16 +139,56 @@ public:
     inline const char* getAtlasName(){ return m_sAtlasName.c_str(); }
     inline void setAtlasName(const char* atlasName) { m_sAtlasName = atlasName; }
     
+    /** the characters defined in the font. The set is built on the first call */
     std::set<unsigned int>* getCharacterSet() const;
+
+    /** returns the definition of a character, or NULL if the font doesn't define it */
+    inline const ccBMFontDef* getFontDef(unsigned int charID) const
+    {
+        if (charID <= 0xffff)
+        {
+            const unsigned short *pPage = m_pGlyphPages[charID >> 8];
+            unsigned int index = pPage ? pPage[charID & 0xff] : 0;
+            return index ? &m_pFontDefs[index - 1] : NULL;
+        }
+        return findFontDef(charID);
+    }
+
+    /** returns the kerning amount between two characters */
+    int getKerningAmount(unsigned short first, unsigned short second) const;
+
+    inline unsigned int getFontDefCount() const { return m_uFontDefCount; }
+    inline unsigned int getKerningCount() const { return m_uKerningCount; }
+
+    /** writes the configuration in the binary format of BMFont.
+     The atlas is referenced by its file name only, so it must be next to the written file.
+     The fields that the engine doesn't use (font size, base, size of the page...) are written as 0.
+     */
+    bool writeBinaryFile(const char *pszFullPath);
 private:
-    std::set<unsigned int>* parseConfigFile(const char *controlFile);
-    void parseCharacterDefinition(std::string line, ccBMFontDef *characterDefinition);
-    void parseInfoArguments(std::string line);
-    void parseCommonArguments(std::string line);
-    void parseImageFileName(std::string line, const char *fntFile);
-    void parseKerningEntry(std::string line);
-    void purgeKerningDictionary();
-    void purgeFontDefDictionary();
+    bool parseConfigFile(const char *controlFile);
+    bool parseBinaryConfigFile(const unsigned char *pData, unsigned long uSize, const char *controlFile);
+    bool parseTextConfigFile(const char *pData, unsigned long uSize, const char *controlFile);
+    void parseCharacterDefinition(const char *pszLine, const char *pszEnd, ccBMFontDef *characterDefinition);
+    void parseInfoArguments(const char *pszLine, const char *pszEnd);
+    void parseCommonArguments(const char *pszLine, const char *pszEnd);
+    void parseImageFileName(const char *pszLine, const char *pszEnd, const char *fntFile);
+    void parseKerningEntry(const char *pszLine, const char *pszEnd, ccBMFontKerning *kerning);
+    void checkCommonArguments(int scaleW, int scaleH, int pages);
+    void setTables(std::vector<ccBMFontDef>& fontDefs, std::vector<ccBMFontKerning>& kernings);
+    const ccBMFontDef* findFontDef(unsigned int charID) const;
+    void purgeTables();
+
+    // glyphs sorted by charID
+    ccBMFontDef *m_pFontDefs;
+    unsigned int m_uFontDefCount;
+    // 256 pages of 256 characters of the BMP, allocated when the font uses them: index in m_pFontDefs + 1, or 0
+    unsigned short *m_pGlyphPages[256];
+    // kernings sorted by key
+    ccBMFontKerning *m_pKernings;
+    unsigned int m_uKerningCount;
+    // Character Set defines the letters that actually exist in the font
+    mutable std::set<unsigned int> *m_pCharacterSet;
 };
 
 /** @brief CCLabelBMFont is a subclass of CCSpriteBatchNode.
@@ -160,7 +202,12 @@ Features:
 - change the opacity
 - It can be used as part of a menu item.
 - anchorPoint can be used to align the "label"
-- Supports AngelCode text format
+- Supports AngelCode text and binary formats
+- The letters can be drawn without sprites, see setLetterSpritesEnabled()
+
+setString() lays the string out, then only updates the letters that moved or changed,
+so labels updated every frame (scores, timers) only touch the characters that changed.
+Without the letter sprites, setting the string already shown does nothing.
 
 Limitations:
 - All inner characters are using an anchorPoint of (0.5f, 0.5f) and it is not recommend to change it
@@ -242,14 +289,25 @@ public:
 
     void setFntFile(const char* fntFile);
     const char* getFntFile();
+
+    /** Whether or not every letter is a CCSprite child, tagged with its index in the string. Enabled by default.
+     When disabled, the letters are written as quads in the texture atlas: setString() is much cheaper,
+     but the letters can't be accessed with getChildByTag() and the label can't have children.
+     */
+    void setLetterSpritesEnabled(bool bEnabled);
+    inline bool isLetterSpritesEnabled() { return m_bLetterSpritesEnabled; }
 #if CC_LABELBMFONT_DEBUG_DRAW
     virtual void draw();
 #endif // CC_LABELBMFONT_DEBUG_DRAW
 private:
     char * atlasNameFromFntFile(const char *fntFile);
     int kerningAmountForFirst(unsigned short first, unsigned short second);
-    float getLetterPosXLeft( CCSprite* characterSprite );
-    float getLetterPosXRight( CCSprite* characterSprite );
+    float getLetterPosXLeft( const ccBMFontLetter& letter );
+    float getLetterPosXRight( const ccBMFontLetter& letter );
+    void layoutFontChars();
+    void updateFontChars();
+    void updateLetterSprites();
+    void updateLetterQuads();
     
 protected:
     virtual void setString(unsigned short *newString, bool needUpdateLabel);
@@ -274,8 +332,9 @@ protected:
     // offset of the texture atlas
     CCPoint    m_tImageOffset;
     
-    // reused char
-    CCSprite *m_pReusedChar;
+    // layout of the letters of m_sString
+    std::vector<ccBMFontLetter> m_tLetters;
+    bool m_bLetterSpritesEnabled;
     
     // texture RGBA
     GLubyte m_cDisplayedOpacity;
@@ -30,6 +30,7 @@
 #include "shaders/CCGLProgram.h"
 #include "shaders/CCShaderCache.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "support/CCPointExtension.h"
 #include "draw_nodes/CCDrawingPrimitives.h"
 
@@ -219,6 +220,10 @@ void CCClippingNode::visit()
     glGetIntegerv(GL_STENCIL_PASS_DEPTH_FAIL, (GLint *)&currentStencilPassDepthFail);
     glGetIntegerv(GL_STENCIL_PASS_DEPTH_PASS, (GLint *)&currentStencilPassDepthPass);
     
+    // the quads recorded so far must not be clipped
+    CCRenderer *renderer = CCDirector::sharedDirector()->getRenderer();
+    renderer->flush();
+
     // enable stencil use
     glEnable(GL_STENCIL_TEST);
     // check for OpenGL error while enabling stencil test
@@ -308,6 +313,9 @@ void CCClippingNode::visit()
     transform();
     m_pStencil->visit();
     kmGLPopMatrix();
+
+    // the stencil quads are drawn with the stencil state above
+    renderer->flush();
     
     // restore alpha test state
     if (m_fAlphaThreshold < 1)
@@ -344,6 +352,7 @@ void CCClippingNode::visit()
     
     // draw (according to the stencil test func) this node and its childs
     CCNode::visit();
+    renderer->flush();
     
     ///////////////////////////////////
     // CLEANUP
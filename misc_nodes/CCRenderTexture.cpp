@@ -26,6 +26,7 @@ THE SOFTWARE.
 #include "CCConfiguration.h"
 #include "misc_nodes/CCRenderTexture.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "platform/platform.h"
 #include "platform/CCImage.h"
 #include "shaders/CCGLProgram.h"
@@ -361,6 +362,9 @@ bool CCRenderTexture::initWithWidthAndHeight(int w, int h, CCTexture2DPixelForma
 
 void CCRenderTexture::begin()
 {
+    // the recorded quads belong to the previous framebuffer
+    CCDirector::sharedDirector()->getRenderer()->flush();
+
     kmGLMatrixMode(KM_GL_PROJECTION);
 	kmGLPushMatrix();
 	kmGLMatrixMode(KM_GL_MODELVIEW);
@@ -463,6 +467,9 @@ void CCRenderTexture::end()
 {
     CCDirector *director = CCDirector::sharedDirector();
     
+    // the recorded quads must end up in the texture
+    director->getRenderer()->flush();
+
     glBindFramebuffer(GL_FRAMEBUFFER, m_nOldFBO);
 
     // restore viewport
@@ -228,6 +228,8 @@ unsigned int CCParticleBatchNode::addChildHelper(CCParticleSystem* child, int z,
 
     child->setParent(this);
 
+    this->addChildToTagIndex(child);
+
     if( m_bRunning ) 
     {
         child->onEnter();
@@ -437,7 +439,8 @@ void CCParticleBatchNode::increaseAtlasCapacityTo(unsigned int quantity)
 //sets a 0'd quad into the quads array
 void CCParticleBatchNode::disableParticle(unsigned int particleIndex)
 {
-    ccV3F_C4B_T2F_Quad* quad = &((m_pTextureAtlas->getQuads())[particleIndex]);
+    // called by CCParticleSystem::updateParticles(), which may run on the simulator threads
+    ccV3F_C4B_T2F_Quad* quad = &((m_pTextureAtlas->getRawQuads())[particleIndex]);
     quad->br.vertices.x = quad->br.vertices.y = quad->tr.vertices.x = quad->tr.vertices.y = quad->tl.vertices.x = quad->tl.vertices.y = quad->bl.vertices.x = quad->bl.vertices.y = 0.0f;
 }
 
@@ -95,7 +95,7 @@ public:
     virtual void reorderChild(CCNode * child, int zOrder);
     void removeChildAtIndex(unsigned int index, bool doCleanup);
     void removeAllChildrenWithCleanup(bool doCleanup);
-    /** disables a particle by inserting a 0'd quad into the texture atlas */
+    /** disables a particle by inserting a 0'd quad into the texture atlas. The caller marks the quad dirty in the atlas */
     void disableParticle(unsigned int particleIndex);
     virtual void draw(void);
     // returns the used texture
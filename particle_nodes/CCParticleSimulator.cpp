@@ -0,0 +1,278 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "CCParticleSimulator.h"
+#include "CCParticleSystem.h"
+#include "CCDirector.h"
+#include "CCScheduler.h"
+
+#ifdef EMSCRIPTEN
+// Hack to get ASM.JS validation (no undefined symbols allowed).
+#define pthread_cond_signal(_)
+#define pthread_cond_broadcast(_)
+#endif // EMSCRIPTEN
+
+NS_CC_BEGIN
+
+static CCParticleSimulator *s_pSharedParticleSimulator = NULL;
+
+CCParticleSimulator* CCParticleSimulator::sharedParticleSimulator()
+{
+    if (! s_pSharedParticleSimulator)
+    {
+        s_pSharedParticleSimulator = new CCParticleSimulator();
+    }
+    return s_pSharedParticleSimulator;
+}
+
+void CCParticleSimulator::purgeSharedParticleSimulator()
+{
+    if (s_pSharedParticleSimulator)
+    {
+        s_pSharedParticleSimulator->setEnabled(false);
+    }
+    CC_SAFE_RELEASE_NULL(s_pSharedParticleSimulator);
+}
+
+CCParticleSimulator::CCParticleSimulator()
+: m_bEnabled(false)
+, m_uThreads(CC_PARTICLE_SIMULATION_THREADS)
+, m_uJobsCount(0)
+, m_uNextJob(0)
+, m_uJobsDone(0)
+, m_uGeneration(0)
+, m_bQuit(false)
+{
+    pthread_mutex_init(&m_jobsMutex, NULL);
+    pthread_cond_init(&m_jobsCondition, NULL);
+    pthread_cond_init(&m_doneCondition, NULL);
+}
+
+CCParticleSimulator::~CCParticleSimulator()
+{
+    stopThreads();
+
+    pthread_mutex_destroy(&m_jobsMutex);
+    pthread_cond_destroy(&m_jobsCondition);
+    pthread_cond_destroy(&m_doneCondition);
+}
+
+void CCParticleSimulator::setEnabled(bool bEnabled)
+{
+    if (m_bEnabled == bEnabled)
+    {
+        return;
+    }
+
+    m_bEnabled = bEnabled;
+
+    CCScheduler *pScheduler = CCDirector::sharedDirector()->getScheduler();
+    if (bEnabled)
+    {
+        pScheduler->scheduleUpdateForTarget(this, kCCParticleSimulatorPriority, false);
+    }
+    else
+    {
+        // don't lose the updates of the systems already queued
+        update(0);
+        pScheduler->unscheduleUpdateForTarget(this);
+        stopThreads();
+    }
+}
+
+void CCParticleSimulator::setThreads(unsigned int uThreads)
+{
+    if (m_uThreads != uThreads)
+    {
+        // the threads are started again by the next update
+        stopThreads();
+        m_uThreads = uThreads;
+    }
+}
+
+void CCParticleSimulator::addSystem(CCParticleSystem *pSystem, float dt)
+{
+    if (pSystem->m_nSimulationJob >= 0)
+    {
+        // already queued in this tick, by updateWithNoTime() for instance
+        ccParticleJob& job = m_jobs[pSystem->m_nSimulationJob];
+        job.dt += dt;
+        job.position = pSystem->computeCurrentPosition();
+        return;
+    }
+
+    // everything that touches the scene graph is done here, on the main thread
+    ccParticleJob job;
+    job.system = pSystem;
+    job.dt = dt;
+    job.position = pSystem->computeCurrentPosition();
+    job.alive = true;
+
+    pSystem->retain();
+    pSystem->m_nSimulationJob = (int)m_jobs.size();
+    m_jobs.push_back(job);
+}
+
+void CCParticleSimulator::update(float dt)
+{
+    CC_UNUSED_PARAM(dt);
+
+    if (m_jobs.empty())
+    {
+        return;
+    }
+
+    if (m_workerThreads.size() < m_uThreads)
+    {
+        startThreads();
+    }
+
+    pthread_mutex_lock(&m_jobsMutex);
+    m_uJobsCount = m_jobs.size();
+    m_uNextJob = 0;
+    m_uJobsDone = 0;
+    ++m_uGeneration;
+    pthread_mutex_unlock(&m_jobsMutex);
+    pthread_cond_broadcast(&m_jobsCondition);
+
+    // the main thread works too, then waits for the jobs still running on the workers
+    runJobs();
+
+    pthread_mutex_lock(&m_jobsMutex);
+    while (m_uJobsDone < m_uJobsCount)
+    {
+        pthread_cond_wait(&m_doneCondition, &m_jobsMutex);
+    }
+    pthread_mutex_unlock(&m_jobsMutex);
+
+    // the OpenGL part, in the order the systems were queued.
+    // finishUpdate() may change the scene and queue systems again: work on a copy of the queue
+    std::vector<ccParticleJob> jobs;
+    jobs.swap(m_jobs);
+    for (unsigned int i = 0; i < jobs.size(); ++i)
+    {
+        jobs[i].system->m_nSimulationJob = -1;
+    }
+    for (unsigned int i = 0; i < jobs.size(); ++i)
+    {
+        jobs[i].system->finishUpdate(jobs[i].alive);
+        jobs[i].system->release();
+    }
+}
+
+void CCParticleSimulator::runJobs()
+{
+    while (true)
+    {
+        // a worker late from the previous generation may get here: everything is read under the lock
+        pthread_mutex_lock(&m_jobsMutex);
+        if (m_uNextJob >= m_uJobsCount)
+        {
+            pthread_mutex_unlock(&m_jobsMutex);
+            break;
+        }
+        unsigned int uJob = m_uNextJob++;
+        pthread_mutex_unlock(&m_jobsMutex);
+
+        ccParticleJob& job = m_jobs[uJob];
+        job.alive = job.system->updateParticles(job.dt, job.position);
+
+        pthread_mutex_lock(&m_jobsMutex);
+        if (++m_uJobsDone == m_uJobsCount)
+        {
+            pthread_cond_signal(&m_doneCondition);
+        }
+        pthread_mutex_unlock(&m_jobsMutex);
+    }
+}
+
+void* CCParticleSimulator::workerThread(void *pData)
+{
+    CCParticleSimulator *pSimulator = (CCParticleSimulator*)pData;
+    unsigned int uGeneration = 0;
+
+    pthread_mutex_lock(&pSimulator->m_jobsMutex);
+    uGeneration = pSimulator->m_uGeneration;
+    while (true)
+    {
+        while (! pSimulator->m_bQuit && pSimulator->m_uGeneration == uGeneration)
+        {
+            pthread_cond_wait(&pSimulator->m_jobsCondition, &pSimulator->m_jobsMutex);
+        }
+        if (pSimulator->m_bQuit)
+        {
+            break;
+        }
+        uGeneration = pSimulator->m_uGeneration;
+
+        pthread_mutex_unlock(&pSimulator->m_jobsMutex);
+        pSimulator->runJobs();
+        pthread_mutex_lock(&pSimulator->m_jobsMutex);
+    }
+    pthread_mutex_unlock(&pSimulator->m_jobsMutex);
+
+    return NULL;
+}
+
+void CCParticleSimulator::startThreads()
+{
+#ifndef EMSCRIPTEN
+    pthread_mutex_lock(&m_jobsMutex);
+    m_bQuit = false;
+    pthread_mutex_unlock(&m_jobsMutex);
+
+    while (m_workerThreads.size() < m_uThreads)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, workerThread, this) != 0)
+        {
+            // run with the threads we have
+            m_uThreads = m_workerThreads.size();
+            break;
+        }
+        m_workerThreads.push_back(thread);
+    }
+#endif // EMSCRIPTEN
+}
+
+void CCParticleSimulator::stopThreads()
+{
+    if (m_workerThreads.empty())
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&m_jobsMutex);
+    m_bQuit = true;
+    pthread_mutex_unlock(&m_jobsMutex);
+    pthread_cond_broadcast(&m_jobsCondition);
+
+    for (unsigned int i = 0; i < m_workerThreads.size(); ++i)
+    {
+        pthread_join(m_workerThreads[i], NULL);
+    }
+    m_workerThreads.clear();
+}
+
+NS_CC_END
@@ -0,0 +1,124 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CCPARTICLE_SIMULATOR_H__
+#define __CCPARTICLE_SIMULATOR_H__
+
+#include "cocoa/CCObject.h"
+#include "cocoa/CCGeometry.h"
+#include "ccConfig.h"
+#include <vector>
+#include <pthread.h>
+
+NS_CC_BEGIN
+
+class CCParticleSystem;
+
+/**
+ * @addtogroup particle_nodes
+ * @{
+ */
+
+/** Priority of the simulator in the scheduler: after the particle systems, which update with priority 1 */
+#define kCCParticleSimulatorPriority INT_MAX
+
+/** @brief Updates the particle systems in parallel, on worker threads.
+
+ When it is enabled, CCParticleSystem::update() doesn't update the particles: it queues the system in the simulator.
+ Once all the systems have been updated by the scheduler, the simulator runs CCParticleSystem::updateParticles()
+ (emission, life, integration and quads) for all the queued systems, including the ones in a CCParticleBatchNode,
+ on its worker threads and the main thread. Then, back on the main thread, it calls CCParticleSystem::postStep()
+ for the systems and removes the finished ones.
+
+ Every system draws its random numbers from its own generator (see CCParticleSystem::setRandomSeed()),
+ so the particles don't depend on the thread that updated them.
+
+ Disabled by default.
+ @since v2.1
+ */
+class CC_DLL CCParticleSimulator : public CCObject
+{
+public:
+    CCParticleSimulator();
+    virtual ~CCParticleSimulator();
+
+    /** returns the shared simulator */
+    static CCParticleSimulator* sharedParticleSimulator();
+
+    /** stops the worker threads and releases the shared simulator */
+    static void purgeSharedParticleSimulator();
+
+    /** whether or not the particle systems are updated by the simulator */
+    bool isEnabled() { return m_bEnabled; }
+    /** enables or disables the simulator. The systems queued when it's disabled are updated immediately */
+    void setEnabled(bool bEnabled);
+
+    /** number of worker threads. CC_PARTICLE_SIMULATION_THREADS by default */
+    unsigned int getThreads() { return m_uThreads; }
+    /** sets the number of worker threads. 0 updates all the systems on the main thread */
+    void setThreads(unsigned int uThreads);
+
+    /** queues the system to be updated by dt at the end of the scheduler tick. Called by CCParticleSystem::update().
+     A system queued twice is updated once, with the sum of the delta times.
+     */
+    void addSystem(CCParticleSystem *pSystem, float dt);
+
+    /** updates all the queued systems. Scheduled after the particle systems while the simulator is enabled */
+    virtual void update(float dt);
+
+private:
+    void startThreads();
+    void stopThreads();
+    void runJobs();
+    static void* workerThread(void *pData);
+
+    typedef struct _ccParticleJob
+    {
+        CCParticleSystem    *system;        // retained
+        float               dt;
+        CCPoint             position;       // CCParticleSystem::computeCurrentPosition(), taken on the main thread
+        bool                alive;          // result of CCParticleSystem::updateParticles()
+    } ccParticleJob;
+
+    bool                        m_bEnabled;
+    unsigned int                m_uThreads;
+    std::vector<ccParticleJob>  m_jobs;
+
+    std::vector<pthread_t>      m_workerThreads;
+    pthread_mutex_t             m_jobsMutex;
+    pthread_cond_t              m_jobsCondition;    // signaled when there are jobs to run or the threads must quit
+    pthread_cond_t              m_doneCondition;    // signaled when all the jobs are done
+    unsigned int                m_uJobsCount;       // jobs of the current generation
+    unsigned int                m_uNextJob;
+    unsigned int                m_uJobsDone;
+    unsigned int                m_uGeneration;      // incremented every time jobs are started
+    bool                        m_bQuit;
+};
+
+// end of particle_nodes group
+/// @}
+
+NS_CC_END
+
+#endif // __CCPARTICLE_SIMULATOR_H__
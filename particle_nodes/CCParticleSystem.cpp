@@ -54,11 +54,20 @@ THE SOFTWARE.
 #include "support/zip_support/ZipUtils.h"
 #include "CCDirector.h"
 #include "support/CCProfiling.h"
+#include "CCParticleSimulator.h"
 // opengl
 #include "CCGL.h"
 
 #include <string>
 
+#if CC_USE_PARTICLE_SIMD && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define CC_PARTICLE_USE_SSE 1
+#elif CC_USE_PARTICLE_SIMD && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#include <arm_neon.h>
+#define CC_PARTICLE_USE_NEON 1
+#endif
+
 using namespace std;
 
 
@@ -81,16 +90,294 @@ NS_CC_BEGIN
 //  cocos2d uses a another approach, but the results are almost identical. 
 //
 
+// number of float arrays in CCParticleData, laid out one after the other from posX
+#define kCCParticleDataFloatArrays 25
+
+CCParticleData::CCParticleData()
+: posX(NULL)
+, posY(NULL)
+, startPosX(NULL)
+, startPosY(NULL)
+, colorR(NULL)
+, colorG(NULL)
+, colorB(NULL)
+, colorA(NULL)
+, deltaColorR(NULL)
+, deltaColorG(NULL)
+, deltaColorB(NULL)
+, deltaColorA(NULL)
+, size(NULL)
+, deltaSize(NULL)
+, rotation(NULL)
+, deltaRotation(NULL)
+, timeToLive(NULL)
+, atlasIndex(NULL)
+, capacity(0)
+, m_pBuffer(NULL)
+{
+    modeA.dirX = modeA.dirY = modeA.radialAccel = modeA.tangentialAccel = NULL;
+    modeB.angle = modeB.degreesPerSecond = modeB.radius = modeB.deltaRadius = NULL;
+}
+
+CCParticleData::~CCParticleData()
+{
+    freeArrays();
+}
+
+bool CCParticleData::init(unsigned int uCount)
+{
+    freeArrays();
+
+    unsigned int uCapacity = (uCount + 3) & ~3U;
+    if (uCapacity == 0)
+    {
+        return true;
+    }
+
+    // one block for all the arrays, plus room to align the first one on 16 bytes.
+    // the capacity is a multiple of 4, so all the arrays are aligned too
+    size_t uArraySize = uCapacity * sizeof(float);
+    m_pBuffer = calloc(1, uArraySize * (kCCParticleDataFloatArrays + 1) + 15);
+    if (! m_pBuffer)
+    {
+        return false;
+    }
+
+    float *pArray = (float*)(((size_t)m_pBuffer + 15) & ~(size_t)15);
+    float **ppArrays[kCCParticleDataFloatArrays] = {
+        &posX, &posY, &startPosX, &startPosY,
+        &colorR, &colorG, &colorB, &colorA,
+        &deltaColorR, &deltaColorG, &deltaColorB, &deltaColorA,
+        &size, &deltaSize, &rotation, &deltaRotation, &timeToLive,
+        &modeA.dirX, &modeA.dirY, &modeA.radialAccel, &modeA.tangentialAccel,
+        &modeB.angle, &modeB.degreesPerSecond, &modeB.radius, &modeB.deltaRadius
+    };
+    for (unsigned int i = 0; i < kCCParticleDataFloatArrays; ++i)
+    {
+        *ppArrays[i] = pArray;
+        pArray += uCapacity;
+    }
+    atlasIndex = (unsigned int*)pArray;
+
+    capacity = uCapacity;
+    return true;
+}
+
+void CCParticleData::freeArrays()
+{
+    CC_SAFE_FREE(m_pBuffer);
+
+    posX = posY = startPosX = startPosY = NULL;
+    colorR = colorG = colorB = colorA = NULL;
+    deltaColorR = deltaColorG = deltaColorB = deltaColorA = NULL;
+    size = deltaSize = rotation = deltaRotation = timeToLive = NULL;
+    modeA.dirX = modeA.dirY = modeA.radialAccel = modeA.tangentialAccel = NULL;
+    modeB.angle = modeB.degreesPerSecond = modeB.radius = modeB.deltaRadius = NULL;
+    atlasIndex = NULL;
+    capacity = 0;
+}
+
+void CCParticleData::copyParticle(unsigned int uDst, unsigned int uSrc)
+{
+    float *pArray = posX;
+    for (unsigned int i = 0; i < kCCParticleDataFloatArrays; ++i, pArray += capacity)
+    {
+        pArray[uDst] = pArray[uSrc];
+    }
+    atlasIndex[uDst] = atlasIndex[uSrc];
+}
+
+//
+// Particle integration kernels.
+// They process the particles 4 at a time up to uCount rounded up to 4, which stays in the arrays
+// since their capacity is a multiple of 4. The extra values are dead particles, updating them is harmless.
+//
+
+// pValues[i] += pDeltas[i] * dt
+static void ccParticlesMultiplyAdd(float *pValues, const float *pDeltas, float dt, unsigned int uCount)
+{
+#if CC_PARTICLE_USE_SSE
+    __m128 vDt = _mm_set1_ps(dt);
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        _mm_store_ps(pValues + i, _mm_add_ps(_mm_load_ps(pValues + i), _mm_mul_ps(_mm_load_ps(pDeltas + i), vDt)));
+    }
+#elif CC_PARTICLE_USE_NEON
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        vst1q_f32(pValues + i, vmlaq_n_f32(vld1q_f32(pValues + i), vld1q_f32(pDeltas + i), dt));
+    }
+#else
+    for (unsigned int i = 0; i < uCount; ++i)
+    {
+        pValues[i] += pDeltas[i] * dt;
+    }
+#endif
+}
+
+// pValues[i] = MAX(0, pValues[i] + pDeltas[i] * dt)
+static void ccParticlesMultiplyAddPositive(float *pValues, const float *pDeltas, float dt, unsigned int uCount)
+{
+#if CC_PARTICLE_USE_SSE
+    __m128 vDt = _mm_set1_ps(dt);
+    __m128 vZero = _mm_setzero_ps();
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        __m128 v = _mm_add_ps(_mm_load_ps(pValues + i), _mm_mul_ps(_mm_load_ps(pDeltas + i), vDt));
+        _mm_store_ps(pValues + i, _mm_max_ps(v, vZero));
+    }
+#elif CC_PARTICLE_USE_NEON
+    float32x4_t vZero = vdupq_n_f32(0);
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        float32x4_t v = vmlaq_n_f32(vld1q_f32(pValues + i), vld1q_f32(pDeltas + i), dt);
+        vst1q_f32(pValues + i, vmaxq_f32(v, vZero));
+    }
+#else
+    for (unsigned int i = 0; i < uCount; ++i)
+    {
+        pValues[i] = MAX(0, pValues[i] + pDeltas[i] * dt);
+    }
+#endif
+}
+
+// pValues[i] -= dt
+static void ccParticlesSubtract(float *pValues, float dt, unsigned int uCount)
+{
+#if CC_PARTICLE_USE_SSE
+    __m128 vDt = _mm_set1_ps(dt);
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        _mm_store_ps(pValues + i, _mm_sub_ps(_mm_load_ps(pValues + i), vDt));
+    }
+#elif CC_PARTICLE_USE_NEON
+    float32x4_t vDt = vdupq_n_f32(dt);
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        vst1q_f32(pValues + i, vsubq_f32(vld1q_f32(pValues + i), vDt));
+    }
+#else
+    for (unsigned int i = 0; i < uCount; ++i)
+    {
+        pValues[i] -= dt;
+    }
+#endif
+}
+
+// Mode A: the radial and tangential accelerations are along and perpendicular to the
+// direction from the source to the particle. dir += (radial + tangential + gravity) * dt, pos += dir * dt
+static void ccParticlesUpdateGravityMode(CCParticleData& data, const CCPoint& gravity, float dt, unsigned int uCount)
+{
+    float *px = data.posX, *py = data.posY;
+    float *dx = data.modeA.dirX, *dy = data.modeA.dirY;
+    const float *radialAccel = data.modeA.radialAccel, *tangentialAccel = data.modeA.tangentialAccel;
+
+#if CC_PARTICLE_USE_SSE
+    __m128 vDt = _mm_set1_ps(dt);
+    __m128 vGx = _mm_set1_ps(gravity.x);
+    __m128 vGy = _mm_set1_ps(gravity.y);
+    __m128 vOne = _mm_set1_ps(1.0f);
+    __m128 vZero = _mm_setzero_ps();
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        __m128 x = _mm_load_ps(px + i);
+        __m128 y = _mm_load_ps(py + i);
+
+        // normalized position, (0, 0) for the particles at the source
+        __m128 lengthSq = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        __m128 invLength = _mm_and_ps(_mm_cmpneq_ps(lengthSq, vZero), _mm_div_ps(vOne, _mm_sqrt_ps(lengthSq)));
+        __m128 nx = _mm_mul_ps(x, invLength);
+        __m128 ny = _mm_mul_ps(y, invLength);
+
+        __m128 radial = _mm_load_ps(radialAccel + i);
+        __m128 tangential = _mm_load_ps(tangentialAccel + i);
+        __m128 ax = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(nx, radial), _mm_mul_ps(ny, tangential)), vGx);
+        __m128 ay = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ny, radial), _mm_mul_ps(nx, tangential)), vGy);
+
+        __m128 vx = _mm_add_ps(_mm_load_ps(dx + i), _mm_mul_ps(ax, vDt));
+        __m128 vy = _mm_add_ps(_mm_load_ps(dy + i), _mm_mul_ps(ay, vDt));
+        _mm_store_ps(dx + i, vx);
+        _mm_store_ps(dy + i, vy);
+        _mm_store_ps(px + i, _mm_add_ps(x, _mm_mul_ps(vx, vDt)));
+        _mm_store_ps(py + i, _mm_add_ps(y, _mm_mul_ps(vy, vDt)));
+    }
+#elif CC_PARTICLE_USE_NEON
+    float32x4_t vZero = vdupq_n_f32(0);
+    for (unsigned int i = 0; i < uCount; i += 4)
+    {
+        float32x4_t x = vld1q_f32(px + i);
+        float32x4_t y = vld1q_f32(py + i);
+
+        // normalized position, (0, 0) for the particles at the source.
+        // NEON has no division: reciprocal square root estimate refined by 2 Newton-Raphson steps
+        float32x4_t lengthSq = vmlaq_f32(vmulq_f32(x, x), y, y);
+        float32x4_t invLength = vrsqrteq_f32(lengthSq);
+        invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(lengthSq, invLength), invLength));
+        invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(lengthSq, invLength), invLength));
+        uint32x4_t nonZero = vmvnq_u32(vceqq_f32(lengthSq, vZero));
+        invLength = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(invLength), nonZero));
+        float32x4_t nx = vmulq_f32(x, invLength);
+        float32x4_t ny = vmulq_f32(y, invLength);
+
+        float32x4_t radial = vld1q_f32(radialAccel + i);
+        float32x4_t tangential = vld1q_f32(tangentialAccel + i);
+        float32x4_t ax = vaddq_f32(vmlsq_f32(vmulq_f32(nx, radial), ny, tangential), vdupq_n_f32(gravity.x));
+        float32x4_t ay = vaddq_f32(vmlaq_f32(vmulq_f32(ny, radial), nx, tangential), vdupq_n_f32(gravity.y));
+
+        float32x4_t vx = vmlaq_n_f32(vld1q_f32(dx + i), ax, dt);
+        float32x4_t vy = vmlaq_n_f32(vld1q_f32(dy + i), ay, dt);
+        vst1q_f32(dx + i, vx);
+        vst1q_f32(dy + i, vy);
+        vst1q_f32(px + i, vmlaq_n_f32(x, vx, dt));
+        vst1q_f32(py + i, vmlaq_n_f32(y, vy, dt));
+    }
+#else
+    for (unsigned int i = 0; i < uCount; ++i)
+    {
+        float nx = 0, ny = 0;
+        if (px[i] || py[i])
+        {
+            float invLength = 1.0f / sqrtf(px[i] * px[i] + py[i] * py[i]);
+            nx = px[i] * invLength;
+            ny = py[i] * invLength;
+        }
+
+        float ax = nx * radialAccel[i] - ny * tangentialAccel[i] + gravity.x;
+        float ay = ny * radialAccel[i] + nx * tangentialAccel[i] + gravity.y;
+
+        dx[i] += ax * dt;
+        dy[i] += ay * dt;
+        px[i] += dx[i] * dt;
+        py[i] += dy[i] * dt;
+    }
+#endif
+}
+
+// Mode B: the particles turn around the source while their radius changes
+static void ccParticlesUpdateRadiusMode(CCParticleData& data, float dt, unsigned int uCount)
+{
+    ccParticlesMultiplyAdd(data.modeB.angle, data.modeB.degreesPerSecond, dt, uCount);
+    ccParticlesMultiplyAdd(data.modeB.radius, data.modeB.deltaRadius, dt, uCount);
+
+    for (unsigned int i = 0; i < uCount; ++i)
+    {
+        data.posX[i] = - cosf(data.modeB.angle[i]) * data.modeB.radius[i];
+        data.posY[i] = - sinf(data.modeB.angle[i]) * data.modeB.radius[i];
+    }
+}
+
 CCParticleSystem::CCParticleSystem()
 : m_sPlistFile("")
 , m_fElapsed(0)
-, m_pParticles(NULL)
 , m_fEmitCounter(0)
 , m_uParticleIdx(0)
 , m_pBatchNode(NULL)
 , m_uAtlasIndex(0)
 , m_bTransformSystemDirty(false)
 , m_uAllocatedParticles(0)
+, m_tCurrentPosition(CCPointZero)
+, m_uRandomState(0)
+, m_nSimulationJob(-1)
 , m_bIsActive(true)
 , m_uParticleCount(0)
 , m_fDuration(0)
@@ -116,6 +403,7 @@ CCParticleSystem::CCParticleSystem()
 , m_ePositionType(kCCPositionTypeFree)
 , m_bIsAutoRemoveOnFinish(false)
 , m_nEmitterMode(kCCParticleModeGravity)
+, m_uRandomSeed(0)
 {
     modeA.gravity = CCPointZero;
     modeA.speed = 0;
@@ -393,11 +681,7 @@ bool CCParticleSystem::initWithTotalParticles(unsigned int numberOfParticles)
 {
     m_uTotalParticles = numberOfParticles;
 
-    CC_SAFE_FREE(m_pParticles);
-    
-    m_pParticles = (tCCParticle*)calloc(m_uTotalParticles, sizeof(tCCParticle));
-
-    if( ! m_pParticles )
+    if( ! m_tParticleData.init(m_uTotalParticles) )
     {
         CCLOG("Particle system: not enough memory");
         this->release();
@@ -409,12 +693,15 @@ bool CCParticleSystem::initWithTotalParticles(unsigned int numberOfParticles)
     {
         for (unsigned int i = 0; i < m_uTotalParticles; i++)
         {
-            m_pParticles[i].atlasIndex=i;
+            m_tParticleData.atlasIndex[i]=i;
         }
     }
     // default, active
     m_bIsActive = true;
 
+    // the systems draw their own random numbers, from a seed taken from the global generator
+    setRandomSeed((unsigned int)rand());
+
     // default blend function
     m_tBlendFunc.src = CC_BLEND_SRC;
     m_tBlendFunc.dst = CC_BLEND_DST;
@@ -447,7 +734,6 @@ CCParticleSystem::~CCParticleSystem()
     // Since the scheduler retains the "target (in this case the ParticleSystem)
 	// it is not needed to call "unscheduleUpdate" here. In fact, it will be called in "cleanup"
     //unscheduleUpdate();
-    CC_SAFE_FREE(m_pParticles);
     CC_SAFE_RELEASE(m_pTexture);
 }
 
@@ -458,122 +744,126 @@ bool CCParticleSystem::addParticle()
         return false;
     }
 
-    tCCParticle * particle = &m_pParticles[ m_uParticleCount ];
-    this->initParticle(particle);
+    m_tCurrentPosition = this->computeCurrentPosition();
+    this->initParticle(m_uParticleCount);
     ++m_uParticleCount;
 
     return true;
 }
 
-void CCParticleSystem::initParticle(tCCParticle* particle)
+void CCParticleSystem::initParticle(unsigned int uIndex)
 {
+    CCParticleData& particle = m_tParticleData;
+
     // timeToLive
     // no negative life. prevent division by 0
-    particle->timeToLive = m_fLife + m_fLifeVar * CCRANDOM_MINUS1_1();
-    particle->timeToLive = MAX(0, particle->timeToLive);
+    particle.timeToLive[uIndex] = m_fLife + m_fLifeVar * randomMinus1To1();
+    particle.timeToLive[uIndex] = MAX(0, particle.timeToLive[uIndex]);
 
     // position
-    particle->pos.x = m_tSourcePosition.x + m_tPosVar.x * CCRANDOM_MINUS1_1();
+    particle.posX[uIndex] = m_tSourcePosition.x + m_tPosVar.x * randomMinus1To1();
 
-    particle->pos.y = m_tSourcePosition.y + m_tPosVar.y * CCRANDOM_MINUS1_1();
+    particle.posY[uIndex] = m_tSourcePosition.y + m_tPosVar.y * randomMinus1To1();
 
 
     // Color
     ccColor4F start;
-    start.r = clampf(m_tStartColor.r + m_tStartColorVar.r * CCRANDOM_MINUS1_1(), 0, 1);
-    start.g = clampf(m_tStartColor.g + m_tStartColorVar.g * CCRANDOM_MINUS1_1(), 0, 1);
-    start.b = clampf(m_tStartColor.b + m_tStartColorVar.b * CCRANDOM_MINUS1_1(), 0, 1);
-    start.a = clampf(m_tStartColor.a + m_tStartColorVar.a * CCRANDOM_MINUS1_1(), 0, 1);
+    start.r = clampf(m_tStartColor.r + m_tStartColorVar.r * randomMinus1To1(), 0, 1);
+    start.g = clampf(m_tStartColor.g + m_tStartColorVar.g * randomMinus1To1(), 0, 1);
+    start.b = clampf(m_tStartColor.b + m_tStartColorVar.b * randomMinus1To1(), 0, 1);
+    start.a = clampf(m_tStartColor.a + m_tStartColorVar.a * randomMinus1To1(), 0, 1);
 
     ccColor4F end;
-    end.r = clampf(m_tEndColor.r + m_tEndColorVar.r * CCRANDOM_MINUS1_1(), 0, 1);
-    end.g = clampf(m_tEndColor.g + m_tEndColorVar.g * CCRANDOM_MINUS1_1(), 0, 1);
-    end.b = clampf(m_tEndColor.b + m_tEndColorVar.b * CCRANDOM_MINUS1_1(), 0, 1);
-    end.a = clampf(m_tEndColor.a + m_tEndColorVar.a * CCRANDOM_MINUS1_1(), 0, 1);
-
-    particle->color = start;
-    particle->deltaColor.r = (end.r - start.r) / particle->timeToLive;
-    particle->deltaColor.g = (end.g - start.g) / particle->timeToLive;
-    particle->deltaColor.b = (end.b - start.b) / particle->timeToLive;
-    particle->deltaColor.a = (end.a - start.a) / particle->timeToLive;
+    end.r = clampf(m_tEndColor.r + m_tEndColorVar.r * randomMinus1To1(), 0, 1);
+    end.g = clampf(m_tEndColor.g + m_tEndColorVar.g * randomMinus1To1(), 0, 1);
+    end.b = clampf(m_tEndColor.b + m_tEndColorVar.b * randomMinus1To1(), 0, 1);
+    end.a = clampf(m_tEndColor.a + m_tEndColorVar.a * randomMinus1To1(), 0, 1);
+
+    particle.colorR[uIndex] = start.r;
+    particle.colorG[uIndex] = start.g;
+    particle.colorB[uIndex] = start.b;
+    particle.colorA[uIndex] = start.a;
+    particle.deltaColorR[uIndex] = (end.r - start.r) / particle.timeToLive[uIndex];
+    particle.deltaColorG[uIndex] = (end.g - start.g) / particle.timeToLive[uIndex];
+    particle.deltaColorB[uIndex] = (end.b - start.b) / particle.timeToLive[uIndex];
+    particle.deltaColorA[uIndex] = (end.a - start.a) / particle.timeToLive[uIndex];
 
     // size
-    float startS = m_fStartSize + m_fStartSizeVar * CCRANDOM_MINUS1_1();
+    float startS = m_fStartSize + m_fStartSizeVar * randomMinus1To1();
     startS = MAX(0, startS); // No negative value
 
-    particle->size = startS;
+    particle.size[uIndex] = startS;
 
     if( m_fEndSize == kCCParticleStartSizeEqualToEndSize )
     {
-        particle->deltaSize = 0;
+        particle.deltaSize[uIndex] = 0;
     }
     else
     {
-        float endS = m_fEndSize + m_fEndSizeVar * CCRANDOM_MINUS1_1();
+        float endS = m_fEndSize + m_fEndSizeVar * randomMinus1To1();
         endS = MAX(0, endS); // No negative values
-        particle->deltaSize = (endS - startS) / particle->timeToLive;
+        particle.deltaSize[uIndex] = (endS - startS) / particle.timeToLive[uIndex];
     }
 
     // rotation
-    float startA = m_fStartSpin + m_fStartSpinVar * CCRANDOM_MINUS1_1();
-    float endA = m_fEndSpin + m_fEndSpinVar * CCRANDOM_MINUS1_1();
-    particle->rotation = startA;
-    particle->deltaRotation = (endA - startA) / particle->timeToLive;
+    float startA = m_fStartSpin + m_fStartSpinVar * randomMinus1To1();
+    float endA = m_fEndSpin + m_fEndSpinVar * randomMinus1To1();
+    particle.rotation[uIndex] = startA;
+    particle.deltaRotation[uIndex] = (endA - startA) / particle.timeToLive[uIndex];
 
     // position
-    if( m_ePositionType == kCCPositionTypeFree )
+    if( m_ePositionType == kCCPositionTypeFree || m_ePositionType == kCCPositionTypeRelative )
     {
-        particle->startPos = this->convertToWorldSpace(CCPointZero);
-    }
-    else if ( m_ePositionType == kCCPositionTypeRelative )
-    {
-        particle->startPos = m_obPosition;
+        particle.startPosX[uIndex] = m_tCurrentPosition.x;
+        particle.startPosY[uIndex] = m_tCurrentPosition.y;
     }
 
     // direction
-    float a = CC_DEGREES_TO_RADIANS( m_fAngle + m_fAngleVar * CCRANDOM_MINUS1_1() );    
+    float a = CC_DEGREES_TO_RADIANS( m_fAngle + m_fAngleVar * randomMinus1To1() );    
 
     // Mode Gravity: A
     if (m_nEmitterMode == kCCParticleModeGravity) 
     {
         CCPoint v(cosf( a ), sinf( a ));
-        float s = modeA.speed + modeA.speedVar * CCRANDOM_MINUS1_1();
+        float s = modeA.speed + modeA.speedVar * randomMinus1To1();
 
         // direction
-        particle->modeA.dir = ccpMult( v, s );
+        CCPoint dir = ccpMult( v, s );
+        particle.modeA.dirX[uIndex] = dir.x;
+        particle.modeA.dirY[uIndex] = dir.y;
 
         // radial accel
-        particle->modeA.radialAccel = modeA.radialAccel + modeA.radialAccelVar * CCRANDOM_MINUS1_1();
+        particle.modeA.radialAccel[uIndex] = modeA.radialAccel + modeA.radialAccelVar * randomMinus1To1();
  
 
         // tangential accel
-        particle->modeA.tangentialAccel = modeA.tangentialAccel + modeA.tangentialAccelVar * CCRANDOM_MINUS1_1();
+        particle.modeA.tangentialAccel[uIndex] = modeA.tangentialAccel + modeA.tangentialAccelVar * randomMinus1To1();
 
         // rotation is dir
         if(modeA.rotationIsDir)
-            particle->rotation = -CC_RADIANS_TO_DEGREES(ccpToAngle(particle->modeA.dir));
+            particle.rotation[uIndex] = -CC_RADIANS_TO_DEGREES(ccpToAngle(dir));
     }
 
     // Mode Radius: B
     else 
     {
         // Set the default diameter of the particle from the source position
-        float startRadius = modeB.startRadius + modeB.startRadiusVar * CCRANDOM_MINUS1_1();
-        float endRadius = modeB.endRadius + modeB.endRadiusVar * CCRANDOM_MINUS1_1();
+        float startRadius = modeB.startRadius + modeB.startRadiusVar * randomMinus1To1();
+        float endRadius = modeB.endRadius + modeB.endRadiusVar * randomMinus1To1();
 
-        particle->modeB.radius = startRadius;
+        particle.modeB.radius[uIndex] = startRadius;
 
         if(modeB.endRadius == kCCParticleStartRadiusEqualToEndRadius)
         {
-            particle->modeB.deltaRadius = 0;
+            particle.modeB.deltaRadius[uIndex] = 0;
         }
         else
         {
-            particle->modeB.deltaRadius = (endRadius - startRadius) / particle->timeToLive;
+            particle.modeB.deltaRadius[uIndex] = (endRadius - startRadius) / particle.timeToLive[uIndex];
         }
 
-        particle->modeB.angle = a;
-        particle->modeB.degreesPerSecond = CC_DEGREES_TO_RADIANS(modeB.rotatePerSecond + modeB.rotatePerSecondVar * CCRANDOM_MINUS1_1());
+        particle.modeB.angle[uIndex] = a;
+        particle.modeB.degreesPerSecond[uIndex] = CC_DEGREES_TO_RADIANS(modeB.rotatePerSecond + modeB.rotatePerSecondVar * randomMinus1To1());
     }    
 }
 
@@ -590,8 +880,7 @@ void CCParticleSystem::resetSystem()
     m_fElapsed = 0;
     for (m_uParticleIdx = 0; m_uParticleIdx < m_uParticleCount; ++m_uParticleIdx)
     {
-        tCCParticle *p = &m_pParticles[m_uParticleIdx];
-        p->timeToLive = 0;
+        m_tParticleData.timeToLive[m_uParticleIdx] = 0;
     }
 }
 bool CCParticleSystem::isFull()
@@ -602,8 +891,39 @@ bool CCParticleSystem::isFull()
 // ParticleSystem - MainLoop
 void CCParticleSystem::update(float dt)
 {
+    CCParticleSimulator *pSimulator = CCParticleSimulator::sharedParticleSimulator();
+    if (pSimulator->isEnabled())
+    {
+        // the particles are updated with the ones of the other systems, on the simulator threads
+        pSimulator->addSystem(this, dt);
+        return;
+    }
+
     CC_PROFILER_START_CATEGORY(kCCProfilerCategoryParticles , "CCParticleSystem - update");
 
+    bool bAlive = updateParticles(dt, computeCurrentPosition());
+    finishUpdate(bAlive);
+
+    CC_PROFILER_STOP_CATEGORY(kCCProfilerCategoryParticles , "CCParticleSystem - update");
+}
+
+CCPoint CCParticleSystem::computeCurrentPosition()
+{
+    if (m_ePositionType == kCCPositionTypeFree)
+    {
+        return this->convertToWorldSpace(CCPointZero);
+    }
+    else if (m_ePositionType == kCCPositionTypeRelative)
+    {
+        return m_obPosition;
+    }
+    return CCPointZero;
+}
+
+bool CCParticleSystem::updateParticles(float dt, const CCPoint& currentPosition)
+{
+    m_tCurrentPosition = currentPosition;
+
     if (m_bIsActive && m_fEmissionRate)
     {
         float rate = 1.0f / m_fEmissionRate;
@@ -615,7 +935,8 @@ void CCParticleSystem::update(float dt)
         
         while (m_uParticleCount < m_uTotalParticles && m_fEmitCounter > rate) 
         {
-            this->addParticle();
+            this->initParticle(m_uParticleCount);
+            ++m_uParticleCount;
             m_fEmitCounter -= rate;
         }
 
@@ -628,145 +949,119 @@ void CCParticleSystem::update(float dt)
 
     m_uParticleIdx = 0;
 
-    CCPoint currentPosition = CCPointZero;
-    if (m_ePositionType == kCCPositionTypeFree)
-    {
-        currentPosition = this->convertToWorldSpace(CCPointZero);
-    }
-    else if (m_ePositionType == kCCPositionTypeRelative)
-    {
-        currentPosition = m_obPosition;
-    }
-
     if (m_bVisible)
     {
-        while (m_uParticleIdx < m_uParticleCount)
-        {
-            tCCParticle *p = &m_pParticles[m_uParticleIdx];
+        CCParticleData& data = m_tParticleData;
 
-            // life
-            p->timeToLive -= dt;
+        // life
+        ccParticlesSubtract(data.timeToLive, dt, m_uParticleCount);
 
-            if (p->timeToLive > 0) 
+        // remove the dead particles, moving the last ones in their place
+        while (m_uParticleIdx < m_uParticleCount)
+        {
+            if (data.timeToLive[m_uParticleIdx] > 0)
             {
-                // Mode A: gravity, direction, tangential accel & radial accel
-                if (m_nEmitterMode == kCCParticleModeGravity) 
-                {
-                    CCPoint tmp, radial, tangential;
-
-                    radial = CCPointZero;
-                    // radial acceleration
-                    if (p->pos.x || p->pos.y)
-                    {
-                        radial = ccpNormalize(p->pos);
-                    }
-                    tangential = radial;
-                    radial = ccpMult(radial, p->modeA.radialAccel);
-
-                    // tangential acceleration
-                    float newy = tangential.x;
-                    tangential.x = -tangential.y;
-                    tangential.y = newy;
-                    tangential = ccpMult(tangential, p->modeA.tangentialAccel);
-
-                    // (gravity + radial + tangential) * dt
-                    tmp = ccpAdd( ccpAdd( radial, tangential), modeA.gravity);
-                    tmp = ccpMult( tmp, dt);
-                    p->modeA.dir = ccpAdd( p->modeA.dir, tmp);
-                    tmp = ccpMult(p->modeA.dir, dt);
-                    p->pos = ccpAdd( p->pos, tmp );
-                }
-
-                // Mode B: radius movement
-                else 
-                {                
-                    // Update the angle and radius of the particle.
-                    p->modeB.angle += p->modeB.degreesPerSecond * dt;
-                    p->modeB.radius += p->modeB.deltaRadius * dt;
-
-                    p->pos.x = - cosf(p->modeB.angle) * p->modeB.radius;
-                    p->pos.y = - sinf(p->modeB.angle) * p->modeB.radius;
-                }
-
-                // color
-                p->color.r += (p->deltaColor.r * dt);
-                p->color.g += (p->deltaColor.g * dt);
-                p->color.b += (p->deltaColor.b * dt);
-                p->color.a += (p->deltaColor.a * dt);
+                ++m_uParticleIdx;
+                continue;
+            }
 
-                // size
-                p->size += (p->deltaSize * dt);
-                p->size = MAX( 0, p->size );
+            // life < 0
+            unsigned int currentIndex = data.atlasIndex[m_uParticleIdx];
+            if( m_uParticleIdx != m_uParticleCount-1 )
+            {
+                data.copyParticle(m_uParticleIdx, m_uParticleCount-1);
+            }
+            if (m_pBatchNode)
+            {
+                //disable the switched particle
+                m_pBatchNode->disableParticle(m_uAtlasIndex+currentIndex);
 
-                // angle
-                p->rotation += (p->deltaRotation * dt);
+                //switch indexes
+                data.atlasIndex[m_uParticleCount-1] = currentIndex;
+            }
 
-                //
-                // update values in quad
-                //
+            --m_uParticleCount;
 
-                CCPoint    newPos;
+            if( m_uParticleCount == 0 && m_bIsAutoRemoveOnFinish )
+            {
+                return false;
+            }
+        }
 
-                if (m_ePositionType == kCCPositionTypeFree || m_ePositionType == kCCPositionTypeRelative) 
-                {
-                    CCPoint diff = ccpSub( currentPosition, p->startPos );
-                    newPos = ccpSub(p->pos, diff);
-                } 
-                else
-                {
-                    newPos = p->pos;
-                }
+        // Mode A: gravity, direction, tangential accel & radial accel
+        if (m_nEmitterMode == kCCParticleModeGravity)
+        {
+            ccParticlesUpdateGravityMode(data, modeA.gravity, dt, m_uParticleCount);
+        }
+        // Mode B: radius movement
+        else
+        {
+            ccParticlesUpdateRadiusMode(data, dt, m_uParticleCount);
+        }
 
-                // translate newPos to correct position, since matrix transform isn't performed in batchnode
-                // don't update the particle with the new position information, it will interfere with the radius and tangential calculations
-                if (m_pBatchNode)
-                {
-                    newPos.x+=m_obPosition.x;
-                    newPos.y+=m_obPosition.y;
-                }
+        // color
+        ccParticlesMultiplyAdd(data.colorR, data.deltaColorR, dt, m_uParticleCount);
+        ccParticlesMultiplyAdd(data.colorG, data.deltaColorG, dt, m_uParticleCount);
+        ccParticlesMultiplyAdd(data.colorB, data.deltaColorB, dt, m_uParticleCount);
+        ccParticlesMultiplyAdd(data.colorA, data.deltaColorA, dt, m_uParticleCount);
 
-                updateQuadWithParticle(p, newPos);
-                //updateParticleImp(self, updateParticleSel, p, newPos);
+        // size
+        ccParticlesMultiplyAddPositive(data.size, data.deltaSize, dt, m_uParticleCount);
 
-                // update particle counter
-                ++m_uParticleIdx;
-            } 
-            else 
-            {
-                // life < 0
-                int currentIndex = p->atlasIndex;
-                if( m_uParticleIdx != m_uParticleCount-1 )
-                {
-                    m_pParticles[m_uParticleIdx] = m_pParticles[m_uParticleCount-1];
-                }
-                if (m_pBatchNode)
-                {
-                    //disable the switched particle
-                    m_pBatchNode->disableParticle(m_uAtlasIndex+currentIndex);
+        // angle
+        ccParticlesMultiplyAdd(data.rotation, data.deltaRotation, dt, m_uParticleCount);
 
-                    //switch indexes
-                    m_pParticles[m_uParticleCount-1].atlasIndex = currentIndex;
-                }
+        //
+        // update values in quads
+        //
+        updateParticleQuads(currentPosition);
 
+        m_bTransformSystemDirty = false;
+    }
 
-                --m_uParticleCount;
+    return true;
+}
 
-                if( m_uParticleCount == 0 && m_bIsAutoRemoveOnFinish )
-                {
-                    this->unscheduleUpdate();
-                    m_pParent->removeChild(this, true);
-                    return;
-                }
-            }
-        } //while
-        m_bTransformSystemDirty = false;
+void CCParticleSystem::finishUpdate(bool bAlive)
+{
+    if (! bAlive)
+    {
+        this->unscheduleUpdate();
+        // the system may have been removed while CCParticleSimulator was updating it
+        if (m_pParent)
+        {
+            m_pParent->removeChild(this, true);
+        }
+        return;
     }
+
     if (! m_pBatchNode)
     {
         postStep();
     }
+    else
+    {
+        // the quads of the system were written without touching the atlas, which the systems of the batch share
+        m_pBatchNode->getTextureAtlas()->setDirtyRange(m_uAtlasIndex, m_uTotalParticles);
+    }
+}
 
-    CC_PROFILER_STOP_CATEGORY(kCCProfilerCategoryParticles , "CCParticleSystem - update");
+float CCParticleSystem::randomMinus1To1()
+{
+    // linear congruential generator (Numerical Recipes), the 24 high bits make the float
+    m_uRandomState = m_uRandomState * 1664525U + 1013904223U;
+    return (m_uRandomState >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+unsigned int CCParticleSystem::getRandomSeed()
+{
+    return m_uRandomSeed;
+}
+
+void CCParticleSystem::setRandomSeed(unsigned int uRandomSeed)
+{
+    m_uRandomSeed = uRandomSeed;
+    m_uRandomState = uRandomSeed;
 }
 
 void CCParticleSystem::updateWithNoTime(void)
@@ -774,6 +1069,16 @@ void CCParticleSystem::updateWithNoTime(void)
     this->update(0.0f);
 }
 
+void CCParticleSystem::updateParticleQuads(const CCPoint& currentPosition)
+{
+    tCCParticle particle;
+    for (m_uParticleIdx = 0; m_uParticleIdx < m_uParticleCount; ++m_uParticleIdx)
+    {
+        CCPoint newPosition = getParticle(m_uParticleIdx, currentPosition, &particle);
+        updateQuadWithParticle(&particle, newPosition);
+    }
+}
+
 void CCParticleSystem::updateQuadWithParticle(tCCParticle* particle, const CCPoint& newPosition)
 {
     CC_UNUSED_PARAM(particle);
@@ -781,6 +1086,43 @@ void CCParticleSystem::updateQuadWithParticle(tCCParticle* particle, const CCPoi
     // should be overridden
 }
 
+CCPoint CCParticleSystem::getParticle(unsigned int uIndex, const CCPoint& currentPosition, tCCParticle *pParticle)
+{
+    const CCParticleData& data = m_tParticleData;
+    unsigned int i = uIndex;
+
+    pParticle->pos = ccp(data.posX[i], data.posY[i]);
+    pParticle->startPos = ccp(data.startPosX[i], data.startPosY[i]);
+    pParticle->color = ccc4f(data.colorR[i], data.colorG[i], data.colorB[i], data.colorA[i]);
+    pParticle->deltaColor = ccc4f(data.deltaColorR[i], data.deltaColorG[i], data.deltaColorB[i], data.deltaColorA[i]);
+    pParticle->size = data.size[i];
+    pParticle->deltaSize = data.deltaSize[i];
+    pParticle->rotation = data.rotation[i];
+    pParticle->deltaRotation = data.deltaRotation[i];
+    pParticle->timeToLive = data.timeToLive[i];
+    pParticle->atlasIndex = data.atlasIndex[i];
+    pParticle->modeA.dir = ccp(data.modeA.dirX[i], data.modeA.dirY[i]);
+    pParticle->modeA.radialAccel = data.modeA.radialAccel[i];
+    pParticle->modeA.tangentialAccel = data.modeA.tangentialAccel[i];
+    pParticle->modeB.angle = data.modeB.angle[i];
+    pParticle->modeB.degreesPerSecond = data.modeB.degreesPerSecond[i];
+    pParticle->modeB.radius = data.modeB.radius[i];
+    pParticle->modeB.deltaRadius = data.modeB.deltaRadius[i];
+
+    CCPoint newPosition = pParticle->pos;
+    if (m_ePositionType == kCCPositionTypeFree || m_ePositionType == kCCPositionTypeRelative)
+    {
+        newPosition = ccpSub(newPosition, ccpSub(currentPosition, pParticle->startPos));
+    }
+
+    // translate newPos to correct position, since matrix transform isn't performed in batchnode
+    if (m_pBatchNode)
+    {
+        newPosition = ccpAdd(newPosition, m_obPosition);
+    }
+    return newPosition;
+}
+
 void CCParticleSystem::postStep()
 {
     // should be overridden
@@ -1317,7 +1659,7 @@ void CCParticleSystem::setBatchNode(CCParticleBatchNode* batchNode)
             //each particle needs a unique index
             for (unsigned int i = 0; i < m_uTotalParticles; i++)
             {
-                m_pParticles[i].atlasIndex=i;
+                m_tParticleData.atlasIndex[i]=i;
             }
         }
     }
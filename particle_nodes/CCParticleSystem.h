@@ -89,7 +89,8 @@ enum {
 }; 
 
 /**
-Structure that contains the values of each particle
+Structure that contains the values of each particle.
+The particles are stored in a CCParticleData, this is a copy of one of them given to updateQuadWithParticle().
 */
 typedef struct sCCParticle {
     CCPoint     pos;
@@ -125,6 +126,72 @@ typedef struct sCCParticle {
 
 }tCCParticle;
 
+/** @brief The values of the particles of a system, stored as a structure of arrays.
+
+Every attribute has its own array, so the update of the particles runs over contiguous floats
+and can be done 4 particles at a time. The arrays are 16 bytes aligned and their capacity is
+padded to a multiple of 4.
+@since v2.1
+*/
+class CC_DLL CCParticleData
+{
+public:
+    CCParticleData();
+    ~CCParticleData();
+
+    /** allocates the arrays for uCount particles, freeing the previous ones. The values are zeroed. */
+    bool init(unsigned int uCount);
+    /** frees the arrays */
+    void freeArrays();
+    /** copies all the values of the particle uSrc, atlas index included, to the particle uDst */
+    void copyParticle(unsigned int uDst, unsigned int uSrc);
+
+    float           *posX;
+    float           *posY;
+    float           *startPosX;
+    float           *startPosY;
+    float           *colorR;
+    float           *colorG;
+    float           *colorB;
+    float           *colorA;
+    float           *deltaColorR;
+    float           *deltaColorG;
+    float           *deltaColorB;
+    float           *deltaColorA;
+    float           *size;
+    float           *deltaSize;
+    float           *rotation;
+    float           *deltaRotation;
+    float           *timeToLive;
+
+    //! Mode A: gravity, direction, radial accel, tangential accel
+    struct {
+        float       *dirX;
+        float       *dirY;
+        float       *radialAccel;
+        float       *tangentialAccel;
+    } modeA;
+
+    //! Mode B: radius mode
+    struct {
+        float       *angle;
+        float       *degreesPerSecond;
+        float       *radius;
+        float       *deltaRadius;
+    } modeB;
+
+    unsigned int    *atlasIndex;
+
+    //! number of values of every array, a multiple of 4
+    unsigned int    capacity;
+
+private:
+    CCParticleData(const CCParticleData&);
+    CCParticleData& operator=(const CCParticleData&);
+
+    void *m_pBuffer;
+};
+
 //typedef void (*CC_UPDATE_PARTICLE_IMP)(id, SEL, tCCParticle*, CCPoint);
 
 class CCTexture2D;
@@ -216,8 +283,8 @@ protected:
         float rotatePerSecondVar;
     } modeB;
 
-    //! Array of particles
-    tCCParticle *m_pParticles;
+    //! Values of the particles
+    CCParticleData m_tParticleData;
 
     // color modulate
     //    BOOL colorModulate;
@@ -242,6 +309,13 @@ protected:
     bool m_bTransformSystemDirty;
     // Number of allocated particles
     unsigned int m_uAllocatedParticles;
+    // position the free and relative particles are moved relative to, for the update in progress
+    CCPoint m_tCurrentPosition;
+    // state of the random numbers generator of the particles
+    unsigned int m_uRandomState;
+    // index of the system in the queue of CCParticleSimulator, -1 if it isn't queued
+    int m_nSimulationJob;
+    friend class CCParticleSimulator;
 
     /** Is the emitter active */
     bool m_bIsActive;
@@ -368,6 +442,13 @@ public:
     */
     CC_PROPERTY(int, m_nEmitterMode, EmitterMode)
 
+    /** seed of the system's own random numbers generator, used to initialize the particles.
+    The random numbers don't depend on the other systems, so the system emits the same particles
+    whatever the thread it's updated on (see CCParticleSimulator). Initialized with rand() by initWithTotalParticles().
+    @since v2.1
+    */
+    CC_PROPERTY(unsigned int, m_uRandomSeed, RandomSeed)
+
 public:
     CCParticleSystem();
     virtual ~CCParticleSystem();
@@ -405,8 +486,8 @@ public:
     virtual bool initWithTotalParticles(unsigned int numberOfParticles);
     //! Add a particle to the emitter
     bool addParticle();
-    //! Initializes a particle
-    void initParticle(tCCParticle* particle);
+    //! Initializes the particle at index uIndex
+    void initParticle(unsigned int uIndex);
     //! stop emitting particles. Running particles will continue to run until they die
     void stopSystem();
     //! Kill all living particles.
@@ -414,7 +495,15 @@ public:
     //! whether or not the system is full
     bool isFull();
 
-    //! should be overridden by subclasses
+    /** should be overridden by subclasses.
+     Writes the quads of the m_uParticleCount living particles. currentPosition is the position
+     of the emitter the particles are moved relative to, for the free and relative position types.
+     By default, calls updateQuadWithParticle() for every particle.
+     */
+    virtual void updateParticleQuads(const CCPoint& currentPosition);
+    /** writes the quad of one particle, m_uParticleIdx being its index. Called by the default updateParticleQuads(),
+     and by CCParticleSystemQuad when a subclass overrides it. The particle is a copy, changing it has no effect.
+     */
     virtual void updateQuadWithParticle(tCCParticle* particle, const CCPoint& newPosition);
     //! should be overridden by subclasses
     virtual void postStep();
@@ -422,8 +511,24 @@ public:
     virtual void update(float dt);
     virtual void updateWithNoTime(void);
 
+    /** position the free and relative particles are moved relative to: the emitter in world space
+     for kCCPositionTypeFree, its position for kCCPositionTypeRelative.
+     */
+    CCPoint computeCurrentPosition();
+    /** the part of update() that touches neither the scene graph nor OpenGL, so CCParticleSimulator can run it
+     on a worker thread: emission, life, integration and quads.
+     Returns false if the system has finished and must be removed (see setAutoRemoveOnFinish()).
+     */
+    bool updateParticles(float dt, const CCPoint& currentPosition);
+    /** the end of update(), on the main thread: removes the system if bAlive is false, calls postStep() otherwise */
+    void finishUpdate(bool bAlive);
+
 protected:
     virtual void updateBlendFunc();
+    //! copies the values of the particle uIndex, and returns the position of its quad as updateQuadWithParticle() expects it
+    CCPoint getParticle(unsigned int uIndex, const CCPoint& currentPosition, tCCParticle *pParticle);
+    //! random number between -1 and 1 from the system's own generator, the counterpart of CCRANDOM_MINUS1_1()
+    float randomMinus1To1();
 };
 
 // end of particle_nodes group
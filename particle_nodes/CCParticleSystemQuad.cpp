@@ -29,12 +29,15 @@ THE SOFTWARE.
 #include "CCParticleSystemQuad.h"
 #include "sprite_nodes/CCSpriteFrame.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "CCParticleBatchNode.h"
 #include "textures/CCTextureAtlas.h"
 #include "shaders/CCShaderCache.h"
 #include "shaders/ccGLStateCache.h"
 #include "shaders/CCGLProgram.h"
 #include "support/TransformUtils.h"
+#include "cocoa/CCAffineTransform.h"
+#include "support/CCPointExtension.h"
 #include "support/CCNotificationCenter.h"
 #include "CCEventType.h"
 
@@ -43,6 +46,34 @@ THE SOFTWARE.
 
 NS_CC_BEGIN
 
+// number of particles whose vertices are computed together
+#define kCCParticleQuadBatchSize 64
+
+// the square of a particle, rotated around its center then moved to its position
+static void ccParticleQuadTransform(float rotation, float size, GLfloat x, GLfloat y, CCAffineTransform *pTransform, CCRect *pRect)
+{
+    if (rotation)
+    {
+        GLfloat r = (GLfloat)-CC_DEGREES_TO_RADIANS(rotation);
+        GLfloat cr = cosf(r);
+        GLfloat sr = sinf(r);
+        pTransform->a = cr;
+        pTransform->b = sr;
+        pTransform->c = -sr;
+        pTransform->d = cr;
+    }
+    else
+    {
+        pTransform->a = 1;
+        pTransform->b = 0;
+        pTransform->c = 0;
+        pTransform->d = 1;
+    }
+    pTransform->tx = x;
+    pTransform->ty = y;
+    pRect->setRect(-size/2, -size/2, size, size);
+}
+
 //implementation CCParticleSystemQuad
 // overriding the init method
 bool CCParticleSystemQuad::initWithTotalParticles(unsigned int numberOfParticles)
@@ -80,6 +111,9 @@ bool CCParticleSystemQuad::initWithTotalParticles(unsigned int numberOfParticles
 CCParticleSystemQuad::CCParticleSystemQuad()
 :m_pQuads(NULL)
 ,m_pIndices(NULL)
+,m_bQuadsDirty(true)
+,m_nQuadWriterOverridden(-1)
+,m_bProbingQuadWriter(false)
 #if CC_TEXTURE_ATLAS_USE_VAO
 ,m_uVAOname(0)
 #endif
@@ -237,106 +271,123 @@ void CCParticleSystemQuad::initIndices()
     }
 }
 
-void CCParticleSystemQuad::updateQuadWithParticle(tCCParticle* particle, const CCPoint& newPosition)
+void CCParticleSystemQuad::updateParticleQuads(const CCPoint& currentPosition)
 {
-    ccV3F_C4B_T2F_Quad *quad;
+    // the subclasses written for the array of tCCParticle override updateQuadWithParticle(). Find it out once,
+    // with the first particle: the probe is cleared only if the implementation of this class is called
+    if (m_nQuadWriterOverridden < 0 && m_uParticleCount > 0)
+    {
+        tCCParticle particle;
+        CCPoint newPosition = getParticle(0, currentPosition, &particle);
+        m_uParticleIdx = 0;
+        m_bProbingQuadWriter = true;
+        updateQuadWithParticle(&particle, newPosition);
+        m_nQuadWriterOverridden = m_bProbingQuadWriter ? 1 : 0;
+        m_bProbingQuadWriter = false;
+    }
+    if (m_nQuadWriterOverridden > 0)
+    {
+        CCParticleSystem::updateParticleQuads(currentPosition);
+        return;
+    }
 
+    const CCParticleData& data = m_tParticleData;
+
+    ccV3F_C4B_T2F_Quad *quads;
     if (m_pBatchNode)
     {
-        ccV3F_C4B_T2F_Quad *batchQuads = m_pBatchNode->getTextureAtlas()->getQuads();
-        quad = &(batchQuads[m_uAtlasIndex+particle->atlasIndex]);
+        // on the simulator threads: the range of the system is marked dirty by finishUpdate()
+        quads = m_pBatchNode->getTextureAtlas()->getRawQuads() + m_uAtlasIndex;
     }
     else
     {
-        quad = &(m_pQuads[m_uParticleIdx]);
+        quads = m_pQuads;
     }
-    ccColor4B color = (m_bOpacityModifyRGB)
-        ? ccc4( particle->color.r*particle->color.a*255, particle->color.g*particle->color.a*255, particle->color.b*particle->color.a*255, particle->color.a*255)
-        : ccc4( particle->color.r*255, particle->color.g*255, particle->color.b*255, particle->color.a*255);
 
-    quad->bl.colors = color;
-    quad->br.colors = color;
-    quad->tl.colors = color;
-    quad->tr.colors = color;
+    // Free and relative particles move relative to the emitter: pos - (currentPosition - startPos).
+    // Translate them to correct position in a batch node, since matrix transform isn't performed there
+    bool bFromStartPos = (m_ePositionType == kCCPositionTypeFree || m_ePositionType == kCCPositionTypeRelative);
+    CCPoint offset = bFromStartPos ? ccpNeg(currentPosition) : CCPointZero;
+    if (m_pBatchNode)
+    {
+        offset = ccpAdd(offset, m_obPosition);
+    }
 
-    // vertices
-    GLfloat size_2 = particle->size/2;
-    if (particle->rotation) 
+    // the vertices are computed kCCParticleQuadBatchSize quads at a time by CCAffineTransformApplyToQuads()
+    CCAffineTransform transforms[kCCParticleQuadBatchSize];
+    CCRect rects[kCCParticleQuadBatchSize];
+    ccV3F_C4B_T2F_Quad *batchQuads[kCCParticleQuadBatchSize];
+    unsigned int batchCount = 0;
+
+    for (unsigned int i = 0; i < m_uParticleCount; ++i)
     {
-        GLfloat x1 = -size_2;
-        GLfloat y1 = -size_2;
+        ccV3F_C4B_T2F_Quad *quad = m_pBatchNode ? &quads[data.atlasIndex[i]] : &quads[i];
 
-        GLfloat x2 = size_2;
-        GLfloat y2 = size_2;
-        GLfloat x = newPosition.x;
-        GLfloat y = newPosition.y;
+        GLfloat x = data.posX[i] + offset.x;
+        GLfloat y = data.posY[i] + offset.y;
+        if (bFromStartPos)
+        {
+            x += data.startPosX[i];
+            y += data.startPosY[i];
+        }
 
-        GLfloat r = (GLfloat)-CC_DEGREES_TO_RADIANS(particle->rotation);
-        GLfloat cr = cosf(r);
-        GLfloat sr = sinf(r);
-        GLfloat ax = x1 * cr - y1 * sr + x;
-        GLfloat ay = x1 * sr + y1 * cr + y;
-        GLfloat bx = x2 * cr - y1 * sr + x;
-        GLfloat by = x2 * sr + y1 * cr + y;
-        GLfloat cx = x2 * cr - y2 * sr + x;
-        GLfloat cy = x2 * sr + y2 * cr + y;
-        GLfloat dx = x1 * cr - y2 * sr + x;
-        GLfloat dy = x1 * sr + y2 * cr + y;
-
-        // bottom-left
-        quad->bl.vertices.x = ax;
-        quad->bl.vertices.y = ay;
+        float a = data.colorA[i];
+        ccColor4B color = (m_bOpacityModifyRGB)
+            ? ccc4( data.colorR[i]*a*255, data.colorG[i]*a*255, data.colorB[i]*a*255, a*255)
+            : ccc4( data.colorR[i]*255, data.colorG[i]*255, data.colorB[i]*255, a*255);
 
-        // bottom-right vertex:
-        quad->br.vertices.x = bx;
-        quad->br.vertices.y = by;
+        quad->bl.colors = color;
+        quad->br.colors = color;
+        quad->tl.colors = color;
+        quad->tr.colors = color;
 
-        // top-left vertex:
-        quad->tl.vertices.x = dx;
-        quad->tl.vertices.y = dy;
+        ccParticleQuadTransform(data.rotation[i], data.size[i], x, y, &transforms[batchCount], &rects[batchCount]);
+        batchQuads[batchCount] = quad;
 
-        // top-right vertex:
-        quad->tr.vertices.x = cx;
-        quad->tr.vertices.y = cy;
-    } 
-    else 
+        if (++batchCount == kCCParticleQuadBatchSize)
+        {
+            CCAffineTransformApplyToQuads(transforms, rects, batchQuads, batchCount);
+            batchCount = 0;
+        }
+    }
+    CCAffineTransformApplyToQuads(transforms, rects, batchQuads, batchCount);
+}
+
+void CCParticleSystemQuad::updateQuadWithParticle(tCCParticle* particle, const CCPoint& newPosition)
+{
+    m_bProbingQuadWriter = false;
+
+    ccV3F_C4B_T2F_Quad *quad;
+    if (m_pBatchNode)
     {
-        // bottom-left vertex:
-        quad->bl.vertices.x = newPosition.x - size_2;
-        quad->bl.vertices.y = newPosition.y - size_2;
+        quad = m_pBatchNode->getTextureAtlas()->getRawQuads() + m_uAtlasIndex + particle->atlasIndex;
+    }
+    else
+    {
+        quad = &(m_pQuads[m_uParticleIdx]);
+    }
 
-        // bottom-right vertex:
-        quad->br.vertices.x = newPosition.x + size_2;
-        quad->br.vertices.y = newPosition.y - size_2;
+    const ccColor4F& c = particle->color;
+    ccColor4B color = (m_bOpacityModifyRGB)
+        ? ccc4( c.r*c.a*255, c.g*c.a*255, c.b*c.a*255, c.a*255)
+        : ccc4( c.r*255, c.g*255, c.b*255, c.a*255);
 
-        // top-left vertex:
-        quad->tl.vertices.x = newPosition.x - size_2;
-        quad->tl.vertices.y = newPosition.y + size_2;
+    quad->bl.colors = color;
+    quad->br.colors = color;
+    quad->tl.colors = color;
+    quad->tr.colors = color;
 
-        // top-right vertex:
-        quad->tr.vertices.x = newPosition.x + size_2;
-        quad->tr.vertices.y = newPosition.y + size_2;                
-    }
+    CCAffineTransform transform;
+    CCRect rect;
+    ccParticleQuadTransform(particle->rotation, particle->size, newPosition.x, newPosition.y, &transform, &rect);
+    CCAffineTransformApplyToQuads(&transform, &rect, &quad, 1);
 }
+
 void CCParticleSystemQuad::postStep()
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
-	
-	// Option 1: Sub Data
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(m_pQuads[0])*m_uTotalParticles, m_pQuads);
-	
-	// Option 2: Data
-    //	glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * particleCount, quads_, GL_DYNAMIC_DRAW);
-	
-	// Option 3: Orphaning + glMapBuffer
-	// glBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0])*m_uTotalParticles, NULL, GL_STREAM_DRAW);
-	// void *buf = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-	// memcpy(buf, m_pQuads, sizeof(m_pQuads[0])*m_uTotalParticles);
-	// glUnmapBuffer(GL_ARRAY_BUFFER);
-    
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
-	CHECK_GL_ERROR_DEBUG();
+    // The quads are uploaded by draw(), and only if the system draws by itself:
+    // the renderer and the batch node read m_pQuads directly.
+    m_bQuadsDirty = true;
 }
 
 // overriding draw method
@@ -344,6 +395,14 @@ void CCParticleSystemQuad::draw()
 {    
     CCAssert(!m_pBatchNode,"draw should not be called when added to a particleBatchNode");
 
+    CCRenderer *renderer = CCDirector::sharedDirector()->getRenderer();
+    if (renderer->canRecord(getShaderProgram()))
+    {
+        // consecutive emitters sharing the texture and the blend function end up in the same draw call
+        renderer->addQuads(m_pTexture->getName(), getShaderProgram(), m_tBlendFunc, m_pQuads, m_uParticleIdx);
+        return;
+    }
+
     CC_NODE_DRAW_SETUP();
 
     ccGLBindTexture2D( m_pTexture->getName() );
@@ -351,6 +410,15 @@ void CCParticleSystemQuad::draw()
 
     CCAssert( m_uParticleIdx == m_uParticleCount, "Abnormal error in particle quad");
 
+    if (m_bQuadsDirty)
+    {
+        // only the live particles, in orphaned storage: the previous frame may still be drawing from the VBO
+        glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
+        ccGLStreamBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * m_uTotalParticles, sizeof(m_pQuads[0]) * m_uParticleIdx, m_pQuads, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_bQuadsDirty = false;
+    }
+
 #if CC_TEXTURE_ATLAS_USE_VAO
     //
     // Using VBO and VAO
@@ -404,24 +472,21 @@ void CCParticleSystemQuad::setTotalParticles(unsigned int tp)
     if( tp > m_uAllocatedParticles )
     {
         // Allocate new memory
-        size_t particlesSize = tp * sizeof(tCCParticle);
         size_t quadsSize = sizeof(m_pQuads[0]) * tp * 1;
         size_t indicesSize = sizeof(m_pIndices[0]) * tp * 6 * 1;
 
-        tCCParticle* particlesNew = (tCCParticle*)realloc(m_pParticles, particlesSize);
+        bool particlesAllocated = m_tParticleData.init(tp);
         ccV3F_C4B_T2F_Quad* quadsNew = (ccV3F_C4B_T2F_Quad*)realloc(m_pQuads, quadsSize);
         GLushort* indicesNew = (GLushort*)realloc(m_pIndices, indicesSize);
 
-        if (particlesNew && quadsNew && indicesNew)
+        if (particlesAllocated && quadsNew && indicesNew)
         {
             // Assign pointers
-            m_pParticles = particlesNew;
             m_pQuads = quadsNew;
             m_pIndices = indicesNew;
 
             // Clear the memory
             // XXX: Bug? If the quads are cleared, then drawing doesn't work... WHY??? XXX
-            memset(m_pParticles, 0, particlesSize);
             memset(m_pQuads, 0, quadsSize);
             memset(m_pIndices, 0, indicesSize);
 
@@ -430,7 +495,11 @@ void CCParticleSystemQuad::setTotalParticles(unsigned int tp)
         else
         {
             // Out of memory, failed to resize some array
-            if (particlesNew) m_pParticles = particlesNew;
+            if (! particlesAllocated)
+            {
+                // the previous particles are gone too
+                m_uAllocatedParticles = m_uTotalParticles = m_uParticleCount = 0;
+            }
             if (quadsNew) m_pQuads = quadsNew;
             if (indicesNew) m_pIndices = indicesNew;
 
@@ -445,7 +514,7 @@ void CCParticleSystemQuad::setTotalParticles(unsigned int tp)
         {
             for (unsigned int i = 0; i < m_uTotalParticles; i++)
             {
-                m_pParticles[i].atlasIndex=i;
+                m_tParticleData.atlasIndex[i]=i;
             }
         }
 
@@ -55,6 +55,9 @@ class CC_DLL CCParticleSystemQuad : public CCParticleSystem
 protected:
     ccV3F_C4B_T2F_Quad    *m_pQuads;        // quads to be rendered
     GLushort            *m_pIndices;    // indices
+    bool                m_bQuadsDirty;  // the quads changed since they were uploaded to the VBO
+    int                 m_nQuadWriterOverridden;    // whether a subclass overrides updateQuadWithParticle(), -1 until known
+    bool                m_bProbingQuadWriter;
 
 #if CC_TEXTURE_ATLAS_USE_VAO
     GLuint                m_uVAOname;
@@ -90,6 +93,10 @@ public:
     // super methods
     virtual bool initWithTotalParticles(unsigned int numberOfParticles);
     virtual void setTexture(CCTexture2D* texture);
+    virtual void updateParticleQuads(const CCPoint& currentPosition);
+    /** writes the quad of one particle. updateParticleQuads() writes all the quads in one pass, and calls this method
+     for every particle only if a subclass overrides it without calling this implementation.
+     */
     virtual void updateQuadWithParticle(tCCParticle* particle, const CCPoint& newPosition);
     virtual void postStep();
     virtual void draw();
@@ -0,0 +1,315 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#include "CCAssetBundle.h"
+#include "CCFileData.h"
+#include "platform/CCPlatformConfig.h"
+#include "ccMacros.h"
+#include <zlib.h>
+#include <string.h>
+
+#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32) && (CC_TARGET_PLATFORM != CC_PLATFORM_MARMALADE)
+#define CC_ASSET_BUNDLE_USE_PREAD 1
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define CC_ASSET_BUNDLE_USE_PREAD 0
+#endif
+
+NS_CC_BEGIN
+
+static unsigned int ccAssetBundleReadUInt16(const unsigned char *pData)
+{
+    return pData[0] | (pData[1] << 8);
+}
+
+static unsigned int ccAssetBundleReadUInt32(const unsigned char *pData)
+{
+    return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((unsigned int)pData[3] << 24);
+}
+
+CCAssetBundle::CCAssetBundle()
+: m_uFileCount(0)
+, m_pIndex(NULL)
+, m_pNames(NULL)
+, m_nFile(-1)
+, m_pFile(NULL)
+{
+    pthread_mutex_init(&m_fileMutex, NULL);
+}
+
+CCAssetBundle::~CCAssetBundle()
+{
+#if CC_ASSET_BUNDLE_USE_PREAD
+    if (m_nFile >= 0)
+    {
+        close(m_nFile);
+    }
+#else
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+    }
+#endif
+    pthread_mutex_destroy(&m_fileMutex);
+    CC_SAFE_DELETE_ARRAY(m_pIndex);
+}
+
+CCAssetBundle* CCAssetBundle::create(const char* pszFullPath)
+{
+    CCAssetBundle *pRet = new CCAssetBundle();
+    if (pRet && pRet->initWithFile(pszFullPath))
+    {
+        pRet->autorelease();
+        return pRet;
+    }
+    CC_SAFE_DELETE(pRet);
+    return NULL;
+}
+
+bool CCAssetBundle::initWithFile(const char* pszFullPath)
+{
+    CCAssert(m_pIndex == NULL, "CCAssetBundle: already initialized");
+
+    bool bRet = false;
+    do
+    {
+        m_strPath = pszFullPath;
+
+        unsigned long uFileSize = 0;
+#if CC_ASSET_BUNDLE_USE_PREAD
+        m_nFile = open(pszFullPath, O_RDONLY);
+        CC_BREAK_IF(m_nFile < 0);
+        off_t size = lseek(m_nFile, 0, SEEK_END);
+        CC_BREAK_IF(size < 0);
+        uFileSize = (unsigned long)size;
+#else
+        m_pFile = fopen(pszFullPath, "rb");
+        CC_BREAK_IF(! m_pFile);
+        fseek(m_pFile, 0, SEEK_END);
+        uFileSize = ftell(m_pFile);
+#endif
+
+        unsigned char header[kCCAssetBundleHeaderSize];
+        CC_BREAK_IF(! readRange(0, kCCAssetBundleHeaderSize, header));
+        CC_BREAK_IF(memcmp(header, kCCAssetBundleMagic, 4) != 0);
+        CC_BREAK_IF(ccAssetBundleReadUInt32(header + 4) != kCCAssetBundleVersion);
+
+        unsigned int uCount = ccAssetBundleReadUInt32(header + 8);
+        unsigned int uNamesSize = ccAssetBundleReadUInt32(header + 12);
+        unsigned long uIndexSize = (unsigned long)uCount * kCCAssetBundleEntrySize + uNamesSize;
+        CC_BREAK_IF(uCount > uFileSize / kCCAssetBundleEntrySize || uIndexSize > uFileSize - kCCAssetBundleHeaderSize);
+
+        // the index is read once, the lookups don't touch the file anymore
+        m_pIndex = new unsigned char[uIndexSize];
+        CC_BREAK_IF(! readRange(kCCAssetBundleHeaderSize, uIndexSize, m_pIndex));
+        m_pNames = (const char*)m_pIndex + uCount * kCCAssetBundleEntrySize;
+
+        // check the entries now, so reading them doesn't have to
+        unsigned int i = 0;
+        for (; i < uCount; ++i)
+        {
+            const unsigned char *pEntry = m_pIndex + i * kCCAssetBundleEntrySize;
+            unsigned int uNameOffset = ccAssetBundleReadUInt32(pEntry + 4);
+            unsigned int uNameLength = ccAssetBundleReadUInt16(pEntry + 8);
+            unsigned int uDataOffset = ccAssetBundleReadUInt32(pEntry + 12);
+            unsigned int uStoredSize = ccAssetBundleReadUInt32(pEntry + 16);
+            if ((unsigned long)uNameOffset + uNameLength > uNamesSize || (unsigned long)uDataOffset + uStoredSize > uFileSize)
+            {
+                break;
+            }
+            if (pEntry[11] == kCCAssetBundleCompressionNone && uStoredSize != ccAssetBundleReadUInt32(pEntry + 20))
+            {
+                break;
+            }
+        }
+        CC_BREAK_IF(i != uCount);
+
+        m_uFileCount = uCount;
+        bRet = true;
+    } while (0);
+
+    if (! bRet)
+    {
+        CCLOG("cocos2d: CCAssetBundle: %s is not a valid bundle", pszFullPath);
+    }
+    return bRet;
+}
+
+bool CCAssetBundle::readRange(unsigned long uOffset, unsigned long uSize, unsigned char *pBuffer)
+{
+#if CC_ASSET_BUNDLE_USE_PREAD
+    unsigned long uRead = 0;
+    while (uRead < uSize)
+    {
+        ssize_t n = pread(m_nFile, pBuffer + uRead, uSize - uRead, (off_t)(uOffset + uRead));
+        if (n <= 0)
+        {
+            return false;
+        }
+        uRead += n;
+    }
+    return true;
+#else
+    pthread_mutex_lock(&m_fileMutex);
+    bool bRet = fseek(m_pFile, uOffset, SEEK_SET) == 0 && fread(pBuffer, 1, uSize, m_pFile) == uSize;
+    pthread_mutex_unlock(&m_fileMutex);
+    return bRet;
+#endif
+}
+
+const unsigned char* CCAssetBundle::findEntry(const std::string& name)
+{
+    unsigned int uLength = (unsigned int)name.length();
+    unsigned int uHash = ccAssetBundleHash(name.c_str(), uLength);
+
+    // first entry with this hash
+    unsigned int uLow = 0;
+    unsigned int uHigh = m_uFileCount;
+    while (uLow < uHigh)
+    {
+        unsigned int uMiddle = (uLow + uHigh) / 2;
+        if (ccAssetBundleReadUInt32(m_pIndex + uMiddle * kCCAssetBundleEntrySize) < uHash)
+        {
+            uLow = uMiddle + 1;
+        }
+        else
+        {
+            uHigh = uMiddle;
+        }
+    }
+
+    for (; uLow < m_uFileCount; ++uLow)
+    {
+        const unsigned char *pEntry = m_pIndex + uLow * kCCAssetBundleEntrySize;
+        if (ccAssetBundleReadUInt32(pEntry) != uHash)
+        {
+            break;
+        }
+        if (ccAssetBundleReadUInt16(pEntry + 8) == uLength
+            && memcmp(m_pNames + ccAssetBundleReadUInt32(pEntry + 4), name.c_str(), uLength) == 0)
+        {
+            return pEntry;
+        }
+    }
+    return NULL;
+}
+
+bool CCAssetBundle::containsFile(const std::string& name)
+{
+    return findEntry(name) != NULL;
+}
+
+bool CCAssetBundle::getTextureInfo(const std::string& name, ccAssetBundleTextureInfo *pInfo)
+{
+    const unsigned char *pEntry = findEntry(name);
+    if (! pEntry || pEntry[10] != kCCAssetBundleTypeTexture)
+    {
+        return false;
+    }
+
+    if (pInfo)
+    {
+        pInfo->width = ccAssetBundleReadUInt16(pEntry + 24);
+        pInfo->height = ccAssetBundleReadUInt16(pEntry + 26);
+        pInfo->pixelFormat = pEntry[28];
+        pInfo->premultipliedAlpha = (pEntry[29] & kCCAssetBundleTexturePremultipliedAlpha) != 0;
+    }
+    return true;
+}
+
+unsigned char* CCAssetBundle::getFileData(const std::string& name, unsigned long *pSize)
+{
+    CCAssert(pSize != NULL, "Invalid parameters.");
+    *pSize = 0;
+
+    const unsigned char *pEntry = findEntry(name);
+    if (! pEntry)
+    {
+        return NULL;
+    }
+
+    unsigned long uOffset = ccAssetBundleReadUInt32(pEntry + 12);
+    unsigned long uStoredSize = ccAssetBundleReadUInt32(pEntry + 16);
+    unsigned long uSize = ccAssetBundleReadUInt32(pEntry + 20);
+
+    unsigned char *pBuffer = new unsigned char[uSize];
+    if (pEntry[11] == kCCAssetBundleCompressionNone)
+    {
+        if (! readRange(uOffset, uSize, pBuffer))
+        {
+            delete [] pBuffer;
+            return NULL;
+        }
+    }
+    else
+    {
+        unsigned char *pStored = new unsigned char[uStoredSize];
+        uLongf uDestSize = uSize;
+        bool bRead = readRange(uOffset, uStoredSize, pStored)
+            && pEntry[11] == kCCAssetBundleCompressionZlib
+            && uncompress(pBuffer, &uDestSize, pStored, uStoredSize) == Z_OK
+            && uDestSize == uSize;
+        delete [] pStored;
+        if (! bRead)
+        {
+            CCLOG("cocos2d: CCAssetBundle: can't uncompress %s in %s", name.c_str(), m_strPath.c_str());
+            delete [] pBuffer;
+            return NULL;
+        }
+    }
+
+    *pSize = uSize;
+    return pBuffer;
+}
+
+CCFileData* CCAssetBundle::getFileDataView(const std::string& name)
+{
+    const unsigned char *pEntry = findEntry(name);
+    if (! pEntry)
+    {
+        return NULL;
+    }
+
+    CCFileData *pData = new CCFileData();
+    unsigned long uSize = ccAssetBundleReadUInt32(pEntry + 20);
+    if (pEntry[11] == kCCAssetBundleCompressionNone && uSize >= kCCFileDataMinMappedSize)
+    {
+        if (pData->initWithFileRange(m_strPath.c_str(), ccAssetBundleReadUInt32(pEntry + 12), uSize) && pData->getSize() == uSize)
+        {
+            return pData;
+        }
+        pData->release();
+        pData = new CCFileData();
+    }
+
+    unsigned char *pBuffer = getFileData(name, &uSize);
+    if (! pData->initWithBuffer(pBuffer, uSize))
+    {
+        pData->release();
+        return NULL;
+    }
+    return pData;
+}
+
+NS_CC_END
@@ -0,0 +1,111 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CC_ASSET_BUNDLE_H__
+#define __CC_ASSET_BUNDLE_H__
+
+#include "cocoa/CCObject.h"
+#include "platform/CCAssetBundleFormat.h"
+#include <string>
+#include <stdio.h>
+#include <pthread.h>
+
+NS_CC_BEGIN
+
+class CCFileData;
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/** The description of a texture stored decoded in an asset bundle */
+typedef struct _ccAssetBundleTextureInfo
+{
+    unsigned int    pixelFormat;            // kCCAssetBundlePixelFormat*
+    unsigned int    width;
+    unsigned int    height;
+    bool            premultipliedAlpha;
+} ccAssetBundleTextureInfo;
+
+/** @brief A read-only archive of assets, written by the ccbundle tool of proj.linux.
+
+ The files are stored one after the other, optionally compressed with zlib, behind an index sorted by hash:
+ finding a file doesn't touch the file system, and the bundle is opened only once.
+ The png files can be stored already decoded in a pixel format of CCTexture2D, CCTextureCache uploads them as they are.
+
+ Bundles are mounted by CCFileUtils::mountBundle(), then their files are found like the files of a search path.
+ The files can be read by several threads at the same time.
+ */
+class CC_DLL CCAssetBundle : public CCObject
+{
+public:
+    CCAssetBundle();
+    virtual ~CCAssetBundle();
+
+    /** opens the bundle at the given full path, which must be on the file system */
+    static CCAssetBundle* create(const char* pszFullPath);
+
+    bool initWithFile(const char* pszFullPath);
+
+    /** the full path of the bundle */
+    inline const std::string& getPath() { return m_strPath; }
+
+    /** number of files in the bundle */
+    inline unsigned int getFileCount() { return m_uFileCount; }
+
+    /** whether or not the bundle contains the file, whose name is relative to the packed directory */
+    bool containsFile(const std::string& name);
+
+    /** returns the uncompressed contents of a file in a buffer allocated with new[], or NULL.
+     For a texture these are the pixels.
+     */
+    unsigned char* getFileData(const std::string& name, unsigned long *pSize);
+
+    /** same as getFileData(), but big uncompressed files are mapped in memory. The returned object is retained */
+    CCFileData* getFileDataView(const std::string& name);
+
+    /** returns whether or not the file is a decoded texture, and its description */
+    bool getTextureInfo(const std::string& name, ccAssetBundleTextureInfo *pInfo);
+
+private:
+    const unsigned char* findEntry(const std::string& name);
+    bool readRange(unsigned long uOffset, unsigned long uSize, unsigned char *pBuffer);
+
+    std::string     m_strPath;
+    unsigned int    m_uFileCount;
+    unsigned char   *m_pIndex;                  // the entries then the names
+    const char      *m_pNames;
+    // read with pread() on the POSIX platforms, with fseek() and fread() under the lock elsewhere
+    int             m_nFile;
+    FILE            *m_pFile;
+    pthread_mutex_t m_fileMutex;
+};
+
+// end of platform group
+/// @}
+
+NS_CC_END
+
+#endif // __CC_ASSET_BUNDLE_H__
@@ -0,0 +1,91 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CC_ASSET_BUNDLE_FORMAT_H__
+#define __CC_ASSET_BUNDLE_FORMAT_H__
+
+/*
+ Layout of the asset bundles written by proj.linux/ccbundle and read by CCAssetBundle.
+ It doesn't depend on cocos2d, so the packer can include it. All the numbers are little endian.
+
+ header, kCCAssetBundleHeaderSize bytes:
+    0   "CCAB"
+    4   u32 version
+    8   u32 number of entries
+    12  u32 size of the names block
+
+ entries, kCCAssetBundleEntrySize bytes each, sorted by hash then by name:
+    0   u32 hash of the name, ccAssetBundleHash()
+    4   u32 offset of the name in the names block
+    8   u16 length of the name
+    10  u8  type, kCCAssetBundleType*
+    11  u8  compression, kCCAssetBundleCompression*
+    12  u32 offset of the data from the start of the bundle
+    16  u32 size of the data in the bundle
+    20  u32 size of the data once uncompressed
+    24  u16 width of a texture
+    26  u16 height of a texture
+    28  u8  pixel format of a texture, kCCAssetBundlePixelFormat*
+    29  u8  flags of a texture, kCCAssetBundleTexture*
+    30  u16 reserved
+
+ names block: the names of the entries, relative to the packed directory with '/' separators, without '\0'
+
+ data: the entries, every one starting on a kCCAssetBundleDataAlignment boundary
+ */
+
+#define kCCAssetBundleMagic                 "CCAB"
+#define kCCAssetBundleVersion               1
+#define kCCAssetBundleHeaderSize            16
+#define kCCAssetBundleEntrySize             32
+#define kCCAssetBundleDataAlignment         16
+
+// a file, returned as it was packed
+#define kCCAssetBundleTypeFile              0
+// an image decoded by the packer, the data are the pixels, ready for glTexImage2D
+#define kCCAssetBundleTypeTexture           1
+
+#define kCCAssetBundleCompressionNone       0
+// zlib stream, as written by compress2()
+#define kCCAssetBundleCompressionZlib       1
+
+#define kCCAssetBundlePixelFormatRGBA8888   0
+#define kCCAssetBundlePixelFormatRGB565     1
+#define kCCAssetBundlePixelFormatRGBA4444   2
+
+// the color components were multiplied by the alpha, as CCImage does for the png files
+#define kCCAssetBundleTexturePremultipliedAlpha 1
+
+/** FNV-1a hash of a name */
+static inline unsigned int ccAssetBundleHash(const char *pszName, unsigned int uLength)
+{
+    unsigned int uHash = 2166136261u;
+    for (unsigned int i = 0; i < uLength; ++i)
+    {
+        uHash = (uHash ^ (unsigned char)pszName[i]) * 16777619u;
+    }
+    return uHash;
+}
+
+#endif // __CC_ASSET_BUNDLE_FORMAT_H__
@@ -0,0 +1,158 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "CCFileData.h"
+#include "platform/CCPlatformConfig.h"
+#include "ccMacros.h"
+#include <stdio.h>
+
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_LINUX) || (CC_TARGET_PLATFORM == CC_PLATFORM_ANDROID) \
+    || (CC_TARGET_PLATFORM == CC_PLATFORM_IOS) || (CC_TARGET_PLATFORM == CC_PLATFORM_MAC) \
+    || (CC_TARGET_PLATFORM == CC_PLATFORM_BLACKBERRY) || (CC_TARGET_PLATFORM == CC_PLATFORM_TIZEN)
+#define CC_FILE_DATA_USE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define CC_FILE_DATA_USE_MMAP 0
+#endif
+
+NS_CC_BEGIN
+
+CCFileData::CCFileData()
+: m_pBytes(NULL)
+, m_uSize(0)
+, m_bMapped(false)
+, m_pMapping(NULL)
+, m_uMappingSize(0)
+{
+}
+
+CCFileData::~CCFileData()
+{
+#if CC_FILE_DATA_USE_MMAP
+    if (m_bMapped)
+    {
+        munmap(m_pMapping, m_uMappingSize);
+        return;
+    }
+#endif
+    CC_SAFE_DELETE_ARRAY(m_pBytes);
+}
+
+bool CCFileData::initWithBuffer(unsigned char* pBuffer, unsigned long uSize)
+{
+    CCAssert(m_pBytes == NULL, "CCFileData: already initialized");
+    m_pBytes = pBuffer;
+    m_uSize = uSize;
+    m_bMapped = false;
+    return pBuffer != NULL;
+}
+
+bool CCFileData::initWithFile(const char* pszFullPath)
+{
+#if CC_FILE_DATA_USE_MMAP
+    struct stat st;
+    if (stat(pszFullPath, &st) != 0 || ! S_ISREG(st.st_mode))
+    {
+        return false;
+    }
+    return initWithFileRange(pszFullPath, 0, (unsigned long)st.st_size);
+#else
+    FILE *fp = fopen(pszFullPath, "rb");
+    if (! fp)
+    {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    unsigned long uSize = ftell(fp);
+    fclose(fp);
+    return initWithFileRange(pszFullPath, 0, uSize);
+#endif
+}
+
+bool CCFileData::initWithFileRange(const char* pszFullPath, unsigned long uOffset, unsigned long uSize)
+{
+    CCAssert(m_pBytes == NULL, "CCFileData: already initialized");
+
+#if CC_FILE_DATA_USE_MMAP
+    int fd = open(pszFullPath, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (uSize >= kCCFileDataMinMappedSize)
+    {
+        // mmap() wants an offset aligned on a page
+        unsigned long uPageSize = (unsigned long)sysconf(_SC_PAGESIZE);
+        unsigned long uDelta = uOffset % uPageSize;
+        void *pMapped = mmap(NULL, uSize + uDelta, PROT_READ, MAP_PRIVATE, fd, (off_t)(uOffset - uDelta));
+        if (pMapped != MAP_FAILED)
+        {
+#ifdef MADV_SEQUENTIAL
+            // the images and the plists are read from the start to the end
+            madvise(pMapped, uSize + uDelta, MADV_SEQUENTIAL);
+#endif
+            m_pMapping = pMapped;
+            m_uMappingSize = uSize + uDelta;
+            m_pBytes = (unsigned char*)pMapped + uDelta;
+            m_uSize = uSize;
+            m_bMapped = true;
+            close(fd);
+            return true;
+        }
+    }
+
+    // small file, or mmap failed
+    m_pBytes = new unsigned char[uSize];
+    unsigned long uRead = 0;
+    while (uRead < uSize)
+    {
+        ssize_t n = pread(fd, m_pBytes + uRead, uSize - uRead, (off_t)(uOffset + uRead));
+        if (n <= 0)
+        {
+            break;
+        }
+        uRead += n;
+    }
+    m_uSize = uRead;
+    close(fd);
+    return true;
+#else
+    FILE *fp = fopen(pszFullPath, "rb");
+    if (! fp)
+    {
+        return false;
+    }
+    fseek(fp, uOffset, SEEK_SET);
+    m_pBytes = new unsigned char[uSize];
+    m_uSize = fread(m_pBytes, sizeof(unsigned char), uSize, fp);
+    fclose(fp);
+    return true;
+#endif
+}
+
+NS_CC_END
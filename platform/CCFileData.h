@@ -0,0 +1,83 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#ifndef __CC_FILEDATA_H__
+#define __CC_FILEDATA_H__
+
+#include "cocoa/CCObject.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/** Files smaller than this are read in memory, mapping them costs more than copying them. */
+#define kCCFileDataMinMappedSize (16 * 1024)
+
+/** @brief The read-only contents of a file, returned by CCFileUtils::getFileDataView().
+
+ On the platforms that support it, the files bigger than kCCFileDataMinMappedSize are mapped in memory,
+ so they are decoded straight from the page cache. The others are read in a buffer.
+ The bytes are valid until the object is released, they must never be written.
+ */
+class CC_DLL CCFileData : public CCObject
+{
+public:
+    CCFileData();
+    virtual ~CCFileData();
+
+    /** maps or reads the file at the given full path */
+    bool initWithFile(const char* pszFullPath);
+
+    /** maps or reads uSize bytes from uOffset in the file at the given full path, such as a stored entry of a zip file */
+    bool initWithFileRange(const char* pszFullPath, unsigned long uOffset, unsigned long uSize);
+
+    /** takes the ownership of a buffer allocated with new[], such as the one returned by CCFileUtils::getFileData() */
+    bool initWithBuffer(unsigned char* pBuffer, unsigned long uSize);
+
+    /** the contents of the file */
+    inline const unsigned char* getBytes() { return m_pBytes; }
+
+    /** the size of the file in bytes */
+    inline unsigned long getSize() { return m_uSize; }
+
+    /** whether or not the file is mapped in memory instead of copied */
+    inline bool isMapped() { return m_bMapped; }
+
+private:
+    unsigned char   *m_pBytes;
+    unsigned long   m_uSize;
+    bool            m_bMapped;
+    void            *m_pMapping;        // the mapping starts at a page boundary, before m_pBytes
+    unsigned long   m_uMappingSize;
+};
+
+// end of platform group
+/// @}
+
+NS_CC_END
+
+#endif // __CC_FILEDATA_H__
@@ -23,13 +23,24 @@ THE SOFTWARE.
 ****************************************************************************/
 
 #include "CCFileUtils.h"
+#include "CCFileData.h"
+#include "CCAssetBundle.h"
 #include "CCDirector.h"
 #include "cocoa/CCDictionary.h"
 #include "cocoa/CCString.h"
 #include "CCSAXParser.h"
 #include "support/tinyxml2/tinyxml2.h"
 #include "support/zip_support/unzip.h"
+#include "support/data_support/uthash.h"
 #include <stack>
+#include <algorithm>
+#include <pthread.h>
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32)
+#include <windows.h>
+#elif (CC_TARGET_PLATFORM != CC_PLATFORM_MARMALADE)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
 
 using namespace std;
 
@@ -454,9 +465,169 @@ CCArray* CCFileUtils::createCCArrayWithContentsOfFile(const std::string& filenam
 
 #endif /* (CC_TARGET_PLATFORM != CC_PLATFORM_IOS) && (CC_TARGET_PLATFORM != CC_PLATFORM_MAC) */
 
+//////////////////////////////////////////////////////////////////////////
+// Asset index
+//////////////////////////////////////////////////////////////////////////
+
+// Index file: "CCAI", version and number of files (little endian 32 bits),
+// then for every file the length of its path (little endian 16 bits) and the path, without '\0'.
+#define kCCAssetIndexMagic      "CCAI"
+#define kCCAssetIndexVersion    1
+
+// The file systems of Windows and Mac OS X ignore the case: so does the index there, a hit is probed anyway
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32) || (CC_TARGET_PLATFORM == CC_PLATFORM_MAC)
+#define CC_ASSET_INDEX_IGNORE_CASE 1
+#else
+#define CC_ASSET_INDEX_IGNORE_CASE 0
+#endif
+
+typedef struct _ccAssetIndexEntry
+{
+    char            *path;  // relative to the search path
+    UT_hash_handle  hh;
+} ccAssetIndexEntry;
+
+typedef struct _ccAssetIndex
+{
+    ccAssetIndexEntry   *entries;
+    bool                bScanned;           // false if the search path couldn't be scanned, it is probed then
+    bool                bLoadedFromFile;
+} ccAssetIndex;
+
+static ccAssetIndex* ccAssetIndexNew()
+{
+    ccAssetIndex *pIndex = (ccAssetIndex*)malloc(sizeof(ccAssetIndex));
+    pIndex->entries = NULL;
+    pIndex->bScanned = false;
+    pIndex->bLoadedFromFile = false;
+    return pIndex;
+}
+
+static void ccAssetIndexFree(ccAssetIndex *pIndex)
+{
+    ccAssetIndexEntry *pEntry, *pTmp;
+    HASH_ITER(hh, pIndex->entries, pEntry, pTmp)
+    {
+        HASH_DEL(pIndex->entries, pEntry);
+        free(pEntry);
+    }
+    free(pIndex);
+}
+
+static void ccAssetIndexAdd(ccAssetIndex *pIndex, const char *pszPath, unsigned int uLength)
+{
+    // the path is stored right after the entry
+    ccAssetIndexEntry *pEntry = (ccAssetIndexEntry*)malloc(sizeof(ccAssetIndexEntry) + uLength + 1);
+    pEntry->path = (char*)(pEntry + 1);
+    memcpy(pEntry->path, pszPath, uLength);
+    pEntry->path[uLength] = '\0';
+#if CC_ASSET_INDEX_IGNORE_CASE
+    std::transform(pEntry->path, pEntry->path + uLength, pEntry->path, ::tolower);
+#endif
+
+    ccAssetIndexEntry *pExisting = NULL;
+    HASH_FIND(hh, pIndex->entries, pEntry->path, uLength, pExisting);
+    if (pExisting)
+    {
+        free(pEntry);
+        return;
+    }
+    HASH_ADD_KEYPTR(hh, pIndex->entries, pEntry->path, uLength, pEntry);
+}
+
+static bool ccAssetIndexContains(ccAssetIndex *pIndex, const std::string& path)
+{
+    ccAssetIndexEntry *pEntry = NULL;
+#if CC_ASSET_INDEX_IGNORE_CASE
+    std::string key = path;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    HASH_FIND(hh, pIndex->entries, key.c_str(), key.length(), pEntry);
+#else
+    HASH_FIND(hh, pIndex->entries, path.c_str(), path.length(), pEntry);
+#endif
+    return pEntry != NULL;
+}
+
+// Removes the "." and "dir/.." components and the repeated '/' of a path relative to a search path, like the file system
+// does, so that it can be looked up in the asset index or in a bundle. Returns false if it goes above the search path.
+static bool ccAssetIndexNormalizePath(const std::string& path, std::string& normalized)
+{
+    if (path.find("./") == std::string::npos && path.find("//") == std::string::npos)
+    {
+        normalized = path;
+        return true;
+    }
+
+    std::vector<std::string> components;
+    size_t start = 0;
+    while (start <= path.length())
+    {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos)
+        {
+            end = path.length();
+        }
+
+        std::string component = path.substr(start, end - start);
+        if (component == "..")
+        {
+            if (components.empty())
+            {
+                return false;
+            }
+            components.pop_back();
+        }
+        else if (component.length() > 0 && component != ".")
+        {
+            components.push_back(component);
+        }
+        start = end + 1;
+    }
+
+    normalized.clear();
+    for (std::vector<std::string>::iterator iter = components.begin(); iter != components.end(); ++iter)
+    {
+        if (iter != components.begin())
+        {
+            normalized += "/";
+        }
+        normalized += *iter;
+    }
+    return true;
+}
+
+static unsigned int ccAssetIndexReadUInt32(const unsigned char *pData)
+{
+    return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((unsigned int)pData[3] << 24);
+}
+
+static void ccAssetIndexWriteUInt32(FILE *fp, unsigned int uValue)
+{
+    unsigned char bytes[4] = { (unsigned char)uValue, (unsigned char)(uValue >> 8), (unsigned char)(uValue >> 16), (unsigned char)(uValue >> 24) };
+    fwrite(bytes, 1, 4, fp);
+}
 
 CCFileUtils* CCFileUtils::s_sharedFileUtils = NULL;
 
+// getFileDataView() is called by the texture loading threads too: the counters are only read and written under the mutex
+static pthread_mutex_t      s_fileDataCountersMutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long long   s_uBytesMapped = 0;
+static unsigned long long   s_uBytesCopied = 0;
+
+void CCFileUtils::countFileData(unsigned long uSize, bool bMapped)
+{
+    pthread_mutex_lock(&s_fileDataCountersMutex);
+    if (bMapped)
+    {
+        s_uBytesMapped += uSize;
+    }
+    else
+    {
+        s_uBytesCopied += uSize;
+    }
+    pthread_mutex_unlock(&s_fileDataCountersMutex);
+}
+
 void CCFileUtils::purgeFileUtils()
 {
     CC_SAFE_DELETE(s_sharedFileUtils);
@@ -464,12 +635,25 @@ void CCFileUtils::purgeFileUtils()
 
 CCFileUtils::CCFileUtils()
 : m_pFilenameLookupDict(NULL)
+, m_bAssetIndexEnabled(false)
 {
+    pthread_mutex_init(&m_bundlesMutex, NULL);
 }
 
 CCFileUtils::~CCFileUtils()
 {
     CC_SAFE_RELEASE(m_pFilenameLookupDict);
+
+    for (std::map<std::string, ccAssetIndex*>::iterator iter = m_assetIndex.begin(); iter != m_assetIndex.end(); ++iter)
+    {
+        ccAssetIndexFree(iter->second);
+    }
+
+    for (std::map<std::string, CCAssetBundle*>::iterator iter = m_bundles.begin(); iter != m_bundles.end(); ++iter)
+    {
+        iter->second->release();
+    }
+    pthread_mutex_destroy(&m_bundlesMutex);
 }
 
 bool CCFileUtils::init()
@@ -482,6 +666,353 @@ bool CCFileUtils::init()
 void CCFileUtils::purgeCachedEntries()
 {
     m_fullPathCache.clear();
+
+    // the files of the scanned search paths may have changed, they are scanned again when they are needed
+    std::map<std::string, ccAssetIndex*>::iterator iter = m_assetIndex.begin();
+    while (iter != m_assetIndex.end())
+    {
+        if (iter->second->bLoadedFromFile)
+        {
+            ++iter;
+        }
+        else
+        {
+            ccAssetIndexFree(iter->second);
+            m_assetIndex.erase(iter++);
+        }
+    }
+}
+
+void CCFileUtils::invalidateSearchCache()
+{
+    m_fullPathCache.clear();
+
+    std::map<std::string, ccAssetIndex*>::iterator iter = m_assetIndex.begin();
+    while (iter != m_assetIndex.end())
+    {
+        if (std::find(m_searchPathArray.begin(), m_searchPathArray.end(), iter->first) != m_searchPathArray.end())
+        {
+            ++iter;
+        }
+        else
+        {
+            ccAssetIndexFree(iter->second);
+            m_assetIndex.erase(iter++);
+        }
+    }
+}
+
+ccAssetIndex* CCFileUtils::getAssetIndex(const std::string& searchPath)
+{
+    std::map<std::string, ccAssetIndex*>::iterator iter = m_assetIndex.find(searchPath);
+    if (iter != m_assetIndex.end())
+    {
+        return iter->second;
+    }
+
+    ccAssetIndex *pIndex = ccAssetIndexNew();
+    std::vector<std::string> files;
+    pIndex->bScanned = listFilesInDirectory(searchPath, files);
+    for (std::vector<std::string>::iterator fileIter = files.begin(); fileIter != files.end(); ++fileIter)
+    {
+        ccAssetIndexAdd(pIndex, fileIter->c_str(), fileIter->length());
+    }
+    m_assetIndex.insert(std::pair<std::string, ccAssetIndex*>(searchPath, pIndex));
+
+    //CCLOG("cocos2d: CCFileUtils: indexed %u files in %s", (unsigned int)files.size(), searchPath.c_str());
+    return pIndex;
+}
+
+void CCFileUtils::setAssetIndexEnabled(bool bEnabled)
+{
+    if (m_bAssetIndexEnabled != bEnabled)
+    {
+        m_bAssetIndexEnabled = bEnabled;
+        // drops the files that weren't found, they are only cached when the index is enabled
+        m_fullPathCache.clear();
+    }
+}
+
+bool CCFileUtils::isAssetIndexEnabled()
+{
+    return m_bAssetIndexEnabled;
+}
+
+bool CCFileUtils::loadAssetIndexFromFile(const char* pszIndexFile)
+{
+    unsigned long uSize = 0;
+    unsigned char *pData = getFileData(pszIndexFile, "rb", &uSize);
+    if (! pData)
+    {
+        return false;
+    }
+
+    ccAssetIndex *pIndex = ccAssetIndexNew();
+    bool bRet = false;
+    do 
+    {
+        CC_BREAK_IF(uSize < 12 || memcmp(pData, kCCAssetIndexMagic, 4) != 0);
+        CC_BREAK_IF(ccAssetIndexReadUInt32(pData + 4) != kCCAssetIndexVersion);
+
+        unsigned int uCount = ccAssetIndexReadUInt32(pData + 8);
+        unsigned long uOffset = 12;
+        unsigned int i = 0;
+        for (; i < uCount; ++i)
+        {
+            CC_BREAK_IF(uOffset + 2 > uSize);
+            unsigned int uLength = pData[uOffset] | (pData[uOffset + 1] << 8);
+            uOffset += 2;
+            CC_BREAK_IF(uOffset + uLength > uSize);
+            ccAssetIndexAdd(pIndex, (const char*)pData + uOffset, uLength);
+            uOffset += uLength;
+        }
+        CC_BREAK_IF(i != uCount);
+
+        bRet = true;
+    } while (0);
+
+    delete [] pData;
+
+    if (! bRet)
+    {
+        CCLOG("cocos2d: CCFileUtils: invalid asset index: %s", pszIndexFile);
+        ccAssetIndexFree(pIndex);
+        return false;
+    }
+
+    pIndex->bScanned = true;
+    pIndex->bLoadedFromFile = true;
+
+    std::map<std::string, ccAssetIndex*>::iterator iter = m_assetIndex.find(m_strDefaultResRootPath);
+    if (iter != m_assetIndex.end())
+    {
+        ccAssetIndexFree(iter->second);
+        m_assetIndex.erase(iter);
+    }
+    m_assetIndex.insert(std::pair<std::string, ccAssetIndex*>(m_strDefaultResRootPath, pIndex));
+
+    m_fullPathCache.clear();
+    m_bAssetIndexEnabled = true;
+    return true;
+}
+
+bool CCFileUtils::writeAssetIndexToFile(const char* pszDirectory, const char* pszIndexFile)
+{
+    CCAssert(pszDirectory != NULL && pszIndexFile != NULL, "Invalid parameters.");
+
+    std::string strDirectory = pszDirectory;
+    if (strDirectory.length() > 0 && strDirectory[strDirectory.length()-1] != '/')
+    {
+        strDirectory += "/";
+    }
+
+    std::vector<std::string> files;
+    if (! listFilesInDirectory(strDirectory, files))
+    {
+        CCLOG("cocos2d: CCFileUtils: can't scan %s", pszDirectory);
+        return false;
+    }
+
+    FILE *fp = fopen(pszIndexFile, "wb");
+    if (! fp)
+    {
+        CCLOG("cocos2d: CCFileUtils: can't write %s", pszIndexFile);
+        return false;
+    }
+
+    fwrite(kCCAssetIndexMagic, 1, 4, fp);
+    ccAssetIndexWriteUInt32(fp, kCCAssetIndexVersion);
+    ccAssetIndexWriteUInt32(fp, files.size());
+    for (std::vector<std::string>::iterator iter = files.begin(); iter != files.end(); ++iter)
+    {
+        CCAssert(iter->length() <= 0xffff, "the path is too long for the asset index");
+        unsigned char length[2] = { (unsigned char)iter->length(), (unsigned char)(iter->length() >> 8) };
+        fwrite(length, 1, 2, fp);
+        fwrite(iter->c_str(), 1, iter->length(), fp);
+    }
+
+    bool bRet = ferror(fp) == 0;
+    fclose(fp);
+    return bRet;
+}
+
+bool CCFileUtils::mountBundle(const char* pszBundleFile)
+{
+    CCAssert(pszBundleFile != NULL, "CCFileUtils: Invalid path");
+
+    std::string fullPath = fullPathForFilename(pszBundleFile);
+    std::string searchPath = fullPath + "/";
+    if (m_bundles.find(searchPath) != m_bundles.end())
+    {
+        return true;
+    }
+
+    CCAssetBundle *pBundle = new CCAssetBundle();
+    if (! pBundle->initWithFile(fullPath.c_str()))
+    {
+        pBundle->release();
+        return false;
+    }
+    pthread_mutex_lock(&m_bundlesMutex);
+    m_bundles.insert(std::pair<std::string, CCAssetBundle*>(searchPath, pBundle));
+    pthread_mutex_unlock(&m_bundlesMutex);
+
+    if (std::find(m_searchPathArray.begin(), m_searchPathArray.end(), searchPath) == m_searchPathArray.end())
+    {
+        m_searchPathArray.insert(m_searchPathArray.begin(), searchPath);
+    }
+    invalidateSearchCache();
+
+    CCLOG("cocos2d: CCFileUtils: mounted %s, %u files", fullPath.c_str(), pBundle->getFileCount());
+    return true;
+}
+
+void CCFileUtils::unmountBundle(const char* pszBundleFile)
+{
+    CCAssert(pszBundleFile != NULL, "CCFileUtils: Invalid path");
+
+    std::string searchPath = fullPathForFilename(pszBundleFile) + "/";
+    pthread_mutex_lock(&m_bundlesMutex);
+    std::map<std::string, CCAssetBundle*>::iterator iter = m_bundles.find(searchPath);
+    if (iter == m_bundles.end())
+    {
+        pthread_mutex_unlock(&m_bundlesMutex);
+        return;
+    }
+    // the loading threads that found it keep it until they are done
+    iter->second->release();
+    m_bundles.erase(iter);
+    pthread_mutex_unlock(&m_bundlesMutex);
+
+    std::vector<std::string>::iterator pathIter = std::find(m_searchPathArray.begin(), m_searchPathArray.end(), searchPath);
+    if (pathIter != m_searchPathArray.end())
+    {
+        m_searchPathArray.erase(pathIter);
+    }
+    invalidateSearchCache();
+}
+
+CCAssetBundle* CCFileUtils::getBundleForFullPath(const std::string& fullPath, std::string& name)
+{
+    CCAssetBundle *pBundle = NULL;
+
+    pthread_mutex_lock(&m_bundlesMutex);
+    for (std::map<std::string, CCAssetBundle*>::iterator iter = m_bundles.begin(); iter != m_bundles.end(); ++iter)
+    {
+        if (fullPath.compare(0, iter->first.length(), iter->first) == 0)
+        {
+            name = fullPath.substr(iter->first.length());
+            pBundle = iter->second;
+            pBundle->retain();
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_bundlesMutex);
+
+    return pBundle;
+}
+
+void CCFileUtils::releaseBundle(CCAssetBundle* pBundle)
+{
+    pthread_mutex_lock(&m_bundlesMutex);
+    pBundle->release();
+    pthread_mutex_unlock(&m_bundlesMutex);
+}
+
+bool CCFileUtils::listFilesInDirectory(const std::string& strDirectory, std::vector<std::string>& files)
+{
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_MARMALADE)
+    CC_UNUSED_PARAM(strDirectory);
+    CC_UNUSED_PARAM(files);
+    return false;
+#else
+    // the subdirectories that remain to be scanned, relative to strDirectory
+    std::stack<std::string> directories;
+    directories.push("");
+    bool bRoot = true;
+
+    while (! directories.empty())
+    {
+        std::string relativeDirectory = directories.top();
+        directories.pop();
+
+#if (CC_TARGET_PLATFORM == CC_PLATFORM_WIN32)
+        WIN32_FIND_DATAA findData;
+        HANDLE hFind = FindFirstFileA((strDirectory + relativeDirectory + "*").c_str(), &findData);
+        if (hFind == INVALID_HANDLE_VALUE)
+        {
+            if (bRoot)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        do 
+        {
+            std::string name = findData.cFileName;
+            if (name == "." || name == "..")
+            {
+                continue;
+            }
+            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                directories.push(relativeDirectory + name + "/");
+            }
+            else
+            {
+                files.push_back(relativeDirectory + name);
+            }
+        } while (FindNextFileA(hFind, &findData));
+        FindClose(hFind);
+#else
+        DIR *pDir = opendir((strDirectory + relativeDirectory).c_str());
+        if (! pDir)
+        {
+            if (bRoot)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        struct dirent *pEntry = NULL;
+        while ((pEntry = readdir(pDir)) != NULL)
+        {
+            std::string name = pEntry->d_name;
+            if (name == "." || name == "..")
+            {
+                continue;
+            }
+
+            bool bDirectory = false;
+#ifdef DT_DIR
+            if (pEntry->d_type != DT_UNKNOWN)
+            {
+                bDirectory = pEntry->d_type == DT_DIR;
+            }
+            else
+#endif
+            {
+                struct stat st;
+                bDirectory = stat((strDirectory + relativeDirectory + name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+            }
+
+            if (bDirectory)
+            {
+                directories.push(relativeDirectory + name + "/");
+            }
+            else
+            {
+                files.push_back(relativeDirectory + name);
+            }
+        }
+        closedir(pDir);
+#endif
+        bRoot = false;
+    }
+    return true;
+#endif
 }
 
 unsigned char* CCFileUtils::getFileData(const char* pszFileName, const char* pszMode, unsigned long * pSize)
@@ -493,6 +1024,16 @@ unsigned char* CCFileUtils::getFileData(const char* pszFileName, const char* psz
     {
         // read the file from hardware
         std::string fullPath = fullPathForFilename(pszFileName);
+
+        std::string name;
+        CCAssetBundle *pBundle = getBundleForFullPath(fullPath, name);
+        if (pBundle)
+        {
+            pBuffer = pBundle->getFileData(name, pSize);
+            releaseBundle(pBundle);
+            break;
+        }
+
         FILE *fp = fopen(fullPath.c_str(), pszMode);
         CC_BREAK_IF(!fp);
         
@@ -514,6 +1055,82 @@ unsigned char* CCFileUtils::getFileData(const char* pszFileName, const char* psz
     return pBuffer;
 }
 
+CCFileData* CCFileUtils::getFileDataView(const char* pszFileName)
+{
+    CCAssert(pszFileName != NULL, "Invalid parameters.");
+
+    std::string fullPath = fullPathForFilename(pszFileName);
+
+    std::string name;
+    CCAssetBundle *pBundle = getBundleForFullPath(fullPath, name);
+    if (pBundle)
+    {
+        CCFileData *pBundleData = pBundle->getFileDataView(name);
+        releaseBundle(pBundle);
+        if (pBundleData)
+        {
+            countFileData(pBundleData->getSize(), pBundleData->isMapped());
+        }
+        return pBundleData;
+    }
+
+    CCFileData *pData = new CCFileData();
+    if (pData->initWithFile(fullPath.c_str()))
+    {
+        countFileData(pData->getSize(), pData->isMapped());
+        return pData;
+    }
+    pData->release();
+
+    // not a file of the file system, such as the assets in the apk on Android
+    unsigned long uSize = 0;
+    unsigned char *pBuffer = getFileData(fullPath.c_str(), "rb", &uSize);
+    if (! pBuffer)
+    {
+        return NULL;
+    }
+    pData = new CCFileData();
+    pData->initWithBuffer(pBuffer, uSize);
+    countFileData(uSize, false);
+    return pData;
+}
+
+void CCFileUtils::getFileDataCounters(unsigned long long *pBytesMapped, unsigned long long *pBytesCopied)
+{
+    pthread_mutex_lock(&s_fileDataCountersMutex);
+    if (pBytesMapped)
+    {
+        *pBytesMapped = s_uBytesMapped;
+    }
+    if (pBytesCopied)
+    {
+        *pBytesCopied = s_uBytesCopied;
+    }
+    pthread_mutex_unlock(&s_fileDataCountersMutex);
+}
+
+unsigned long long CCFileUtils::getBytesMapped()
+{
+    unsigned long long uBytes = 0;
+    getFileDataCounters(&uBytes, NULL);
+    return uBytes;
+}
+
+unsigned long long CCFileUtils::getBytesCopied()
+{
+    unsigned long long uBytes = 0;
+    getFileDataCounters(NULL, &uBytes);
+    return uBytes;
+}
+
+void CCFileUtils::resetFileDataCounters()
+{
+    pthread_mutex_lock(&s_fileDataCountersMutex);
+    s_uBytesMapped = 0;
+    s_uBytesCopied = 0;
+    pthread_mutex_unlock(&s_fileDataCountersMutex);
+}
+
 unsigned char* CCFileUtils::getFileDataFromZip(const char* pszZipFilePath, const char* pszFileName, unsigned long * pSize)
 {
     unsigned char * pBuffer = NULL;
@@ -609,21 +1226,64 @@ std::string CCFileUtils::fullPathForFilename(const char* pszFileName)
     if (cacheIter != m_fullPathCache.end())
     {
         //CCLOG("Return full path from cache: %s", cacheIter->second.c_str());
-        return cacheIter->second;
+        // an empty full path means that the file wasn't found
+        return cacheIter->second.length() > 0 ? cacheIter->second : strFileName;
     }
     
     // Get the new file name.
     std::string newFilename = getNewFilename(pszFileName);
     
+    // Split it like getPathForFilename() to build the paths looked up in the asset index and in the bundles
+    std::string file = newFilename;
+    std::string file_path = "";
+    size_t pos = newFilename.find_last_of("/");
+    if (pos != std::string::npos)
+    {
+        file_path = newFilename.substr(0, pos+1);
+        file = newFilename.substr(pos+1);
+    }
+    
     string fullpath = "";
     
     for (std::vector<std::string>::iterator searchPathsIter = m_searchPathArray.begin();
          searchPathsIter != m_searchPathArray.end(); ++searchPathsIter) {
+        
+        // a mounted bundle: look up its index instead of the file system
+        std::map<std::string, CCAssetBundle*>::iterator bundleIter = m_bundles.empty() ? m_bundles.end() : m_bundles.find(*searchPathsIter);
+        if (bundleIter != m_bundles.end())
+        {
+            for (std::vector<std::string>::iterator resOrderIter = m_searchResolutionsOrderArray.begin();
+                 resOrderIter != m_searchResolutionsOrderArray.end(); ++resOrderIter) {
+                
+                std::string name;
+                if (ccAssetIndexNormalizePath(file_path + *resOrderIter + file, name) && bundleIter->second->containsFile(name))
+                {
+                    fullpath = *searchPathsIter + name;
+                    m_fullPathCache.insert(std::pair<std::string, std::string>(pszFileName, fullpath));
+                    return fullpath;
+                }
+            }
+            continue;
+        }
+        
+        ccAssetIndex *pIndex = m_bAssetIndexEnabled ? getAssetIndex(*searchPathsIter) : NULL;
+        if (pIndex && ! pIndex->bScanned)
+        {
+            pIndex = NULL;
+        }
+        
         for (std::vector<std::string>::iterator resOrderIter = m_searchResolutionsOrderArray.begin();
              resOrderIter != m_searchResolutionsOrderArray.end(); ++resOrderIter) {
             
             //CCLOG("\n\nSEARCHING: %s, %s, %s", newFilename.c_str(), resOrderIter->c_str(), searchPathsIter->c_str());
             
+            // Not in the index: no need to probe the file system. A path that goes above the search path is probed
+            std::string indexPath;
+            if (pIndex && ccAssetIndexNormalizePath(file_path + *resOrderIter + file, indexPath) && ! ccAssetIndexContains(pIndex, indexPath))
+            {
+                continue;
+            }
+            
             fullpath = this->getPathForFilename(newFilename, *resOrderIter, *searchPathsIter);
             
             if (fullpath.length() > 0)
@@ -638,6 +1298,11 @@ std::string CCFileUtils::fullPathForFilename(const char* pszFileName)
     
     //CCLOG("cocos2d: fullPathForFilename: No file found at %s. Possible missing file.", pszFileName);
 
+    if (m_bAssetIndexEnabled)
+    {
+        m_fullPathCache.insert(std::pair<std::string, std::string>(pszFileName, ""));
+    }
+
     // The file wasn't found, return the file name passed in.
     return pszFileName;
 }
@@ -674,11 +1339,13 @@ void CCFileUtils::setSearchResolutionsOrder(const std::vector<std::string>& sear
     {
         m_searchResolutionsOrderArray.push_back("");
     }
+    invalidateSearchCache();
 }
 
 void CCFileUtils::addSearchResolutionsOrder(const char* order)
 {
     m_searchResolutionsOrderArray.push_back(order);
+    invalidateSearchCache();
 }
 
 const std::vector<std::string>& CCFileUtils::getSearchResolutionsOrder()
@@ -721,6 +1388,8 @@ void CCFileUtils::setSearchPaths(const std::vector<std::string>& searchPaths)
         //CCLOG("Default root path doesn't exist, adding it.");
         m_searchPathArray.push_back(m_strDefaultResRootPath);
     }
+    // the search paths that are still there keep their index
+    invalidateSearchCache();
 }
 
 void CCFileUtils::addSearchPath(const char* path_)
@@ -737,6 +1406,7 @@ void CCFileUtils::addSearchPath(const char* path_)
         path += "/";
     }
     m_searchPathArray.push_back(path);
+    invalidateSearchCache();
 }
 
 void CCFileUtils::setFilenameLookupDictionary(CCDictionary* pFilenameLookupDict)
@@ -744,6 +1414,7 @@ void CCFileUtils::setFilenameLookupDictionary(CCDictionary* pFilenameLookupDict)
     CC_SAFE_RELEASE(m_pFilenameLookupDict);
     m_pFilenameLookupDict = pFilenameLookupDict;
     CC_SAFE_RETAIN(m_pFilenameLookupDict);
+    m_fullPathCache.clear();
 }
 
 void CCFileUtils::loadFilenameLookupDictionaryFromFile(const char* filename)
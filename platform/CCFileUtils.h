@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include <string>
 #include <vector>
 #include <map>
+#include <pthread.h>
 #include "CCPlatformMacros.h"
 #include "ccTypes.h"
 #include "ccTypeInfo.h"
@@ -35,6 +36,9 @@ NS_CC_BEGIN
 
 class CCDictionary;
 class CCArray;
+class CCFileData;
+class CCAssetBundle;
+struct _ccAssetIndex;
 /**
  * @addtogroup platform
  * @{
@@ -78,6 +82,7 @@ public:
      *        For instance, in the CocosPlayer sample, every time you run application from CocosBuilder,
      *        All the resources will be downloaded to the writable folder, before new js app launchs,
      *        this method should be invoked to clean the file search cache.
+     *        The search paths indexed by scanning them are scanned again. The index loaded from a file is kept.
      */
     virtual void purgeCachedEntries();
     
@@ -92,6 +97,28 @@ public:
      */
     virtual unsigned char* getFileData(const char* pszFileName, const char* pszMode, unsigned long * pSize);
 
+    /**
+     *  Gets the read-only contents of a resource file, without copying them when it is possible.
+     *
+     *  The big files are mapped in memory on the platforms that support it, the others are read like getFileData().
+     *  Use it for the files that are parsed or decoded and then thrown away (images, plists, tmx files).
+     *
+     *  @param[in]  pszFileName The resource file name which contains the path.
+     *  @return Upon success, the contents of the file, otherwise NULL.
+     *  @warning The object isn't autoreleased, so it can be used on any thread: you are responsible for calling release() on it.
+     */
+    virtual CCFileData* getFileDataView(const char* pszFileName);
+
+    /**
+     *  Bytes of the files returned by getFileDataView() that were mapped in memory, and that were copied,
+     *  since the last call to resetFileDataCounters(). The loading threads update them under a lock:
+     *  getFileDataCounters() reads both at once, so a reset or a load can't happen between the two values.
+     */
+    void getFileDataCounters(unsigned long long *pBytesMapped, unsigned long long *pBytesCopied);
+    unsigned long long getBytesMapped();
+    unsigned long long getBytesCopied();
+    void resetFileDataCounters();
+
     /**
      *  Gets resource file data from a zip file.
      *
@@ -261,6 +288,75 @@ public:
      */
     virtual const std::vector<std::string>& getSearchPaths();
 
+    /**
+     *  Enables or disables the asset index.
+     *
+     *  When it is enabled, fullPathForFilename() doesn't probe the file system for every search path and every resolution
+     *  directory. Every search path is scanned once, the first time a file is looked up in it, and the candidates are looked
+     *  up in the list of its files. The files that can't be found are cached too, so call purgeCachedEntries() after new
+     *  files were written in a search path.
+     *  The search paths that can't be scanned (such as "assets/" on Android, which lives in the apk) are probed as usual,
+     *  unless they are covered by an index loaded with loadAssetIndexFromFile().
+     *  The "." and ".." components of the file names are resolved before the lookup. On Windows and Mac OS X, whose file
+     *  systems ignore the case, the lookup ignores it too.
+     *
+     *  Disabled by default.
+     */
+    virtual void setAssetIndexEnabled(bool bEnabled);
+    virtual bool isAssetIndexEnabled();
+    
+    /**
+     *  Loads a prebuilt asset index, written by writeAssetIndexToFile(), and enables the asset index.
+     *  It lists the files of the default resource root path, which isn't scanned anymore.
+     *
+     *  @param pszIndexFile The index file, it is searched like any resource.
+     *  @return true if the index was loaded.
+     */
+    virtual bool loadAssetIndexFromFile(const char* pszIndexFile);
+    
+    /**
+     *  Scans a directory and writes the list of its files, for loadAssetIndexFromFile().
+     *  Meant to be run by a desktop build of the game on its resource folder, before packaging it.
+     *
+     *  @param pszDirectory The directory to scan, it must be an absolute path.
+     *  @param pszIndexFile The full path of the index file to write.
+     *  @return true if the index was written.
+     */
+    virtual bool writeAssetIndexToFile(const char* pszDirectory, const char* pszIndexFile);
+
+    /**
+     *  Mounts an asset bundle, written by the ccbundle tool of proj.linux.
+     *
+     *  The bundle is added in front of the search paths as "<full path of the bundle>/". Its files are found by
+     *  fullPathForFilename() like the files of a directory, resolution directories included, without probing the
+     *  file system, and getFileData() and getFileDataView() read them from the bundle.
+     *  It can be moved in the search paths with setSearchPaths(), it stays mounted until unmountBundle() is called.
+     *  Mount the bundles before loading textures asynchronously.
+     *
+     *  @param pszBundleFile The bundle, it is searched like any resource. It must be on the file system, not in the apk.
+     *  @return true if the bundle was mounted.
+     */
+    virtual bool mountBundle(const char* pszBundleFile);
+
+    /**
+     *  Unmounts a bundle mounted by mountBundle(), and removes it from the search paths.
+     */
+    virtual void unmountBundle(const char* pszBundleFile);
+
+    /**
+     *  Returns the mounted bundle that contains a full path returned by fullPathForFilename(), and the name of the file
+     *  in it. Returns NULL if the file isn't in a bundle.
+     *  It can be called from any thread. The bundle is retained, since it can be unmounted meanwhile: the caller gives it
+     *  back with releaseBundle().
+     */
+    CCAssetBundle* getBundleForFullPath(const std::string& fullPath, std::string& name);
+
+    /**
+     *  Releases a bundle returned by getBundleForFullPath(). The reference count of CCObject isn't atomic,
+     *  so the bundles are retained and released under the same lock.
+     */
+    void releaseBundle(CCAssetBundle* pBundle);
+
     /**
      *  Gets the writable path.
      *  @return  The path that can be write/read a file in
@@ -340,6 +436,15 @@ protected:
      */
     virtual std::string getFullPathForDirectoryAndFilename(const std::string& strDirectory, const std::string& strFilename);
     
+    /**
+     *  Lists the files in a directory and in its subdirectories, for the asset index.
+     *
+     *  @param strDirectory The directory to scan.
+     *  @param files        Receives the paths of the files, relative to strDirectory.
+     *  @return false if the directory can't be scanned, the search path isn't indexed then.
+     */
+    virtual bool listFilesInDirectory(const std::string& strDirectory, std::vector<std::string>& files);
+    
     /**
      *  Creates a dictionary by the contents of a file.
      *  @note This method is used internally.
@@ -358,6 +463,22 @@ protected:
      */
     virtual CCArray* createCCArrayWithContentsOfFile(const std::string& filename);
     
+    /**
+     *  Adds a file returned by getFileDataView() to the counters, for the subclasses that override it.
+     */
+    static void countFileData(unsigned long uSize, bool bMapped);
+    
+    /**
+     *  Returns the index of a search path, scanning it if needed.
+     */
+    struct _ccAssetIndex* getAssetIndex(const std::string& searchPath);
+    
+    /**
+     *  Drops the index of the search paths that aren't in m_searchPathArray anymore, and all the cached full paths.
+     *  Called when the search paths, the resolution directories or the filename lookup dictionary change.
+     */
+    void invalidateSearchCache();
+    
     /** Dictionary used to lookup filenames based on a key.
      *  It is used internally by the following methods:
      *
@@ -394,6 +515,20 @@ protected:
      */
     std::map<std::string, std::string> m_fullPathCache;
     
+    /**
+     *  The asset index: the files of the indexed search paths, by search path.
+     *  When the asset index is enabled, the files that can't be found are cached in m_fullPathCache with an empty full path.
+     */
+    std::map<std::string, struct _ccAssetIndex*> m_assetIndex;
+    bool m_bAssetIndexEnabled;
+    
+    /**
+     *  The mounted bundles, by search path.
+     *  getBundleForFullPath() reads them from the texture loading threads, they are changed under m_bundlesMutex.
+     */
+    std::map<std::string, CCAssetBundle*> m_bundles;
+    pthread_mutex_t m_bundlesMutex;
+    
     /**
      *  The singleton pointer of CCFileUtils.
      */
@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "CCCommon.h"
 #include "CCStdC.h"
 #include "CCFileUtils.h"
+#include "CCFileData.h"
 //libpng库的头文件  
 #include "png.h"
 //libjpg库的头文件
@@ -129,17 +130,16 @@ bool CCImage::initWithImageFile(const char * strPath, EImageFormat eImgFmt/* = e
 
     SDL_FreeSurface(iSurf);
 #else
-    unsigned long nSize = 0;
-    //调用文件操作函数库中的函数读取相应路径的文件到内存中，并返回内存的地址给指针变量pBuffer。  
+    //调用文件操作函数库中的函数读取相应路径的文件。大文件直接映射到内存中，不用复制。
     std::string fullPath = CCFileUtils::sharedFileUtils()->fullPathForFilename(strPath);
-    unsigned char* pBuffer = CCFileUtils::sharedFileUtils()->getFileData(fullPath.c_str(), "rb", &nSize);
-    if (pBuffer != NULL && nSize > 0)
+    CCFileData* pData = CCFileUtils::sharedFileUtils()->getFileDataView(fullPath.c_str());
+    if (pData != NULL && pData->getSize() > 0)
     {
-         //如果读取成功，则将内存地址做为参数调用initWithImageData函数来加载图片数据。 
-        bRet = initWithImageData(pBuffer, nSize, eImgFmt);
+         //如果读取成功，则将内存地址做为参数调用initWithImageData函数来加载图片数据。解码器只读取这些数据。
+        bRet = initWithImageData((void*)pData->getBytes(), pData->getSize(), eImgFmt);
     }
-     //释放读取文件所创建的内存。
-    CC_SAFE_DELETE_ARRAY(pBuffer);
+     //释放文件数据。
+    CC_SAFE_RELEASE(pData);
 #endif // EMSCRIPTEN
 
     return bRet;
@@ -148,16 +148,15 @@ bool CCImage::initWithImageFile(const char * strPath, EImageFormat eImgFmt/* = e
 bool CCImage::initWithImageFileThreadSafe(const char *fullpath, EImageFormat imageType)
 {
     bool bRet = false;
-    unsigned long nSize = 0;
-    //调用文件操作函数库中的函数读取相应路径的文件到内存中，并返回内存的地址给指针变量pBuffer。
-    unsigned char *pBuffer = CCFileUtils::sharedFileUtils()->getFileData(fullpath, "rb", &nSize);
-    if (pBuffer != NULL && nSize > 0)
+    //调用文件操作函数库中的函数读取相应路径的文件。大文件直接映射到内存中，不用复制。
+    CCFileData* pData = CCFileUtils::sharedFileUtils()->getFileDataView(fullpath);
+    if (pData != NULL && pData->getSize() > 0)
     {
-        //如果读取成功，则将内存地址做为参数调用initWithImageData函数来加载图片数据。 
-        bRet = initWithImageData(pBuffer, nSize, imageType);
+        //如果读取成功，则将内存地址做为参数调用initWithImageData函数来加载图片数据。解码器只读取这些数据。
+        bRet = initWithImageData((void*)pData->getBytes(), pData->getSize(), imageType);
     }
-    //释放读取文件所创建的内存。
-    CC_SAFE_DELETE_ARRAY(pBuffer);
+    //释放文件数据。CCFileData没有被autorelease，所以可以在加载线程中使用。
+    CC_SAFE_RELEASE(pData);
     return bRet;
 }
 //从内存中加载图片数据。
@@ -25,6 +25,7 @@
 #include "CCSAXParser.h"
 #include "cocoa/CCDictionary.h"
 #include "CCFileUtils.h"
+#include "CCFileData.h"
 #include "support/tinyxml2/tinyxml2.h"
 
 #include <vector> // because its based on windows 8 build :P
@@ -115,13 +116,12 @@ bool CCSAXParser::parse(const char* pXMLData, unsigned int uDataLength)
 bool CCSAXParser::parse(const char *pszFile)
 {
     bool bRet = false;
-    unsigned long size = 0;
-    char* pBuffer = (char*)CCFileUtils::sharedFileUtils()->getFileData(pszFile, "rt", &size);
-    if (pBuffer != NULL && size > 0)
+    CCFileData* pData = CCFileUtils::sharedFileUtils()->getFileDataView(pszFile);
+    if (pData != NULL && pData->getSize() > 0)
     {
-        bRet = parse(pBuffer, size);
+        bRet = parse((const char*)pData->getBytes(), pData->getSize());
     }
-    CC_SAFE_DELETE_ARRAY(pBuffer);
+    CC_SAFE_RELEASE(pData);
     return bRet;
 }
 
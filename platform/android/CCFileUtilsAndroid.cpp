@@ -23,6 +23,8 @@ THE SOFTWARE.
 ****************************************************************************/
 #include "CCFileUtilsAndroid.h"
 #include "support/zip_support/ZipUtils.h"
+#include "platform/CCFileData.h"
+#include "platform/CCAssetBundle.h"
 #include "platform/CCCommon.h"
 #include "jni/Java_org_cocos2dx_lib_Cocos2dxHelper.h"
 
@@ -120,7 +122,20 @@ unsigned char* CCFileUtilsAndroid::getFileData(const char* pszFileName, const ch
 
     string fullPath = fullPathForFilename(pszFileName);
 
-    if (fullPath[0] != '/')
+    string name;
+    CCAssetBundle *pBundle = getBundleForFullPath(fullPath, name);
+
+    if (pBundle)
+    {
+        unsigned long size = 0;
+        pData = pBundle->getFileData(name, &size);
+        releaseBundle(pBundle);
+        if (pSize)
+        {
+            *pSize = size;
+        }
+    }
+    else if (fullPath[0] != '/')
     {
         //CCLOG("GETTING FILE RELATIVE DATA: %s", pszFileName);
         pData = s_pZipFile->getFileData(fullPath.c_str(), pSize);
@@ -159,6 +174,32 @@ unsigned char* CCFileUtilsAndroid::getFileData(const char* pszFileName, const ch
     return pData;
 }
 
+CCFileData* CCFileUtilsAndroid::getFileDataView(const char* pszFileName)
+{
+    if ((! pszFileName) || 0 == strlen(pszFileName))
+    {
+        return NULL;
+    }
+
+    string fullPath = fullPathForFilename(pszFileName);
+    if (fullPath[0] == '/')
+    {
+        return CCFileUtils::getFileDataView(fullPath.c_str());
+    }
+
+    // in the apk: the images, which aapt doesn't compress, are mapped straight from it
+    CCFileData* pData = s_pZipFile->getFileDataView(fullPath);
+    if (pData)
+    {
+        countFileData(pData->getSize(), pData->isMapped());
+    }
+    else
+    {
+        CCLOG("Get data from file(%s) failed!", pszFileName);
+    }
+    return pData;
+}
+
 string CCFileUtilsAndroid::getWritablePath()
 {
     // Fix for Nexus 10 (Android 4.2 multi-user environment)
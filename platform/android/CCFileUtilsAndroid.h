@@ -49,6 +49,7 @@ public:
     /* override funtions */
     bool init();
     virtual unsigned char* getFileData(const char* pszFileName, const char* pszMode, unsigned long * pSize);
+    virtual CCFileData* getFileDataView(const char* pszFileName);
     virtual std::string getWritablePath();
     virtual bool isFileExist(const std::string& strFilePath);
     virtual bool isAbsolutePath(const std::string& strPath);
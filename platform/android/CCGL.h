@@ -35,6 +35,12 @@ THE SOFTWARE.
 #define GL_DEPTH24_STENCIL8			GL_DEPTH24_STENCIL8_OES
 #define GL_WRITE_ONLY				GL_WRITE_ONLY_OES
 
+#define CC_GL_PROGRAM_BINARY		1
+#define glGetProgramBinary			glGetProgramBinaryOES
+#define glProgramBinary				glProgramBinaryOES
+#define GL_PROGRAM_BINARY_LENGTH	GL_PROGRAM_BINARY_LENGTH_OES
+#define GL_NUM_PROGRAM_BINARY_FORMATS	GL_NUM_PROGRAM_BINARY_FORMATS_OES
+
 // GL_GLEXT_PROTOTYPES isn't defined in glplatform.h on android ndk r7 
 // we manually define it here
 #include <GLES2/gl2platform.h>
@@ -61,5 +67,11 @@ extern PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArraysOESEXT;
 #define glBindVertexArrayOES glBindVertexArrayOESEXT
 #define glDeleteVertexArraysOES glDeleteVertexArraysOESEXT
 
+extern PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOESEXT;
+extern PFNGLPROGRAMBINARYOESPROC glProgramBinaryOESEXT;
+
+#define glGetProgramBinaryOES glGetProgramBinaryOESEXT
+#define glProgramBinaryOES glProgramBinaryOESEXT
+
 
 #endif // __CCGL_H__
@@ -28,5 +28,6 @@ THE SOFTWARE.
 #include "GL/glew.h"
 
 #define CC_GL_DEPTH24_STENCIL8		GL_DEPTH24_STENCIL8
+#define CC_GL_PROGRAM_BINARY		1
 
 #endif // __CCGL_H__
@@ -1,5 +1,6 @@
 #include "CCFileUtilsMarmalade.h"
 #include "platform/CCCommon.h"
+#include "platform/CCAssetBundle.h"
 #include "ccMacros.h"
 #include "CCApplication.h"
 #include "cocoa/CCString.h"
@@ -43,6 +44,15 @@ unsigned char* CCFileUtilsMarmalade::getFileData(const char* pszFileName, const
 	IW_CALLSTACK("CCFileUtils::getFileData");
     
     std::string fullPath = fullPathForFilename(pszFileName);
+
+    std::string name;
+    CCAssetBundle *pBundle = getBundleForFullPath(fullPath, name);
+    if (pBundle)
+    {
+        unsigned char *pData = pBundle->getFileData(name, pSize);
+        releaseBundle(pBundle);
+        return pData;
+    }
     
 	s3eFile* pFile = s3eFileOpen(fullPath.c_str(), pszMode);
 	
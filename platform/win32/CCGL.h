@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "GL/glew.h"
 
 #define CC_GL_DEPTH24_STENCIL8		GL_DEPTH24_STENCIL8
+#define CC_GL_PROGRAM_BINARY		1
 
 // These macros are only for making CCTexturePVR.cpp complied without errors since they are not included in GLEW.
 #define GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG                      0x8C00
@@ -0,0 +1,282 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ bundlebench: loads the same textures and text files from a resource directory and from an asset bundle packed by
+ ccbundle, and compares the load times.
+
+ usage: bundlebench [files] [packer]
+    files   number of png files, and of text files, 100 by default
+    packer  path of ccbundle, the one built next to this benchmark by default
+
+ The png files are 256 x 256 with alpha, the text files are 4 KB plists. They are written in the writable path,
+ packed in RGBA8888, with the default compression (-z 6) and without it (-z 0), and removed at the end. Every mode
+ is timed 3 times, the best time is printed. Needs a display, the window is opened by CCEGLView.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+USING_NS_CC;
+
+#ifndef CCBUNDLE_PATH
+#define CCBUNDLE_PATH   "ccbundle"
+#endif
+
+#define kTextureSide    256
+#define kTextSize       4096
+#define kRounds         3
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static long fileSize(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long)st.st_size : 0;
+}
+
+static std::string textureName(unsigned int i)
+{
+    char name[32];
+    sprintf(name, "textures/tex%03u.png", i);
+    return name;
+}
+
+static std::string textName(unsigned int i)
+{
+    char name[32];
+    sprintf(name, "data/text%03u.plist", i);
+    return name;
+}
+
+static bool writeResources(const std::string& directory, unsigned int uFiles, long *pBytes)
+{
+    mkdir(directory.c_str(), 0755);
+    mkdir((directory + "textures").c_str(), 0755);
+    mkdir((directory + "data").c_str(), 0755);
+
+    *pBytes = 0;
+    unsigned char *pPixels = new unsigned char[kTextureSide * kTextureSide * 4];
+    unsigned int n = 1;
+    bool bRet = true;
+    for (unsigned int i = 0; i < uFiles && bRet; i++)
+    {
+        // gradients with some noise, and a varying alpha so the packer premultiplies
+        for (unsigned int p = 0; p < kTextureSide * kTextureSide; p++)
+        {
+            n = n * 1103515245 + 12345;
+            unsigned int x = p % kTextureSide, y = p / kTextureSide;
+            pPixels[p * 4] = (unsigned char)(x + i);
+            pPixels[p * 4 + 1] = (unsigned char)(y + (n >> 28));
+            pPixels[p * 4 + 2] = (unsigned char)(x ^ y);
+            pPixels[p * 4 + 3] = (unsigned char)(255 - (x + y) / 2);
+        }
+        std::string path = directory + textureName(i);
+        CCImage *pImage = new CCImage();
+        bRet = pImage->initWithImageData(pPixels, kTextureSide * kTextureSide * 4, CCImage::kFmtRawData, kTextureSide, kTextureSide, 8)
+            && pImage->saveToFile(path.c_str(), false);
+        pImage->release();
+        *pBytes += fileSize(path);
+    }
+    delete [] pPixels;
+
+    for (unsigned int i = 0; i < uFiles && bRet; i++)
+    {
+        std::string path = directory + textName(i);
+        FILE *fp = fopen(path.c_str(), "w");
+        if (! fp)
+        {
+            return false;
+        }
+        fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<plist version=\"1.0\">\n<dict>\n");
+        for (unsigned int k = 0; ftell(fp) < kTextSize; k++)
+        {
+            fprintf(fp, "    <key>key%u_%u</key>\n    <string>value %u of file %u</string>\n", k, i, k * 7, i);
+        }
+        fprintf(fp, "</dict>\n</plist>\n");
+        fclose(fp);
+        *pBytes += fileSize(path);
+    }
+    return bRet;
+}
+
+static void removeResources(const std::string& directory, unsigned int uFiles)
+{
+    for (unsigned int i = 0; i < uFiles; i++)
+    {
+        remove((directory + textureName(i)).c_str());
+        remove((directory + textName(i)).c_str());
+    }
+    rmdir((directory + "textures").c_str());
+    rmdir((directory + "data").c_str());
+    rmdir(directory.c_str());
+}
+
+// loads every file through the search paths, returns the seconds spent on the textures and on the text files
+static bool loadFiles(unsigned int uFiles, std::vector<std::string>& texts, double *pTextures, double *pTexts)
+{
+    CCTextureCache::sharedTextureCache()->removeAllTextures();
+    CCFileUtils::sharedFileUtils()->purgeCachedEntries();
+
+    bool bCheck = texts.empty();
+    double t = now();
+    for (unsigned int i = 0; i < uFiles; i++)
+    {
+        CCTexture2D *pTexture = CCTextureCache::sharedTextureCache()->addImage(textureName(i).c_str());
+        if (! pTexture || pTexture->getPixelsWide() != kTextureSide || pTexture->getPixelsHigh() != kTextureSide)
+        {
+            printf("FAILED: can't load %s\n", textureName(i).c_str());
+            return false;
+        }
+    }
+    *pTextures = MIN(*pTextures, now() - t);
+
+    t = now();
+    for (unsigned int i = 0; i < uFiles; i++)
+    {
+        unsigned long uSize = 0;
+        unsigned char *pData = CCFileUtils::sharedFileUtils()->getFileData(textName(i).c_str(), "rb", &uSize);
+        if (! pData)
+        {
+            printf("FAILED: can't read %s\n", textName(i).c_str());
+            return false;
+        }
+        std::string text((const char*)pData, uSize);
+        delete [] pData;
+        if (bCheck)
+        {
+            texts.push_back(text);
+        }
+        else if (text != texts[i])
+        {
+            printf("FAILED: %s doesn't match the loose file\n", textName(i).c_str());
+            return false;
+        }
+    }
+    *pTexts = MIN(*pTexts, now() - t);
+    return true;
+}
+
+// packs the directory with the given zlib level, then loads the files from the bundle
+static bool benchBundle(const std::string& packer, const std::string& directory, const std::string& bundle, int nLevel,
+                        unsigned int uFiles, std::vector<std::string>& texts)
+{
+    char command[1024];
+    snprintf(command, sizeof(command), "%s -t rgba8888 -z %d %s %s > /dev/null", packer.c_str(), nLevel, directory.c_str(), bundle.c_str());
+    double pack = now();
+    if (system(command) != 0)
+    {
+        printf("FAILED: %s\n", command);
+        return false;
+    }
+    pack = now() - pack;
+
+    CCFileUtils *pFileUtils = CCFileUtils::sharedFileUtils();
+    double textures = 1e9, textFiles = 1e9, mount = 1e9;
+    bool bRet = true;
+    for (int r = 0; r < kRounds && bRet; r++)
+    {
+        double t = now();
+        bRet = pFileUtils->mountBundle(bundle.c_str());
+        mount = MIN(mount, now() - t);
+        if (! bRet)
+        {
+            printf("FAILED: can't mount %s\n", bundle.c_str());
+            break;
+        }
+        bRet = loadFiles(uFiles, texts, &textures, &textFiles);
+        pFileUtils->unmountBundle(bundle.c_str());
+    }
+    if (bRet)
+    {
+        printf("bundle -z %d: textures %8.1f ms, text files %6.2f ms, mount %.2f ms, %6.1f MB packed in %.0f ms\n",
+               nLevel, textures * 1e3, textFiles * 1e3, mount * 1e3, fileSize(bundle) / 1048576.0, pack * 1e3);
+    }
+    remove(bundle.c_str());
+    return bRet;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uFiles = argc > 1 ? (unsigned int)atoi(argv[1]) : 100;
+    std::string packer = argc > 2 ? argv[2] : CCBUNDLE_PATH;
+    if (uFiles == 0)
+    {
+        printf("usage: bundlebench [files] [packer]\n");
+        return 1;
+    }
+
+    CCEGLView *pView = CCEGLView::sharedOpenGLView();
+    pView->setFrameSize(64, 64);
+    CCConfiguration::sharedConfiguration()->gatherGPUInfo();
+
+    CCFileUtils *pFileUtils = CCFileUtils::sharedFileUtils();
+    std::string directory = pFileUtils->getWritablePath() + "bundlebench/";
+    std::string bundle = pFileUtils->getWritablePath() + "bundlebench.ccb";
+    long looseBytes = 0;
+    if (! writeResources(directory, uFiles, &looseBytes))
+    {
+        printf("FAILED: can't write the resources in %s\n", directory.c_str());
+        removeResources(directory, uFiles);
+        return 1;
+    }
+
+    std::vector<std::string> searchPaths = pFileUtils->getSearchPaths();
+    std::vector<std::string> texts;
+    double textures = 1e9, textFiles = 1e9;
+    bool bRet = true;
+
+    std::vector<std::string> looseSearchPaths(1, directory);
+    pFileUtils->setSearchPaths(looseSearchPaths);
+    for (int r = 0; r < kRounds && bRet; r++)
+    {
+        bRet = loadFiles(uFiles, texts, &textures, &textFiles);
+    }
+    pFileUtils->setSearchPaths(searchPaths);
+    if (bRet)
+    {
+        printf("loose files: textures %8.1f ms, text files %6.2f ms, %u png + %u plist files, %6.1f MB\n",
+               textures * 1e3, textFiles * 1e3, uFiles, uFiles, looseBytes / 1048576.0);
+    }
+
+    // the texts read from the loose files are the reference
+    bRet = bRet && benchBundle(packer, directory, bundle, 6, uFiles, texts);
+    bRet = bRet && benchBundle(packer, directory, bundle, 0, uFiles, texts);
+
+    CCTextureCache::sharedTextureCache()->removeAllTextures();
+    removeResources(directory, uFiles);
+    return bRet ? 0 : 1;
+}
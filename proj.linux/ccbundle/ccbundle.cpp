@@ -0,0 +1,545 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ ccbundle: packs a resource directory in an asset bundle, mounted by CCFileUtils::mountBundle().
+
+ usage: ccbundle [-t rgba8888|rgba4444|rgb565] [-z level] [-r] <resource directory> <bundle file>
+    -t  pixel format of the png files, decoded like CCImage and CCTexture2D do. rgba8888 by default
+    -r  keep the png files as they are instead of decoding them
+    -z  zlib compression level, from 0 (store everything) to 9. 6 by default
+ */
+
+#include "platform/CCAssetBundleFormat.h"
+#include "png.h"
+#include <zlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+typedef struct _BundleEntry
+{
+    std::string                 name;
+    unsigned int                hash;
+    unsigned char               type;
+    unsigned char               compression;
+    unsigned int                size;
+    std::vector<unsigned char>  data;           // as stored in the bundle
+    unsigned int                offset;
+    unsigned int                width;
+    unsigned int                height;
+    unsigned char               pixelFormat;
+    unsigned char               textureFlags;
+} BundleEntry;
+
+static bool compareEntries(const BundleEntry *a, const BundleEntry *b)
+{
+    if (a->hash != b->hash)
+    {
+        return a->hash < b->hash;
+    }
+    return a->name < b->name;
+}
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& data)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (! fp)
+    {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data.resize(size);
+    bool bRet = size == 0 || fread(&data[0], 1, size, fp) == (size_t)size;
+    fclose(fp);
+    return bRet;
+}
+
+// the files of a directory and of its subdirectories, relative to the root, sorted so the bundles are reproducible
+static bool listFiles(const std::string& root, const std::string& directory, std::vector<std::string>& files)
+{
+    DIR *pDir = opendir((root + directory).c_str());
+    if (! pDir)
+    {
+        fprintf(stderr, "ccbundle: can't open %s\n", (root + directory).c_str());
+        return false;
+    }
+
+    std::vector<std::string> names;
+    struct dirent *pEntry;
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        // skips ".", ".." and the hidden files
+        if (pEntry->d_name[0] != '.')
+        {
+            names.push_back(pEntry->d_name);
+        }
+    }
+    closedir(pDir);
+    std::sort(names.begin(), names.end());
+
+    bool bRet = true;
+    for (unsigned int i = 0; i < names.size() && bRet; ++i)
+    {
+        std::string path = directory + names[i];
+        struct stat st;
+        if (stat((root + path).c_str(), &st) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+        {
+            bRet = listFiles(root, path + "/", files);
+        }
+        else if (S_ISREG(st.st_mode))
+        {
+            files.push_back(path);
+        }
+    }
+    return bRet;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// png decoding, same as CCImage::_initWithPngData() and CCTexture2D::initPremultipliedATextureWithImage()
+//////////////////////////////////////////////////////////////////////////
+
+#define CC_RGB_PREMULTIPLY_ALPHA(vr, vg, vb, va) \
+    (unsigned)(((unsigned)((unsigned char)(vr) * ((unsigned char)(va) + 1)) >> 8) | \
+    ((unsigned)((unsigned char)(vg) * ((unsigned char)(va) + 1) >> 8) << 8) | \
+    ((unsigned)((unsigned char)(vb) * ((unsigned char)(va) + 1) >> 8) << 16) | \
+    ((unsigned)(unsigned char)(va) << 24))
+
+typedef struct _PngSource
+{
+    const unsigned char         *data;
+    size_t                      size;
+    size_t                      offset;
+    // filled after setjmp(), they live here so a png error doesn't leave them in a register
+    std::vector<unsigned char>  decoded;
+    std::vector<png_bytep>      rows;
+} PngSource;
+
+static void pngReadCallback(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+    PngSource *pSource = (PngSource*)png_get_io_ptr(png_ptr);
+    if (pSource->offset + length > pSource->size)
+    {
+        png_error(png_ptr, "pngReadCallback failed");
+    }
+    memcpy(data, pSource->data + pSource->offset, length);
+    pSource->offset += length;
+}
+
+// decodes a png file in 32 bits pixels (premultiplied if it has an alpha channel)
+static bool decodePng(const std::vector<unsigned char>& file, std::vector<unsigned int>& pixels, unsigned int *pWidth, unsigned int *pHeight, bool *pHasAlpha)
+{
+    if (file.size() < 8 || png_sig_cmp((png_bytep)&file[0], 0, 8))
+    {
+        return false;
+    }
+
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+    png_infop info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+    if (! info_ptr)
+    {
+        png_destroy_read_struct(&png_ptr, NULL, NULL);
+        return false;
+    }
+
+    PngSource source;
+    if (setjmp(png_jmpbuf(png_ptr)))
+    {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return false;
+    }
+
+    source.data = &file[0];
+    source.size = file.size();
+    source.offset = 0;
+    png_set_read_fn(png_ptr, &source, pngReadCallback);
+    png_read_info(png_ptr, info_ptr);
+
+    unsigned int width = png_get_image_width(png_ptr, info_ptr);
+    unsigned int height = png_get_image_height(png_ptr, info_ptr);
+    int bitDepth = png_get_bit_depth(png_ptr, info_ptr);
+    int colorType = png_get_color_type(png_ptr, info_ptr);
+
+    if (colorType == PNG_COLOR_TYPE_PALETTE)
+    {
+        png_set_palette_to_rgb(png_ptr);
+    }
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+    {
+        png_set_expand_gray_1_2_4_to_8(png_ptr);
+    }
+    if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS))
+    {
+        png_set_tRNS_to_alpha(png_ptr);
+    }
+    if (bitDepth == 16)
+    {
+        png_set_strip_16(png_ptr);
+    }
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+    {
+        png_set_gray_to_rgb(png_ptr);
+    }
+    png_read_update_info(png_ptr, info_ptr);
+
+    png_uint_32 rowBytes = png_get_rowbytes(png_ptr, info_ptr);
+    unsigned int channels = rowBytes / width;
+    source.decoded.resize(rowBytes * height);
+    source.rows.resize(height);
+    for (unsigned int i = 0; i < height; ++i)
+    {
+        source.rows[i] = &source.decoded[0] + i * rowBytes;
+    }
+    png_read_image(png_ptr, &source.rows[0]);
+    png_read_end(png_ptr, NULL);
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+
+    if (channels != 3 && channels != 4)
+    {
+        return false;
+    }
+
+    pixels.resize(width * height);
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const unsigned char *pRow = source.rows[y];
+        for (unsigned int x = 0; x < width; ++x, pRow += channels)
+        {
+            pixels[y * width + x] = (channels == 4)
+                ? CC_RGB_PREMULTIPLY_ALPHA(pRow[0], pRow[1], pRow[2], pRow[3])
+                : (pRow[0] | (pRow[1] << 8) | (pRow[2] << 16) | 0xff000000);
+        }
+    }
+
+    *pWidth = width;
+    *pHeight = height;
+    *pHasAlpha = (channels == 4);
+    return true;
+}
+
+// converts 32 bits pixels in the pixel format, with the same rounding as CCTexture2D
+static void convertPixels(const std::vector<unsigned int>& pixels, unsigned char pixelFormat, std::vector<unsigned char>& data)
+{
+    if (pixelFormat == kCCAssetBundlePixelFormatRGBA8888)
+    {
+        data.resize(pixels.size() * 4);
+        for (unsigned int i = 0; i < pixels.size(); ++i)
+        {
+            data[i * 4 + 0] = (pixels[i] >> 0) & 0xFF;
+            data[i * 4 + 1] = (pixels[i] >> 8) & 0xFF;
+            data[i * 4 + 2] = (pixels[i] >> 16) & 0xFF;
+            data[i * 4 + 3] = (pixels[i] >> 24) & 0xFF;
+        }
+        return;
+    }
+
+    data.resize(pixels.size() * 2);
+    for (unsigned int i = 0; i < pixels.size(); ++i)
+    {
+        unsigned int pixel = pixels[i];
+        unsigned short pixel16;
+        if (pixelFormat == kCCAssetBundlePixelFormatRGB565)
+        {
+            pixel16 = ((((pixel >> 0) & 0xFF) >> 3) << 11) |
+                      ((((pixel >> 8) & 0xFF) >> 2) << 5) |
+                      ((((pixel >> 16) & 0xFF) >> 3) << 0);
+        }
+        else
+        {
+            pixel16 = ((((pixel >> 0) & 0xFF) >> 4) << 12) |
+                      ((((pixel >> 8) & 0xFF) >> 4) << 8) |
+                      ((((pixel >> 16) & 0xFF) >> 4) << 4) |
+                      ((((pixel >> 24) & 0xFF) >> 4) << 0);
+        }
+        // GL reads the 16 bits pixels in the byte order of the machine, which is little endian on all the targets
+        data[i * 2 + 0] = pixel16 & 0xFF;
+        data[i * 2 + 1] = pixel16 >> 8;
+    }
+}
+
+static bool hasPngExtension(const std::string& name)
+{
+    if (name.length() < 4)
+    {
+        return false;
+    }
+    std::string extension = name.substr(name.length() - 4);
+    for (unsigned int i = 0; i < extension.length(); ++i)
+    {
+        extension[i] = tolower(extension[i]);
+    }
+    return extension == ".png";
+}
+
+//////////////////////////////////////////////////////////////////////////
+// bundle writing
+//////////////////////////////////////////////////////////////////////////
+
+static void writeUInt16(std::vector<unsigned char>& out, unsigned int uValue)
+{
+    out.push_back(uValue & 0xFF);
+    out.push_back((uValue >> 8) & 0xFF);
+}
+
+static void writeUInt32(std::vector<unsigned char>& out, unsigned int uValue)
+{
+    out.push_back(uValue & 0xFF);
+    out.push_back((uValue >> 8) & 0xFF);
+    out.push_back((uValue >> 16) & 0xFF);
+    out.push_back((uValue >> 24) & 0xFF);
+}
+
+static int usage()
+{
+    fprintf(stderr,
+        "usage: ccbundle [-t rgba8888|rgba4444|rgb565] [-z level] [-r] <resource directory> <bundle file>\n"
+        "    -t  pixel format of the png files, rgba8888 by default\n"
+        "    -r  keep the png files as they are instead of decoding them\n"
+        "    -z  zlib compression level, from 0 (store everything) to 9, 6 by default\n");
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char pixelFormat = kCCAssetBundlePixelFormatRGBA8888;
+    bool bDecodePng = true;
+    int nLevel = 6;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "rgba8888") == 0)
+            {
+                pixelFormat = kCCAssetBundlePixelFormatRGBA8888;
+            }
+            else if (strcmp(argv[i], "rgba4444") == 0)
+            {
+                pixelFormat = kCCAssetBundlePixelFormatRGBA4444;
+            }
+            else if (strcmp(argv[i], "rgb565") == 0)
+            {
+                pixelFormat = kCCAssetBundlePixelFormatRGB565;
+            }
+            else
+            {
+                return usage();
+            }
+        }
+        else if (strcmp(argv[i], "-z") == 0 && i + 1 < argc)
+        {
+            nLevel = atoi(argv[++i]);
+            if (nLevel < 0 || nLevel > 9)
+            {
+                return usage();
+            }
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            bDecodePng = false;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (argc - i != 2)
+    {
+        return usage();
+    }
+
+    std::string root = argv[i];
+    if (root[root.length() - 1] != '/')
+    {
+        root += "/";
+    }
+    const char *pszBundleFile = argv[i + 1];
+
+    std::vector<std::string> files;
+    if (! listFiles(root, "", files))
+    {
+        return 1;
+    }
+
+    std::vector<BundleEntry*> entries;
+    unsigned long uNamesSize = 0;
+    unsigned long long uInputSize = 0;
+    unsigned int uTextures = 0;
+    for (unsigned int f = 0; f < files.size(); ++f)
+    {
+        BundleEntry *pEntry = new BundleEntry();
+        pEntry->name = files[f];
+        pEntry->hash = ccAssetBundleHash(pEntry->name.c_str(), pEntry->name.length());
+        pEntry->type = kCCAssetBundleTypeFile;
+        pEntry->width = 0;
+        pEntry->height = 0;
+        pEntry->pixelFormat = 0;
+        pEntry->textureFlags = 0;
+
+        std::vector<unsigned char> contents;
+        if (! readFile(root + files[f], contents) || pEntry->name.length() > 0xFFFF)
+        {
+            fprintf(stderr, "ccbundle: can't read %s\n", files[f].c_str());
+            return 1;
+        }
+        uInputSize += contents.size();
+
+        std::vector<unsigned int> pixels;
+        unsigned int width, height;
+        bool bHasAlpha;
+        if (bDecodePng && hasPngExtension(pEntry->name) && decodePng(contents, pixels, &width, &height, &bHasAlpha))
+        {
+            if (width <= 0xFFFF && height <= 0xFFFF)
+            {
+                convertPixels(pixels, pixelFormat, contents);
+                pEntry->type = kCCAssetBundleTypeTexture;
+                pEntry->width = width;
+                pEntry->height = height;
+                pEntry->pixelFormat = pixelFormat;
+                pEntry->textureFlags = bHasAlpha ? kCCAssetBundleTexturePremultipliedAlpha : 0;
+                ++uTextures;
+            }
+        }
+        else if (bDecodePng && hasPngExtension(pEntry->name))
+        {
+            fprintf(stderr, "ccbundle: warning: can't decode %s, it is stored as it is\n", files[f].c_str());
+        }
+
+        pEntry->size = contents.size();
+        pEntry->compression = kCCAssetBundleCompressionNone;
+        if (nLevel > 0 && contents.size() > 0)
+        {
+            uLongf uCompressedSize = compressBound(contents.size());
+            pEntry->data.resize(uCompressedSize);
+            // only worth it if it saves at least 1/8 of the file
+            if (compress2(&pEntry->data[0], &uCompressedSize, &contents[0], contents.size(), nLevel) == Z_OK
+                && uCompressedSize < contents.size() - contents.size() / 8)
+            {
+                pEntry->data.resize(uCompressedSize);
+                pEntry->compression = kCCAssetBundleCompressionZlib;
+            }
+        }
+        if (pEntry->compression == kCCAssetBundleCompressionNone)
+        {
+            pEntry->data.swap(contents);
+        }
+
+        uNamesSize += pEntry->name.length();
+        entries.push_back(pEntry);
+    }
+    std::sort(entries.begin(), entries.end(), compareEntries);
+
+    // the data start after the index, every entry on an aligned offset
+    unsigned long long uOffset = kCCAssetBundleHeaderSize + (unsigned long long)entries.size() * kCCAssetBundleEntrySize + uNamesSize;
+    for (unsigned int e = 0; e < entries.size(); ++e)
+    {
+        uOffset = (uOffset + kCCAssetBundleDataAlignment - 1) / kCCAssetBundleDataAlignment * kCCAssetBundleDataAlignment;
+        entries[e]->offset = (unsigned int)uOffset;
+        uOffset += entries[e]->data.size();
+    }
+    if (uOffset > 0xFFFFFFFFULL)
+    {
+        fprintf(stderr, "ccbundle: the bundle would be bigger than 4 GB\n");
+        return 1;
+    }
+
+    std::vector<unsigned char> index;
+    index.insert(index.end(), kCCAssetBundleMagic, kCCAssetBundleMagic + 4);
+    writeUInt32(index, kCCAssetBundleVersion);
+    writeUInt32(index, entries.size());
+    writeUInt32(index, uNamesSize);
+
+    unsigned int uNameOffset = 0;
+    for (unsigned int e = 0; e < entries.size(); ++e)
+    {
+        BundleEntry *pEntry = entries[e];
+        writeUInt32(index, pEntry->hash);
+        writeUInt32(index, uNameOffset);
+        writeUInt16(index, pEntry->name.length());
+        index.push_back(pEntry->type);
+        index.push_back(pEntry->compression);
+        writeUInt32(index, pEntry->offset);
+        writeUInt32(index, pEntry->data.size());
+        writeUInt32(index, pEntry->size);
+        writeUInt16(index, pEntry->width);
+        writeUInt16(index, pEntry->height);
+        index.push_back(pEntry->pixelFormat);
+        index.push_back(pEntry->textureFlags);
+        writeUInt16(index, 0);
+        uNameOffset += pEntry->name.length();
+    }
+    for (unsigned int e = 0; e < entries.size(); ++e)
+    {
+        index.insert(index.end(), entries[e]->name.begin(), entries[e]->name.end());
+    }
+
+    FILE *fp = fopen(pszBundleFile, "wb");
+    if (! fp)
+    {
+        fprintf(stderr, "ccbundle: can't write %s\n", pszBundleFile);
+        return 1;
+    }
+    bool bWritten = fwrite(&index[0], 1, index.size(), fp) == index.size();
+    unsigned long uWritten = index.size();
+    for (unsigned int e = 0; e < entries.size() && bWritten; ++e)
+    {
+        std::vector<unsigned char> padding;
+        while (uWritten + padding.size() < entries[e]->offset)
+        {
+            padding.push_back(0);
+        }
+        bWritten = padding.empty() || fwrite(&padding[0], 1, padding.size(), fp) == padding.size();
+        bWritten = bWritten && (entries[e]->data.empty() || fwrite(&entries[e]->data[0], 1, entries[e]->data.size(), fp) == entries[e]->data.size());
+        uWritten += padding.size() + entries[e]->data.size();
+    }
+    bWritten = (fclose(fp) == 0) && bWritten;
+    if (! bWritten)
+    {
+        fprintf(stderr, "ccbundle: can't write %s\n", pszBundleFile);
+        remove(pszBundleFile);
+        return 1;
+    }
+
+    printf("ccbundle: %u files (%u textures), %llu bytes packed in %lu bytes\n",
+        (unsigned int)entries.size(), uTextures, uInputSize, uWritten);
+
+    for (unsigned int e = 0; e < entries.size(); ++e)
+    {
+        delete entries[e];
+    }
+    return 0;
+}
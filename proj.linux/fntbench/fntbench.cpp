@@ -0,0 +1,193 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ fntbench: loads a large text .fnt file, converts it with CCBMFontConfiguration::writeBinaryFile(), loads the
+ binary file, and checks that both configurations have the same glyphs and kernings.
+
+ usage: fntbench [glyphs] [repeats]
+    glyphs   number of characters of the font, from U+4E00, 8000 by default
+    repeats  number of loads of each file, 20 by default
+
+ The font has a kerning pair for one glyph in four. The files are written in the writable path and removed at the
+ end. The atlas isn't loaded, so no display is needed.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+USING_NS_CC;
+
+#define kFirstChar      0x4e00
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// 32 x 32 cells in 1024 x 1024 pages
+static bool writeTextFont(const std::string& fntPath, unsigned int uGlyphs)
+{
+    FILE *fp = fopen(fntPath.c_str(), "w");
+    if (! fp)
+    {
+        return false;
+    }
+    fprintf(fp, "info face=\"fntbench\" size=32 bold=0 italic=0 charset=\"\" unicode=1 stretchH=100 smooth=1 aa=1 padding=1,2,3,4 spacing=1,1\n");
+    fprintf(fp, "common lineHeight=34 base=28 scaleW=1024 scaleH=1024 pages=1 packed=0\n");
+    fprintf(fp, "page id=0 file=\"fntbench.png\"\n");
+    fprintf(fp, "chars count=%u\n", uGlyphs);
+    for (unsigned int i = 0; i < uGlyphs; i++)
+    {
+        fprintf(fp, "char id=%-5u x=%-4u y=%-4u width=%-3u height=%-3u xoffset=%-3d yoffset=%-3d xadvance=%-3u page=0  chnl=15\n",
+                kFirstChar + i, (i % 32) * 32, (i / 32 % 32) * 32, 28 + i % 4, 30 + i % 3, (int)(i % 5) - 2, (int)(i % 7), 30 + i % 3);
+    }
+    fprintf(fp, "kernings count=%u\n", uGlyphs / 4);
+    for (unsigned int i = 0; i < uGlyphs / 4; i++)
+    {
+        fprintf(fp, "kerning first=%-5u second=%-5u amount=%d\n", kFirstChar + i * 4, kFirstChar + (i * 7) % uGlyphs, -(int)(1 + i % 3));
+    }
+    fclose(fp);
+    return true;
+}
+
+static unsigned int compareFonts(CCBMFontConfiguration *pText, CCBMFontConfiguration *pBinary, unsigned int uGlyphs)
+{
+    unsigned int uDifferences = 0;
+    if (pText->getFontDefCount() != pBinary->getFontDefCount() || pText->getKerningCount() != pBinary->getKerningCount()
+        || pText->m_nCommonHeight != pBinary->m_nCommonHeight
+        || pText->m_tPadding.left != pBinary->m_tPadding.left || pText->m_tPadding.top != pBinary->m_tPadding.top
+        || pText->m_tPadding.right != pBinary->m_tPadding.right || pText->m_tPadding.bottom != pBinary->m_tPadding.bottom
+        || strcmp(pText->getAtlasName(), pBinary->getAtlasName()) != 0)
+    {
+        uDifferences++;
+    }
+    for (unsigned int c = 0; c <= 0xffff; c++)
+    {
+        const ccBMFontDef *a = pText->getFontDef(c);
+        const ccBMFontDef *b = pBinary->getFontDef(c);
+        if (! a != ! b)
+        {
+            uDifferences++;
+        }
+        else if (a && (a->charID != b->charID || ! a->rect.equals(b->rect)
+                       || a->xOffset != b->xOffset || a->yOffset != b->yOffset || a->xAdvance != b->xAdvance))
+        {
+            uDifferences++;
+        }
+    }
+    for (unsigned int i = 0; i < uGlyphs; i += 4)
+    {
+        unsigned short first = kFirstChar + i;
+        unsigned short second = kFirstChar + (i / 4 * 7) % uGlyphs;
+        if (pText->getKerningAmount(first, second) != pBinary->getKerningAmount(first, second)
+            || pText->getKerningAmount(first, second) == 0)
+        {
+            uDifferences++;
+        }
+    }
+    return uDifferences;
+}
+
+// best time of the loads in milliseconds
+static double timeLoad(const std::string& path, unsigned int uRepeats)
+{
+    double best = 1e9;
+    for (unsigned int i = 0; i < uRepeats; i++)
+    {
+        CCBMFontConfiguration *pConfiguration = new CCBMFontConfiguration();
+        double t = now();
+        bool bRet = pConfiguration->initWithFNTfile(path.c_str());
+        t = now() - t;
+        pConfiguration->release();
+        if (! bRet)
+        {
+            return -1;
+        }
+        best = MIN(best, t * 1e3);
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uGlyphs = argc > 1 ? (unsigned int)atoi(argv[1]) : 8000;
+    unsigned int uRepeats = argc > 2 ? (unsigned int)atoi(argv[2]) : 20;
+    if (uGlyphs == 0 || uGlyphs > 0xffff - kFirstChar || uRepeats == 0)
+    {
+        printf("usage: fntbench [glyphs] [repeats]\n");
+        return 1;
+    }
+
+    std::string textPath = CCFileUtils::sharedFileUtils()->getWritablePath() + "fntbench.fnt";
+    std::string binaryPath = CCFileUtils::sharedFileUtils()->getWritablePath() + "fntbench_binary.fnt";
+    if (! writeTextFont(textPath, uGlyphs))
+    {
+        printf("FAILED: can't write %s\n", textPath.c_str());
+        return 1;
+    }
+
+    CCBMFontConfiguration *pText = new CCBMFontConfiguration();
+    CCBMFontConfiguration *pBinary = new CCBMFontConfiguration();
+    bool bRet = pText->initWithFNTfile(textPath.c_str()) && pText->writeBinaryFile(binaryPath.c_str())
+        && pBinary->initWithFNTfile(binaryPath.c_str());
+    unsigned int uDifferences = bRet ? compareFonts(pText, pBinary, uGlyphs) : 0;
+
+    double textLoad = bRet ? timeLoad(textPath, uRepeats) : -1;
+    double binaryLoad = bRet ? timeLoad(binaryPath, uRepeats) : -1;
+
+    // a label's worth of lookups, as in CCLabelBMFont::createFontChars()
+    double t = now();
+    unsigned int uFound = 0;
+    for (unsigned int i = 0; i < 1000000; i++)
+    {
+        uFound += pBinary->getFontDef(kFirstChar + (i * 7919) % (uGlyphs + 100)) != NULL;
+    }
+    double lookup = (now() - t) * 1e3;
+
+    pText->release();
+    pBinary->release();
+    remove(textPath.c_str());
+    remove(binaryPath.c_str());
+
+    if (! bRet || textLoad < 0 || binaryLoad < 0)
+    {
+        printf("FAILED: can't load or convert the font\n");
+        return 1;
+    }
+    printf("%u glyphs, %u kernings: text file %7.2f ms, binary file %6.2f ms, 1M lookups %6.2f ms (%u found)\n",
+           uGlyphs, uGlyphs / 4, textLoad, binaryLoad, lookup, uFound);
+    if (uDifferences)
+    {
+        printf("FAILED: %u differences between the text and the binary files\n", uDifferences);
+        return 1;
+    }
+    return 0;
+}
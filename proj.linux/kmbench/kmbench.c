@@ -0,0 +1,228 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ kmbench: compares the kazmath kernels of sse_matrix_impl.c with the scalar build (KM_NO_SSE), then times both.
+
+ usage: kmbench [iterations]
+    iterations  random inputs checked per kernel, 100000 by default
+
+ The vector transforms add their products in the same order as the scalar code, so their results must have
+ the same bits. The inverse uses another method, it is checked by the error of A * inverse(A) against the identity
+ instead. kmMat4Multiply and kmMat4Transpose have no SSE version, they aren't compared. Exits with 1 if a check fails.
+ */
+
+#include "kazmath/mat3.h"
+#include "kazmath/mat4.h"
+#include "kazmath/vec2.h"
+#include "kazmath/vec3.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* the scalar build, see the Makefile */
+kmMat4* scalar_kmMat4Multiply(kmMat4* pOut, const kmMat4* pM1, const kmMat4* pM2);
+kmMat4* scalar_kmMat4Inverse(kmMat4* pOut, const kmMat4* pM);
+kmVec3* scalar_kmVec3Transform(kmVec3* pOut, const kmVec3* pV, const kmMat4* pM);
+kmVec3* scalar_kmVec3TransformArray(kmVec3* pOut, const kmVec3* pV, const kmMat4* pM, unsigned int count);
+kmVec2* scalar_kmVec2TransformArray(kmVec2* pOut, const kmVec2* pV, const kmMat3* pM, unsigned int count);
+
+#define kVectorCount    1000
+#define kMatrixCount    1024
+
+static unsigned int s_uSeed = 1;
+
+/* same inputs on every run */
+static float randomFloat(void)
+{
+    s_uSeed = s_uSeed * 1103515245u + 12345u;
+    return ((s_uSeed >> 8) / (float)(1 << 24)) * 200.0f - 100.0f;
+}
+
+static void randomFloats(float *pValues, unsigned int count)
+{
+    unsigned int i;
+    for (i = 0; i < count; i++)
+    {
+        pValues[i] = randomFloat();
+    }
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* largest |A * inverse(A) - I| */
+static double inverseError(const kmMat4 *pM, const kmMat4 *pInverse)
+{
+    kmMat4 identity;
+    double error = 0;
+    int i;
+
+    scalar_kmMat4Multiply(&identity, pM, pInverse);
+    for (i = 0; i < 16; i++)
+    {
+        double e = fabs(identity.mat[i] - (i % 5 == 0 ? 1.0 : 0.0));
+        if (e > error)
+        {
+            error = e;
+        }
+    }
+    return error;
+}
+
+static int check(const char *pszName, int bSame)
+{
+    if (! bSame)
+    {
+        printf("FAILED: %s differs from the scalar build\n", pszName);
+    }
+    return bSame ? 0 : 1;
+}
+
+static int checkKernels(unsigned int uIterations)
+{
+    double inverseErrorSSE = 0, inverseErrorScalar = 0;
+    int failures = 0;
+    int bVec3 = 1, bVec3Array = 1, bVec2Array = 1;
+    unsigned int i;
+
+    for (i = 0; i < uIterations; i++)
+    {
+        kmMat4 a, out, scalarOut;
+        kmMat3 m3;
+        /* one more vector than transformed, which must be left alone */
+        kmVec3 v3[8], out3[8], scalarOut3[8];
+        kmVec2 v2[6], out2[6], scalarOut2[6];
+
+        randomFloats(a.mat, 16);
+        randomFloats(m3.mat, 9);
+        randomFloats((float*)v3, 3 * 8);
+        randomFloats((float*)v2, 2 * 6);
+
+        if (kmMat4Inverse(&out, &a) && scalar_kmMat4Inverse(&scalarOut, &a))
+        {
+            double e = inverseError(&a, &out);
+            double scalarE = inverseError(&a, &scalarOut);
+            inverseErrorSSE = e > inverseErrorSSE ? e : inverseErrorSSE;
+            inverseErrorScalar = scalarE > inverseErrorScalar ? scalarE : inverseErrorScalar;
+        }
+
+        kmVec3Transform(&out3[0], &v3[0], &a);
+        scalar_kmVec3Transform(&scalarOut3[0], &v3[0], &a);
+        bVec3 = bVec3 && memcmp(&out3[0], &scalarOut3[0], sizeof(kmVec3)) == 0;
+
+        memset(out3, 0x55, sizeof(out3));
+        memset(scalarOut3, 0x55, sizeof(scalarOut3));
+        kmVec3TransformArray(out3, v3, &a, 7);
+        scalar_kmVec3TransformArray(scalarOut3, v3, &a, 7);
+        bVec3Array = bVec3Array && memcmp(out3, scalarOut3, sizeof(out3)) == 0;
+
+        memset(out2, 0x55, sizeof(out2));
+        memset(scalarOut2, 0x55, sizeof(scalarOut2));
+        kmVec2TransformArray(out2, v2, &m3, 5);
+        scalar_kmVec2TransformArray(scalarOut2, v2, &m3, 5);
+        bVec2Array = bVec2Array && memcmp(out2, scalarOut2, sizeof(out2)) == 0;
+    }
+
+    failures += check("kmVec3Transform", bVec3);
+    failures += check("kmVec3TransformArray", bVec3Array);
+    failures += check("kmVec2TransformArray", bVec2Array);
+
+    printf("kmMat4Inverse: max |A * inverse(A) - I| %g, scalar %g\n", inverseErrorSSE, inverseErrorScalar);
+    if (inverseErrorSSE > 4 * inverseErrorScalar + 1e-5)
+    {
+        printf("FAILED: kmMat4Inverse is less accurate than the scalar build\n");
+        failures++;
+    }
+
+    return failures;
+}
+
+static void benchKernels(void)
+{
+    static kmMat4 s_matrices[kMatrixCount];
+    static kmVec3 s_vectors[kVectorCount];
+    static kmVec2 s_vectors2[kVectorCount];
+    kmMat4 m, inverse;
+    kmMat3 m3;
+    double t, sse, scalar;
+    int i;
+
+    randomFloats((float*)s_matrices, 16 * kMatrixCount);
+    randomFloats((float*)s_vectors, 3 * kVectorCount);
+    randomFloats((float*)s_vectors2, 2 * kVectorCount);
+    randomFloats(m.mat, 16);
+    randomFloats(m3.mat, 9);
+    /* keeps the transformed vectors finite */
+    for (i = 0; i < 16; i++)
+    {
+        m.mat[i] *= 0.01f;
+    }
+    for (i = 0; i < 9; i++)
+    {
+        m3.mat[i] *= 0.01f;
+    }
+
+    /* each inverse depends on the previous one, so that the calls aren't overlapped */
+    inverse = s_matrices[0];
+    t = now();
+    for (i = 0; i < 1000000; i++) { kmMat4Inverse(&inverse, &s_matrices[0]); s_matrices[0].mat[3] += inverse.mat[5] * 1e-9f; }
+    sse = (now() - t) * 1e9 / 1000000.0;
+    t = now();
+    for (i = 0; i < 1000000; i++) { scalar_kmMat4Inverse(&inverse, &s_matrices[0]); s_matrices[0].mat[3] += inverse.mat[5] * 1e-9f; }
+    scalar = (now() - t) * 1e9 / 1000000.0;
+    printf("kmMat4Inverse         %6.2f ns, scalar %6.2f ns\n", sse, scalar);
+
+    t = now();
+    for (i = 0; i < 10000; i++) kmVec3TransformArray(s_vectors, s_vectors, &m, kVectorCount);
+    sse = (now() - t) * 1e9 / (10000.0 * kVectorCount);
+    t = now();
+    for (i = 0; i < 10000; i++) scalar_kmVec3TransformArray(s_vectors, s_vectors, &m, kVectorCount);
+    scalar = (now() - t) * 1e9 / (10000.0 * kVectorCount);
+    printf("kmVec3TransformArray  %6.2f ns, scalar %6.2f ns per vector\n", sse, scalar);
+
+    t = now();
+    for (i = 0; i < 10000; i++) kmVec2TransformArray(s_vectors2, s_vectors2, &m3, kVectorCount);
+    sse = (now() - t) * 1e9 / (10000.0 * kVectorCount);
+    t = now();
+    for (i = 0; i < 10000; i++) scalar_kmVec2TransformArray(s_vectors2, s_vectors2, &m3, kVectorCount);
+    scalar = (now() - t) * 1e9 / (10000.0 * kVectorCount);
+    printf("kmVec2TransformArray  %6.2f ns, scalar %6.2f ns per vector\n", sse, scalar);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uIterations = argc > 1 ? (unsigned int)atoi(argv[1]) : 100000;
+    int failures = checkKernels(uIterations);
+
+    benchKernels();
+
+    return failures ? 1 : 0;
+}
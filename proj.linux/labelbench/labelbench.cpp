@@ -0,0 +1,153 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+
+/*
+ labelbench: times CCLabelBMFont::setString() on 1k-character strings, with the letter sprites and without
+ them (setLetterSpritesEnabled(false)).
+
+ usage: labelbench [repeats]
+    repeats  number of setString() per test, 200 by default
+
+ Each mode sets strings where every letter changes, strings where one letter changes, and the same string.
+ The font, 95 ASCII characters in a 256 x 256 texture, is written in the writable path and removed at the end.
+ Needs a display, the window is opened by CCEGLView.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+USING_NS_CC;
+
+#define kLabelLength    1000
+#define kLineLength     100
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// a font of 16 x 16 cells, the characters 32 to 126 in order
+static bool writeFont(const std::string& fntPath, const std::string& pngPath)
+{
+    unsigned char *pPixels = new unsigned char[256 * 256 * 4];
+    memset(pPixels, 0xff, 256 * 256 * 4);
+    CCImage *pImage = new CCImage();
+    bool bRet = pImage->initWithImageData(pPixels, 256 * 256 * 4, CCImage::kFmtRawData, 256, 256, 8)
+        && pImage->saveToFile(pngPath.c_str(), false);
+    pImage->release();
+    delete [] pPixels;
+
+    FILE *fp = fopen(fntPath.c_str(), "w");
+    if (! bRet || ! fp)
+    {
+        return false;
+    }
+    fprintf(fp, "info face=\"labelbench\" size=16 bold=0 italic=0 charset=\"\" unicode=0 stretchH=100 smooth=1 aa=1 padding=0,0,0,0 spacing=1,1\n");
+    fprintf(fp, "common lineHeight=16 base=13 scaleW=256 scaleH=256 pages=1 packed=0\n");
+    fprintf(fp, "page id=0 file=\"%s\"\n", pngPath.substr(pngPath.find_last_of('/') + 1).c_str());
+    fprintf(fp, "chars count=95\n");
+    for (int c = 32; c < 127; c++)
+    {
+        int i = c - 32;
+        fprintf(fp, "char id=%d x=%d y=%d width=14 height=16 xoffset=1 yoffset=0 xadvance=15 page=0 chnl=0\n",
+                c, (i % 16) * 16, (i / 16) * 16);
+    }
+    fclose(fp);
+    return true;
+}
+
+// kLabelLength printable characters starting at cFirst, broken in lines of kLineLength
+static std::string makeString(int nFirst)
+{
+    std::string str;
+    for (int i = 0; i < kLabelLength; i++)
+    {
+        str += (i % kLineLength == kLineLength - 1) ? '\n' : (char)(33 + (nFirst + i) % 94);
+    }
+    return str;
+}
+
+// microseconds per setString(), alternating between the two strings
+static double timeSetString(CCLabelBMFont *pLabel, const std::string& first, const std::string& second, unsigned int uRepeats)
+{
+    pLabel->setString(first.c_str());
+    double t = now();
+    for (unsigned int i = 0; i < uRepeats; i++)
+    {
+        pLabel->setString((i & 1) ? first.c_str() : second.c_str());
+    }
+    return (now() - t) * 1e6 / uRepeats;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uRepeats = argc > 1 ? (unsigned int)atoi(argv[1]) : 200;
+    if (uRepeats == 0)
+    {
+        uRepeats = 1;
+    }
+
+    CCEGLView *pView = CCEGLView::sharedOpenGLView();
+    pView->setFrameSize(64, 64);
+    CCConfiguration::sharedConfiguration()->gatherGPUInfo();
+
+    std::string fntPath = CCFileUtils::sharedFileUtils()->getWritablePath() + "labelbench.fnt";
+    std::string pngPath = CCFileUtils::sharedFileUtils()->getWritablePath() + "labelbench.png";
+    if (! writeFont(fntPath, pngPath))
+    {
+        printf("FAILED: can't write the font in %s\n", CCFileUtils::sharedFileUtils()->getWritablePath().c_str());
+        return 1;
+    }
+
+    std::string str = makeString(0);
+    std::string shifted = makeString(1);
+    std::string oneLetter = str;
+    oneLetter[kLabelLength / 2] = (oneLetter[kLabelLength / 2] == 'A') ? 'B' : 'A';
+
+    for (int nSprites = 1; nSprites >= 0; nSprites--)
+    {
+        CCLabelBMFont *pLabel = CCLabelBMFont::create("", fntPath.c_str());
+        pLabel->retain();
+        pLabel->setLetterSpritesEnabled(nSprites != 0);
+
+        double every = timeSetString(pLabel, str, shifted, uRepeats);
+        double one = timeSetString(pLabel, str, oneLetter, uRepeats);
+        double same = timeSetString(pLabel, str, str, uRepeats);
+        printf("%-11s %u letters: every letter changes %8.1f us, one letter %8.1f us, same string %8.1f us\n",
+               nSprites ? "sprites" : "no sprites", kLabelLength, every, one, same);
+
+        pLabel->release();
+    }
+
+    remove(fntPath.c_str());
+    remove(pngPath.c_str());
+    return 0;
+}
@@ -0,0 +1,122 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+
+/*
+ poolbench: times the creation and the destruction of the pooled classes, from their CCObjectPool and from
+ the global operator new and delete, which is what they use when CC_ENABLE_OBJECT_POOLS is 0.
+
+ usage: poolbench [objects]
+    objects  number of objects created and destroyed per test, 1000000 by default
+
+ Each class is tested with one object alive at a time, and with 1000 objects alive at once, like the strings
+ and the actions created during a frame and released by the autorelease pool at its end.
+ The objects are deleted directly rather than released, so that both ways do the same work besides the memory.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+USING_NS_CC;
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// constructs an object in ptr, or in memory from the pool of its class if ptr is NULL
+static CCString* newString(void *ptr) { return ptr ? new (ptr) CCString("poolbench") : new CCString("poolbench"); }
+static CCInteger* newInteger(void *ptr) { return ptr ? new (ptr) CCInteger(7) : new CCInteger(7); }
+static CCTouch* newTouch(void *ptr) { return ptr ? new (ptr) CCTouch() : new CCTouch(); }
+
+// nanoseconds per object created and destroyed, uAlive at a time
+template <class T>
+static double timeObjects(T* (*pfnNew)(void*), bool bPooled, unsigned int uObjects, unsigned int uAlive)
+{
+    std::vector<T*> objects(uAlive);
+    unsigned int uRounds = uObjects / uAlive;
+
+    double t = now();
+    for (unsigned int r = 0; r < uRounds; r++)
+    {
+        for (unsigned int i = 0; i < uAlive; i++)
+        {
+            objects[i] = pfnNew(bPooled ? NULL : ::operator new(sizeof(T)));
+        }
+        for (unsigned int i = 0; i < uAlive; i++)
+        {
+            if (bPooled)
+            {
+                delete objects[i];
+            }
+            else
+            {
+                objects[i]->~T();
+                ::operator delete(objects[i]);
+            }
+        }
+    }
+    return (now() - t) * 1e9 / (uRounds * uAlive);
+}
+
+template <class T>
+static void bench(const char *pszName, T* (*pfnNew)(void*), unsigned int uObjects)
+{
+    static const unsigned int s_uAlive[] = { 1, 1000 };
+
+    for (unsigned int i = 0; i < sizeof(s_uAlive) / sizeof(s_uAlive[0]); i++)
+    {
+        // once untimed, so that the pool has its slabs and malloc its free blocks
+        timeObjects(pfnNew, true, s_uAlive[i], s_uAlive[i]);
+        timeObjects(pfnNew, false, s_uAlive[i], s_uAlive[i]);
+
+        double pooled = timeObjects(pfnNew, true, uObjects, s_uAlive[i]);
+        double global = timeObjects(pfnNew, false, uObjects, s_uAlive[i]);
+        printf("%-10s %4u alive: pool %6.1f ns, operator new %6.1f ns per object\n", pszName, s_uAlive[i], pooled, global);
+    }
+}
+
+int main(int argc, char **argv)
+{
+#if CC_ENABLE_OBJECT_POOLS
+    unsigned int uObjects = argc > 1 ? (unsigned int)atoi(argv[1]) : 1000000;
+    if (uObjects < 1000)
+    {
+        uObjects = 1000;
+    }
+
+    bench("CCString", newString, uObjects);
+    bench("CCInteger", newInteger, uObjects);
+    bench("CCTouch", newTouch, uObjects);
+    return 0;
+#else
+    printf("the object pools are disabled, see CC_ENABLE_OBJECT_POOLS\n");
+    return 1;
+#endif
+}
@@ -0,0 +1,164 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ quadbench: compares CCAffineTransformApplyToQuads() with the one quad at a time code CCSprite::updateTransform()
+ used before, on the quads of 10k sprites, then times both.
+
+ usage: quadbench [sprites] [repeats]
+    sprites  number of quads, 10000 by default
+    repeats  number of times they are transformed, 1000 by default
+
+ The quads are transformed in the order of the atlas, then scattered in the atlas like the children of a batch node
+ that were reordered. The vertices must have the same bits. Exits with 1 if they don't.
+ */
+
+#include "cocoa/CCAffineTransform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+USING_NS_CC;
+
+static unsigned int s_uSeed = 1;
+
+// same inputs on every run
+static float randomFloat(float fMin, float fMax)
+{
+    s_uSeed = s_uSeed * 1103515245u + 12345u;
+    return fMin + ((s_uSeed >> 8) / (float)(1 << 24)) * (fMax - fMin);
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// the vertices as CCSprite::updateTransform() computed them one by one
+static void transformQuad(ccV3F_C4B_T2F_Quad *pQuad, const CCAffineTransform& transform, const CCRect& rect)
+{
+    float x1 = rect.origin.x;
+    float y1 = rect.origin.y;
+    float x2 = x1 + rect.size.width;
+    float y2 = y1 + rect.size.height;
+    float x = transform.tx;
+    float y = transform.ty;
+
+    float cr = transform.a;
+    float sr = transform.b;
+    float cr2 = transform.d;
+    float sr2 = -transform.c;
+    float ax = x1 * cr - y1 * sr2 + x;
+    float ay = x1 * sr + y1 * cr2 + y;
+
+    float bx = x2 * cr - y1 * sr2 + x;
+    float by = x2 * sr + y1 * cr2 + y;
+
+    float cx = x2 * cr - y2 * sr2 + x;
+    float cy = x2 * sr + y2 * cr2 + y;
+
+    float dx = x1 * cr - y2 * sr2 + x;
+    float dy = x1 * sr + y2 * cr2 + y;
+
+    pQuad->bl.vertices = vertex3(ax, ay, pQuad->bl.vertices.z);
+    pQuad->br.vertices = vertex3(bx, by, pQuad->br.vertices.z);
+    pQuad->tl.vertices = vertex3(dx, dy, pQuad->tl.vertices.z);
+    pQuad->tr.vertices = vertex3(cx, cy, pQuad->tr.vertices.z);
+}
+
+// returns whether or not both ways computed the same vertices
+static bool run(const char *pszName, const std::vector<unsigned int>& order, unsigned int uRepeats)
+{
+    unsigned int uCount = order.size();
+    std::vector<CCAffineTransform> transforms(uCount);
+    std::vector<CCRect> rects(uCount);
+    std::vector<ccV3F_C4B_T2F_Quad> batchQuads(uCount), singleQuads(uCount);
+    std::vector<ccV3F_C4B_T2F_Quad*> batchPointers(uCount), singlePointers(uCount);
+
+    for (unsigned int i = 0; i < uCount; i++)
+    {
+        float fAngle = randomFloat(0, 6.28f);
+        float fScaleX = randomFloat(0.5f, 2.0f);
+        float fScaleY = randomFloat(0.5f, 2.0f);
+        transforms[i] = CCAffineTransformMake(cosf(fAngle) * fScaleX, sinf(fAngle) * fScaleX,
+                                              -sinf(fAngle) * fScaleY, cosf(fAngle) * fScaleY,
+                                              randomFloat(0, 1024), randomFloat(0, 768));
+        rects[i] = CCRectMake(randomFloat(-8, 8), randomFloat(-8, 8), randomFloat(1, 128), randomFloat(1, 128));
+        batchPointers[i] = &batchQuads[order[i]];
+        singlePointers[i] = &singleQuads[order[i]];
+    }
+    memset(&batchQuads[0], 0, uCount * sizeof(ccV3F_C4B_T2F_Quad));
+    memset(&singleQuads[0], 0, uCount * sizeof(ccV3F_C4B_T2F_Quad));
+
+    double t = now();
+    for (unsigned int k = 0; k < uRepeats; k++)
+    {
+        CCAffineTransformApplyToQuads(&transforms[0], &rects[0], &batchPointers[0], uCount);
+    }
+    double batchTime = (now() - t) * 1e6 / uRepeats;
+
+    t = now();
+    for (unsigned int k = 0; k < uRepeats; k++)
+    {
+        for (unsigned int i = 0; i < uCount; i++)
+        {
+            transformQuad(singlePointers[i], transforms[i], rects[i]);
+        }
+        // the quads are read by the next frame, the stores can't be dropped
+        __asm__ __volatile__("" : : "r"(&singleQuads[0]) : "memory");
+    }
+    double singleTime = (now() - t) * 1e6 / uRepeats;
+
+    bool bSame = memcmp(&batchQuads[0], &singleQuads[0], uCount * sizeof(ccV3F_C4B_T2F_Quad)) == 0;
+    printf("%-10s %u quads: batch %8.1f us, one by one %8.1f us%s\n", pszName, uCount, batchTime, singleTime,
+           bSame ? "" : "  FAILED: the vertices differ");
+    return bSame;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uCount = argc > 1 ? (unsigned int)atoi(argv[1]) : 10000;
+    unsigned int uRepeats = argc > 2 ? (unsigned int)atoi(argv[2]) : 1000;
+    std::vector<unsigned int> order(uCount);
+
+    for (unsigned int i = 0; i < uCount; i++)
+    {
+        order[i] = i;
+    }
+    bool bSame = run("in order", order, uRepeats);
+
+    for (unsigned int i = uCount - 1; i > 0; i--)
+    {
+        std::swap(order[i], order[(unsigned int)randomFloat(0, (float)i + 0.999f)]);
+    }
+    bSame = run("scattered", order, uRepeats) && bSame;
+
+    return bSame ? 0 : 1;
+}
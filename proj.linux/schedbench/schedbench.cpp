@@ -0,0 +1,185 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+
+/*
+ schedbench: times CCScheduler::update() with 10k targets that have one custom selector each, against the loop
+ it replaced, which called CCTimer::update() on every timer of every target, every frame. That loop is copied
+ here, over entries allocated like the hash elements of the scheduler.
+
+ usage: schedbench [targets] [frames]
+    targets  number of targets, 10000 by default
+    frames   number of frames of 1/60 s, 600 by default
+
+ The intervals go from 0.1 s to 5 s. Both ways must call the selectors the same number of times, give or take
+ one call per target for the rounding of the elapsed time. Exits with 1 if they don't.
+ */
+
+#include "cocos2d.h"
+#include "support/data_support/ccCArray.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+USING_NS_CC;
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+class BenchTarget : public CCObject
+{
+public:
+    BenchTarget() : m_uCalls(0) {}
+
+    void tick(float dt)
+    {
+        ++m_uCalls;
+    }
+
+    unsigned int m_uCalls;
+};
+
+// the hash element of a target before the heap, in the list uthash iterated
+struct OldTimerEntry
+{
+    ccArray *timers;
+    CCObject *target;
+    unsigned int timerIndex;
+    CCTimer *currentTimer;
+    bool currentTimerSalvaged;
+    bool paused;
+    void *hh[7];
+    OldTimerEntry *next;
+};
+
+// CCScheduler::update() before the heap, without the salvage of the removed timers
+static void oldUpdate(OldTimerEntry *pEntries, float dt)
+{
+    for (OldTimerEntry *elt = pEntries; elt; elt = elt->next)
+    {
+        if (! elt->paused)
+        {
+            for (elt->timerIndex = 0; elt->timerIndex < elt->timers->num; ++(elt->timerIndex))
+            {
+                elt->currentTimer = (CCTimer*)(elt->timers->arr[elt->timerIndex]);
+                elt->currentTimerSalvaged = false;
+                elt->currentTimer->update(dt);
+                elt->currentTimer = NULL;
+            }
+        }
+    }
+}
+
+static float intervalForTarget(unsigned int i)
+{
+    return 0.1f * (1 + i % 50);
+}
+
+static unsigned int totalCalls(const std::vector<BenchTarget*>& targets)
+{
+    unsigned int uCalls = 0;
+    for (unsigned int i = 0; i < targets.size(); i++)
+    {
+        uCalls += targets[i]->m_uCalls;
+        targets[i]->m_uCalls = 0;
+    }
+    return uCalls;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uTargets = argc > 1 ? (unsigned int)atoi(argv[1]) : 10000;
+    unsigned int uFrames = argc > 2 ? (unsigned int)atoi(argv[2]) : 600;
+    const float dt = 1.0f / 60;
+    std::vector<BenchTarget*> targets(uTargets);
+    OldTimerEntry *pEntries = NULL, **ppLast = &pEntries;
+
+    for (unsigned int i = 0; i < uTargets; i++)
+    {
+        targets[i] = new BenchTarget();
+    }
+
+    // the heap of CCScheduler
+    CCScheduler *pScheduler = new CCScheduler();
+    for (unsigned int i = 0; i < uTargets; i++)
+    {
+        pScheduler->scheduleSelector(schedule_selector(BenchTarget::tick), targets[i], intervalForTarget(i), false);
+    }
+
+    double t = now();
+    for (unsigned int f = 0; f < uFrames; f++)
+    {
+        pScheduler->update(dt);
+    }
+    double heapTime = (now() - t) * 1e6 / uFrames;
+    unsigned int uHeapCalls = totalCalls(targets);
+
+    pScheduler->unscheduleAll();
+    pScheduler->release();
+
+    // every timer updated every frame, as the scheduler did before, allocated the same way
+    for (unsigned int i = 0; i < uTargets; i++)
+    {
+        OldTimerEntry *pEntry = (OldTimerEntry*)calloc(sizeof(*pEntry), 1);
+        pEntry->target = targets[i];
+        pEntry->timers = ccArrayNew(10);
+        CCTimer *pTimer = new CCTimer();
+        pTimer->initWithTarget(targets[i], schedule_selector(BenchTarget::tick), intervalForTarget(i), kCCRepeatForever, 0.0f);
+        ccArrayAppendObject(pEntry->timers, pTimer);
+        pTimer->release();
+        *ppLast = pEntry;
+        ppLast = &pEntry->next;
+    }
+
+    t = now();
+    for (unsigned int f = 0; f < uFrames; f++)
+    {
+        oldUpdate(pEntries, dt);
+    }
+    double loopTime = (now() - t) * 1e6 / uFrames;
+    unsigned int uLoopCalls = totalCalls(targets);
+
+    bool bSame = (uHeapCalls > uLoopCalls ? uHeapCalls - uLoopCalls : uLoopCalls - uHeapCalls) <= uTargets;
+    printf("%u targets, %u frames: heap %8.1f us per frame, %u calls; every timer %8.1f us per frame, %u calls%s\n",
+           uTargets, uFrames, heapTime, uHeapCalls, loopTime, uLoopCalls, bSame ? "" : "  FAILED: the calls differ");
+
+    while (pEntries)
+    {
+        OldTimerEntry *pNext = pEntries->next;
+        ccArrayFree(pEntries->timers);
+        free(pEntries);
+        pEntries = pNext;
+    }
+    for (unsigned int i = 0; i < uTargets; i++)
+    {
+        targets[i]->release();
+    }
+
+    return bSame ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+
+/*
+ shaderbench: times the loading of the default shaders by CCShaderCache without the program binaries,
+ as on the first launch, and with the binaries saved by that launch, as on the next ones.
+
+ usage: shaderbench [repeats]
+    repeats  number of loads of each kind, 10 by default
+
+ Both kinds are loaded once before they are timed, so that the driver's own compiler and caches are warm and
+ the difference is the work the binaries save. Without GL_OES_get_program_binary / GL_ARB_get_program_binary
+ both kinds compile from source. Needs a display, the window is opened by CCEGLView.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+USING_NS_CC;
+
+static const char *s_pszShaderKeys[] = {
+    kCCShader_PositionTextureColor,
+    kCCShader_PositionTextureColorAlphaTest,
+    kCCShader_PositionColor,
+    kCCShader_PositionTexture,
+    kCCShader_PositionTexture_uColor,
+    kCCShader_PositionTextureA8Color,
+    kCCShader_Position_uColor,
+    kCCShader_PositionLengthTexureColor,
+};
+
+static const unsigned int kShaderCount = sizeof(s_pszShaderKeys) / sizeof(s_pszShaderKeys[0]);
+
+// the path CCShaderCache saves the binary of a default shader to
+static std::string binaryPath(const char *pszKey)
+{
+    return CCFileUtils::sharedFileUtils()->getWritablePath() + "cc_" + pszKey + ".bin";
+}
+
+static void removeBinaries()
+{
+    for (unsigned int i = 0; i < kShaderCount; i++)
+    {
+        remove(binaryPath(s_pszShaderKeys[i]).c_str());
+    }
+}
+
+static unsigned int countBinaries()
+{
+    unsigned int uCount = 0;
+    for (unsigned int i = 0; i < kShaderCount; i++)
+    {
+        FILE *fp = fopen(binaryPath(s_pszShaderKeys[i]).c_str(), "rb");
+        if (fp)
+        {
+            uCount++;
+            fclose(fp);
+        }
+    }
+    return uCount;
+}
+
+// milliseconds spent by the shader cache to load the default shaders, until GL is done with them
+static double loadDefaultShaders()
+{
+    struct cc_timeval start, end;
+
+    CCTime::gettimeofdayCocos2d(&start, NULL);
+    CCShaderCache::sharedShaderCache();
+    glFinish();
+    CCTime::gettimeofdayCocos2d(&end, NULL);
+
+    CCShaderCache::purgeSharedShaderCache();
+    // the names of the deleted programs can be given again, the state cache must not skip glUseProgram()
+    ccGLInvalidateStateCache();
+    return CCTime::timersubCocos2d(&start, &end);
+}
+
+static double averageLoad(unsigned int uRepeats, bool bBinaries)
+{
+    double total = 0;
+    for (unsigned int i = 0; i < uRepeats; i++)
+    {
+        if (! bBinaries)
+        {
+            removeBinaries();
+        }
+        total += loadDefaultShaders();
+    }
+    return total / uRepeats;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uRepeats = argc > 1 ? (unsigned int)atoi(argv[1]) : 10;
+    if (uRepeats == 0)
+    {
+        uRepeats = 1;
+    }
+
+    CCEGLView *pView = CCEGLView::sharedOpenGLView();
+    pView->setFrameSize(64, 64);
+    CCConfiguration::sharedConfiguration()->gatherGPUInfo();
+    printf("program binaries %s\n", CCConfiguration::sharedConfiguration()->supportsProgramBinary() ? "supported" : "not supported");
+
+    averageLoad(1, false);
+    double withoutBinaries = averageLoad(uRepeats, false);
+
+    // the last load without the binaries saved them
+    unsigned int uBinaries = countBinaries();
+    if (uBinaries == 0 && CCConfiguration::sharedConfiguration()->supportsProgramBinary())
+    {
+        printf("the binaries couldn't be saved in %s, check that the directory can be created\n",
+               CCFileUtils::sharedFileUtils()->getWritablePath().c_str());
+    }
+    averageLoad(1, true);
+    double withBinaries = averageLoad(uRepeats, true);
+
+    printf("%u default shaders: without the binaries %8.2f ms, with %u binaries %8.2f ms\n",
+           kShaderCount, withoutBinaries, uBinaries, withBinaries);
+
+    removeBinaries();
+    return 0;
+}
@@ -0,0 +1,181 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ streambench: times the vertex uploads of a quad buffer that is rewritten every frame, like the one of
+ CCParticleSystemQuad, when only some of its quads are drawn.
+
+ usage: streambench [capacity] [frames]
+    capacity  number of quads of the buffer, 10000 by default
+    frames    number of frames of each test, 300 by default
+
+ Every frame moves the live quads, uploads them and draws them. The uploads are:
+    whole buffer   glBufferSubData() of the whole buffer, what CCParticleSystemQuad did before
+    live, in place glBufferSubData() of the live quads, ccGLStreamBufferData() with CC_USE_VBO_ORPHANING 0
+    live, orphaned ccGLStreamBufferData() as built, glBufferData() with NULL then the live quads
+ The live quads are 1%, 10% and 100% of the buffer. Each frame ends with glFlush(), the last one with glFinish().
+ Needs a display, the window is opened by CCEGLView.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+USING_NS_CC;
+
+#define kVertexSize     sizeof(ccV3F_C4B_T2F)
+
+enum
+{
+    kUploadWholeBuffer,
+    kUploadLiveInPlace,
+    kUploadLiveOrphaned
+};
+
+static const char *s_pszUploadNames[] = { "whole buffer", "live, in place", "live, orphaned" };
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void moveQuads(ccV3F_C4B_T2F_Quad *pQuads, unsigned int uCount, unsigned int uFrame)
+{
+    for (unsigned int i = 0; i < uCount; i++)
+    {
+        float x = (float)((i * 37 + uFrame * 3) % 960);
+        float y = (float)((i * 91 + uFrame * 5) % 640);
+        ccV3F_C4B_T2F_Quad& quad = pQuads[i];
+        quad.bl.vertices = vertex3(x, y, 0);
+        quad.br.vertices = vertex3(x + 8, y, 0);
+        quad.tl.vertices = vertex3(x, y + 8, 0);
+        quad.tr.vertices = vertex3(x + 8, y + 8, 0);
+    }
+}
+
+// microseconds per frame
+static double runFrames(int nUpload, GLuint buffer, std::vector<ccV3F_C4B_T2F_Quad>& quads, unsigned int uLive, unsigned int uFrames)
+{
+    GLsizeiptr capacity = quads.size() * sizeof(ccV3F_C4B_T2F_Quad);
+    GLsizeiptr live = uLive * sizeof(ccV3F_C4B_T2F_Quad);
+
+    double t = now();
+    for (unsigned int f = 0; f < uFrames; f++)
+    {
+        moveQuads(&quads[0], uLive, f);
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        if (nUpload == kUploadWholeBuffer)
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, capacity, &quads[0]);
+        }
+        else if (nUpload == kUploadLiveInPlace)
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, live, &quads[0]);
+        }
+        else
+        {
+            ccGLStreamBufferData(GL_ARRAY_BUFFER, capacity, live, &quads[0], GL_DYNAMIC_DRAW);
+        }
+
+        glVertexAttribPointer(kCCVertexAttrib_Position, 3, GL_FLOAT, GL_FALSE, kVertexSize, (GLvoid*)offsetof(ccV3F_C4B_T2F, vertices));
+        glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, kVertexSize, (GLvoid*)offsetof(ccV3F_C4B_T2F, colors));
+        glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, kVertexSize, (GLvoid*)offsetof(ccV3F_C4B_T2F, texCoords));
+        glDrawElements(GL_TRIANGLES, (GLsizei)uLive * 6, GL_UNSIGNED_SHORT, 0);
+        glFlush();
+    }
+    glFinish();
+    return (now() - t) * 1e6 / uFrames;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uCapacity = argc > 1 ? (unsigned int)atoi(argv[1]) : 10000;
+    unsigned int uFrames = argc > 2 ? (unsigned int)atoi(argv[2]) : 300;
+    // the indices are GLushort
+    if (uCapacity == 0 || uCapacity > 16384 || uFrames == 0)
+    {
+        printf("usage: streambench [capacity (at most 16384)] [frames]\n");
+        return 1;
+    }
+
+    CCEGLView *pView = CCEGLView::sharedOpenGLView();
+    pView->setFrameSize(960, 640);
+    CCDirector::sharedDirector()->setOpenGLView(pView);
+    CCConfiguration::sharedConfiguration()->gatherGPUInfo();
+
+    CCGLProgram *pProgram = CCShaderCache::sharedShaderCache()->programForKey(kCCShader_PositionTextureColor);
+    pProgram->use();
+    pProgram->setUniformsForBuiltins();
+    ccGLEnableVertexAttribs(kCCVertexAttribFlag_PosColorTex);
+    ccGLBindTexture2D(0);
+
+    std::vector<ccV3F_C4B_T2F_Quad> quads(uCapacity);
+    memset(&quads[0], 0xff, uCapacity * sizeof(ccV3F_C4B_T2F_Quad));
+    std::vector<GLushort> indices(uCapacity * 6);
+    for (unsigned int i = 0; i < uCapacity; i++)
+    {
+        indices[i * 6 + 0] = (GLushort)(i * 4 + 0);
+        indices[i * 6 + 1] = (GLushort)(i * 4 + 1);
+        indices[i * 6 + 2] = (GLushort)(i * 4 + 2);
+        indices[i * 6 + 3] = (GLushort)(i * 4 + 3);
+        indices[i * 6 + 4] = (GLushort)(i * 4 + 2);
+        indices[i * 6 + 5] = (GLushort)(i * 4 + 1);
+    }
+
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, uCapacity * sizeof(ccV3F_C4B_T2F_Quad), &quads[0], GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+    static const unsigned int s_uLivePercents[] = { 1, 10, 100 };
+    for (unsigned int p = 0; p < sizeof(s_uLivePercents) / sizeof(s_uLivePercents[0]); p++)
+    {
+        unsigned int uLive = MAX(uCapacity * s_uLivePercents[p] / 100, 1u);
+        printf("%5u of %u quads:", uLive, uCapacity);
+        for (int nUpload = kUploadWholeBuffer; nUpload <= kUploadLiveOrphaned; nUpload++)
+        {
+            printf("  %s %7.1f us", s_pszUploadNames[nUpload], runFrames(nUpload, buffers[0], quads, uLive, uFrames));
+        }
+        printf("\n");
+    }
+
+    GLenum error = glGetError();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glDeleteBuffers(2, buffers);
+    if (error != GL_NO_ERROR)
+    {
+        printf("FAILED: GL error 0x%04x\n", error);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+
+/*
+ tagbench: times CCNode::getChildByTag() against the number of children, with and without the tag index
+ (setChildTagIndexEnabled()).
+
+ usage: tagbench [lookups]
+    lookups  number of lookups per test, 1000000 by default
+
+ The tags are looked up in a random order, half of them are not among the children. Both ways must find the
+ same children. Exits with 1 if they don't.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+USING_NS_CC;
+
+static unsigned int s_uSeed = 1;
+
+// same tags on every run
+static int randomTag(int nMax)
+{
+    s_uSeed = s_uSeed * 1103515245u + 12345u;
+    return (int)((s_uSeed >> 8) % (unsigned int)nMax);
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// nanoseconds per lookup, pFound counts the children found
+static double timeLookups(CCNode *pParent, const std::vector<int>& tags, unsigned int *pFound)
+{
+    unsigned int uFound = 0;
+    double t = now();
+    for (unsigned int i = 0; i < tags.size(); i++)
+    {
+        uFound += pParent->getChildByTag(tags[i]) != NULL;
+    }
+    double ns = (now() - t) * 1e9 / tags.size();
+    *pFound = uFound;
+    return ns;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uLookups = argc > 1 ? (unsigned int)atoi(argv[1]) : 1000000;
+    static const unsigned int s_uChildren[] = { 4, 16, 64, 256, 1024, 4096 };
+    bool bSame = true;
+
+    for (unsigned int c = 0; c < sizeof(s_uChildren) / sizeof(s_uChildren[0]); c++)
+    {
+        unsigned int uChildren = s_uChildren[c];
+        CCNode *pParent = CCNode::create();
+        pParent->retain();
+        for (unsigned int i = 0; i < uChildren; i++)
+        {
+            // the even tags only, the odd ones are missed
+            pParent->addChild(CCNode::create(), 0, (int)(2 * i));
+        }
+        // the autoreleased children are owned by their parent only
+        CCPoolManager::sharedPoolManager()->pop();
+
+        std::vector<int> tags(uLookups);
+        for (unsigned int i = 0; i < uLookups; i++)
+        {
+            tags[i] = randomTag(2 * uChildren);
+        }
+
+        unsigned int uFound, uIndexFound;
+        pParent->setChildTagIndexEnabled(false);
+        double scan = timeLookups(pParent, tags, &uFound);
+        pParent->setChildTagIndexEnabled(true);
+        double index = timeLookups(pParent, tags, &uIndexFound);
+
+        printf("%5u children: scan %7.1f ns, index %7.1f ns per lookup%s\n", uChildren, scan, index,
+               uFound == uIndexFound ? "" : "  FAILED: the children found differ");
+        bSame = bSame && uFound == uIndexFound;
+
+        pParent->release();
+    }
+
+    return bSame ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ tmxbench: builds a large orthogonal TMX layer at once and in chunks, and compares the build time, the quads in
+ the texture atlas, the growth of the process, the first draw and the setTileGID() edits.
+
+ usage: tmxbench [size] [chunk size]
+    size        width and height of the layer in tiles, 1024 by default
+    chunk size  tiles per side of the chunks, 32 by default
+
+ One tile in 16 is empty. The maps (base64, not compressed) and the 8 x 8 tiles tileset are written in the
+ writable path and removed at the end. The chunked layer is built first, so the memory freed by the other one
+ doesn't hide its growth. Needs a display, the window is opened by CCEGLView.
+ */
+
+#include "cocos2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+
+USING_NS_CC;
+
+#define kTileSize       32
+#define kTilesetTiles   8
+#define kEdits          10000
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// resident size of the process in bytes
+static long residentBytes()
+{
+    long pages = 0, resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp)
+    {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static unsigned int gidAt(unsigned int x, unsigned int y)
+{
+    return ((x + y) % 16 == 0) ? 0 : 1 + (x * 7 + y * 13) % (kTilesetTiles * kTilesetTiles);
+}
+
+static std::string base64(const unsigned char *pData, unsigned int uLength)
+{
+    static const char s_szAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string str;
+    str.reserve((uLength + 2) / 3 * 4);
+    for (unsigned int i = 0; i < uLength; i += 3)
+    {
+        unsigned int n = pData[i] << 16;
+        n |= (i + 1 < uLength) ? pData[i + 1] << 8 : 0;
+        n |= (i + 2 < uLength) ? pData[i + 2] : 0;
+        str += s_szAlphabet[(n >> 18) & 63];
+        str += s_szAlphabet[(n >> 12) & 63];
+        str += (i + 1 < uLength) ? s_szAlphabet[(n >> 6) & 63] : '=';
+        str += (i + 2 < uLength) ? s_szAlphabet[n & 63] : '=';
+    }
+    return str;
+}
+
+// a map of uSize x uSize tiles, built in chunks when uChunkSize isn't 0
+static bool writeMap(const std::string& tmxPath, const std::string& pngName, unsigned int uSize, unsigned int uChunkSize)
+{
+    unsigned int uCount = uSize * uSize;
+    unsigned char *pTiles = new unsigned char[uCount * 4];
+    for (unsigned int i = 0; i < uCount; i++)
+    {
+        // the gids are little endian
+        unsigned int gid = gidAt(i % uSize, i / uSize);
+        pTiles[i * 4] = gid & 0xff;
+        pTiles[i * 4 + 1] = (gid >> 8) & 0xff;
+        pTiles[i * 4 + 2] = (gid >> 16) & 0xff;
+        pTiles[i * 4 + 3] = (gid >> 24) & 0xff;
+    }
+    std::string data = base64(pTiles, uCount * 4);
+    delete [] pTiles;
+
+    FILE *fp = fopen(tmxPath.c_str(), "w");
+    if (! fp)
+    {
+        return false;
+    }
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(fp, "<map version=\"1.0\" orientation=\"orthogonal\" width=\"%u\" height=\"%u\" tilewidth=\"%d\" tileheight=\"%d\">\n",
+            uSize, uSize, kTileSize, kTileSize);
+    fprintf(fp, " <tileset firstgid=\"1\" name=\"tmxbench\" tilewidth=\"%d\" tileheight=\"%d\">\n", kTileSize, kTileSize);
+    fprintf(fp, "  <image source=\"%s\" width=\"%d\" height=\"%d\"/>\n", pngName.c_str(), kTileSize * kTilesetTiles, kTileSize * kTilesetTiles);
+    fprintf(fp, " </tileset>\n");
+    fprintf(fp, " <layer name=\"ground\" width=\"%u\" height=\"%u\">\n", uSize, uSize);
+    if (uChunkSize)
+    {
+        fprintf(fp, "  <properties>\n   <property name=\"cc_chunk_size\" value=\"%u\"/>\n  </properties>\n", uChunkSize);
+    }
+    fprintf(fp, "  <data encoding=\"base64\">\n   %s\n  </data>\n", data.c_str());
+    fprintf(fp, " </layer>\n</map>\n");
+    fclose(fp);
+    return true;
+}
+
+static bool writeTileset(const std::string& pngPath)
+{
+    unsigned int uSide = kTileSize * kTilesetTiles;
+    unsigned char *pPixels = new unsigned char[uSide * uSide * 4];
+    memset(pPixels, 0xff, uSide * uSide * 4);
+    CCImage *pImage = new CCImage();
+    bool bRet = pImage->initWithImageData(pPixels, uSide * uSide * 4, CCImage::kFmtRawData, uSide, uSide, 8)
+        && pImage->saveToFile(pngPath.c_str(), false);
+    pImage->release();
+    delete [] pPixels;
+    return bRet;
+}
+
+static bool benchMap(const char *pszName, const std::string& tmxPath, unsigned int uSize)
+{
+    long resident = residentBytes();
+    double t = now();
+    CCTMXTiledMap *pMap = CCTMXTiledMap::create(tmxPath.c_str());
+    double build = now() - t;
+    if (! pMap)
+    {
+        printf("FAILED: %s: can't load %s\n", pszName, tmxPath.c_str());
+        return false;
+    }
+    pMap->retain();
+    CCTMXLayer *pLayer = pMap->layerNamed("ground");
+
+    // the chunked layer builds the chunks around the screen when it is drawn
+    t = now();
+    pMap->visit();
+    double draw = now() - t;
+    long grown = residentBytes() - resident;
+
+    CCTextureAtlas *pAtlas = pLayer->getTextureAtlas();
+    unsigned int uQuads = pAtlas->getCapacity();
+    unsigned int uAtlasBytes = uQuads * (sizeof(ccV3F_C4B_T2F_Quad) + 6 * sizeof(GLushort));
+
+    // the edits inside and outside the built chunks, each one rewrites at most one quad
+    srand(1);
+    t = now();
+    for (unsigned int i = 0; i < kEdits; i++)
+    {
+        unsigned int x = rand() % uSize;
+        unsigned int y = rand() % uSize;
+        pLayer->setTileGID(1 + gidAt(y, x) % (kTilesetTiles * kTilesetTiles), ccp(x, y));
+    }
+    double edits = now() - t;
+
+    printf("%-8s %ux%u: build %8.1f ms, first draw %7.1f ms, %8u quads (%6.1f MB), process grew %7.1f MB, setTileGID %6.2f us\n",
+           pszName, uSize, uSize, build * 1e3, draw * 1e3, uQuads, uAtlasBytes / 1048576.0, grown / 1048576.0,
+           edits * 1e6 / kEdits);
+
+    bool bRet = pLayer->isChunked() == (strcmp(pszName, "chunked") == 0);
+    if (! bRet)
+    {
+        printf("FAILED: %s: the layer %s built in chunks\n", pszName, pLayer->isChunked() ? "is" : "isn't");
+    }
+    pMap->release();
+    CCPoolManager::sharedPoolManager()->pop();
+    return bRet;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uSize = argc > 1 ? (unsigned int)atoi(argv[1]) : 1024;
+    unsigned int uChunkSize = argc > 2 ? (unsigned int)atoi(argv[2]) : 32;
+    if (uSize == 0 || uChunkSize == 0)
+    {
+        printf("usage: tmxbench [size] [chunk size]\n");
+        return 1;
+    }
+
+    CCEGLView *pView = CCEGLView::sharedOpenGLView();
+    pView->setFrameSize(960, 640);
+    CCDirector::sharedDirector()->setOpenGLView(pView);
+    CCConfiguration::sharedConfiguration()->gatherGPUInfo();
+
+    std::string path = CCFileUtils::sharedFileUtils()->getWritablePath();
+    std::string pngPath = path + "tmxbench.png";
+    std::string chunkedPath = path + "tmxbench_chunked.tmx";
+    std::string wholePath = path + "tmxbench_whole.tmx";
+    if (! writeTileset(pngPath)
+        || ! writeMap(chunkedPath, "tmxbench.png", uSize, uChunkSize)
+        || ! writeMap(wholePath, "tmxbench.png", uSize, 0))
+    {
+        printf("FAILED: can't write the maps in %s\n", path.c_str());
+        return 1;
+    }
+    // the tileset is loaded once, outside of the measures
+    CCTextureCache::sharedTextureCache()->addImage(pngPath.c_str());
+
+    bool bRet = benchMap("chunked", chunkedPath, uSize) && benchMap("whole", wholePath, uSize);
+
+    remove(chunkedPath.c_str());
+    remove(wholePath.c_str());
+    remove(pngPath.c_str());
+    return bRet ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+/****************************************************************************
+Copyright (c) 2013 cocos2d-x.org
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ zipbench: reads the entries of a zip archive from several threads at the same time, with ZipFile::getFileData(),
+ ZipFile::getFileDataView() and minizip serialized by one lock, and checks the contents.
+
+ usage: zipbench [threads] [rounds]
+    threads  number of reading threads, 8 by default
+    rounds   number of times each thread reads every entry, 5 by default
+
+ The archive, 200 entries of 4 KB to 256 KB, one in two stored and the others deflated, is written in the
+ writable path and removed at the end. Every mode runs with one thread, then with all the threads.
+ */
+
+#include "cocos2d.h"
+#include "support/zip_support/ZipUtils.h"
+#include "support/zip_support/unzip.h"
+#include "platform/CCFileData.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+
+USING_NS_CC;
+
+#define kEntries        200
+#define kMinEntrySize   4096
+#define kMaxEntrySize   (256 * 1024)
+
+enum
+{
+    kModeFileData,
+    kModeFileDataView,
+    kModeMinizip
+};
+
+static const char *s_pszModeNames[] = { "getFileData", "getFileDataView", "minizip + lock" };
+
+struct Entry
+{
+    std::string     name;
+    unsigned long   size;
+    unsigned long   crc;
+};
+
+struct Bench
+{
+    int                 mode;
+    unsigned int        rounds;
+    std::vector<Entry>  entries;
+    ZipFile             *pZipFile;
+    unzFile             pMinizip;
+    pthread_mutex_t     minizipLock;
+};
+
+struct Reader
+{
+    Bench           *pBench;
+    unsigned int    index;
+    unsigned int    errors;
+    pthread_t       thread;
+};
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void put16(std::string& out, unsigned int v)
+{
+    out += (char)(v & 0xff);
+    out += (char)((v >> 8) & 0xff);
+}
+
+static void put32(std::string& out, unsigned long v)
+{
+    put16(out, v & 0xffff);
+    put16(out, (v >> 16) & 0xffff);
+}
+
+// compressible bytes: runs of a few letters
+static void makeContents(unsigned char *pData, unsigned long uSize, unsigned int uSeed)
+{
+    unsigned int n = uSeed * 2654435761u + 1;
+    for (unsigned long i = 0; i < uSize; )
+    {
+        n = n * 1103515245 + 12345;
+        unsigned long run = 1 + ((n >> 16) & 7);
+        for (unsigned long j = 0; j < run && i < uSize; j++)
+        {
+            pData[i++] = (unsigned char)('a' + ((n >> 24) % 12));
+        }
+    }
+}
+
+static bool writeArchive(const std::string& path, std::vector<Entry>& entries)
+{
+    std::string archive, directory;
+    srand(1);
+    for (unsigned int i = 0; i < kEntries; i++)
+    {
+        Entry entry;
+        char name[32];
+        sprintf(name, "assets/file%03u.bin", i);
+        entry.name = name;
+        entry.size = kMinEntrySize + rand() % (kMaxEntrySize - kMinEntrySize);
+
+        std::vector<unsigned char> contents(entry.size);
+        makeContents(&contents[0], entry.size, i);
+        entry.crc = crc32(0, &contents[0], entry.size);
+
+        bool bDeflated = (i & 1) != 0;
+        std::vector<unsigned char> data;
+        if (bDeflated)
+        {
+            z_stream stream;
+            memset(&stream, 0, sizeof(stream));
+            if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+                return false;
+            }
+            data.resize(deflateBound(&stream, entry.size));
+            stream.next_in = &contents[0];
+            stream.avail_in = entry.size;
+            stream.next_out = &data[0];
+            stream.avail_out = data.size();
+            int err = deflate(&stream, Z_FINISH);
+            data.resize(stream.total_out);
+            deflateEnd(&stream);
+            if (err != Z_STREAM_END)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            data = contents;
+        }
+
+        unsigned long offset = archive.size();
+        put32(archive, 0x04034b50);
+        put16(archive, 20);
+        put16(archive, 0);
+        put16(archive, bDeflated ? 8 : 0);
+        put32(archive, 0);
+        put32(archive, entry.crc);
+        put32(archive, data.size());
+        put32(archive, entry.size);
+        put16(archive, entry.name.size());
+        put16(archive, 0);
+        archive += entry.name;
+        archive.append((const char*)&data[0], data.size());
+
+        put32(directory, 0x02014b50);
+        put16(directory, 20);
+        put16(directory, 20);
+        put16(directory, 0);
+        put16(directory, bDeflated ? 8 : 0);
+        put32(directory, 0);
+        put32(directory, entry.crc);
+        put32(directory, data.size());
+        put32(directory, entry.size);
+        put16(directory, entry.name.size());
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, 0);
+        put32(directory, 0);
+        put32(directory, offset);
+        directory += entry.name;
+
+        entries.push_back(entry);
+    }
+
+    unsigned long directoryOffset = archive.size();
+    archive += directory;
+    put32(archive, 0x06054b50);
+    put16(archive, 0);
+    put16(archive, 0);
+    put16(archive, kEntries);
+    put16(archive, kEntries);
+    put32(archive, directory.size());
+    put32(archive, directoryOffset);
+    put16(archive, 0);
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (! fp)
+    {
+        return false;
+    }
+    bool bRet = fwrite(archive.data(), 1, archive.size(), fp) == archive.size();
+    fclose(fp);
+    return bRet;
+}
+
+static unsigned char *readMinizip(Bench *pBench, const std::string& name, unsigned long *pSize)
+{
+    unsigned char *pBuffer = NULL;
+    *pSize = 0;
+    pthread_mutex_lock(&pBench->minizipLock);
+    unz_file_info info;
+    if (unzLocateFile(pBench->pMinizip, name.c_str(), 1) == UNZ_OK
+        && unzGetCurrentFileInfo(pBench->pMinizip, &info, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK
+        && unzOpenCurrentFile(pBench->pMinizip) == UNZ_OK)
+    {
+        pBuffer = new unsigned char[info.uncompressed_size];
+        int nRead = unzReadCurrentFile(pBench->pMinizip, pBuffer, info.uncompressed_size);
+        unzCloseCurrentFile(pBench->pMinizip);
+        *pSize = nRead > 0 ? (unsigned long)nRead : 0;
+    }
+    pthread_mutex_unlock(&pBench->minizipLock);
+    return pBuffer;
+}
+
+static void *readEntries(void *pArg)
+{
+    Reader *pReader = (Reader*)pArg;
+    Bench *pBench = pReader->pBench;
+    unsigned int uCount = pBench->entries.size();
+    for (unsigned int r = 0; r < pBench->rounds; r++)
+    {
+        for (unsigned int i = 0; i < uCount; i++)
+        {
+            // the threads start at different entries
+            const Entry& entry = pBench->entries[(i + pReader->index * 37) % uCount];
+            unsigned long uSize = 0;
+            unsigned long crc = 0;
+            if (pBench->mode == kModeFileDataView)
+            {
+                CCFileData *pData = pBench->pZipFile->getFileDataView(entry.name);
+                if (pData)
+                {
+                    uSize = pData->getSize();
+                    crc = crc32(0, pData->getBytes(), uSize);
+                    pData->release();
+                }
+            }
+            else
+            {
+                unsigned char *pBuffer = (pBench->mode == kModeFileData) ? pBench->pZipFile->getFileData(entry.name, &uSize)
+                                                                         : readMinizip(pBench, entry.name, &uSize);
+                if (pBuffer)
+                {
+                    crc = crc32(0, pBuffer, uSize);
+                    delete [] pBuffer;
+                }
+            }
+            if (uSize != entry.size || crc != entry.crc)
+            {
+                pReader->errors++;
+            }
+        }
+    }
+    return NULL;
+}
+
+// returns the number of errors
+static unsigned int runBench(Bench *pBench, unsigned int uThreads)
+{
+    std::vector<Reader> readers(uThreads);
+    double t = now();
+    for (unsigned int i = 0; i < uThreads; i++)
+    {
+        readers[i].pBench = pBench;
+        readers[i].index = i;
+        readers[i].errors = 0;
+        pthread_create(&readers[i].thread, NULL, readEntries, &readers[i]);
+    }
+    unsigned int uErrors = 0;
+    for (unsigned int i = 0; i < uThreads; i++)
+    {
+        pthread_join(readers[i].thread, NULL);
+        uErrors += readers[i].errors;
+    }
+    t = now() - t;
+
+    double bytes = 0;
+    for (unsigned int i = 0; i < pBench->entries.size(); i++)
+    {
+        bytes += pBench->entries[i].size;
+    }
+    bytes *= (double)pBench->rounds * uThreads;
+    printf("%-16s %2u threads: %8.1f ms, %8.1f MB/s, %u errors\n",
+           s_pszModeNames[pBench->mode], uThreads, t * 1e3, bytes / 1048576.0 / t, uErrors);
+    return uErrors;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int uThreads = argc > 1 ? (unsigned int)atoi(argv[1]) : 8;
+    unsigned int uRounds = argc > 2 ? (unsigned int)atoi(argv[2]) : 5;
+    if (uThreads == 0 || uRounds == 0)
+    {
+        printf("usage: zipbench [threads] [rounds]\n");
+        return 1;
+    }
+
+    Bench bench;
+    bench.rounds = uRounds;
+    std::string path = CCFileUtils::sharedFileUtils()->getWritablePath() + "zipbench.zip";
+    if (! writeArchive(path, bench.entries))
+    {
+        printf("FAILED: can't write %s\n", path.c_str());
+        return 1;
+    }
+
+    bench.pZipFile = new ZipFile(path);
+    bench.pMinizip = unzOpen(path.c_str());
+    pthread_mutex_init(&bench.minizipLock, NULL);
+    if (! bench.pMinizip || ! bench.pZipFile->fileExists(bench.entries[0].name))
+    {
+        printf("FAILED: can't open %s\n", path.c_str());
+        return 1;
+    }
+
+    unsigned int uErrors = 0;
+    for (int mode = kModeFileData; mode <= kModeMinizip; mode++)
+    {
+        bench.mode = mode;
+        uErrors += runBench(&bench, 1);
+        if (uThreads > 1)
+        {
+            uErrors += runBench(&bench, uThreads);
+        }
+    }
+
+    pthread_mutex_destroy(&bench.minizipLock);
+    unzClose(bench.pMinizip);
+    delete bench.pZipFile;
+    remove(path.c_str());
+
+    if (uErrors)
+    {
+        printf("FAILED: %u entries didn't match\n", uErrors);
+        return 1;
+    }
+    return 0;
+}
@@ -26,11 +26,12 @@ THE SOFTWARE.
 ****************************************************************************/
 
 #include "CCDirector.h"
+#include "CCConfiguration.h"
+#include "CCRenderer.h"
 #include "CCGLProgram.h"
 #include "ccGLStateCache.h"
 #include "ccMacros.h"
 #include "platform/CCFileUtils.h"
-#include "support/data_support/uthash.h"
 #include "cocoa/CCString.h"
 // extern
 #include "kazmath/GL/matrix.h"
@@ -38,19 +39,48 @@ THE SOFTWARE.
 
 NS_CC_BEGIN
 
-typedef struct _hashUniformEntry
+// the uniforms at a higher location aren't cached: the locations given by the driver aren't small indices
+#define kCCUniformCacheMaxLocation  1023
+
+typedef struct _uniformCacheEntry
 {
-    GLvoid*         value;       // value
-    unsigned int    location;    // Key
-    UT_hash_handle  hh;          // hash entry
-} tHashUniformEntry;
+    unsigned int    bytes;          // size of the value, 0 until the uniform is set
+    GLfloat         value[16];      // a mat4 at most, the bigger values are in bigValue
+    GLvoid*         bigValue;
+} tUniformCacheEntry;
+
+// the built-in uniforms declared before every shader
+#define CC_SHADER_UNIFORMS \
+    "uniform mat4 CC_PMatrix;\n" \
+    "uniform mat4 CC_MVMatrix;\n" \
+    "uniform mat4 CC_MVPMatrix;\n" \
+    "uniform vec4 CC_Time;\n" \
+    "uniform vec4 CC_SinTime;\n" \
+    "uniform vec4 CC_CosTime;\n" \
+    "uniform vec4 CC_Random01;\n" \
+    "//CC INCLUDES END\n\n"
+
+#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32 && CC_TARGET_PLATFORM != CC_PLATFORM_LINUX && CC_TARGET_PLATFORM != CC_PLATFORM_MAC)
+static const GLchar *s_pszVertexShaderPrologue = "precision highp float;\n" CC_SHADER_UNIFORMS;
+static const GLchar *s_pszFragmentShaderPrologue = "precision mediump float;\n" CC_SHADER_UNIFORMS;
+#else
+static const GLchar *s_pszVertexShaderPrologue = CC_SHADER_UNIFORMS;
+static const GLchar *s_pszFragmentShaderPrologue = CC_SHADER_UNIFORMS;
+#endif
 
 CCGLProgram::CCGLProgram()
 : m_uProgram(0)
 , m_uVertShader(0)
 , m_uFragShader(0)
-, m_pHashForUniforms(NULL)
+, m_pUniformCache(NULL)
+, m_uUniformCacheSize(0)
+, m_uMatrixUniforms(0)
 , m_bUsesTime(false)
+, m_bUsesOnlyBuiltinUniforms(false)
+, m_bMatricesSet(false)
+, m_bModelViewFromStack(false)
+, m_uProjectionVersion(0)
+, m_uModelViewVersion(0)
 {
     memset(m_uUniforms, 0, sizeof(m_uUniforms));
 }
@@ -68,15 +98,7 @@ CCGLProgram::~CCGLProgram()
         ccGLDeleteProgram(m_uProgram);
     }
 
-    tHashUniformEntry *current_element, *tmp;
-
-    // Purge uniform hash
-    HASH_ITER(hh, m_pHashForUniforms, current_element, tmp)
-    {
-        HASH_DEL(m_pHashForUniforms, current_element);
-        free(current_element->value);
-        free(current_element);
-    }
+    purgeUniformCache();
 }
 
 bool CCGLProgram::initWithVertexShaderByteArray(const GLchar* vShaderByteArray, const GLchar* fShaderByteArray)
@@ -113,8 +135,6 @@ bool CCGLProgram::initWithVertexShaderByteArray(const GLchar* vShaderByteArray,
     {
         glAttachShader(m_uProgram, m_uFragShader);
     }
-    m_pHashForUniforms = NULL;
-    
     CHECK_GL_ERROR_DEBUG();
 
     return true;
@@ -128,6 +148,66 @@ bool CCGLProgram::initWithVertexShaderFilename(const char* vShaderFilename, cons
     return initWithVertexShaderByteArray(vertexSource, fragmentSource);
 }
 
+bool CCGLProgram::initWithProgramBinary(GLenum binaryFormat, const GLvoid* binary, GLsizei length)
+{
+#if CC_GL_PROGRAM_BINARY
+    if (! CCConfiguration::sharedConfiguration()->supportsProgramBinary())
+    {
+        return false;
+    }
+
+    m_uProgram = glCreateProgram();
+    m_uVertShader = m_uFragShader = 0;
+    glProgramBinary(m_uProgram, binaryFormat, binary, length);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_uProgram, GL_LINK_STATUS, &status);
+    if (status == GL_TRUE)
+    {
+        clearUniformCache();
+        m_bMatricesSet = false;
+        return true;
+    }
+
+    // an unknown format is an error, it's expected here
+    glGetError();
+    ccGLDeleteProgram(m_uProgram);
+    m_uProgram = 0;
+#else
+    CC_UNUSED_PARAM(binaryFormat);
+    CC_UNUSED_PARAM(binary);
+    CC_UNUSED_PARAM(length);
+#endif
+    return false;
+}
+
+unsigned char* CCGLProgram::getProgramBinary(GLenum *pBinaryFormat, unsigned long *pLength)
+{
+    CCAssert(pBinaryFormat != NULL && pLength != NULL, "Invalid parameters.");
+    *pLength = 0;
+
+#if CC_GL_PROGRAM_BINARY
+    if (m_uProgram && CCConfiguration::sharedConfiguration()->supportsProgramBinary())
+    {
+        GLint length = 0;
+        glGetProgramiv(m_uProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0)
+        {
+            unsigned char *pBinary = new unsigned char[length];
+            GLsizei written = 0;
+            glGetProgramBinary(m_uProgram, length, &written, pBinaryFormat, pBinary);
+            if (written > 0)
+            {
+                *pLength = written;
+                return pBinary;
+            }
+            delete [] pBinary;
+        }
+    }
+#endif
+    return NULL;
+}
+
 const char* CCGLProgram::description()
 {
     return CCString::createWithFormat("<CCGLProgram = "
@@ -136,6 +216,11 @@ const char* CCGLProgram::description()
                                       (size_t)this, m_uProgram, m_uVertShader, m_uFragShader)->getCString();
 }
 
+const GLchar* CCGLProgram::getShaderPrologue(GLenum type)
+{
+    return type == GL_VERTEX_SHADER ? s_pszVertexShaderPrologue : s_pszFragmentShaderPrologue;
+}
+
 bool CCGLProgram::compileShader(GLuint * shader, GLenum type, const GLchar* source)
 {
     GLint status;
@@ -146,17 +231,7 @@ bool CCGLProgram::compileShader(GLuint * shader, GLenum type, const GLchar* sour
     }
     
     const GLchar *sources[] = {
-#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32 && CC_TARGET_PLATFORM != CC_PLATFORM_LINUX && CC_TARGET_PLATFORM != CC_PLATFORM_MAC)
-        (type == GL_VERTEX_SHADER ? "precision highp float;\n" : "precision mediump float;\n"),
-#endif
-        "uniform mat4 CC_PMatrix;\n"
-        "uniform mat4 CC_MVMatrix;\n"
-        "uniform mat4 CC_MVPMatrix;\n"
-        "uniform vec4 CC_Time;\n"
-        "uniform vec4 CC_SinTime;\n"
-        "uniform vec4 CC_CosTime;\n"
-        "uniform vec4 CC_Random01;\n"
-        "//CC INCLUDES END\n\n",
+        getShaderPrologue(type),
         source,
     };
 
@@ -213,8 +288,17 @@ void CCGLProgram::updateUniforms()
     
 	m_uUniforms[kCCUniformRandom01] = glGetUniformLocation(m_uProgram, kCCUniformRandom01_s);
 
+    m_uMatrixUniforms = (m_uUniforms[kCCUniformPMatrix] != -1) + (m_uUniforms[kCCUniformMVMatrix] != -1) + (m_uUniforms[kCCUniformMVPMatrix] != -1);
+
     m_uUniforms[kCCUniformSampler] = glGetUniformLocation(m_uProgram, kCCUniformSampler_s);
 
+    // any other uniform is set by the node, CC_Random01 is drawn again for every draw
+    GLint activeUniforms = 0;
+    glGetProgramiv(m_uProgram, GL_ACTIVE_UNIFORMS, &activeUniforms);
+    GLint builtinUniforms = (GLint)m_uMatrixUniforms + (m_uUniforms[kCCUniformSampler] != -1)
+        + (m_uUniforms[kCCUniformTime] != -1) + (m_uUniforms[kCCUniformSinTime] != -1) + (m_uUniforms[kCCUniformCosTime] != -1);
+    m_bUsesOnlyBuiltinUniforms = (activeUniforms == builtinUniforms);
+
     this->use();
     
     // Since sample most probably won't change, set it to 0 now.
@@ -226,9 +310,21 @@ bool CCGLProgram::link()
     CCAssert(m_uProgram != 0, "Cannot link invalid program");
     
     GLint status = GL_TRUE;
-    
+
+#if CC_GL_PROGRAM_BINARY && defined(GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+    // desktop GL may not keep the binary otherwise
+    if (CCConfiguration::sharedConfiguration()->supportsProgramBinary())
+    {
+        glProgramParameteri(m_uProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+#endif
+
     glLinkProgram(m_uProgram);
 
+    // linking sets all the uniforms to 0
+    clearUniformCache();
+    m_bMatricesSet = false;
+
     if (m_uVertShader)
     {
         glDeleteShader(m_uVertShader);
@@ -257,6 +353,9 @@ bool CCGLProgram::link()
 
 void CCGLProgram::use()
 {
+    // whoever uses a program is about to draw, the batched quads must be drawn before
+    CCRenderer::flushPending();
+
     ccGLUseProgram(m_uProgram);
 }
 
@@ -300,37 +399,76 @@ bool CCGLProgram::updateUniformLocation(GLint location, GLvoid* data, unsigned i
     {
         return false;
     }
-    
-    bool updated = true;
-    tHashUniformEntry *element = NULL;
-    HASH_FIND_INT(m_pHashForUniforms, &location, element);
 
-    if (! element)
+    // the caller sets a matrix uniform itself: the next setUniformsForBuiltins() must upload the matrices again
+    if (location == m_uUniforms[kCCUniformPMatrix] || location == m_uUniforms[kCCUniformMVMatrix]
+        || location == m_uUniforms[kCCUniformMVPMatrix])
     {
-        element = (tHashUniformEntry*)malloc( sizeof(*element) );
+        m_bMatricesSet = false;
+    }
 
-        // key
-        element->location = location;
+    if ((unsigned int)location >= m_uUniformCacheSize)
+    {
+        if (location > kCCUniformCacheMaxLocation)
+        {
+            CC_INCREMENT_UNIFORM_UPLOADS(1);
+            return true;
+        }
+        growUniformCache(location + 1);
+    }
 
-        // value
-        element->value = malloc( bytes );
-        memcpy(element->value, data, bytes );
+    tUniformCacheEntry *entry = m_pUniformCache + location;
+    bool bBig = bytes > sizeof(entry->value);
+    GLvoid *value = bBig ? entry->bigValue : entry->value;
 
-        HASH_ADD_INT(m_pHashForUniforms, location, element);
+    if (entry->bytes == bytes && memcmp(value, data, bytes) == 0)
+    {
+        CC_INCREMENT_SKIPPED_UNIFORMS(1);
+        return false;
     }
-    else
+
+    if (bBig && entry->bytes != bytes)
     {
-        if (memcmp(element->value, data, bytes) == 0)
-        {
-            updated = false;
-        }
-        else
-        {
-            memcpy(element->value, data, bytes);
-        }
+        entry->bigValue = realloc(entry->bigValue, bytes);
+        value = entry->bigValue;
     }
+    memcpy(value, data, bytes);
+    entry->bytes = bytes;
 
-    return updated;
+    CC_INCREMENT_UNIFORM_UPLOADS(1);
+    return true;
+}
+
+void CCGLProgram::growUniformCache(unsigned int uSize)
+{
+    unsigned int uNewSize = MAX(m_uUniformCacheSize * 2, 8);
+    while (uNewSize < uSize)
+    {
+        uNewSize *= 2;
+    }
+
+    m_pUniformCache = (tUniformCacheEntry*)realloc(m_pUniformCache, uNewSize * sizeof(tUniformCacheEntry));
+    memset(m_pUniformCache + m_uUniformCacheSize, 0, (uNewSize - m_uUniformCacheSize) * sizeof(tUniformCacheEntry));
+    m_uUniformCacheSize = uNewSize;
+}
+
+void CCGLProgram::clearUniformCache()
+{
+    for (unsigned int i = 0; i < m_uUniformCacheSize; ++i)
+    {
+        m_pUniformCache[i].bytes = 0;
+    }
+}
+
+void CCGLProgram::purgeUniformCache()
+{
+    for (unsigned int i = 0; i < m_uUniformCacheSize; ++i)
+    {
+        free(m_pUniformCache[i].bigValue);
+    }
+    free(m_pUniformCache);
+    m_pUniformCache = NULL;
+    m_uUniformCacheSize = 0;
 }
 
 GLint CCGLProgram::getUniformLocationForName(const char* name)
@@ -500,19 +638,64 @@ void CCGLProgram::setUniformLocationWithMatrix4fv(GLint location, GLfloat* matri
 
 void CCGLProgram::setUniformsForBuiltins()
 {
-    kmMat4 matrixP;
-	kmMat4 matrixMV;
-	kmMat4 matrixMVP;
-	
-	kmGLGetMatrix(KM_GL_PROJECTION, &matrixP);
-	kmGLGetMatrix(KM_GL_MODELVIEW, &matrixMV);
-	
-	kmMat4Multiply(&matrixMVP, &matrixP, &matrixMV);
-    
-    setUniformLocationWithMatrix4fv(m_uUniforms[kCCUniformPMatrix], matrixP.mat, 1);
-    setUniformLocationWithMatrix4fv(m_uUniforms[kCCUniformMVMatrix], matrixMV.mat, 1);
-    setUniformLocationWithMatrix4fv(m_uUniforms[kCCUniformMVPMatrix], matrixMVP.mat, 1);
-	
+    km_mat4_version uProjectionVersion = kmGLGetMatrixVersion(KM_GL_PROJECTION);
+    km_mat4_version uModelViewVersion = kmGLGetMatrixVersion(KM_GL_MODELVIEW);
+
+    // the uniforms still hold these matrices if the stacks didn't change since the last draw with this program
+    if (! m_bMatricesSet || ! m_bModelViewFromStack
+        || uProjectionVersion != m_uProjectionVersion || uModelViewVersion != m_uModelViewVersion)
+    {
+        setUniformsForMatrices(kmGLGetTopMatrix(KM_GL_PROJECTION), kmGLGetTopMatrix(KM_GL_MODELVIEW), kmGLGetMVPMatrix());
+
+        m_bMatricesSet = true;
+        m_bModelViewFromStack = true;
+        m_uProjectionVersion = uProjectionVersion;
+        m_uModelViewVersion = uModelViewVersion;
+    }
+    else
+    {
+        CC_INCREMENT_SKIPPED_UNIFORMS(m_uMatrixUniforms);
+    }
+
+    setUniformsForTimeAndRandom();
+}
+
+void CCGLProgram::setUniformsForBuiltins(const kmMat4 &matrixMV)
+{
+    km_mat4_version uProjectionVersion = kmGLGetMatrixVersion(KM_GL_PROJECTION);
+
+    // the renderer draws with the same model-view every time
+    if (! m_bMatricesSet || m_bModelViewFromStack
+        || uProjectionVersion != m_uProjectionVersion || memcmp(&matrixMV, &m_sModelView, sizeof(kmMat4)) != 0)
+    {
+        const kmMat4 *pMatrixP = kmGLGetTopMatrix(KM_GL_PROJECTION);
+        kmMat4 matrixMVP;
+        kmMat4Multiply(&matrixMVP, pMatrixP, &matrixMV);
+
+        setUniformsForMatrices(pMatrixP, &matrixMV, &matrixMVP);
+
+        m_bMatricesSet = true;
+        m_bModelViewFromStack = false;
+        m_uProjectionVersion = uProjectionVersion;
+        m_sModelView = matrixMV;
+    }
+    else
+    {
+        CC_INCREMENT_SKIPPED_UNIFORMS(m_uMatrixUniforms);
+    }
+
+    setUniformsForTimeAndRandom();
+}
+
+void CCGLProgram::setUniformsForMatrices(const kmMat4 *pMatrixP, const kmMat4 *pMatrixMV, const kmMat4 *pMatrixMVP)
+{
+    setUniformLocationWithMatrix4fv(m_uUniforms[kCCUniformPMatrix], (GLfloat*)pMatrixP->mat, 1);
+    setUniformLocationWithMatrix4fv(m_uUniforms[kCCUniformMVMatrix], (GLfloat*)pMatrixMV->mat, 1);
+    setUniformLocationWithMatrix4fv(m_uUniforms[kCCUniformMVPMatrix], (GLfloat*)pMatrixMVP->mat, 1);
+}
+
+void CCGLProgram::setUniformsForTimeAndRandom()
+{
 	if(m_bUsesTime)
     {
 		CCDirector *director = CCDirector::sharedDirector();
@@ -536,23 +719,15 @@ void CCGLProgram::reset()
 {
     m_uVertShader = m_uFragShader = 0;
     memset(m_uUniforms, 0, sizeof(m_uUniforms));
+    m_bMatricesSet = false;
     
 
     // it is already deallocated by android
     //ccGLDeleteProgram(m_uProgram);
     m_uProgram = 0;
 
-    
-    tHashUniformEntry *current_element, *tmp;
-    
-    // Purge uniform hash
-    HASH_ITER(hh, m_pHashForUniforms, current_element, tmp) 
-    {
-        HASH_DEL(m_pHashForUniforms, current_element);
-        free(current_element->value);
-        free(current_element);
-    }
-    m_pHashForUniforms = NULL;
+
+    purgeUniformCache();
 }
 
 NS_CC_END
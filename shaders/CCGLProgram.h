@@ -32,6 +32,8 @@ THE SOFTWARE.
 #include "cocoa/CCObject.h"
 
 #include "CCGL.h"
+#include "kazmath/mat4.h"
+#include "kazmath/GL/mat4stack.h"
 
 NS_CC_BEGIN
 
@@ -86,7 +88,7 @@ enum {
 #define    kCCAttributeNamePosition        "a_position"
 #define    kCCAttributeNameTexCoord        "a_texCoord"
 
-struct _hashUniformEntry;
+struct _uniformCacheEntry;
 
 typedef void (*GLInfoFunction)(GLuint program, GLenum pname, GLint* params);
 typedef void (*GLLogFunction) (GLuint program, GLsizei bufsize, GLsizei* length, GLchar* infolog);
@@ -106,11 +108,20 @@ public:
     bool initWithVertexShaderByteArray(const GLchar* vShaderByteArray, const GLchar* fShaderByteArray);
     /** Initializes the CCGLProgram with a vertex and fragment with contents of filenames */
     bool initWithVertexShaderFilename(const char* vShaderFilename, const char* fShaderFilename);
+    /** Initializes the CCGLProgram, already linked, with a binary returned by getProgramBinary().
+     Returns false if the driver doesn't support program binaries or rejects this one, e.g. after it was updated.
+     The attributes keep the locations they had when the program was linked.
+     */
+    bool initWithProgramBinary(GLenum binaryFormat, const GLvoid* binary, GLsizei length);
+    /** returns the binary of the linked program in a buffer allocated with new[], or NULL if the driver can't give it */
+    unsigned char* getProgramBinary(GLenum *pBinaryFormat, unsigned long *pLength);
+    /** the precision and the built-in uniforms that are compiled before the source of every shader of the given type */
+    static const GLchar* getShaderPrologue(GLenum type);
     /**  It will add a new attribute to the shader */
     void addAttribute(const char* attributeName, GLuint index);
     /** links the glProgram */
     bool link();
-    /** it will call glUseProgram() */
+    /** it will call glUseProgram(). The quads recorded in the CCRenderer are drawn first */
     void use();
 /** It will create 4 uniforms:
     - kCCUniformPMatrix
@@ -172,9 +183,15 @@ public:
     /** calls glUniformMatrix4fv only if the values are different than the previous call for this same shader program. */
     void setUniformLocationWithMatrix4fv(GLint location, GLfloat* matrixArray, unsigned int numberOfMatrices);
     
-    /** will update the builtin uniforms if they are different than the previous call for this same shader program. */
+    /** will update the builtin uniforms if they are different than the previous call for this same shader program.
+     The matrices aren't multiplied nor uploaded again if the matrix stacks didn't change since then, see kmGLGetMatrixVersion(),
+     unless CC_PMatrix, CC_MVMatrix or CC_MVPMatrix were set with the setUniformLocationWith* methods in between.
+     */
     void setUniformsForBuiltins();
 
+    /** same as setUniformsForBuiltins(), but uses matrixMV instead of the top of the model-view stack. */
+    void setUniformsForBuiltins(const kmMat4 &matrixMV);
+
     /** returns the vertexShader error log */
     const char* vertexShaderLog();
     /** returns the fragmentShader error log */
@@ -188,8 +205,18 @@ public:
     
     inline const GLuint getProgram() { return m_uProgram; }
 
+    /** whether or not all the active uniforms of the program are set by setUniformsForBuiltins(), CC_Random01 excepted.
+     CCRenderer only records the quads drawn with such programs, the others can have different values per node.
+     */
+    inline bool usesOnlyBuiltinUniforms() { return m_bUsesOnlyBuiltinUniforms; }
+
 private:
     bool updateUniformLocation(GLint location, GLvoid* data, unsigned int bytes);
+    void growUniformCache(unsigned int uSize);
+    void clearUniformCache();
+    void purgeUniformCache();
+    void setUniformsForMatrices(const kmMat4 *pMatrixP, const kmMat4 *pMatrixMV, const kmMat4 *pMatrixMVP);
+    void setUniformsForTimeAndRandom();
     const char* description();
     bool compileShader(GLuint * shader, GLenum type, const GLchar* source);
     const char* logForOpenGLObject(GLuint object, GLInfoFunction infoFunc, GLLogFunction logFunc);
@@ -199,8 +226,19 @@ private:
     GLuint            m_uVertShader;
     GLuint            m_uFragShader;
     GLint             m_uUniforms[kCCUniform_MAX];
-    struct _hashUniformEntry* m_pHashForUniforms;
+    // the last value set to every uniform, indexed by location
+    struct _uniformCacheEntry* m_pUniformCache;
+    unsigned int      m_uUniformCacheSize;
+    unsigned int      m_uMatrixUniforms;
     bool              m_bUsesTime;
+    bool              m_bUsesOnlyBuiltinUniforms;
+
+    // what the matrix uniforms were set from: the versions of the stacks, or the model-view given by the caller
+    bool              m_bMatricesSet;
+    bool              m_bModelViewFromStack;
+    km_mat4_version   m_uProjectionVersion;
+    km_mat4_version   m_uModelViewVersion;
+    kmMat4            m_sModelView;
 };
 
 // end of shaders group
@@ -28,6 +28,11 @@ THE SOFTWARE.
 #include "CCGLProgram.h"
 #include "ccMacros.h"
 #include "ccShaders.h"
+#include "CCConfiguration.h"
+#include "platform/CCFileUtils.h"
+#include "platform/platform.h"
+#include <stdio.h>
+#include <string.h>
 
 NS_CC_BEGIN
 
@@ -44,6 +49,42 @@ enum {
     kCCShaderType_MAX,
 };
 
+static const char *s_pszDefaultShaderKeys[kCCShaderType_MAX] = {
+    kCCShader_PositionTextureColor,
+    kCCShader_PositionTextureColorAlphaTest,
+    kCCShader_PositionColor,
+    kCCShader_PositionTexture,
+    kCCShader_PositionTexture_uColor,
+    kCCShader_PositionTextureA8Color,
+    kCCShader_Position_uColor,
+    kCCShader_PositionLengthTexureColor,
+};
+
+// files of the program binary cache, in the writable path, in the byte order of the device:
+// the header, the driver string, then the binary
+#define kCCProgramBinaryMagic       "CCPB"
+#define kCCProgramBinaryVersion     1
+
+typedef struct _ccProgramBinaryHeader
+{
+    char            magic[4];
+    unsigned int    version;
+    unsigned int    sourceHash;
+    unsigned int    binaryFormat;
+    unsigned int    driverLength;
+    unsigned int    binaryLength;
+} ccProgramBinaryHeader;
+
+// FNV-1a, hashing the terminating '\0' too so that "ab" + "c" and "a" + "bc" differ
+static unsigned int ccProgramBinaryHash(unsigned int uHash, const char *pszString)
+{
+    do
+    {
+        uHash = (uHash ^ (unsigned char)*pszString) * 16777619u;
+    } while (*pszString++);
+    return uHash;
+}
+
 static CCShaderCache *_sharedShaderCache = 0;
 
 CCShaderCache* CCShaderCache::sharedShaderCache()
@@ -84,203 +125,252 @@ bool CCShaderCache::init()
 
 void CCShaderCache::loadDefaultShaders()
 {
-    // Position Texture Color shader
-    CCGLProgram *p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTextureColor);
-
-    m_pPrograms->setObject(p, kCCShader_PositionTextureColor);
-    p->release();
-
-    // Position Texture Color alpha test
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTextureColorAlphaTest);
-
-    m_pPrograms->setObject(p, kCCShader_PositionTextureColorAlphaTest);
-    p->release();
-
-    //
-    // Position, Color shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionColor);
-
-    m_pPrograms->setObject(p, kCCShader_PositionColor);
-    p->release();
-
-    //
-    // Position Texture shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTexture);
-
-    m_pPrograms->setObject(p, kCCShader_PositionTexture);
-    p->release();
-
-    //
-    // Position, Texture attribs, 1 Color as uniform shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTexture_uColor);
-
-    m_pPrograms->setObject(p ,kCCShader_PositionTexture_uColor);
-    p->release();
-
-    //
-    // Position Texture A8 Color shader
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionTextureA8Color);
-    
-    m_pPrograms->setObject(p, kCCShader_PositionTextureA8Color);
-    p->release();
-
-    //
-    // Position and 1 color passed as a uniform (to simulate glColor4ub )
-    //
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_Position_uColor);
-    
-    m_pPrograms->setObject(p, kCCShader_Position_uColor);
-    p->release();
-    
-    //
-	// Position, Legth(TexCoords, Color (used by Draw Node basically )
-	//
-    p = new CCGLProgram();
-    loadDefaultShader(p, kCCShaderType_PositionLengthTexureColor);
-    
-    m_pPrograms->setObject(p, kCCShader_PositionLengthTexureColor);
-    p->release();
+    struct cc_timeval start;
+    CCTime::gettimeofdayCocos2d(&start, NULL);
+
+    unsigned int uFromBinary = 0;
+    for (int type = 0; type < kCCShaderType_MAX; ++type)
+    {
+        CCGLProgram *p = new CCGLProgram();
+        if (loadDefaultShader(p, type))
+        {
+            ++uFromBinary;
+        }
+
+        m_pPrograms->setObject(p, s_pszDefaultShaderKeys[type]);
+        p->release();
+    }
+
+    logLoadingTime(&start, uFromBinary);
 }
 
 void CCShaderCache::reloadDefaultShaders()
 {
+    struct cc_timeval start;
+    CCTime::gettimeofdayCocos2d(&start, NULL);
+
     // reset all programs and reload them
-    
-    // Position Texture Color shader
-    CCGLProgram *p = programForKey(kCCShader_PositionTextureColor);    
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTextureColor);
-
-    // Position Texture Color alpha test
-    p = programForKey(kCCShader_PositionTextureColorAlphaTest);
-    p->reset();    
-    loadDefaultShader(p, kCCShaderType_PositionTextureColorAlphaTest);
-    
-    //
-    // Position, Color shader
-    //
-    p = programForKey(kCCShader_PositionColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionColor);
-    
-    //
-    // Position Texture shader
-    //
-    p = programForKey(kCCShader_PositionTexture);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTexture);
-    
-    //
-    // Position, Texture attribs, 1 Color as uniform shader
-    //
-    p = programForKey(kCCShader_PositionTexture_uColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTexture_uColor);
-    
-    //
-    // Position Texture A8 Color shader
-    //
-    p = programForKey(kCCShader_PositionTextureA8Color);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_PositionTextureA8Color);
-    
-    //
-    // Position and 1 color passed as a uniform (to simulate glColor4ub )
-    //
-    p = programForKey(kCCShader_Position_uColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_Position_uColor);
-    
-    //
-	// Position, Legth(TexCoords, Color (used by Draw Node basically )
-	//
-    p = programForKey(kCCShader_PositionLengthTexureColor);
-    p->reset();
-    loadDefaultShader(p, kCCShaderType_Position_uColor);
+    unsigned int uFromBinary = 0;
+    for (int type = 0; type < kCCShaderType_MAX; ++type)
+    {
+        CCGLProgram *p = programForKey(s_pszDefaultShaderKeys[type]);
+        p->reset();
+        if (loadDefaultShader(p, type))
+        {
+            ++uFromBinary;
+        }
+    }
+
+    logLoadingTime(&start, uFromBinary);
 }
 
-void CCShaderCache::loadDefaultShader(CCGLProgram *p, int type)
+void CCShaderCache::logLoadingTime(struct cc_timeval *pStart, unsigned int uFromBinary)
 {
+#if COCOS2D_DEBUG > 0
+    struct cc_timeval now;
+    CCTime::gettimeofdayCocos2d(&now, NULL);
+    CCLOG("cocos2d: CCShaderCache: %d default shaders loaded in %.2f ms, %u from their binaries",
+          kCCShaderType_MAX, CCTime::timersubCocos2d(pStart, &now), uFromBinary);
+#else
+    CC_UNUSED_PARAM(pStart);
+    CC_UNUSED_PARAM(uFromBinary);
+#endif
+}
+
+bool CCShaderCache::loadDefaultShader(CCGLProgram *p, int type)
+{
+    const GLchar *vert = NULL;
+    const GLchar *frag = NULL;
+    const char *position = kCCAttributeNamePosition;
+    bool bColor = false;
+    bool bTexCoords = false;
+
     switch (type) {
         case kCCShaderType_PositionTextureColor:
-            p->initWithVertexShaderByteArray(ccPositionTextureColor_vert, ccPositionTextureColor_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-            
+            vert = ccPositionTextureColor_vert;
+            frag = ccPositionTextureColor_frag;
+            bColor = bTexCoords = true;
             break;
         case kCCShaderType_PositionTextureColorAlphaTest:
-            p->initWithVertexShaderByteArray(ccPositionTextureColor_vert, ccPositionTextureColorAlphaTest_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
+            vert = ccPositionTextureColor_vert;
+            frag = ccPositionTextureColorAlphaTest_frag;
+            bColor = bTexCoords = true;
             break;
         case kCCShaderType_PositionColor:  
-            p->initWithVertexShaderByteArray(ccPositionColor_vert ,ccPositionColor_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-
+            vert = ccPositionColor_vert;
+            frag = ccPositionColor_frag;
+            bColor = true;
             break;
         case kCCShaderType_PositionTexture:
-            p->initWithVertexShaderByteArray(ccPositionTexture_vert ,ccPositionTexture_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
+            vert = ccPositionTexture_vert;
+            frag = ccPositionTexture_frag;
+            bTexCoords = true;
             break;
         case kCCShaderType_PositionTexture_uColor:
-            p->initWithVertexShaderByteArray(ccPositionTexture_uColor_vert, ccPositionTexture_uColor_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
+            vert = ccPositionTexture_uColor_vert;
+            frag = ccPositionTexture_uColor_frag;
+            bTexCoords = true;
             break;
         case kCCShaderType_PositionTextureA8Color:
-            p->initWithVertexShaderByteArray(ccPositionTextureA8Color_vert, ccPositionTextureA8Color_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-
+            vert = ccPositionTextureA8Color_vert;
+            frag = ccPositionTextureA8Color_frag;
+            bColor = bTexCoords = true;
             break;
         case kCCShaderType_Position_uColor:
-            p->initWithVertexShaderByteArray(ccPosition_uColor_vert, ccPosition_uColor_frag);    
-            
-            p->addAttribute("aVertex", kCCVertexAttrib_Position);    
-            
+            vert = ccPosition_uColor_vert;
+            frag = ccPosition_uColor_frag;
+            position = "aVertex";
             break;
         case kCCShaderType_PositionLengthTexureColor:
-            p->initWithVertexShaderByteArray(ccPositionColorLengthTexture_vert, ccPositionColorLengthTexture_frag);
-            
-            p->addAttribute(kCCAttributeNamePosition, kCCVertexAttrib_Position);
-            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
-            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
-            
+            vert = ccPositionColorLengthTexture_vert;
+            frag = ccPositionColorLengthTexture_frag;
+            bColor = bTexCoords = true;
             break;
         default:
             CCLOG("cocos2d: %s:%d, error shader type", __FUNCTION__, __LINE__);
-            return;
+            return false;
+    }
+
+    // the attribute locations are part of the binary, they are hashed with the sources and what compileShader() adds
+    unsigned int uHash = ccProgramBinaryHash(2166136261u, CCGLProgram::getShaderPrologue(GL_VERTEX_SHADER));
+    uHash = ccProgramBinaryHash(uHash, CCGLProgram::getShaderPrologue(GL_FRAGMENT_SHADER));
+    uHash = ccProgramBinaryHash(uHash, vert);
+    uHash = ccProgramBinaryHash(uHash, frag);
+    uHash = ccProgramBinaryHash(uHash, position);
+    uHash = ccProgramBinaryHash(uHash, bColor ? kCCAttributeNameColor : "");
+    uHash = ccProgramBinaryHash(uHash, bTexCoords ? kCCAttributeNameTexCoord : "");
+
+    bool bFromBinary = loadProgramBinary(p, s_pszDefaultShaderKeys[type], uHash);
+    if (! bFromBinary)
+    {
+        p->initWithVertexShaderByteArray(vert, frag);
+
+        p->addAttribute(position, kCCVertexAttrib_Position);
+        if (bColor)
+        {
+            p->addAttribute(kCCAttributeNameColor, kCCVertexAttrib_Color);
+        }
+        if (bTexCoords)
+        {
+            p->addAttribute(kCCAttributeNameTexCoord, kCCVertexAttrib_TexCoords);
+        }
+
+        p->link();
+        saveProgramBinary(p, s_pszDefaultShaderKeys[type], uHash);
     }
-    
-    p->link();
     p->updateUniforms();
     
     CHECK_GL_ERROR_DEBUG();
+    return bFromBinary;
+}
+
+std::string CCShaderCache::programBinaryPath(const char* key)
+{
+    return CCFileUtils::sharedFileUtils()->getWritablePath() + "cc_" + key + ".bin";
+}
+
+std::string CCShaderCache::programBinaryDriver()
+{
+    // a binary can only be loaded by the driver which made it
+    std::string driver = (const char*)glGetString(GL_VENDOR);
+    driver += '\n';
+    driver += (const char*)glGetString(GL_RENDERER);
+    driver += '\n';
+    driver += (const char*)glGetString(GL_VERSION);
+    return driver;
+}
+
+bool CCShaderCache::loadProgramBinary(CCGLProgram *p, const char* key, unsigned int uSourceHash)
+{
+#if CC_ENABLE_PROGRAM_BINARY_CACHE
+    if (! CCConfiguration::sharedConfiguration()->supportsProgramBinary())
+    {
+        return false;
+    }
+
+    bool bRet = false;
+    unsigned char *pBinary = NULL;
+    FILE *fp = fopen(programBinaryPath(key).c_str(), "rb");
+    do
+    {
+        CC_BREAK_IF(! fp);
+        fseek(fp, 0, SEEK_END);
+        long lFileSize = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+
+        ccProgramBinaryHeader header;
+        CC_BREAK_IF(lFileSize < (long)sizeof(header) || fread(&header, sizeof(header), 1, fp) != 1);
+        CC_BREAK_IF(memcmp(header.magic, kCCProgramBinaryMagic, 4) != 0 || header.version != kCCProgramBinaryVersion);
+        CC_BREAK_IF(header.sourceHash != uSourceHash);
+
+        std::string driver = programBinaryDriver();
+        CC_BREAK_IF(header.driverLength != driver.length() || header.binaryLength == 0);
+        CC_BREAK_IF((unsigned long)lFileSize != sizeof(header) + header.driverLength + header.binaryLength);
+
+        pBinary = new unsigned char[header.driverLength + header.binaryLength];
+        CC_BREAK_IF(fread(pBinary, 1, header.driverLength + header.binaryLength, fp) != header.driverLength + header.binaryLength);
+        CC_BREAK_IF(memcmp(pBinary, driver.c_str(), header.driverLength) != 0);
+
+        bRet = p->initWithProgramBinary(header.binaryFormat, pBinary + header.driverLength, header.binaryLength);
+    } while (0);
+
+    CC_SAFE_DELETE_ARRAY(pBinary);
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return bRet;
+#else
+    CC_UNUSED_PARAM(p);
+    CC_UNUSED_PARAM(key);
+    CC_UNUSED_PARAM(uSourceHash);
+    return false;
+#endif
+}
+
+void CCShaderCache::saveProgramBinary(CCGLProgram *p, const char* key, unsigned int uSourceHash)
+{
+#if CC_ENABLE_PROGRAM_BINARY_CACHE
+    GLenum binaryFormat = 0;
+    unsigned long uLength = 0;
+    unsigned char *pBinary = p->getProgramBinary(&binaryFormat, &uLength);
+    if (! pBinary)
+    {
+        return;
+    }
+
+    std::string driver = programBinaryDriver();
+
+    ccProgramBinaryHeader header;
+    memcpy(header.magic, kCCProgramBinaryMagic, 4);
+    header.version = kCCProgramBinaryVersion;
+    header.sourceHash = uSourceHash;
+    header.binaryFormat = binaryFormat;
+    header.driverLength = (unsigned int)driver.length();
+    header.binaryLength = (unsigned int)uLength;
+
+    std::string path = programBinaryPath(key);
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp)
+    {
+        bool bWritten = fwrite(&header, sizeof(header), 1, fp) == 1
+            && fwrite(driver.c_str(), 1, driver.length(), fp) == driver.length()
+            && fwrite(pBinary, 1, uLength, fp) == uLength;
+        fclose(fp);
+
+        // a truncated file would be rejected anyway, but not before being read
+        if (! bWritten)
+        {
+            CCLOG("cocos2d: CCShaderCache: can't save the binary of %s", key);
+            remove(path.c_str());
+        }
+    }
+    delete [] pBinary;
+#else
+    CC_UNUSED_PARAM(p);
+    CC_UNUSED_PARAM(key);
+    CC_UNUSED_PARAM(uSourceHash);
+#endif
 }
 
 CCGLProgram* CCShaderCache::programForKey(const char* key)
@@ -28,6 +28,7 @@ THE SOFTWARE.
 #define __CCSHADERCACHE_H__
 
 #include "cocoa/CCDictionary.h"
+#include <string>
 
 NS_CC_BEGIN
 
@@ -54,10 +55,12 @@ public:
     /** purges the cache. It releases the retained instance. */
     static void purgeSharedShaderCache();
 
-    /** loads the default shaders */
+    /** loads the default shaders.
+     Their binaries are loaded from the writable path when possible, see CC_ENABLE_PROGRAM_BINARY_CACHE.
+     */
     void loadDefaultShaders();
     
-    /** reload the default shaders */
+    /** reload the default shaders, from their binaries when possible */
     void reloadDefaultShaders();
 
     /** returns a GL program for a given key */
@@ -68,7 +71,13 @@ public:
 
 private:
     bool init();
-    void loadDefaultShader(CCGLProgram *program, int type);
+    // returns whether or not the program was loaded from its binary
+    bool loadDefaultShader(CCGLProgram *program, int type);
+    void logLoadingTime(struct cc_timeval *pStart, unsigned int uFromBinary);
+    std::string programBinaryPath(const char* key);
+    std::string programBinaryDriver();
+    bool loadProgramBinary(CCGLProgram *program, const char* key, unsigned int uSourceHash);
+    void saveProgramBinary(CCGLProgram *program, const char* key, unsigned int uSourceHash);
 
     CCDictionary* m_pPrograms;
 
@@ -196,6 +196,21 @@ void ccGLBindVAO(GLuint vaoId)
 #endif
 }
 
+void ccGLStreamBufferData(GLenum target, GLsizeiptr capacity, GLsizeiptr size, const GLvoid *data, GLenum usage)
+{
+    CCAssert(size <= capacity, "ccGLStreamBufferData: size is bigger than the capacity of the buffer");
+
+#if CC_USE_VBO_ORPHANING
+    glBufferData(target, capacity, NULL, usage);
+#else
+    CC_UNUSED_PARAM(usage);
+#endif
+    if (size > 0)
+    {
+        glBufferSubData(target, 0, size, data);
+    }
+}
+
 void ccGLEnable(ccGLServerState flags)
 {
 #if CC_ENABLE_GL_STATE_CACHE
@@ -146,6 +146,13 @@ void CC_DLL ccGLDeleteTextureN(GLuint textureUnit, GLuint textureId);
  */
 void CC_DLL ccGLBindVAO(GLuint vaoId);
 
+/** Uploads the first size bytes of data to the buffer bound to target, whose storage has capacity bytes.
+ If CC_USE_VBO_ORPHANING is enabled the storage of the buffer is orphaned first, so the upload doesn't wait for
+ the draws that are still reading the buffer. In that case the bytes past size are undefined after the call.
+ If it is disabled, it will call glBufferSubData() directly.
+ */
+void CC_DLL ccGLStreamBufferData(GLenum target, GLsizeiptr capacity, GLsizeiptr size, const GLvoid *data, GLenum usage);
+
 /** It will enable / disable the server side GL states.
  If CC_ENABLE_GL_STATE_CACHE is disabled, it will call glEnable() directly.
  @since v2.0.0
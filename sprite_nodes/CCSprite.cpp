@@ -37,6 +37,7 @@ THE SOFTWARE.
 #include "shaders/ccGLStateCache.h"
 #include "shaders/CCGLProgram.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "support/CCPointExtension.h"
 #include "cocoa/CCGeometry.h"
 #include "textures/CCTexture2D.h"
@@ -51,12 +52,6 @@ using namespace std;
 
 NS_CC_BEGIN
 
-#if CC_SPRITEBATCHNODE_RENDER_SUBPIXEL
-#define RENDER_IN_SUBPIXEL
-#else
-#define RENDER_IN_SUBPIXEL(__ARGS__) (ceil(__ARGS__))
-#endif
-
 CCSprite* CCSprite::createWithTexture(CCTexture2D *pTexture)
 {
     CCSprite *pobSprite = new CCSprite();
@@ -444,7 +439,90 @@ void CCSprite::setTextureCoords(CCRect rect)
     }
 }
 
+CCSpriteTransformBatch::CCSpriteTransformBatch()
+: m_uCount(0)
+{
+}
+
+void CCSpriteTransformBatch::addQuad(CCSprite *pSprite, ccV3F_C4B_T2F_Quad *pQuad, const CCAffineTransform& transform, const CCRect& rect)
+{
+    m_pSprites[m_uCount] = pSprite;
+    m_pQuads[m_uCount] = pQuad;
+    m_tTransforms[m_uCount] = transform;
+    m_tRects[m_uCount] = rect;
+    if (++m_uCount == kCCSpriteTransformBatchSize)
+    {
+        flush();
+    }
+}
+
+void CCSpriteTransformBatch::flush()
+{
+    CCAffineTransformApplyToQuads(m_tTransforms, m_tRects, m_pQuads, m_uCount);
+
+    for (unsigned int i = 0; i < m_uCount; i++)
+    {
+        ccV3F_C4B_T2F_Quad *pQuad = m_pQuads[i];
+#if ! CC_SPRITEBATCHNODE_RENDER_SUBPIXEL
+        pQuad->bl.vertices.x = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->bl.vertices.x);
+        pQuad->bl.vertices.y = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->bl.vertices.y);
+        pQuad->br.vertices.x = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->br.vertices.x);
+        pQuad->br.vertices.y = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->br.vertices.y);
+        pQuad->tl.vertices.x = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->tl.vertices.x);
+        pQuad->tl.vertices.y = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->tl.vertices.y);
+        pQuad->tr.vertices.x = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->tr.vertices.x);
+        pQuad->tr.vertices.y = CC_SPRITEBATCHNODE_RENDER_IN_SUBPIXEL(pQuad->tr.vertices.y);
+#endif // ! CC_SPRITEBATCHNODE_RENDER_SUBPIXEL
+
+        // MARMALADE CHANGE: ADDED CHECK FOR NULL, TO PERMIT SPRITES WITH NO BATCH NODE / TEXTURE ATLAS
+        CCTextureAtlas *pAtlas = m_pSprites[i]->getTextureAtlas();
+        if (pAtlas)
+        {
+            pAtlas->updateQuad(pQuad, m_pSprites[i]->getAtlasIndex());
+        }
+
+#if CC_SPRITE_DEBUG_DRAW
+        // draw bounding box
+        CCPoint vertices[4] = {
+            ccp( pQuad->bl.vertices.x, pQuad->bl.vertices.y ),
+            ccp( pQuad->br.vertices.x, pQuad->br.vertices.y ),
+            ccp( pQuad->tr.vertices.x, pQuad->tr.vertices.y ),
+            ccp( pQuad->tl.vertices.x, pQuad->tl.vertices.y ),
+        };
+        ccDrawPoly(vertices, 4, true);
+#endif // CC_SPRITE_DEBUG_DRAW
+    }
+    m_uCount = 0;
+}
+
 void CCSprite::updateTransform(void)
+{
+    CCSpriteTransformBatch batch;
+    addQuadToTransformBatch(&batch);
+    updateChildrenTransformInBatch(&batch);
+    batch.flush();
+}
+
+void CCSprite::updateTransformInBatch(CCSpriteTransformBatch *pBatch)
+{
+    if (canTransformInBatch())
+    {
+        addQuadToTransformBatch(pBatch);
+        updateChildrenTransformInBatch(pBatch);
+    }
+    else
+    {
+        // the subclass computes its quad in its own updateTransform()
+        updateTransform();
+    }
+}
+
+bool CCSprite::canTransformInBatch(void)
+{
+    return true;
+}
+
+void CCSprite::addQuadToTransformBatch(CCSpriteTransformBatch *pBatch)
 {
     CCAssert(m_pobBatchNode, "updateTransform is only valid when CCSprite is being rendered using an CCSpriteBatchNode");
 
@@ -456,6 +534,11 @@ void CCSprite::updateTransform(void)
         {
             m_sQuad.br.vertices = m_sQuad.tl.vertices = m_sQuad.tr.vertices = m_sQuad.bl.vertices = vertex3(0,0,0);
             m_bShouldBeHidden = true;
+
+            if (m_pobTextureAtlas)
+            {
+                m_pobTextureAtlas->updateQuad(&m_sQuad, m_uAtlasIndex);
+            }
         }
         else 
         {
@@ -472,71 +555,28 @@ void CCSprite::updateTransform(void)
             }
 
             //
-            // calculate the Quad based on the Affine Matrix
+            // the quad is calculated from the Affine Matrix by the batch, with the other dirty sprites
             //
-
-            CCSize size = m_obRect.size;
-
-            float x1 = m_obOffsetPosition.x;
-            float y1 = m_obOffsetPosition.y;
-
-            float x2 = x1 + size.width;
-            float y2 = y1 + size.height;
-            float x = m_transformToBatch.tx;
-            float y = m_transformToBatch.ty;
-
-            float cr = m_transformToBatch.a;
-            float sr = m_transformToBatch.b;
-            float cr2 = m_transformToBatch.d;
-            float sr2 = -m_transformToBatch.c;
-            float ax = x1 * cr - y1 * sr2 + x;
-            float ay = x1 * sr + y1 * cr2 + y;
-
-            float bx = x2 * cr - y1 * sr2 + x;
-            float by = x2 * sr + y1 * cr2 + y;
-
-            float cx = x2 * cr - y2 * sr2 + x;
-            float cy = x2 * sr + y2 * cr2 + y;
-
-            float dx = x1 * cr - y2 * sr2 + x;
-            float dy = x1 * sr + y2 * cr2 + y;
-
-            m_sQuad.bl.vertices = vertex3( RENDER_IN_SUBPIXEL(ax), RENDER_IN_SUBPIXEL(ay), m_fVertexZ );
-            m_sQuad.br.vertices = vertex3( RENDER_IN_SUBPIXEL(bx), RENDER_IN_SUBPIXEL(by), m_fVertexZ );
-            m_sQuad.tl.vertices = vertex3( RENDER_IN_SUBPIXEL(dx), RENDER_IN_SUBPIXEL(dy), m_fVertexZ );
-            m_sQuad.tr.vertices = vertex3( RENDER_IN_SUBPIXEL(cx), RENDER_IN_SUBPIXEL(cy), m_fVertexZ );
+            m_sQuad.bl.vertices.z = m_sQuad.br.vertices.z = m_sQuad.tl.vertices.z = m_sQuad.tr.vertices.z = m_fVertexZ;
+            pBatch->addQuad(this, &m_sQuad, m_transformToBatch, CCRect(m_obOffsetPosition.x, m_obOffsetPosition.y, m_obRect.size.width, m_obRect.size.height));
         }
 
-        // MARMALADE CHANGE: ADDED CHECK FOR NULL, TO PERMIT SPRITES WITH NO BATCH NODE / TEXTURE ATLAS
-        if (m_pobTextureAtlas)
-		{
-            m_pobTextureAtlas->updateQuad(&m_sQuad, m_uAtlasIndex);
-        }
-		
         m_bRecursiveDirty = false;
         setDirty(false);
     }
+}
 
-    // MARMALADE CHANGED
-    // recursively iterate over children
-/*    if( m_bHasChildren ) 
+void CCSprite::updateChildrenTransformInBatch(CCSpriteTransformBatch *pBatch)
+{
+    // recursively iterate over children, which are sprites in a batch node
+    if (m_pChildren && m_pChildren->count() > 0)
     {
-        // MARMALADE: CHANGED TO USE CCNode*
-        // NOTE THAT WE HAVE ALSO DEFINED virtual CCNode::updateTransform()
-        arrayMakeObjectsPerformSelector(m_pChildren, updateTransform, CCSprite*);
-    }*/
-    CCNode::updateTransform();
-
-#if CC_SPRITE_DEBUG_DRAW
-    // draw bounding box
-    CCPoint vertices[4] = {
-        ccp( m_sQuad.bl.vertices.x, m_sQuad.bl.vertices.y ),
-        ccp( m_sQuad.br.vertices.x, m_sQuad.br.vertices.y ),
-        ccp( m_sQuad.tr.vertices.x, m_sQuad.tr.vertices.y ),
-        ccp( m_sQuad.tl.vertices.x, m_sQuad.tl.vertices.y ),
-    };
-    ccDrawPoly(vertices, 4, true);
-#endif // CC_SPRITE_DEBUG_DRAW
+        CCObject *pObject = NULL;
+        CCARRAY_FOREACH(m_pChildren, pObject)
+        {
+            ((CCSprite*)pObject)->updateTransformInBatch(pBatch);
+        }
+    }
 }
 
 // draw
@@ -547,49 +587,65 @@ void CCSprite::draw(void)
 
     CCAssert(!m_pobBatchNode, "If CCSprite is being rendered by CCSpriteBatchNode, CCSprite#draw SHOULD NOT be called");
 
-    CC_NODE_DRAW_SETUP();
-
-    ccGLBlendFunc( m_sBlendFunc.src, m_sBlendFunc.dst );
+    CCRenderer *renderer = CCDirector::sharedDirector()->getRenderer();
+    if (renderer->isCullingEnabled() && ! renderer->isQuadVisible(&m_sQuad))
+    {
+        CC_PROFILER_STOP_CATEGORY(kCCProfilerCategorySprite, "CCSprite - draw");
+        return;
+    }
 
-    if (m_pobTexture != NULL)
+    if (m_pobTexture != NULL && renderer->canRecord(getShaderProgram()))
     {
-        ccGLBindTexture2D( m_pobTexture->getName() );
-        ccGLEnableVertexAttribs( kCCVertexAttribFlag_PosColorTex );
+        // drawn by the renderer, together with the following quads that share the same state
+        renderer->addQuads(m_pobTexture->getName(), getShaderProgram(), m_sBlendFunc, &m_sQuad, 1);
     }
     else
     {
-        ccGLBindTexture2D(0);
-        ccGLEnableVertexAttribs( kCCVertexAttribFlag_Position | kCCVertexAttribFlag_Color );
-    }
+        CC_NODE_DRAW_SETUP();
+
+        ccGLBlendFunc( m_sBlendFunc.src, m_sBlendFunc.dst );
+
+        if (m_pobTexture != NULL)
+        {
+            ccGLBindTexture2D( m_pobTexture->getName() );
+            ccGLEnableVertexAttribs( kCCVertexAttribFlag_PosColorTex );
+        }
+        else
+        {
+            ccGLBindTexture2D(0);
+            ccGLEnableVertexAttribs( kCCVertexAttribFlag_Position | kCCVertexAttribFlag_Color );
+        }
 
 #define kQuadSize sizeof(m_sQuad.bl)
 #ifdef EMSCRIPTEN
-    long offset = 0;
-    setGLBufferData(&m_sQuad, 4 * kQuadSize, 0);
+        long offset = 0;
+        setGLBufferData(&m_sQuad, 4 * kQuadSize, 0);
 #else
-    long offset = (long)&m_sQuad;
+        long offset = (long)&m_sQuad;
 #endif // EMSCRIPTEN
 
-    // vertex
-    int diff = offsetof( ccV3F_C4B_T2F, vertices);
-    glVertexAttribPointer(kCCVertexAttrib_Position, 3, GL_FLOAT, GL_FALSE, kQuadSize, (void*) (offset + diff));
+        // vertex
+        int diff = offsetof( ccV3F_C4B_T2F, vertices);
+        glVertexAttribPointer(kCCVertexAttrib_Position, 3, GL_FLOAT, GL_FALSE, kQuadSize, (void*) (offset + diff));
 
-    if (m_pobTexture != NULL)
-    {
-        // texCoods
-        diff = offsetof( ccV3F_C4B_T2F, texCoords);
-        glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, kQuadSize, (void*)(offset + diff));
-    }
+        if (m_pobTexture != NULL)
+        {
+            // texCoods
+            diff = offsetof( ccV3F_C4B_T2F, texCoords);
+            glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, kQuadSize, (void*)(offset + diff));
+        }
     
-    // color
-    diff = offsetof( ccV3F_C4B_T2F, colors);
-    glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, kQuadSize, (void*)(offset + diff));
+        // color
+        diff = offsetof( ccV3F_C4B_T2F, colors);
+        glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, kQuadSize, (void*)(offset + diff));
 
 
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    CHECK_GL_ERROR_DEBUG();
+        CHECK_GL_ERROR_DEBUG();
 
+        CC_INCREMENT_GL_DRAWS(1);
+    }
 
 #if CC_SPRITE_DEBUG_DRAW == 1
     // draw bounding box
@@ -611,8 +667,6 @@ void CCSprite::draw(void)
     ccDrawPoly(vertices, 4, true);
 #endif // CC_SPRITE_DEBUG_DRAW
 
-    CC_INCREMENT_GL_DRAWS(1);
-
     CC_PROFILER_STOP_CATEGORY(kCCProfilerCategorySprite, "CCSprite - draw");
 }
 
@@ -704,24 +758,7 @@ void CCSprite::sortAllChildren()
 {
     if (m_bReorderChildDirty)
     {
-        int i = 0,j = 0,length = m_pChildren->data->num;
-        CCNode** x = (CCNode**)m_pChildren->data->arr;
-        CCNode *tempItem = NULL;
-
-        // insertion sort
-        for(i=1; i<length; i++)
-        {
-            tempItem = x[i];
-            j = i-1;
-
-            //continue moving element downwards while zOrder is smaller or when zOrder is the same but orderOfArrival is smaller
-            while(j>=0 && ( tempItem->getZOrder() < x[j]->getZOrder() || ( tempItem->getZOrder() == x[j]->getZOrder() && tempItem->getOrderOfArrival() < x[j]->getOrderOfArrival() ) ) )
-            {
-                x[j+1] = x[j];
-                j = j-1;
-            }
-            x[j+1] = tempItem;
-        }
+        sortNodesByZOrder(m_pChildren);
 
         if ( m_pobBatchNode)
         {
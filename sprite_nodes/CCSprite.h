@@ -55,6 +55,34 @@ struct transformValues_;
 
 #define CCSpriteIndexNotInitialized 0xffffffff     /// CCSprite invalid index on the CCSpriteBatchNode
 
+#define kCCSpriteTransformBatchSize 64              /// Number of quads transformed together by CCSpriteTransformBatch
+
+class CCSprite;
+
+/**
+ * The sprites of a CCSpriteBatchNode whose quads have to be transformed.
+ * CCSpriteBatchNode collects its dirty sprites in one, then their vertices are computed together
+ * by CCAffineTransformApplyToQuads() and their quads are copied to the texture atlas.
+ */
+class CC_DLL CCSpriteTransformBatch
+{
+public:
+    CCSpriteTransformBatch();
+
+    /** adds the quad of a sprite, whose rect is transformed by transform. Flushes the batch when it is full */
+    void addQuad(CCSprite *pSprite, ccV3F_C4B_T2F_Quad *pQuad, const CCAffineTransform& transform, const CCRect& rect);
+
+    /** computes the vertices of the quads added since the last flush, and updates the texture atlas of their sprites */
+    void flush();
+
+private:
+    unsigned int        m_uCount;
+    CCSprite            *m_pSprites[kCCSpriteTransformBatchSize];
+    ccV3F_C4B_T2F_Quad  *m_pQuads[kCCSpriteTransformBatchSize];
+    CCAffineTransform   m_tTransforms[kCCSpriteTransformBatchSize];
+    CCRect              m_tRects[kCCSpriteTransformBatchSize];
+};
+
 
 /** 
  * CCSprite is a 2d image ( http://en.wikipedia.org/wiki/Sprite_(computer_graphics) )
@@ -310,6 +338,19 @@ public:
      * Updates the quad according the rotation, position, scale values. 
      */
     virtual void updateTransform(void);
+
+    /**
+     * Same as updateTransform() for this sprite and its children, but the quads to transform are added to pBatch,
+     * which computes them when it is flushed. CCSpriteBatchNode updates its sprites this way.
+     * Calls updateTransform() instead when canTransformInBatch() returns false.
+     */
+    virtual void updateTransformInBatch(CCSpriteTransformBatch *pBatch);
+
+    /**
+     * Whether or not the quad of this sprite can be computed by updateTransformInBatch() rather than by updateTransform().
+     * Returns true. A subclass that overrides updateTransform() must override it to return false.
+     */
+    virtual bool canTransformInBatch(void);
     
     /**
      * Returns the batch node object if this sprite is rendered by CCSpriteBatchNode
@@ -488,6 +529,10 @@ public:
     /// @} End of Sprite properties getter/setters
     
 protected:
+    /// adds the quad of this sprite to pBatch if it is dirty, the part of updateTransform() that doesn't recurse
+    void addQuadToTransformBatch(CCSpriteTransformBatch *pBatch);
+    /// calls updateTransformInBatch() on the children
+    void updateChildrenTransformInBatch(CCSpriteTransformBatch *pBatch);
     void updateColor(void);
     virtual void setTextureCoords(CCRect rect);
     virtual void updateBlendFunc(void);
@@ -35,6 +35,7 @@ THE SOFTWARE.
 #include "shaders/CCGLProgram.h"
 #include "shaders/ccGLStateCache.h"
 #include "CCDirector.h"
+#include "CCRenderer.h"
 #include "support/TransformUtils.h"
 #include "support/CCProfiling.h"
 // external
@@ -247,25 +248,7 @@ void CCSpriteBatchNode::sortAllChildren()
 {
     if (m_bReorderChildDirty)
     {
-        int i = 0,j = 0,length = m_pChildren->data->num;
-        CCNode ** x = (CCNode**)m_pChildren->data->arr;
-        CCNode *tempItem = NULL;
-
-        //insertion sort
-        for(i=1; i<length; i++)
-        {
-            tempItem = x[i];
-            j = i-1;
-
-            //continue moving element downwards while zOrder is smaller or when zOrder is the same but orderOfArrival is smaller
-            while(j>=0 && ( tempItem->getZOrder() < x[j]->getZOrder() || ( tempItem->getZOrder() == x[j]->getZOrder() && tempItem->getOrderOfArrival() < x[j]->getOrderOfArrival() ) ) )
-            {
-                x[j+1] = x[j];
-                j--;
-            }
-
-            x[j+1] = tempItem;
-        }
+        sortNodesByZOrder(m_pChildren);
 
         //sorted now check all children
         if (m_pChildren->count() > 0)
@@ -273,110 +256,96 @@ void CCSpriteBatchNode::sortAllChildren()
             //first sort all children recursively based on zOrder
             arrayMakeObjectsPerformSelector(m_pChildren, sortAllChildren, CCSprite*);
 
+            int count = (int)m_pobDescendants->count();
+            CCSprite** pNewOrder = (CCSprite**)malloc(count * sizeof(CCSprite*));
             int index=0;
 
             CCObject* pObj = NULL;
-            //fast dispatch, give every child a new atlasIndex based on their relative zOrder (keep parent -> child relations intact)
-            // and at the same time reorder descendants and the quads to the right index
+            // list the descendants in their new order, based on their relative zOrder (keep parent -> child relations intact)
             CCARRAY_FOREACH(m_pChildren, pObj)
             {
                 CCSprite* pChild = (CCSprite*)pObj;
-                updateAtlasIndex(pChild, &index);
+                updateAtlasIndex(pChild, pNewOrder, &index);
             }
+            CCAssert(index == count, "CCSpriteBatchNode: the descendants don't match the children");
+
+            reorderDescendants(pNewOrder, index);
+            free(pNewOrder);
         }
 
         m_bReorderChildDirty=false;
     }
 }
 
-void CCSpriteBatchNode::updateAtlasIndex(CCSprite* sprite, int* curIndex)
+void CCSpriteBatchNode::updateAtlasIndex(CCSprite* sprite, CCSprite** pNewOrder, int* curIndex)
 {
-    unsigned int count = 0;
     CCArray* pArray = sprite->getChildren();
-    if (pArray != NULL)
-    {
-        count = pArray->count();
-    }
-    
-    int oldIndex = 0;
-
-    if( count == 0 )
-    {
-        oldIndex = sprite->getAtlasIndex();
-        sprite->setAtlasIndex(*curIndex);
-        sprite->setOrderOfArrival(0);
-        if (oldIndex != *curIndex){
-            swap(oldIndex, *curIndex);
-        }
-        (*curIndex)++;
-    }
-    else
-    {
-        bool needNewIndex=true;
+    bool needNewIndex = true;
 
-        if (((CCSprite*) (pArray->data->arr[0]))->getZOrder() >= 0)
-        {
-            //all children are in front of the parent
-            oldIndex = sprite->getAtlasIndex();
-            sprite->setAtlasIndex(*curIndex);
-            sprite->setOrderOfArrival(0);
-            if (oldIndex != *curIndex)
-            {
-                swap(oldIndex, *curIndex);
-            }
-            (*curIndex)++;
-
-            needNewIndex = false;
-        }
+    sprite->setOrderOfArrival(0);
 
+    if (pArray != NULL && pArray->count() > 0)
+    {
         CCObject* pObj = NULL;
         CCARRAY_FOREACH(pArray,pObj)
         {
             CCSprite* child = (CCSprite*)pObj;
             if (needNewIndex && child->getZOrder() >= 0)
             {
-                oldIndex = sprite->getAtlasIndex();
-                sprite->setAtlasIndex(*curIndex);
-                sprite->setOrderOfArrival(0);
-                if (oldIndex != *curIndex) {
-                    this->swap(oldIndex, *curIndex);
-                }
-                (*curIndex)++;
+                // the sprite is drawn before its first child in front of it
+                pNewOrder[(*curIndex)++] = sprite;
                 needNewIndex = false;
-
             }
 
-            updateAtlasIndex(child, curIndex);
+            updateAtlasIndex(child, pNewOrder, curIndex);
         }
+    }
 
-        if (needNewIndex)
-        {//all children have a zOrder < 0)
-            oldIndex=sprite->getAtlasIndex();
-            sprite->setAtlasIndex(*curIndex);
-            sprite->setOrderOfArrival(0);
-            if (oldIndex!=*curIndex) {
-                swap(oldIndex, *curIndex);
-            }
-            (*curIndex)++;
-        }
+    if (needNewIndex)
+    {//no children, or all children have a zOrder < 0
+        pNewOrder[(*curIndex)++] = sprite;
     }
 }
 
-void CCSpriteBatchNode::swap(int oldIndex, int newIndex)
+void CCSpriteBatchNode::reorderDescendants(CCSprite** pNewOrder, int count)
 {
     CCObject** x = m_pobDescendants->data->arr;
+
+    // only the descendants between the first and the last one that moved are touched
+    int first = 0, last = count - 1;
+    while (first < count && x[first] == pNewOrder[first])
+    {
+        first++;
+    }
+    while (last > first && x[last] == pNewOrder[last])
+    {
+        last--;
+    }
+    if (first >= count)
+    {
+        return;
+    }
+
+    // the atlas index of a descendant is still its old position: gather the quads in their new order, then copy them back
     ccV3F_C4B_T2F_Quad* quads = m_pobTextureAtlas->getQuads();
+    int moved = last - first + 1;
+    ccV3F_C4B_T2F_Quad* pMovedQuads = (ccV3F_C4B_T2F_Quad*)malloc(moved * sizeof(ccV3F_C4B_T2F_Quad));
 
-    CCObject* tempItem = x[oldIndex];
-    ccV3F_C4B_T2F_Quad tempItemQuad=quads[oldIndex];
+    int i = 0;
+    for (i = first; i <= last; i++)
+    {
+        pMovedQuads[i - first] = quads[pNewOrder[i]->getAtlasIndex()];
+    }
 
-    //update the index of other swapped item
-    ((CCSprite*) x[newIndex])->setAtlasIndex(oldIndex);
+    for (i = first; i <= last; i++)
+    {
+        quads[i] = pMovedQuads[i - first];
+        x[i] = pNewOrder[i];
+        pNewOrder[i]->setAtlasIndex(i);
+    }
 
-    x[oldIndex]=x[newIndex];
-    quads[oldIndex]=quads[newIndex];
-    x[newIndex]=tempItem;
-    quads[newIndex]=tempItemQuad;
+    free(pMovedQuads);
+    m_pobTextureAtlas->setDirty(true);
 }
 
 void CCSpriteBatchNode::reorderBatch(bool reorder)
@@ -395,13 +364,40 @@ void CCSpriteBatchNode::draw(void)
         return;
     }
 
-    CC_NODE_DRAW_SETUP();
+    // the quads of the dirty sprites are transformed together
+    CCSpriteTransformBatch batch;
+    CCObject *pObject = NULL;
+    CCARRAY_FOREACH(m_pChildren, pObject)
+    {
+        ((CCSprite*)pObject)->updateTransformInBatch(&batch);
+    }
+    batch.flush();
 
-    arrayMakeObjectsPerformSelector(m_pChildren, updateTransform, CCSprite*);
+    // small batches (labels mostly) are merged with the neighbour quads by the renderer,
+    // the big ones are drawn from their own VBO, which isn't uploaded again if they didn't change
+    CCRenderer *renderer = CCDirector::sharedDirector()->getRenderer();
+    if (renderer->canRecord(getShaderProgram()) && m_pobTextureAtlas->getTotalQuads() <= kCCRendererMaxBatchNodeQuads)
+    {
+        if (renderer->isCullingEnabled())
+        {
+            // only the quads inside the viewport are recorded
+            renderer->addVisibleQuads(m_pobTextureAtlas->getTexture()->getName(), getShaderProgram(), m_blendFunc,
+                                      m_pobTextureAtlas->getQuads(), m_pobTextureAtlas->getTotalQuads());
+        }
+        else
+        {
+            renderer->addQuads(m_pobTextureAtlas->getTexture()->getName(), getShaderProgram(), m_blendFunc,
+                               m_pobTextureAtlas->getQuads(), m_pobTextureAtlas->getTotalQuads());
+        }
+    }
+    else
+    {
+        CC_NODE_DRAW_SETUP();
 
-    ccGLBlendFunc( m_blendFunc.src, m_blendFunc.dst );
+        ccGLBlendFunc( m_blendFunc.src, m_blendFunc.dst );
 
-    m_pobTextureAtlas->drawQuads();
+        m_pobTextureAtlas->drawQuads();
+    }
 
     CC_PROFILER_STOP("CCSpriteBatchNode - draw");
 }
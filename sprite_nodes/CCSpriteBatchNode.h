@@ -162,8 +162,8 @@ protected:
     CCSpriteBatchNode * addSpriteWithoutQuad(CCSprite*child, unsigned int z, int aTag);
 
 private:
-    void updateAtlasIndex(CCSprite* sprite, int* curIndex);
-    void swap(int oldIndex, int newIndex);
+    void updateAtlasIndex(CCSprite* sprite, CCSprite** pNewOrder, int* curIndex);
+    void reorderDescendants(CCSprite** pNewOrder, int count);
     void updateBlendFunc();
 
 protected:
@@ -28,8 +28,19 @@
 #include "ZipUtils.h"
 #include "ccMacros.h"
 #include "platform/CCFileUtils.h"
+#include "platform/CCFileData.h"
 #include "unzip.h"
 #include <map>
+#include <pthread.h>
+
+// pread() lets the loading threads read the archive at the same time, with no lock and no per thread handle
+#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32) && (CC_TARGET_PLATFORM != CC_PLATFORM_MARMALADE)
+#define CC_ZIP_USE_PREAD 1
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define CC_ZIP_USE_PREAD 0
+#endif
 
 NS_CC_BEGIN
 
@@ -440,35 +451,308 @@ void ZipUtils::ccSetPvrEncryptionKey(unsigned int keyPart1, unsigned int keyPart
 
 struct ZipEntryInfo
 {
-    unz_file_pos pos;
+    unz_file_pos pos;                   // minizip only
     uLong uncompressed_size;
+    uLong compressed_size;
+    uLong local_header_offset;
+    int compression_method;             // 0: stored, Z_DEFLATED: deflated
 };
 
 class ZipFilePrivate
 {
 public:
+    std::string path;
+    
+    // When the central directory can be read (it's not a zip64 archive), the entries are read and inflated
+    // directly from their offset, by any number of threads at the same time.
+    // Otherwise every read goes through minizip, which has a single current file, under the lock.
+    bool indexed;
+#if CC_ZIP_USE_PREAD
+    int fd;
+#else
+    FILE *fp;
+#endif
     unzFile zipFile;
+    pthread_mutex_t lock;
     
     // std::unordered_map is faster if available on the platform
     typedef std::map<std::string, struct ZipEntryInfo> FileListContainer;
     FileListContainer fileList;
 };
 
+#define kZipLocalHeaderSignature    0x04034b50
+#define kZipCentralHeaderSignature  0x02014b50
+#define kZipEndOfCentralDirSignature 0x06054b50
+#define kZipLocalHeaderSize         30
+#define kZipCentralHeaderSize       46
+#define kZipEndOfCentralDirSize     22
+
+static inline unsigned int zipReadUInt16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline unsigned int zipReadUInt32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static bool zipReadAt(ZipFilePrivate *data, unsigned long offset, unsigned char *buffer, unsigned long length)
+{
+#if CC_ZIP_USE_PREAD
+    unsigned long done = 0;
+    while (done < length)
+    {
+        ssize_t n = pread(data->fd, buffer + done, length - done, (off_t)(offset + done));
+        if (n <= 0)
+        {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+#else
+    pthread_mutex_lock(&data->lock);
+    bool ret = fseek(data->fp, offset, SEEK_SET) == 0 && fread(buffer, 1, length, data->fp) == length;
+    pthread_mutex_unlock(&data->lock);
+    return ret;
+#endif
+}
+
+static unsigned long zipFileSize(ZipFilePrivate *data)
+{
+#if CC_ZIP_USE_PREAD
+    off_t size = lseek(data->fd, 0, SEEK_END);
+    return size < 0 ? 0 : (unsigned long)size;
+#else
+    pthread_mutex_lock(&data->lock);
+    fseek(data->fp, 0, SEEK_END);
+    unsigned long size = ftell(data->fp);
+    pthread_mutex_unlock(&data->lock);
+    return size;
+#endif
+}
+
+// Reads the central directory and stores the entries starting with filter. Fails for zip64 archives.
+static bool zipReadCentralDirectory(ZipFilePrivate *data, const std::string &filter)
+{
+    unsigned long fileSize = zipFileSize(data);
+    if (fileSize < kZipEndOfCentralDirSize)
+    {
+        return false;
+    }
+    
+    // the end of central directory record is followed by a comment of at most 65535 bytes
+    unsigned long tailSize = MIN(fileSize, (unsigned long)(kZipEndOfCentralDirSize + 0xffff));
+    unsigned char *tail = new unsigned char[tailSize];
+    unsigned long entriesCount = 0, directorySize = 0, directoryOffset = 0;
+    bool found = false;
+    if (zipReadAt(data, fileSize - tailSize, tail, tailSize))
+    {
+        for (long i = (long)(tailSize - kZipEndOfCentralDirSize); i >= 0; --i)
+        {
+            if (zipReadUInt32(tail + i) == kZipEndOfCentralDirSignature)
+            {
+                entriesCount = zipReadUInt16(tail + i + 10);
+                directorySize = zipReadUInt32(tail + i + 12);
+                directoryOffset = zipReadUInt32(tail + i + 16);
+                found = true;
+                break;
+            }
+        }
+    }
+    delete [] tail;
+    
+    // not found, zip64 archive or broken record
+    if (! found
+        || entriesCount == 0xffff || directoryOffset == 0xffffffff || directorySize == 0xffffffff
+        || directoryOffset + directorySize > fileSize)
+    {
+        return false;
+    }
+    
+    unsigned char *directory = new unsigned char[directorySize];
+    bool ret = zipReadAt(data, directoryOffset, directory, directorySize);
+    
+    data->fileList.clear();
+    unsigned long offset = 0;
+    for (unsigned long i = 0; ret && i < entriesCount; ++i)
+    {
+        const unsigned char *header = directory + offset;
+        if (offset + kZipCentralHeaderSize > directorySize || zipReadUInt32(header) != kZipCentralHeaderSignature)
+        {
+            ret = false;
+            break;
+        }
+        
+        unsigned int nameLength = zipReadUInt16(header + 28);
+        unsigned int extraLength = zipReadUInt16(header + 30);
+        unsigned int commentLength = zipReadUInt16(header + 32);
+        if (offset + kZipCentralHeaderSize + nameLength > directorySize)
+        {
+            ret = false;
+            break;
+        }
+        
+        std::string currentFileName((const char*)header + kZipCentralHeaderSize, nameLength);
+        // cache info about filtered files only (like 'assets/')
+        if (filter.empty()
+            || currentFileName.compare(0, filter.length(), filter) == 0)
+        {
+            ZipEntryInfo entry;
+            memset(&entry.pos, 0, sizeof(entry.pos));
+            entry.compression_method = zipReadUInt16(header + 10);
+            entry.compressed_size = zipReadUInt32(header + 20);
+            entry.uncompressed_size = zipReadUInt32(header + 24);
+            entry.local_header_offset = zipReadUInt32(header + 42);
+            data->fileList[currentFileName] = entry;
+        }
+        
+        offset += kZipCentralHeaderSize + nameLength + extraLength + commentLength;
+    }
+    delete [] directory;
+    
+    if (! ret)
+    {
+        data->fileList.clear();
+    }
+    return ret;
+}
+
+// The local header may have another extra field than the central directory, so it is read every time.
+static bool zipGetDataOffset(ZipFilePrivate *data, const ZipEntryInfo &entry, unsigned long *offset)
+{
+    unsigned char header[kZipLocalHeaderSize];
+    if (! zipReadAt(data, entry.local_header_offset, header, kZipLocalHeaderSize)
+        || zipReadUInt32(header) != kZipLocalHeaderSignature)
+    {
+        return false;
+    }
+    
+    *offset = entry.local_header_offset + kZipLocalHeaderSize + zipReadUInt16(header + 26) + zipReadUInt16(header + 28);
+    return true;
+}
+
+static unsigned char *zipReadEntry(ZipFilePrivate *data, const ZipEntryInfo &entry)
+{
+    unsigned long offset = 0;
+    if (! zipGetDataOffset(data, entry, &offset))
+    {
+        return NULL;
+    }
+    
+    unsigned char *buffer = new unsigned char[entry.uncompressed_size];
+    
+    if (entry.compression_method == 0)
+    {
+        if (! zipReadAt(data, offset, buffer, entry.uncompressed_size))
+        {
+            CC_SAFE_DELETE_ARRAY(buffer);
+        }
+        return buffer;
+    }
+    
+    if (entry.compression_method != Z_DEFLATED)
+    {
+        CCLOG("cocos2d: ZipFile: unsupported compression method %d", entry.compression_method);
+        CC_SAFE_DELETE_ARRAY(buffer);
+        return NULL;
+    }
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // raw deflate data, no zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        CC_SAFE_DELETE_ARRAY(buffer);
+        return NULL;
+    }
+    
+    stream.next_out = buffer;
+    stream.avail_out = entry.uncompressed_size;
+    
+    unsigned char chunk[16 * 1024];
+    unsigned long remaining = entry.compressed_size;
+    int err = Z_OK;
+    while (remaining > 0 && err == Z_OK)
+    {
+        unsigned long length = MIN(remaining, (unsigned long)sizeof(chunk));
+        if (! zipReadAt(data, offset, chunk, length))
+        {
+            err = Z_ERRNO;
+            break;
+        }
+        offset += length;
+        remaining -= length;
+        
+        stream.next_in = chunk;
+        stream.avail_in = length;
+        err = inflate(&stream, Z_NO_FLUSH);
+        if (err == Z_BUF_ERROR && stream.avail_out == 0)
+        {
+            // the output is complete
+            err = Z_STREAM_END;
+        }
+    }
+    inflateEnd(&stream);
+    
+    if ((err != Z_STREAM_END && err != Z_OK) || stream.total_out != entry.uncompressed_size)
+    {
+        CCLOG("cocos2d: ZipFile: can't inflate the entry, error %d", err);
+        CC_SAFE_DELETE_ARRAY(buffer);
+    }
+    return buffer;
+}
+
 ZipFile::ZipFile(const std::string &zipFile, const std::string &filter)
 : m_data(new ZipFilePrivate)
 {
-    m_data->zipFile = unzOpen(zipFile.c_str());
-    if (m_data->zipFile)
+    m_data->path = zipFile;
+    m_data->indexed = false;
+    m_data->zipFile = NULL;
+    pthread_mutex_init(&m_data->lock, NULL);
+    
+#if CC_ZIP_USE_PREAD
+    m_data->fd = open(zipFile.c_str(), O_RDONLY);
+    if (m_data->fd >= 0)
+#else
+    m_data->fp = fopen(zipFile.c_str(), "rb");
+    if (m_data->fp)
+#endif
+    {
+        m_data->indexed = zipReadCentralDirectory(m_data, filter);
+    }
+    
+    if (! m_data->indexed)
     {
-        setFilter(filter);
+        m_data->zipFile = unzOpen(zipFile.c_str());
+        if (m_data->zipFile)
+        {
+            setFilter(filter);
+        }
     }
 }
 
 ZipFile::~ZipFile()
 {
-    if (m_data && m_data->zipFile)
+    if (m_data)
     {
-        unzClose(m_data->zipFile);
+        if (m_data->zipFile)
+        {
+            unzClose(m_data->zipFile);
+        }
+#if CC_ZIP_USE_PREAD
+        if (m_data->fd >= 0)
+        {
+            close(m_data->fd);
+        }
+#else
+        if (m_data->fp)
+        {
+            fclose(m_data->fp);
+        }
+#endif
+        pthread_mutex_destroy(&m_data->lock);
     }
     CC_SAFE_DELETE(m_data);
 }
@@ -479,6 +763,13 @@ bool ZipFile::setFilter(const std::string &filter)
     do
     {
         CC_BREAK_IF(!m_data);
+        
+        if (m_data->indexed)
+        {
+            ret = zipReadCentralDirectory(m_data, filter);
+            break;
+        }
+        
         CC_BREAK_IF(!m_data->zipFile);
         
         // clear existing file list
@@ -505,6 +796,9 @@ bool ZipFile::setFilter(const std::string &filter)
                     ZipEntryInfo entry;
                     entry.pos = posInfo;
                     entry.uncompressed_size = (uLong)fileInfo.uncompressed_size;
+                    entry.compressed_size = (uLong)fileInfo.compressed_size;
+                    entry.local_header_offset = 0;
+                    entry.compression_method = (int)fileInfo.compression_method;
                     m_data->fileList[currentFileName] = entry;
                 }
             }
@@ -542,7 +836,7 @@ unsigned char *ZipFile::getFileData(const std::string &fileName, unsigned long *
     
     do
     {
-        CC_BREAK_IF(!m_data->zipFile);
+        CC_BREAK_IF(!m_data->indexed && !m_data->zipFile);
         CC_BREAK_IF(fileName.empty());
         
         ZipFilePrivate::FileListContainer::const_iterator it = m_data->fileList.find(fileName);
@@ -550,24 +844,76 @@ unsigned char *ZipFile::getFileData(const std::string &fileName, unsigned long *
         
         ZipEntryInfo fileInfo = it->second;
         
-        int nRet = unzGoToFilePos(m_data->zipFile, &fileInfo.pos);
-        CC_BREAK_IF(UNZ_OK != nRet);
+        if (m_data->indexed)
+        {
+            pBuffer = zipReadEntry(m_data, fileInfo);
+            if (pBuffer && pSize)
+            {
+                *pSize = fileInfo.uncompressed_size;
+            }
+            break;
+        }
         
-        nRet = unzOpenCurrentFile(m_data->zipFile);
-        CC_BREAK_IF(UNZ_OK != nRet);
+        // minizip has a single current file
+        pthread_mutex_lock(&m_data->lock);
         
-        pBuffer = new unsigned char[fileInfo.uncompressed_size];
-        int CC_UNUSED nSize = unzReadCurrentFile(m_data->zipFile, pBuffer, fileInfo.uncompressed_size);
-        CCAssert(nSize == 0 || nSize == (int)fileInfo.uncompressed_size, "the file size is wrong");
+        int nRet = unzGoToFilePos(m_data->zipFile, &fileInfo.pos);
+        if (UNZ_OK == nRet)
+        {
+            nRet = unzOpenCurrentFile(m_data->zipFile);
+        }
         
-        if (pSize)
+        if (UNZ_OK == nRet)
         {
-            *pSize = fileInfo.uncompressed_size;
+            pBuffer = new unsigned char[fileInfo.uncompressed_size];
+            int CC_UNUSED nSize = unzReadCurrentFile(m_data->zipFile, pBuffer, fileInfo.uncompressed_size);
+            CCAssert(nSize == 0 || nSize == (int)fileInfo.uncompressed_size, "the file size is wrong");
+            
+            if (pSize)
+            {
+                *pSize = fileInfo.uncompressed_size;
+            }
+            unzCloseCurrentFile(m_data->zipFile);
         }
-        unzCloseCurrentFile(m_data->zipFile);
+        
+        pthread_mutex_unlock(&m_data->lock);
     } while (0);
     
     return pBuffer;
 }
 
+CCFileData *ZipFile::getFileDataView(const std::string &fileName)
+{
+    if (m_data->indexed)
+    {
+        ZipFilePrivate::FileListContainer::const_iterator it = m_data->fileList.find(fileName);
+        if (it == m_data->fileList.end())
+        {
+            return NULL;
+        }
+        
+        // stored entries (aapt doesn't compress the images) are mapped straight from the archive
+        unsigned long offset = 0;
+        if (it->second.compression_method == 0 && zipGetDataOffset(m_data, it->second, &offset))
+        {
+            CCFileData *pData = new CCFileData();
+            if (pData->initWithFileRange(m_data->path.c_str(), offset, it->second.uncompressed_size))
+            {
+                return pData;
+            }
+            pData->release();
+        }
+    }
+    
+    unsigned long uSize = 0;
+    unsigned char *pBuffer = getFileData(fileName, &uSize);
+    if (! pBuffer)
+    {
+        return NULL;
+    }
+    CCFileData *pData = new CCFileData();
+    pData->initWithBuffer(pBuffer, uSize);
+    return pData;
+}
+
 NS_CC_END
@@ -154,12 +154,15 @@ namespace cocos2d
 
     // forward declaration
     class ZipFilePrivate;
+    class CCFileData;
 
     /**
     * Zip file - reader helper class.
     *
     * It will cache the file list of a particular zip file with positions inside an archive,
     * so it would be much faster to read some particular files or to check their existance.
+    * The files are read directly at their offset in the archive, so the texture loading threads
+    * can read several of them at the same time.
     *
     * @since v2.0.5
     */
@@ -210,6 +213,16 @@ namespace cocos2d
         */
         unsigned char *getFileData(const std::string &fileName, unsigned long *pSize);
 
+        /**
+        * Get the read-only contents of a file in the zip file.
+        * The entries stored without compression are mapped in memory straight from the archive when it is possible.
+        * Like getFileData(), it can be called from several threads at the same time.
+        * @param fileName File name
+        * @return Upon success, the contents of the file, otherwise NULL.
+        * @warning The object isn't autoreleased: you are responsible for calling release() on it.
+        */
+        CCFileData *getFileDataView(const std::string &fileName);
+
     private:
         /** Internal data like zip file pointer / file list array and so on */
         ZipFilePrivate *m_data;
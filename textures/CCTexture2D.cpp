@@ -36,6 +36,7 @@ THE SOFTWARE.
 #include "CCConfiguration.h"
 #include "platform/platform.h"
 #include "platform/CCImage.h"
+#include "platform/CCAssetBundle.h"
 #include "CCGL.h"
 #include "support/ccUtils.h"
 #include "platform/CCPlatformMacros.h"
@@ -46,9 +47,7 @@ THE SOFTWARE.
 #include "shaders/ccGLStateCache.h"
 #include "shaders/CCShaderCache.h"
 
-#if CC_ENABLE_CACHE_TEXTURE_DATA
-    #include "CCTextureCache.h"
-#endif
+#include "CCTextureCache.h"
 
 NS_CC_BEGIN
 
@@ -71,6 +70,10 @@ CCTexture2D::CCTexture2D()
 , m_bHasPremultipliedAlpha(false)
 , m_bHasMipmaps(false)
 , m_pShaderProgram(NULL)
+, m_bReady(true)
+, m_pPendingData(NULL)
+, m_pPendingImage(NULL)
+, m_uRowsUploaded(0)
 {
 }
 
@@ -82,6 +85,7 @@ CCTexture2D::~CCTexture2D()
 
     CCLOGINFO("cocos2d: deallocing CCTexture2D %u.", m_uName);
     CC_SAFE_RELEASE(m_pShaderProgram);
+    releasePendingData();
 
     if(m_uName)
     {
@@ -173,21 +177,43 @@ bool CCTexture2D::hasPremultipliedAlpha()
     return m_bHasPremultipliedAlpha;
 }
 
-bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize)
+// GL internal format, format and type used to upload the pixel formats that aren't compressed
+static bool glFormatForPixelFormat(CCTexture2DPixelFormat pixelFormat, GLenum *pInternalFormat, GLenum *pFormat, GLenum *pType)
 {
-    unsigned int bitsPerPixel;
-    //Hack: bitsPerPixelForFormat returns wrong number for RGB_888 textures. See function.
-    if(pixelFormat == kCCTexture2DPixelFormat_RGB888)
-    {
-        bitsPerPixel = 24;
-    }
-    else
+    switch(pixelFormat)
     {
-        bitsPerPixel = bitsPerPixelForFormat(pixelFormat);
+    case kCCTexture2DPixelFormat_RGBA8888:
+        *pInternalFormat = GL_RGBA; *pFormat = GL_RGBA; *pType = GL_UNSIGNED_BYTE;
+        break;
+    case kCCTexture2DPixelFormat_RGB888:
+        *pInternalFormat = GL_RGB; *pFormat = GL_RGB; *pType = GL_UNSIGNED_BYTE;
+        break;
+    case kCCTexture2DPixelFormat_RGBA4444:
+        *pInternalFormat = GL_RGBA; *pFormat = GL_RGBA; *pType = GL_UNSIGNED_SHORT_4_4_4_4;
+        break;
+    case kCCTexture2DPixelFormat_RGB5A1:
+        *pInternalFormat = GL_RGBA; *pFormat = GL_RGBA; *pType = GL_UNSIGNED_SHORT_5_5_5_1;
+        break;
+    case kCCTexture2DPixelFormat_RGB565:
+        *pInternalFormat = GL_RGB; *pFormat = GL_RGB; *pType = GL_UNSIGNED_SHORT_5_6_5;
+        break;
+    case kCCTexture2DPixelFormat_AI88:
+        *pInternalFormat = GL_LUMINANCE_ALPHA; *pFormat = GL_LUMINANCE_ALPHA; *pType = GL_UNSIGNED_BYTE;
+        break;
+    case kCCTexture2DPixelFormat_A8:
+        *pInternalFormat = GL_ALPHA; *pFormat = GL_ALPHA; *pType = GL_UNSIGNED_BYTE;
+        break;
+    case kCCTexture2DPixelFormat_I8:
+        *pInternalFormat = GL_LUMINANCE; *pFormat = GL_LUMINANCE; *pType = GL_UNSIGNED_BYTE;
+        break;
+    default:
+        return false;
     }
+    return true;
+}
 
-    unsigned int bytesPerRow = pixelsWide * bitsPerPixel / 8;
-
+static void setUnpackAlignment(unsigned int bytesPerRow)
+{
     if(bytesPerRow % 8 == 0)
     {
         glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
@@ -204,7 +230,31 @@ bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFor
     {
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     }
+}
 
+unsigned int CCTexture2D::bytesPerRowForFormat(CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide)
+{
+    unsigned int bitsPerPixel;
+    //Hack: bitsPerPixelForFormat returns wrong number for RGB_888 textures. See function.
+    if(pixelFormat == kCCTexture2DPixelFormat_RGB888)
+    {
+        bitsPerPixel = 24;
+    }
+    else
+    {
+        bitsPerPixel = bitsPerPixelForFormat(pixelFormat);
+    }
+
+    return pixelsWide * bitsPerPixel / 8;
+}
+
+bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFormat, unsigned int pixelsWide, unsigned int pixelsHigh, const CCSize& contentSize)
+{
+    setUnpackAlignment(bytesPerRowForFormat(pixelFormat, pixelsWide));
+
+    // the whole texture is uploaded now, forget any pending incremental upload
+    releasePendingData();
+    m_bReady = true;
 
     glGenTextures(1, &m_uName);
     ccGLBindTexture2D(m_uName);
@@ -216,35 +266,14 @@ bool CCTexture2D::initWithData(const void *data, CCTexture2DPixelFormat pixelFor
 
     // Specify OpenGL texture image
 
-    switch(pixelFormat)
+    GLenum internalFormat, format, type;
+    if (glFormatForPixelFormat(pixelFormat, &internalFormat, &format, &type))
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, format, type, data);
+    }
+    else
     {
-    case kCCTexture2DPixelFormat_RGBA8888:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        break;
-    case kCCTexture2DPixelFormat_RGB888:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        break;
-    case kCCTexture2DPixelFormat_RGBA4444:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, data);
-        break;
-    case kCCTexture2DPixelFormat_RGB5A1:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, data);
-        break;
-    case kCCTexture2DPixelFormat_RGB565:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, data);
-        break;
-    case kCCTexture2DPixelFormat_AI88:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, data);
-        break;
-    case kCCTexture2DPixelFormat_A8:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_ALPHA, GL_UNSIGNED_BYTE, data);
-        break;
-    case kCCTexture2DPixelFormat_I8:
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, (GLsizei)pixelsWide, (GLsizei)pixelsHigh, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
-        break;
-    default:
         CCAssert(0, "NSInternalInconsistencyException");
-
     }
 
     m_tContentSize = contentSize;
@@ -291,10 +320,87 @@ bool CCTexture2D::initWithImage(CCImage *uiImage)
     }
     
     // always load premultiplied images
-    return initPremultipliedATextureWithImage(uiImage, imageWidth, imageHeight);
+    return initPremultipliedATextureWithImage(uiImage, imageWidth, imageHeight, false);
+}
+
+bool CCTexture2D::initWithImageIncremental(CCImage *uiImage)
+{
+    if (uiImage == NULL)
+    {
+        CCLOG("cocos2d: CCTexture2D. Can't create Texture. UIImage is nil");
+        return false;
+    }
+
+    unsigned int imageWidth = uiImage->getWidth();
+    unsigned int imageHeight = uiImage->getHeight();
+
+    unsigned maxTextureSize = CCConfiguration::sharedConfiguration()->getMaxTextureSize();
+    if (imageWidth > maxTextureSize || imageHeight > maxTextureSize)
+    {
+        CCLOG("cocos2d: WARNING: Image (%u x %u) is bigger than the supported %u x %u", imageWidth, imageHeight, maxTextureSize, maxTextureSize);
+        return false;
+    }
+
+    return initPremultipliedATextureWithImage(uiImage, imageWidth, imageHeight, true);
+}
+
+bool CCTexture2D::uploadNextStrip()
+{
+    if (m_pPendingData)
+    {
+        unsigned int bytesPerRow = bytesPerRowForFormat(m_ePixelFormat, m_uPixelsWide);
+        unsigned int rows = MAX(kCCTexture2DUploadStripBytes / bytesPerRow, 1);
+        rows = MIN(rows, m_uPixelsHigh - m_uRowsUploaded);
+
+        GLenum internalFormat, format, type;
+        if (! glFormatForPixelFormat(m_ePixelFormat, &internalFormat, &format, &type))
+        {
+            CCAssert(0, "NSInternalInconsistencyException");
+            // nothing can be uploaded, the texture is left empty
+            releasePendingData();
+            m_bReady = true;
+            return true;
+        }
+
+        setUnpackAlignment(bytesPerRow);
+        ccGLBindTexture2D(m_uName);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)m_uRowsUploaded, (GLsizei)m_uPixelsWide, (GLsizei)rows, format, type, m_pPendingData + m_uRowsUploaded * bytesPerRow);
+
+        m_uRowsUploaded += rows;
+        if (m_uRowsUploaded < m_uPixelsHigh)
+        {
+            return false;
+        }
+
+        releasePendingData();
+    }
+
+    m_bReady = true;
+    return true;
+}
+
+void CCTexture2D::releasePendingData()
+{
+    if (m_pPendingImage)
+    {
+        // the pixels belong to the image
+        m_pPendingImage->release();
+    }
+    else
+    {
+        CC_SAFE_DELETE_ARRAY(m_pPendingData);
+    }
+    m_pPendingImage = NULL;
+    m_pPendingData = NULL;
+    m_uRowsUploaded = 0;
+}
+
+bool CCTexture2D::isReady()
+{
+    return m_bReady;
 }
 
-bool CCTexture2D::initPremultipliedATextureWithImage(CCImage *image, unsigned int width, unsigned int height)
+bool CCTexture2D::initPremultipliedATextureWithImage(CCImage *image, unsigned int width, unsigned int height, bool bIncremental)
 {
     unsigned char*            tempData = image->getData();
     unsigned int*             inPixel32  = NULL;
@@ -422,11 +528,29 @@ bool CCTexture2D::initPremultipliedATextureWithImage(CCImage *image, unsigned in
         }
     }
     
-    initWithData(tempData, pixelFormat, width, height, imageSize);
-    
-    if (tempData != image->getData())
+    if (bIncremental)
     {
-        delete [] tempData;
+        // only allocate the texture, CCTextureCache uploads the pixels a few rows every frame
+        initWithData(NULL, pixelFormat, width, height, imageSize);
+
+        if (tempData == image->getData())
+        {
+            image->retain();
+            m_pPendingImage = image;
+        }
+        m_pPendingData = tempData;
+        m_bReady = false;
+
+        CCTextureCache::sharedTextureCache()->addIncrementalUpload(this);
+    }
+    else
+    {
+        initWithData(tempData, pixelFormat, width, height, imageSize);
+    
+        if (tempData != image->getData())
+        {
+            delete [] tempData;
+        }
     }
 
     m_bHasPremultipliedAlpha = image->isPremultipliedAlpha();
@@ -751,6 +875,38 @@ bool CCTexture2D::initWithETCFile(const char* file)
     return bRet;
 }
 
+bool CCTexture2D::initWithBundleTexture(const ccAssetBundleTextureInfo& info, const void* data)
+{
+    CCTexture2DPixelFormat pixelFormat;
+    switch (info.pixelFormat)
+    {
+    case kCCAssetBundlePixelFormatRGBA8888:
+        pixelFormat = kCCTexture2DPixelFormat_RGBA8888;
+        break;
+    case kCCAssetBundlePixelFormatRGB565:
+        pixelFormat = kCCTexture2DPixelFormat_RGB565;
+        break;
+    case kCCAssetBundlePixelFormatRGBA4444:
+        pixelFormat = kCCTexture2DPixelFormat_RGBA4444;
+        break;
+    default:
+        CCLOG("cocos2d: CCTexture2D: unknown bundle pixel format %u", info.pixelFormat);
+        return false;
+    }
+
+    unsigned maxTextureSize = CCConfiguration::sharedConfiguration()->getMaxTextureSize();
+    if (info.width > maxTextureSize || info.height > maxTextureSize)
+    {
+        CCLOG("cocos2d: WARNING: Image (%u x %u) is bigger than the supported %u x %u", info.width, info.height, maxTextureSize, maxTextureSize);
+        return false;
+    }
+
+    // the packer already converted the pixels like initWithImage() does
+    initWithData(data, pixelFormat, info.width, info.height, CCSizeMake((float)info.width, (float)info.height));
+    m_bHasPremultipliedAlpha = info.premultipliedAlpha;
+    return true;
+}
+
 void CCTexture2D::PVRImagesHavePremultipliedAlpha(bool haveAlphaPremultiplied)
 {
     PVRHaveAlphaPremultiplied_ = haveAlphaPremultiplied;
@@ -37,6 +37,7 @@ THE SOFTWARE.
 NS_CC_BEGIN
 
 class CCImage;
+struct _ccAssetBundleTextureInfo;
 
 /**
  * @addtogroup textures
@@ -88,6 +89,9 @@ typedef enum {
 
 class CCGLProgram;
 
+/** Size of the rows of pixels uploaded at once by CCTexture2D::uploadNextStrip() */
+#define kCCTexture2DUploadStripBytes (256 * 1024)
+
 /**
 Extension to set the Min / Mag filter
 */
@@ -141,6 +145,20 @@ public:
 
     bool initWithImage(CCImage * uiImage);
 
+    /** Initializes a texture from a UIImage object without uploading its pixels.
+    The texture is allocated and CCTextureCache uploads the pixels a few rows every frame,
+    within CCTextureCache::getIncrementalUploadBudget(). The texture isn't ready until they are all uploaded.
+    */
+    bool initWithImageIncremental(CCImage * uiImage);
+
+    /** returns false while the pixels of a texture created with initWithImageIncremental() are being uploaded */
+    bool isReady();
+
+    /** uploads the next rows of pixels of a texture created with initWithImageIncremental().
+    Returns true when the texture is ready. Called by CCTextureCache.
+    */
+    bool uploadNextStrip();
+
     /** Initializes a texture from a string with dimensions, alignment, font name and font size */
     bool initWithString(const char *text,  const char *fontName, float fontSize, const CCSize& dimensions, CCTextAlignment hAlignment, CCVerticalTextAlignment vAlignment);
     /** Initializes a texture from a string with font name and font size */
@@ -154,6 +172,9 @@ public:
     /** Initializes a texture from a ETC file */
     bool initWithETCFile(const char* file);
 
+    /** Initializes a texture from the pixels of a texture stored decoded in an asset bundle, see CCAssetBundle::getTextureInfo() */
+    bool initWithBundleTexture(const struct _ccAssetBundleTextureInfo& info, const void* data);
+
     /** sets the min filter, mag filter, wrap s and wrap t texture parameters.
     If the texture size is NPOT (non power of 2), then in can only use GL_CLAMP_TO_EDGE in GL_TEXTURE_WRAP_{S,T}.
 
@@ -245,7 +266,9 @@ public:
     bool hasPremultipliedAlpha();
     bool hasMipmaps();
 private:
-    bool initPremultipliedATextureWithImage(CCImage * image, unsigned int pixelsWide, unsigned int pixelsHigh);
+    bool initPremultipliedATextureWithImage(CCImage * image, unsigned int pixelsWide, unsigned int pixelsHigh, bool bIncremental);
+    unsigned int bytesPerRowForFormat(CCTexture2DPixelFormat format, unsigned int pixelsWide);
+    void releasePendingData();
     
     // By default PVR images are treated as if they don't have the alpha channel premultiplied
     bool m_bPVRHaveAlphaPremultiplied;
@@ -274,6 +297,13 @@ private:
 
     /** shader program used by drawAtPoint and drawInRect */
     CC_PROPERTY(CCGLProgram*, m_pShaderProgram, ShaderProgram);
+
+    bool m_bReady;
+
+    /** pixels not uploaded yet, and the image that owns them if they weren't converted */
+    unsigned char *m_pPendingData;
+    CCImage *m_pPendingImage;
+    unsigned int m_uRowsUploaded;
 };
 
 // end of textures group
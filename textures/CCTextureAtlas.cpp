@@ -47,6 +47,9 @@ NS_CC_BEGIN
 CCTextureAtlas::CCTextureAtlas()
     :m_pIndices(NULL)
     ,m_bDirty(false)
+    ,m_uDirtyStart(0)
+    ,m_uDirtyEnd(0)
+    ,m_uBufferedQuads(0)
     ,m_pTexture(NULL)
     ,m_pQuads(NULL)
 {}
@@ -93,7 +96,7 @@ void CCTextureAtlas::setTexture(CCTexture2D * var)
 ccV3F_C4B_T2F_Quad* CCTextureAtlas::getQuads()
 {
     //if someone accesses the quads directly, presume that changes will be made
-    m_bDirty = true;
+    setDirty(true);
     return m_pQuads;
 }
 
@@ -189,7 +192,7 @@ bool CCTextureAtlas::initWithTexture(CCTexture2D *texture, unsigned int capacity
     setupVBO();
 #endif
 
-    m_bDirty = true;
+    setDirty(true);
 
     return true;
 }
@@ -203,7 +206,7 @@ void CCTextureAtlas::listenBackToForeground(CCObject *obj)
 #endif
     
     // set m_bDirty to true to force it rebinding buffer
-    m_bDirty = true;
+    setDirty(true);
 }
 
 const char* CCTextureAtlas::description()
@@ -253,6 +256,7 @@ void CCTextureAtlas::setupVBOandVAO()
 
     glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * m_uCapacity, m_pQuads, GL_DYNAMIC_DRAW);
+    m_uBufferedQuads = m_uCapacity;
 
     // vertices
     glEnableVertexAttribArray(kCCVertexAttrib_Position);
@@ -292,6 +296,7 @@ void CCTextureAtlas::mapBuffers()
     
     glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * m_uCapacity, m_pQuads, GL_DYNAMIC_DRAW);
+    m_uBufferedQuads = m_uCapacity;
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_pBuffersVBO[1]);
@@ -312,7 +317,7 @@ void CCTextureAtlas::updateQuad(ccV3F_C4B_T2F_Quad *quad, unsigned int index)
     m_pQuads[index] = *quad;    
 
 
-    m_bDirty = true;
+    setDirtyRange(index, 1);
 
 }
 
@@ -336,7 +341,7 @@ void CCTextureAtlas::insertQuad(ccV3F_C4B_T2F_Quad *quad, unsigned int index)
     m_pQuads[index] = *quad;
 
 
-    m_bDirty = true;
+    setDirtyRange(index, m_uTotalQuads - index);
 
 }
 
@@ -359,6 +364,8 @@ void CCTextureAtlas::insertQuads(ccV3F_C4B_T2F_Quad* quads, unsigned int index,
     }
 
 
+    setDirtyRange(index, m_uTotalQuads - index);
+
     unsigned int max = index + amount;
     unsigned int j = 0;
     for (unsigned int i = index; i < max ; i++)
@@ -367,8 +374,6 @@ void CCTextureAtlas::insertQuads(ccV3F_C4B_T2F_Quad* quads, unsigned int index,
         index++;
         j++;
     }
-
-    m_bDirty = true;
 }
 
 void CCTextureAtlas::insertQuadFromIndex(unsigned int oldIndex, unsigned int newIndex)
@@ -397,7 +402,7 @@ void CCTextureAtlas::insertQuadFromIndex(unsigned int oldIndex, unsigned int new
     m_pQuads[newIndex] = quadsBackup;
 
 
-    m_bDirty = true;
+    setDirtyRange(MIN(oldIndex, newIndex), howMany + 1);
 
 }
 
@@ -418,7 +423,7 @@ void CCTextureAtlas::removeQuadAtIndex(unsigned int index)
     m_uTotalQuads--;
 
 
-    m_bDirty = true;
+    setDirtyRange(index, remaining);
 
 }
 
@@ -435,7 +440,7 @@ void CCTextureAtlas::removeQuadsAtIndex(unsigned int index, unsigned int amount)
         memmove( &m_pQuads[index], &m_pQuads[index+amount], sizeof(m_pQuads[0]) * remaining );
     }
 
-    m_bDirty = true;
+    setDirtyRange(index, remaining);
 }
 
 void CCTextureAtlas::removeAllQuads()
@@ -512,7 +517,7 @@ bool CCTextureAtlas::resizeCapacity(unsigned int newCapacity)
     setupIndices();
     mapBuffers();
 
-    m_bDirty = true;
+    setDirty(true);
 
     return true;
 }
@@ -550,7 +555,8 @@ void CCTextureAtlas::moveQuadsFromIndex(unsigned int oldIndex, unsigned int amou
 
     free(tempQuads);
 
-    m_bDirty = true;
+    unsigned int uFirst = MIN(oldIndex, newIndex);
+    setDirtyRange(uFirst, MAX(oldIndex, newIndex) + amount - uFirst);
 }
 
 void CCTextureAtlas::moveQuadsFromIndex(unsigned int index, unsigned int newIndex)
@@ -572,6 +578,60 @@ void CCTextureAtlas::fillWithEmptyQuadsFromIndex(unsigned int index, unsigned in
     }
 }
 
+void CCTextureAtlas::setDirtyRange(unsigned int uIndex, unsigned int uAmount)
+{
+    if (! m_bDirty)
+    {
+        m_bDirty = true;
+        m_uDirtyStart = uIndex;
+        m_uDirtyEnd = uIndex + uAmount;
+    }
+    else
+    {
+        m_uDirtyStart = MIN(m_uDirtyStart, uIndex);
+        m_uDirtyEnd = MAX(m_uDirtyEnd, uIndex + uAmount);
+    }
+}
+
+// Uploads the dirty quads to the array buffer, which must be bound. uCount quads are going to be drawn.
+// Small updates only replace the dirty range. When most of the quads changed (a batch node full of moving
+// sprites), the buffer is orphaned and the quads in use are uploaded again, so the driver doesn't stall.
+void CCTextureAtlas::uploadDirtyQuads(unsigned int uCount)
+{
+    uCount = MIN(MAX(uCount, m_uTotalQuads), m_uCapacity);
+
+    // the quads past the last upload are garbage once the buffer was orphaned
+    if (uCount > m_uBufferedQuads)
+    {
+        setDirtyRange(m_uBufferedQuads, uCount - m_uBufferedQuads);
+    }
+
+    if (! m_bDirty)
+    {
+        return;
+    }
+
+    unsigned int uEnd = MIN(m_uDirtyEnd, m_uCapacity);
+    unsigned int uStart = MIN(m_uDirtyStart, uEnd);
+
+#if CC_USE_VBO_ORPHANING
+    if ((uEnd - uStart) * 2 > uCount)
+    {
+        ccGLStreamBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * m_uCapacity, sizeof(m_pQuads[0]) * uCount, m_pQuads, GL_DYNAMIC_DRAW);
+        m_uBufferedQuads = uCount;
+    }
+    else
+#endif
+    if (uEnd > uStart)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * uStart, sizeof(m_pQuads[0]) * (uEnd - uStart), &m_pQuads[uStart]);
+        // the dirty range covered the quads past the last upload, they hold valid data now
+        m_uBufferedQuads = MAX(m_uBufferedQuads, uEnd);
+    }
+
+    setDirty(false);
+}
+
 // TextureAtlas - Drawing
 
 void CCTextureAtlas::drawQuads()
@@ -599,25 +659,9 @@ void CCTextureAtlas::drawNumberOfQuads(unsigned int n, unsigned int start)
     //
 
     // XXX: update is done in draw... perhaps it should be done in a timer
-    if (m_bDirty) 
-    {
-        glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
-        // option 1: subdata
-        //glBufferSubData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0])*start, sizeof(m_pQuads[0]) * n , &m_pQuads[start] );
-		
-		// option 2: data
-        //		glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * (n-start), &quads_[start], GL_DYNAMIC_DRAW);
-		
-		// option 3: orphaning + glMapBuffer
-		glBufferData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0]) * (n-start), NULL, GL_DYNAMIC_DRAW);
-		void *buf = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-		memcpy(buf, m_pQuads, sizeof(m_pQuads[0])* (n-start));
-		glUnmapBuffer(GL_ARRAY_BUFFER);
-		
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        m_bDirty = false;
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
+    uploadDirtyQuads(start + n);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     ccGLBindVAO(m_uVAOname);
 
@@ -647,11 +691,7 @@ void CCTextureAtlas::drawNumberOfQuads(unsigned int n, unsigned int start)
     glBindBuffer(GL_ARRAY_BUFFER, m_pBuffersVBO[0]);
 
     // XXX: update is done in draw... perhaps it should be done in a timer
-    if (m_bDirty) 
-    {
-        glBufferSubData(GL_ARRAY_BUFFER, sizeof(m_pQuads[0])*start, sizeof(m_pQuads[0]) * n , &m_pQuads[start] );
-        m_bDirty = false;
-    }
+    uploadDirtyQuads(start + n);
 
     ccGLEnableVertexAttribs(kCCVertexAttribFlag_PosColorTex);
 
@@ -62,6 +62,9 @@ protected:
 #endif
     GLuint              m_pBuffersVBO[2]; //0: vertex  1: indices
     bool                m_bDirty; //indicates whether or not the array buffer of the VBO needs to be updated
+    unsigned int        m_uDirtyStart; //first quad that needs to be uploaded
+    unsigned int        m_uDirtyEnd; //one past the last quad that needs to be uploaded
+    unsigned int        m_uBufferedQuads; //quads that hold valid data in the array buffer of the VBO
 
 
     /** quantity of quads that are going to be drawn */
@@ -205,12 +208,20 @@ public:
 
     /** whether or not the array buffer of the VBO needs to be updated*/
     inline bool isDirty(void) { return m_bDirty; }
-    /** specify if the array buffer of the VBO needs to be updated */
-    inline void setDirty(bool bDirty) { m_bDirty = bDirty; }
+    /** specify if the array buffer of the VBO needs to be updated. If true, all the quads are uploaded again */
+    inline void setDirty(bool bDirty) { m_bDirty = bDirty; m_uDirtyStart = 0; m_uDirtyEnd = bDirty ? m_uCapacity : 0; }
+    /** specify that only uAmount quads from uIndex need to be uploaded. The range is merged with the previous dirty range */
+    void setDirtyRange(unsigned int uIndex, unsigned int uAmount);
+
+    /** returns the quads like getQuads(), without marking the atlas dirty.
+     The caller marks the quads it changes with setDirtyRange(). Unlike getQuads(), it can be called from another thread.
+     */
+    inline ccV3F_C4B_T2F_Quad* getRawQuads(void) { return m_pQuads; }
 
 private:
     void setupIndices();
     void mapBuffers();
+    void uploadDirtyQuads(unsigned int uCount);
 #if CC_TEXTURE_ATLAS_USE_VAO
     void setupVBOandVAO();
 #else
@@ -32,6 +32,8 @@ THE SOFTWARE.
 #include "platform/CCFileUtils.h"
 #include "platform/CCThread.h"
 #include "platform/CCImage.h"
+#include "platform/CCFileData.h"
+#include "platform/CCAssetBundle.h"
 #include "support/ccUtils.h"
 #include "CCScheduler.h"
 #include "cocoa/CCString.h"
@@ -41,29 +43,44 @@ THE SOFTWARE.
 #include <cctype>
 #include <queue>
 #include <list>
+#include <vector>
+#include <map>
+#include <algorithm>
 #include <pthread.h>
 
 using namespace std;
 
 NS_CC_BEGIN
 
-typedef struct _AsyncStruct
+typedef struct _AsyncCallback
 {
-    std::string            filename;
-    CCObject    *target;
-    SEL_CallFuncO        selector;
-} AsyncStruct;
+    CCObject        *target;
+    SEL_CallFuncO   selector;
+} AsyncCallback;
+
+struct _AsyncStruct
+{
+    std::string                 filename;
+    // the targets waiting for this image. Only used by the main thread
+    std::vector<AsyncCallback>  callbacks;
+    // guarded by s_asyncStructQueueMutex
+    int                         priority;
+    unsigned long               order;
+};
+typedef struct _AsyncStruct AsyncStruct;
 
 typedef struct _ImageInfo
 {
     AsyncStruct *asyncStruct;
     CCImage        *image;
     CCImage::EImageFormat imageType;
+    // the pixels of a texture of an asset bundle, instead of the image
+    CCFileData  *bundlePixels;
+    ccAssetBundleTextureInfo bundleTexture;
 } ImageInfo;
 
-static pthread_t s_loadingThread;
+static std::vector<pthread_t> s_loadingThreads;
 
-static pthread_mutex_t		s_SleepMutex;
 static pthread_cond_t		s_SleepCondition;
 
 static pthread_mutex_t      s_asyncStructQueueMutex;
@@ -72,14 +89,21 @@ static pthread_mutex_t      s_ImageInfoMutex;
 #ifdef EMSCRIPTEN
 // Hack to get ASM.JS validation (no undefined symbols allowed).
 #define pthread_cond_signal(_)
+#define pthread_cond_broadcast(_)
 #endif // EMSCRIPTEN
 
 static unsigned long s_nAsyncRefCount = 0;
+static unsigned long s_nAsyncOrder = 0;
 
 static bool need_quit = false;
 
-static std::queue<AsyncStruct*>* s_pAsyncStructQueue = NULL;
+// the requests waiting for a loading thread, kept as a heap by priority
+static std::vector<AsyncStruct*>* s_pAsyncStructQueue = NULL;
 static std::queue<ImageInfo*>*   s_pImageQueue = NULL;
+// every request not delivered yet, by full path. Only used by the main thread
+static std::map<std::string, AsyncStruct*>* s_pAsyncStructMap = NULL;
+// the requests whose texture is being uploaded incrementally. Only used by the main thread
+static std::map<CCTexture2D*, AsyncStruct*>* s_pUploadingStructMap = NULL;
 
 static CCImage::EImageFormat computeImageFormatType(string& filename)
 {
@@ -105,6 +129,33 @@ static CCImage::EImageFormat computeImageFormatType(string& filename)
     return ret;
 }
 
+// the pixels of a texture stored decoded in a mounted asset bundle, NULL for the other files. The caller releases them
+static CCFileData* loadBundleTexture(const std::string& fullpath, ccAssetBundleTextureInfo *pInfo)
+{
+    std::string name;
+    CCFileUtils *pFileUtils = CCFileUtils::sharedFileUtils();
+    CCAssetBundle *pBundle = pFileUtils->getBundleForFullPath(fullpath, name);
+    if (! pBundle)
+    {
+        return NULL;
+    }
+
+    // the pixels don't need the bundle, it can be unmounted once they are read
+    CCFileData *pData = pBundle->getTextureInfo(name, pInfo) ? pBundle->getFileDataView(name) : NULL;
+    pFileUtils->releaseBundle(pBundle);
+    return pData;
+}
+
+// the heap keeps the "biggest" request at the front: the highest priority, then the oldest request
+static bool compareAsyncStructPriority(const AsyncStruct *a, const AsyncStruct *b)
+{
+    if (a->priority != b->priority)
+    {
+        return a->priority < b->priority;
+    }
+    return a->order > b->order;
+}
+
 static void* loadImage(void* data)
 {
     AsyncStruct *pAsyncStruct = NULL;
@@ -115,49 +166,51 @@ static void* loadImage(void* data)
         CCThread thread;
         thread.createAutoreleasePool();
 
-        std::queue<AsyncStruct*> *pQueue = s_pAsyncStructQueue;
-        pthread_mutex_lock(&s_asyncStructQueueMutex);// get async struct from queue
-        if (pQueue->empty())
+        // get the async struct with the highest priority from queue
+        pthread_mutex_lock(&s_asyncStructQueueMutex);
+        while (s_pAsyncStructQueue->empty() && !need_quit)
         {
-            pthread_mutex_unlock(&s_asyncStructQueueMutex);
-            if (need_quit) {
-                break;
-            }
-            else {
-            	pthread_cond_wait(&s_SleepCondition, &s_SleepMutex);
-                continue;
-            }
+            pthread_cond_wait(&s_SleepCondition, &s_asyncStructQueueMutex);
         }
-        else
+        if (need_quit)
         {
-            pAsyncStruct = pQueue->front();
-            pQueue->pop();
             pthread_mutex_unlock(&s_asyncStructQueueMutex);
-        }        
+            break;
+        }
+        std::pop_heap(s_pAsyncStructQueue->begin(), s_pAsyncStructQueue->end(), compareAsyncStructPriority);
+        pAsyncStruct = s_pAsyncStructQueue->back();
+        s_pAsyncStructQueue->pop_back();
+        pthread_mutex_unlock(&s_asyncStructQueueMutex);
 
         const char *filename = pAsyncStruct->filename.c_str();
 
+        // the textures of the bundles are read as they are
+        ImageInfo *pImageInfo = new ImageInfo();
+        pImageInfo->bundlePixels = loadBundleTexture(pAsyncStruct->filename, &pImageInfo->bundleTexture);
+
         // compute image type
         CCImage::EImageFormat imageType = computeImageFormatType(pAsyncStruct->filename);
-        if (imageType == CCImage::kFmtUnKnown)
+        CCImage *pImage = NULL;
+        if (pImageInfo->bundlePixels)
+        {
+            // already decoded by the packer
+        }
+        else if (imageType == CCImage::kFmtUnKnown)
         {
             CCLOG("unsupported format %s",filename);
-            delete pAsyncStruct;
-            
-            continue;
         }
-        
-        // generate image            
-        CCImage *pImage = new CCImage();
-        if (pImage && !pImage->initWithImageFileThreadSafe(filename, imageType))
+        else
         {
-            CC_SAFE_RELEASE(pImage);
-            CCLOG("can not load %s", filename);
-            continue;
+            // generate image
+            pImage = new CCImage();
+            if (pImage && !pImage->initWithImageFileThreadSafe(filename, imageType))
+            {
+                CC_SAFE_RELEASE_NULL(pImage);
+                CCLOG("can not load %s", filename);
+            }
         }
 
-        // generate image info
-        ImageInfo *pImageInfo = new ImageInfo();
+        // fill the image info. Failed loads are queued too, without image, so the main thread releases the targets
         pImageInfo->asyncStruct = pAsyncStruct;
         pImageInfo->image = pImage;
         pImageInfo->imageType = imageType;
@@ -168,20 +221,102 @@ static void* loadImage(void* data)
         pthread_mutex_unlock(&s_ImageInfoMutex);    
     }
     
-    if( s_pAsyncStructQueue != NULL )
+    return 0;
+}
+
+static void releaseAsyncStruct(AsyncStruct *pAsyncStruct)
+{
+    for (unsigned int i = 0; i < pAsyncStruct->callbacks.size(); ++i)
     {
-        delete s_pAsyncStructQueue;
-        s_pAsyncStructQueue = NULL;
-        delete s_pImageQueue;
-        s_pImageQueue = NULL;
+        CC_SAFE_RELEASE(pAsyncStruct->callbacks[i].target);
+    }
+    delete pAsyncStruct;
+}
 
-        pthread_mutex_destroy(&s_asyncStructQueueMutex);
-        pthread_mutex_destroy(&s_ImageInfoMutex);
-        pthread_mutex_destroy(&s_SleepMutex);
-        pthread_cond_destroy(&s_SleepCondition);
+// removes the callbacks of pTarget (all of them if pTarget is NULL). Returns true if nobody waits for the image anymore
+// and it was still in the queue: it is not in the queue anymore and the caller has to release it.
+// If it is being loaded, addImageAsyncCallBack() drops the image instead of creating the texture.
+static bool cancelAsyncStruct(AsyncStruct *pAsyncStruct, CCObject *pTarget)
+{
+    std::vector<AsyncCallback>::iterator it = pAsyncStruct->callbacks.begin();
+    while (it != pAsyncStruct->callbacks.end())
+    {
+        if (pTarget == NULL || it->target == pTarget)
+        {
+            CC_SAFE_RELEASE(it->target);
+            it = pAsyncStruct->callbacks.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
-    
-    return 0;
+
+    if (! pAsyncStruct->callbacks.empty())
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_asyncStructQueueMutex);
+    std::vector<AsyncStruct*>::iterator queued = std::find(s_pAsyncStructQueue->begin(), s_pAsyncStructQueue->end(), pAsyncStruct);
+    bool bQueued = (queued != s_pAsyncStructQueue->end());
+    if (bQueued)
+    {
+        s_pAsyncStructQueue->erase(queued);
+        std::make_heap(s_pAsyncStructQueue->begin(), s_pAsyncStructQueue->end(), compareAsyncStructPriority);
+    }
+    pthread_mutex_unlock(&s_asyncStructQueueMutex);
+
+    return bQueued;
+}
+
+static void stopLoadingThreads()
+{
+    if (s_pAsyncStructQueue == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&s_asyncStructQueueMutex);
+    need_quit = true;
+    pthread_mutex_unlock(&s_asyncStructQueueMutex);
+    pthread_cond_broadcast(&s_SleepCondition);
+
+    for (unsigned int i = 0; i < s_loadingThreads.size(); ++i)
+    {
+        pthread_join(s_loadingThreads[i], NULL);
+    }
+    s_loadingThreads.clear();
+
+    // the threads are gone, release the requests that were not delivered
+    while (! s_pImageQueue->empty())
+    {
+        ImageInfo *pImageInfo = s_pImageQueue->front();
+        s_pImageQueue->pop();
+        CC_SAFE_RELEASE(pImageInfo->image);
+        CC_SAFE_RELEASE(pImageInfo->bundlePixels);
+        delete pImageInfo;
+    }
+
+    std::map<std::string, AsyncStruct*>::iterator it;
+    for (it = s_pAsyncStructMap->begin(); it != s_pAsyncStructMap->end(); ++it)
+    {
+        releaseAsyncStruct(it->second);
+    }
+
+    delete s_pAsyncStructQueue;
+    s_pAsyncStructQueue = NULL;
+    delete s_pImageQueue;
+    s_pImageQueue = NULL;
+    delete s_pAsyncStructMap;
+    s_pAsyncStructMap = NULL;
+    delete s_pUploadingStructMap;
+    s_pUploadingStructMap = NULL;
+    s_nAsyncRefCount = 0;
+
+    pthread_mutex_destroy(&s_asyncStructQueueMutex);
+    pthread_mutex_destroy(&s_ImageInfoMutex);
+    pthread_cond_destroy(&s_SleepCondition);
 }
 
 // implementation CCTextureCache
@@ -199,18 +334,23 @@ CCTextureCache * CCTextureCache::sharedTextureCache()
 }
 
 CCTextureCache::CCTextureCache()
+: m_uAsyncLoadingThreads(CC_TEXTURE_ASYNC_LOADING_THREADS)
+, m_fAsyncUploadBudget(CC_TEXTURE_ASYNC_UPLOAD_BUDGET)
+, m_uIncrementalUploadPixels(CC_TEXTURE_INCREMENTAL_UPLOAD_PIXELS)
+, m_fIncrementalUploadBudget(CC_TEXTURE_INCREMENTAL_UPLOAD_BUDGET)
 {
     CCAssert(g_sharedTextureCache == NULL, "Attempted to allocate a second instance of a singleton.");
     
     m_pTextures = new CCDictionary();
+    m_pPendingUploads = new CCArray();
 }
 
 CCTextureCache::~CCTextureCache()
 {
     CCLOGINFO("cocos2d: deallocing CCTextureCache.");
-    need_quit = true;
+    stopLoadingThreads();
 
-    pthread_cond_signal(&s_SleepCondition);
+    CC_SAFE_RELEASE(m_pPendingUploads);
     CC_SAFE_RELEASE(m_pTextures);
 }
 
@@ -236,7 +376,18 @@ CCDictionary* CCTextureCache::snapshotTextures()
     return pRet;
 }
 
+void CCTextureCache::setAsyncLoadingThreads(unsigned int uThreads)
+{
+    CCAssert(s_pAsyncStructQueue == NULL, "TextureCache: the loading threads are already running");
+    m_uAsyncLoadingThreads = MAX(uThreads, 1);
+}
+
 void CCTextureCache::addImageAsync(const char *path, CCObject *target, SEL_CallFuncO selector)
+{
+    addImageAsync(path, target, selector, 0);
+}
+
+void CCTextureCache::addImageAsync(const char *path, CCObject *target, SEL_CallFuncO selector, int priority)
 {
 #ifdef EMSCRIPTEN
     CCLOGWARN("Cannot load image %s asynchronously in Emscripten builds.", path);
@@ -255,7 +406,7 @@ void CCTextureCache::addImageAsync(const char *path, CCObject *target, SEL_CallF
     texture = (CCTexture2D*)m_pTextures->objectForKey(pathKey.c_str());
 
     std::string fullpath = pathKey;
-    if (texture != NULL)
+    if (texture != NULL && texture->isReady())
     {
         if (target && selector)
         {
@@ -268,98 +419,309 @@ void CCTextureCache::addImageAsync(const char *path, CCObject *target, SEL_CallF
     // lazy init
     if (s_pAsyncStructQueue == NULL)
     {             
-        s_pAsyncStructQueue = new queue<AsyncStruct*>();
+        s_pAsyncStructQueue = new vector<AsyncStruct*>();
         s_pImageQueue = new queue<ImageInfo*>();        
+        s_pAsyncStructMap = new map<std::string, AsyncStruct*>();
+        s_pUploadingStructMap = new map<CCTexture2D*, AsyncStruct*>();
         
         pthread_mutex_init(&s_asyncStructQueueMutex, NULL);
         pthread_mutex_init(&s_ImageInfoMutex, NULL);
-        pthread_mutex_init(&s_SleepMutex, NULL);
         pthread_cond_init(&s_SleepCondition, NULL);
-        pthread_create(&s_loadingThread, NULL, loadImage, NULL);
 
         need_quit = false;
+
+        for (unsigned int i = 0; i < m_uAsyncLoadingThreads; ++i)
+        {
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, loadImage, NULL) == 0)
+            {
+                s_loadingThreads.push_back(thread);
+            }
+        }
     }
 
-    if (0 == s_nAsyncRefCount)
+    if (target)
     {
-        CCDirector::sharedDirector()->getScheduler()->scheduleSelector(schedule_selector(CCTextureCache::addImageAsyncCallBack), this, 0, false);
+        target->retain();
     }
 
-    ++s_nAsyncRefCount;
+    AsyncCallback callback;
+    callback.target = target;
+    callback.selector = selector;
 
-    if (target)
+    // the image is already being loaded: don't load it twice, deliver it to this target too
+    std::map<std::string, AsyncStruct*>::iterator it = s_pAsyncStructMap->find(fullpath);
+    if (it != s_pAsyncStructMap->end())
     {
-        target->retain();
+        AsyncStruct *data = it->second;
+        data->callbacks.push_back(callback);
+
+        pthread_mutex_lock(&s_asyncStructQueueMutex);
+        if (priority > data->priority)
+        {
+            data->priority = priority;
+            // no effect if a loading thread already took it
+            std::make_heap(s_pAsyncStructQueue->begin(), s_pAsyncStructQueue->end(), compareAsyncStructPriority);
+        }
+        pthread_mutex_unlock(&s_asyncStructQueueMutex);
+
+        return;
     }
 
+    if (0 == s_nAsyncRefCount)
+    {
+        CCDirector::sharedDirector()->getScheduler()->scheduleSelector(schedule_selector(CCTextureCache::addImageAsyncCallBack), this, 0, false);
+    }
+
+    ++s_nAsyncRefCount;
+
     // generate async struct
     AsyncStruct *data = new AsyncStruct();
     data->filename = fullpath.c_str();
-    data->target = target;
-    data->selector = selector;
+    data->callbacks.push_back(callback);
+    data->priority = priority;
+    data->order = s_nAsyncOrder++;
+    (*s_pAsyncStructMap)[fullpath] = data;
 
     // add async struct into queue
     pthread_mutex_lock(&s_asyncStructQueueMutex);
-    s_pAsyncStructQueue->push(data);
+    s_pAsyncStructQueue->push_back(data);
+    std::push_heap(s_pAsyncStructQueue->begin(), s_pAsyncStructQueue->end(), compareAsyncStructPriority);
     pthread_mutex_unlock(&s_asyncStructQueueMutex);
 
     pthread_cond_signal(&s_SleepCondition);
 }
 
-void CCTextureCache::addImageAsyncCallBack(float dt)
+void CCTextureCache::cancelImageAsync(const char *path, CCObject *target)
 {
-    // the image is generated in loading thread
-    std::queue<ImageInfo*> *imagesQueue = s_pImageQueue;
+    CCAssert(path != NULL, "TextureCache: fileimage MUST not be NULL");
 
-    pthread_mutex_lock(&s_ImageInfoMutex);
-    if (imagesQueue->empty())
+    if (s_pAsyncStructMap == NULL)
     {
-        pthread_mutex_unlock(&s_ImageInfoMutex);
+        return;
     }
-    else
+
+    std::string fullpath = CCFileUtils::sharedFileUtils()->fullPathForFilename(path);
+    std::map<std::string, AsyncStruct*>::iterator it = s_pAsyncStructMap->find(fullpath);
+    if (it == s_pAsyncStructMap->end())
+    {
+        return;
+    }
+
+    AsyncStruct *data = it->second;
+    if (cancelAsyncStruct(data, target))
+    {
+        s_pAsyncStructMap->erase(it);
+        delete data;
+        asyncRequestFinished();
+    }
+}
+
+void CCTextureCache::cancelAllImageAsync(CCObject *target)
+{
+    if (s_pAsyncStructMap == NULL)
+    {
+        return;
+    }
+
+    std::map<std::string, AsyncStruct*>::iterator it = s_pAsyncStructMap->begin();
+    while (it != s_pAsyncStructMap->end())
     {
+        AsyncStruct *data = it->second;
+        if (cancelAsyncStruct(data, target))
+        {
+            s_pAsyncStructMap->erase(it++);
+            delete data;
+            asyncRequestFinished();
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void CCTextureCache::asyncRequestFinished()
+{
+    --s_nAsyncRefCount;
+    if (0 == s_nAsyncRefCount)
+    {
+        CCDirector::sharedDirector()->getScheduler()->unscheduleSelector(schedule_selector(CCTextureCache::addImageAsyncCallBack), this);
+    }
+}
+
+void CCTextureCache::deliverAsyncStruct(AsyncStruct *pAsyncStruct, CCTexture2D *texture)
+{
+    s_pAsyncStructMap->erase(pAsyncStruct->filename);
+
+    if (texture)
+    {
+        for (unsigned int i = 0; i < pAsyncStruct->callbacks.size(); ++i)
+        {
+            CCObject *target = pAsyncStruct->callbacks[i].target;
+            SEL_CallFuncO selector = pAsyncStruct->callbacks[i].selector;
+            if (target && selector)
+            {
+                (target->*selector)(texture);
+            }
+        }
+    }
+
+    releaseAsyncStruct(pAsyncStruct);
+    asyncRequestFinished();
+}
+
+void CCTextureCache::addImageAsyncCallBack(float dt)
+{
+    // the images are generated in the loading threads. Create as many textures as the budget allows, at least one
+    struct cc_timeval start;
+    CCTime::gettimeofdayCocos2d(&start, NULL);
+
+    std::queue<ImageInfo*> *imagesQueue = s_pImageQueue;
+
+    while (true)
+    {
+        pthread_mutex_lock(&s_ImageInfoMutex);
+        if (imagesQueue->empty())
+        {
+            pthread_mutex_unlock(&s_ImageInfoMutex);
+            break;
+        }
+
         ImageInfo *pImageInfo = imagesQueue->front();
         imagesQueue->pop();
         pthread_mutex_unlock(&s_ImageInfoMutex);
 
         AsyncStruct *pAsyncStruct = pImageInfo->asyncStruct;
         CCImage *pImage = pImageInfo->image;
+        CCTexture2D *texture = NULL;
 
-        CCObject *target = pAsyncStruct->target;
-        SEL_CallFuncO selector = pAsyncStruct->selector;
-        const char* filename = pAsyncStruct->filename.c_str();
+        // skip failed loads, and the images nobody waits for anymore
+        if ((pImage || pImageInfo->bundlePixels) && ! pAsyncStruct->callbacks.empty())
+        {
+            const char* filename = pAsyncStruct->filename.c_str();
 
-        // generate texture in render thread
-        CCTexture2D *texture = new CCTexture2D();
+            // generate texture in render thread
+            texture = new CCTexture2D();
 #if 0 //TODO: (CC_TARGET_PLATFORM == CC_PLATFORM_IOS)
-        texture->initWithImage(pImage, kCCResolutioniPhone);
+            texture->initWithImage(pImage, kCCResolutioniPhone);
 #else
-        texture->initWithImage(pImage);
+            if (pImageInfo->bundlePixels)
+            {
+                texture->initWithBundleTexture(pImageInfo->bundleTexture, pImageInfo->bundlePixels->getBytes());
+            }
+            // big images are uploaded a few rows every frame, the targets are called when the texture is ready
+            else if (m_uIncrementalUploadPixels > 0 && pImage->getWidth() * pImage->getHeight() >= m_uIncrementalUploadPixels)
+            {
+                texture->initWithImageIncremental(pImage);
+            }
+            else
+            {
+                texture->initWithImage(pImage);
+            }
 #endif
 
 #if CC_ENABLE_CACHE_TEXTURE_DATA
-       // cache the texture file name
-       VolatileTexture::addImageTexture(texture, filename, pImageInfo->imageType);
+           // cache the texture file name
+           VolatileTexture::addImageTexture(texture, filename, pImageInfo->imageType);
 #endif
 
-        // cache the texture
-        m_pTextures->setObject(texture, filename);
-        texture->autorelease();
+            // cache the texture
+            m_pTextures->setObject(texture, filename);
+            texture->autorelease();
+        }
 
-        if (target && selector)
+        CC_SAFE_RELEASE(pImage);
+        CC_SAFE_RELEASE(pImageInfo->bundlePixels);
+        delete pImageInfo;
+
+        if (texture && ! texture->isReady())
         {
-            (target->*selector)(texture);
-            target->release();
-        }        
+            (*s_pUploadingStructMap)[texture] = pAsyncStruct;
+        }
+        else
+        {
+            deliverAsyncStruct(pAsyncStruct, texture);
+        }
 
-        pImage->release();
-        delete pAsyncStruct;
-        delete pImageInfo;
+        struct cc_timeval now;
+        CCTime::gettimeofdayCocos2d(&now, NULL);
+        if (CCTime::timersubCocos2d(&start, &now) >= m_fAsyncUploadBudget)
+        {
+            break;
+        }
+    }
+}
+
+void CCTextureCache::addIncrementalUpload(CCTexture2D *texture)
+{
+    if (m_pPendingUploads->count() == 0)
+    {
+        CCDirector::sharedDirector()->getScheduler()->scheduleSelector(schedule_selector(CCTextureCache::incrementalUploadCallBack), this, 0, false);
+    }
+
+    m_pPendingUploads->addObject(texture);
+}
+
+void CCTextureCache::incrementalUploadCallBack(float dt)
+{
+    // upload the textures in the order they were created, as many rows as the budget allows, at least one strip
+    struct cc_timeval start;
+    CCTime::gettimeofdayCocos2d(&start, NULL);
+
+    while (m_pPendingUploads->count() > 0)
+    {
+        CCTexture2D *texture = (CCTexture2D*)m_pPendingUploads->objectAtIndex(0);
+        texture->retain();
+
+        if (texture->uploadNextStrip())
+        {
+            incrementalUploadFinished(texture);
+        }
+
+        texture->release();
+
+        struct cc_timeval now;
+        CCTime::gettimeofdayCocos2d(&now, NULL);
+        if (CCTime::timersubCocos2d(&start, &now) >= m_fIncrementalUploadBudget)
+        {
+            break;
+        }
+    }
+
+    if (m_pPendingUploads->count() == 0)
+    {
+        CCDirector::sharedDirector()->getScheduler()->unscheduleSelector(schedule_selector(CCTextureCache::incrementalUploadCallBack), this);
+    }
+}
 
-        --s_nAsyncRefCount;
-        if (0 == s_nAsyncRefCount)
+void CCTextureCache::finishIncrementalUpload(CCTexture2D *texture)
+{
+    texture->retain();
+    while (! texture->uploadNextStrip())
+    {
+    }
+    incrementalUploadFinished(texture);
+    texture->release();
+
+    if (m_pPendingUploads->count() == 0)
+    {
+        CCDirector::sharedDirector()->getScheduler()->unscheduleSelector(schedule_selector(CCTextureCache::incrementalUploadCallBack), this);
+    }
+}
+
+void CCTextureCache::incrementalUploadFinished(CCTexture2D *texture)
+{
+    m_pPendingUploads->removeObject(texture);
+
+    if (s_pUploadingStructMap != NULL)
+    {
+        std::map<CCTexture2D*, AsyncStruct*>::iterator it = s_pUploadingStructMap->find(texture);
+        if (it != s_pUploadingStructMap->end())
         {
-            CCDirector::sharedDirector()->getScheduler()->unscheduleSelector(schedule_selector(CCTextureCache::addImageAsyncCallBack), this);
+            AsyncStruct *pAsyncStruct = it->second;
+            s_pUploadingStructMap->erase(it);
+            deliverAsyncStruct(pAsyncStruct, texture);
         }
     }
 }
@@ -385,6 +747,12 @@ CCTexture2D * CCTextureCache::addImage(const char * path)
     }
     texture = (CCTexture2D*)m_pTextures->objectForKey(pathKey.c_str());
 
+    // an async load is still uploading it, the caller expects the pixels now
+    if (texture && ! texture->isReady())
+    {
+        finishIncrementalUpload(texture);
+    }
+
     std::string fullpath = pathKey; // (CCFileUtils::sharedFileUtils()->fullPathFromRelativePath(path));
     if (! texture) 
     {
@@ -396,7 +764,29 @@ CCTexture2D * CCTextureCache::addImage(const char * path)
         // all images are handled by UIImage except PVR extension that is handled by our own handler
         do 
         {
-            if (std::string::npos != lowerCase.find(".pvr"))
+            // the textures of the mounted bundles were decoded by the packer
+            ccAssetBundleTextureInfo bundleTexture;
+            CCFileData *pBundlePixels = loadBundleTexture(fullpath, &bundleTexture);
+            if (pBundlePixels)
+            {
+                texture = new CCTexture2D();
+                if (texture->initWithBundleTexture(bundleTexture, pBundlePixels->getBytes()))
+                {
+#if CC_ENABLE_CACHE_TEXTURE_DATA
+                    // cache the texture file name
+                    VolatileTexture::addImageTexture(texture, fullpath.c_str(), CCImage::kFmtRawData);
+#endif
+                    m_pTextures->setObject(texture, pathKey.c_str());
+                    texture->release();
+                }
+                else
+                {
+                    CCLOG("cocos2d: Couldn't create texture for file:%s in CCTextureCache", path);
+                    CC_SAFE_RELEASE_NULL(texture);
+                }
+                pBundlePixels->release();
+            }
+            else if (std::string::npos != lowerCase.find(".pvr"))
             {
                 texture = this->addPVRImage(fullpath.c_str());
             }
@@ -837,7 +1227,14 @@ void VolatileTexture::reloadAllTextures()
                     lowerCase[i] = tolower(lowerCase[i]);
                 }
 
-                if (std::string::npos != lowerCase.find(".pvr")) 
+                ccAssetBundleTextureInfo bundleTexture;
+                CCFileData *pBundlePixels = loadBundleTexture(vt->m_strFileName, &bundleTexture);
+                if (pBundlePixels)
+                {
+                    vt->texture->initWithBundleTexture(bundleTexture, pBundlePixels->getBytes());
+                    pBundlePixels->release();
+                }
+                else if (std::string::npos != lowerCase.find(".pvr")) 
                 {
                     CCTexture2DPixelFormat oldPixelFormat = CCTexture2D::defaultAlphaPixelFormat();
                     CCTexture2D::setDefaultAlphaPixelFormat(vt->m_PixelFormat);
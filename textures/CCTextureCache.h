@@ -29,6 +29,7 @@ THE SOFTWARE.
 
 #include "cocoa/CCObject.h"
 #include "cocoa/CCDictionary.h"
+#include "cocoa/CCArray.h"
 #include "textures/CCTexture2D.h"
 #include <string>
 
@@ -42,6 +43,7 @@ NS_CC_BEGIN
 
 class CCLock;
 class CCImage;
+struct _AsyncStruct;
 
 /**
  * @addtogroup textures
@@ -62,6 +64,17 @@ protected:
 private:
     /// todo: void addImageWithAsyncObject(CCAsyncObject* async);
     void addImageAsyncCallBack(float dt);
+    void asyncRequestFinished();
+    void deliverAsyncStruct(struct _AsyncStruct *pAsyncStruct, CCTexture2D *texture);
+    void incrementalUploadCallBack(float dt);
+    void finishIncrementalUpload(CCTexture2D *texture);
+    void incrementalUploadFinished(CCTexture2D *texture);
+
+    unsigned int m_uAsyncLoadingThreads;
+    float m_fAsyncUploadBudget;
+    unsigned int m_uIncrementalUploadPixels;
+    float m_fIncrementalUploadBudget;
+    CCArray* m_pPendingUploads;
 
 public:
 
@@ -98,6 +111,49 @@ public:
     
     void addImageAsync(const char *path, CCObject *target, SEL_CallFuncO selector);
 
+    /** Same as addImageAsync(), but the images with a higher priority are loaded first.
+    * The images with the same priority are loaded in the order they were requested. The default priority is 0.
+    * If the image is already being loaded, it is not loaded twice: the callback is added to the pending request
+    * and the priority of the request is raised if it was lower.
+    */
+    void addImageAsync(const char *path, CCObject *target, SEL_CallFuncO selector, int priority);
+
+    /** Cancels the pending asynchronous loads of an image for a target, or for all the targets if target is NULL.
+    * The target is released and its callback won't be called. When nobody waits for the image anymore it is not loaded.
+    */
+    void cancelImageAsync(const char *path, CCObject *target);
+
+    /** Cancels all the pending asynchronous loads of a target, or of all the targets if target is NULL */
+    void cancelAllImageAsync(CCObject *target);
+
+    /** Number of threads decoding the images loaded by addImageAsync().
+    * It must be set before the first call of addImageAsync(). Default is CC_TEXTURE_ASYNC_LOADING_THREADS.
+    */
+    unsigned int getAsyncLoadingThreads() { return m_uAsyncLoadingThreads; }
+    void setAsyncLoadingThreads(unsigned int uThreads);
+
+    /** Time, in milliseconds, spent every frame creating the textures of the images loaded by addImageAsync().
+    * At least one texture is created every frame. Default is CC_TEXTURE_ASYNC_UPLOAD_BUDGET.
+    */
+    float getAsyncUploadBudget() { return m_fAsyncUploadBudget; }
+    void setAsyncUploadBudget(float fMilliseconds) { m_fAsyncUploadBudget = fMilliseconds; }
+
+    /** Images loaded by addImageAsync() with at least this number of pixels are uploaded a few rows every frame
+    * (see CCTexture2D::initWithImageIncremental()), and the callback is called when the texture is ready.
+    * 0 disables the incremental uploads. Default is CC_TEXTURE_INCREMENTAL_UPLOAD_PIXELS.
+    */
+    unsigned int getIncrementalUploadPixels() { return m_uIncrementalUploadPixels; }
+    void setIncrementalUploadPixels(unsigned int uPixels) { m_uIncrementalUploadPixels = uPixels; }
+
+    /** Time, in milliseconds, spent every frame uploading the textures created with CCTexture2D::initWithImageIncremental().
+    * At least one strip of rows is uploaded every frame. Default is CC_TEXTURE_INCREMENTAL_UPLOAD_BUDGET.
+    */
+    float getIncrementalUploadBudget() { return m_fIncrementalUploadBudget; }
+    void setIncrementalUploadBudget(float fMilliseconds) { m_fIncrementalUploadBudget = fMilliseconds; }
+
+    /** Queues a texture created with CCTexture2D::initWithImageIncremental(). Called by CCTexture2D. */
+    void addIncrementalUpload(CCTexture2D *texture);
+
     /* Returns a Texture2D object given an CGImageRef image
     * If the image was not previously loaded, it will create a new CCTexture2D object and it will return it.
     * Otherwise it will return a reference of a previously loaded image
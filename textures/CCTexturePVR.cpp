@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "support/ccUtils.h"
 #include "CCStdC.h"
 #include "platform/CCFileUtils.h"
+#include "platform/CCFileData.h"
 #include "support/zip_support/ZipUtils.h"
 #include "shaders/ccGLStateCache.h"
 #include <ctype.h>
@@ -615,6 +616,7 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
 {
     unsigned char* pvrdata = NULL;
     int pvrlen = 0;
+    CCFileData* pFileData = NULL;
     
     std::string lowerCase(path);
     for (unsigned int i = 0; i < lowerCase.length(); ++i)
@@ -632,7 +634,13 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
     }
     else
     {
-        pvrdata = CCFileUtils::sharedFileUtils()->getFileData(path, "rb", (unsigned long *)(&pvrlen));
+        // the mipmaps are read-only, they are uploaded straight from the file
+        pFileData = CCFileUtils::sharedFileUtils()->getFileDataView(path);
+        if (pFileData)
+        {
+            pvrdata = const_cast<unsigned char*>(pFileData->getBytes());
+            pvrlen = (int)pFileData->getSize();
+        }
     }
     
     if (pvrlen < 0)
@@ -652,14 +660,22 @@ bool CCTexturePVR::initWithContentsOfFile(const char* path)
 
     m_bRetainName = false; // cocos2d integration
 
-    if (! ((unpackPVRv2Data(pvrdata, pvrlen)  || unpackPVRv3Data(pvrdata, pvrlen)) && createGLTexture()) )
+    bool bRet = (unpackPVRv2Data(pvrdata, pvrlen) || unpackPVRv3Data(pvrdata, pvrlen)) && createGLTexture();
+
+    if (pFileData)
+    {
+        pFileData->release();
+    }
+    else
     {
         CC_SAFE_DELETE_ARRAY(pvrdata);
+    }
+
+    if (! bRet)
+    {
         this->release();
         return false;
     }
-
-    CC_SAFE_DELETE_ARRAY(pvrdata);
     
     return true;
 }
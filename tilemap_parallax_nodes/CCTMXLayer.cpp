@@ -33,6 +33,7 @@ THE SOFTWARE.
 #include "support/CCPointExtension.h"
 #include "support/data_support/ccCArray.h"
 #include "CCDirector.h"
+#include <string.h>
 
 NS_CC_BEGIN
 
@@ -56,6 +57,31 @@ bool CCTMXLayer::initWithTilesetInfo(CCTMXTilesetInfo *tilesetInfo, CCTMXLayerIn
     float totalNumberOfTiles = size.width * size.height;
     float capacity = totalNumberOfTiles * 0.35f + 1; // 35 percent is occupied ?
 
+    m_uChunkSize = CC_TMX_LAYER_CHUNK_SIZE;
+    CCString *chunkSize = layerInfo->getProperties() ? (CCString*)layerInfo->getProperties()->objectForKey("cc_chunk_size") : NULL;
+    if (chunkSize)
+    {
+        m_uChunkSize = chunkSize->uintValue();
+    }
+    if (m_uChunkSize && mapInfo->getOrientation() != CCTMXOrientationOrtho)
+    {
+        CCLOGWARN("cocos2d: WARNING: CCTMXLayer: only the orthogonal layers can be built in chunks, %s is built at once", layerInfo->m_sName.c_str());
+        m_uChunkSize = 0;
+    }
+    // the quads are in the order of the chunks' slots, not in the order of the tiles:
+    // the tiles overlapping their neighbours would be drawn in the wrong order across the chunks
+    if (m_uChunkSize && tilesetInfo
+        && (tilesetInfo->m_tTileSize.width > mapInfo->getTileSize().width || tilesetInfo->m_tTileSize.height > mapInfo->getTileSize().height))
+    {
+        CCLOGWARN("cocos2d: WARNING: CCTMXLayer: the tiles of %s are bigger than the tiles of the map, it is built at once", layerInfo->m_sName.c_str());
+        m_uChunkSize = 0;
+    }
+    if (m_uChunkSize)
+    {
+        // room for the chunks around the screen, the atlas grows if more are needed
+        capacity = (float)(m_uChunkSize * m_uChunkSize * 4);
+    }
+
     CCTexture2D *texture = NULL;
     if( tilesetInfo )
     {
@@ -86,7 +112,10 @@ bool CCTMXLayer::initWithTilesetInfo(CCTMXTilesetInfo *tilesetInfo, CCTMXLayerIn
         CCPoint offset = this->calculateLayerOffset(layerInfo->m_tOffset);
         this->setPosition(CC_POINT_PIXELS_TO_POINTS(offset));
 
-        m_pAtlasIndexArray = ccCArrayNew((unsigned int)totalNumberOfTiles);
+        if (! m_uChunkSize)
+        {
+            m_pAtlasIndexArray = ccCArrayNew((unsigned int)totalNumberOfTiles);
+        }
 
         this->setContentSize(CC_SIZE_PIXELS_TO_POINTS(CCSizeMake(m_tLayerSize.width * m_tMapTileSize.width, m_tLayerSize.height * m_tMapTileSize.height)));
 
@@ -107,6 +136,13 @@ CCTMXLayer::CCTMXLayer()
 ,m_sLayerName("")
 ,m_pReusedTile(NULL)
 ,m_pAtlasIndexArray(NULL)    
+,m_uChunkSize(0)
+,m_uChunksWide(0)
+,m_uChunksHigh(0)
+,m_uVisibleChunkMinX(0)
+,m_uVisibleChunkMinY(0)
+,m_uVisibleChunkMaxX(0)
+,m_uVisibleChunkMaxY(0)
 {}
 
 CCTMXLayer::~CCTMXLayer()
@@ -138,6 +174,13 @@ void CCTMXLayer::setTileSet(CCTMXTilesetInfo* var)
 
 void CCTMXLayer::releaseMap()
 {
+    CCAssert(! m_uChunkSize, "TMXLayer: releaseMap isn't supported by the chunked layers");
+    if (m_uChunkSize)
+    {
+        CCLOGERROR("cocos2d: CCTMXLayer: the chunks of %s are built from the tiles map, it can't be released", m_sLayerName.c_str());
+        return;
+    }
+
     if (m_pTiles)
     {
         delete [] m_pTiles;
@@ -169,29 +212,51 @@ void CCTMXLayer::setupTiles()
     // Parse cocos2d properties
     this->parseInternalProperties();
 
-    for (unsigned int y=0; y < m_tLayerSize.height; y++) 
+    if (m_uChunkSize)
     {
-        for (unsigned int x=0; x < m_tLayerSize.width; x++) 
+        // the quads are built by chunks when they come near the screen, see draw()
+        unsigned int count = (unsigned int)(m_tLayerSize.width * m_tLayerSize.height);
+        for (unsigned int i = 0; i < count; i++)
         {
-            unsigned int pos = (unsigned int)(x + m_tLayerSize.width * y);
-            unsigned int gid = m_pTiles[ pos ];
-
-            // gid are stored in little endian.
-            // if host is big endian, then swap
-            //if( o == CFByteOrderBigEndian )
-            //    gid = CFSwapInt32( gid );
-            /* We support little endian.*/
-
-            // XXX: gid == 0 --> empty tile
-            if (gid != 0) 
+            unsigned int gid = m_pTiles[i];
+            if (gid != 0)
             {
-                this->appendTileForGID(gid, ccp(x, y));
-
-                // Optimization: update min and max GID rendered by the layer
                 m_uMinGID = MIN(gid, m_uMinGID);
                 m_uMaxGID = MAX(gid, m_uMaxGID);
             }
         }
+
+        m_uChunksWide = ((unsigned int)m_tLayerSize.width + m_uChunkSize - 1) / m_uChunkSize;
+        m_uChunksHigh = ((unsigned int)m_tLayerSize.height + m_uChunkSize - 1) / m_uChunkSize;
+        m_tChunkSlots.assign(m_uChunksWide * m_uChunksHigh, -1);
+        m_tSlotChunks.clear();
+    }
+    else
+    {
+        for (unsigned int y=0; y < m_tLayerSize.height; y++) 
+        {
+            for (unsigned int x=0; x < m_tLayerSize.width; x++) 
+            {
+                unsigned int pos = (unsigned int)(x + m_tLayerSize.width * y);
+                unsigned int gid = m_pTiles[ pos ];
+
+                // gid are stored in little endian.
+                // if host is big endian, then swap
+                //if( o == CFByteOrderBigEndian )
+                //    gid = CFSwapInt32( gid );
+                /* We support little endian.*/
+
+                // XXX: gid == 0 --> empty tile
+                if (gid != 0) 
+                {
+                    this->appendTileForGID(gid, ccp(x, y));
+
+                    // Optimization: update min and max GID rendered by the layer
+                    m_uMinGID = MIN(gid, m_uMinGID);
+                    m_uMaxGID = MAX(gid, m_uMaxGID);
+                }
+            }
+        }
     }
 
     CCAssert( m_uMaxGID >= m_pTileSet->m_uFirstGid &&
@@ -320,6 +385,12 @@ CCSprite* CCTMXLayer::reusedTileWithRect(CCRect rect)
 CCSprite * CCTMXLayer::tileAt(const CCPoint& pos)
 {
     CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
+    CCAssert(! m_uChunkSize, "TMXLayer: tileAt isn't supported by the chunked layers");
+    if (m_uChunkSize)
+    {
+        CCLOGERROR("cocos2d: CCTMXLayer: tileAt isn't supported by %s, it is built in chunks", m_sLayerName.c_str());
+        return NULL;
+    }
     CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
 
     CCSprite *tile = NULL;
@@ -362,7 +433,7 @@ unsigned int CCTMXLayer::tileGIDAt(const CCPoint& pos)
 unsigned int CCTMXLayer::tileGIDAt(const CCPoint& pos, ccTMXTileFlags* flags)
 {
     CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
-    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
+    CCAssert(m_pTiles && (m_pAtlasIndexArray || m_uChunkSize), "TMXLayer: the tiles map has been released");
 
     int idx = (int)(pos.x + pos.y * m_tLayerSize.width);
     // Bits on the far end of the 32-bit global tile ID are used for tile flags
@@ -505,7 +576,7 @@ void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos)
 void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos, ccTMXTileFlags flags)
 {
     CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
-    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
+    CCAssert(m_pTiles && (m_pAtlasIndexArray || m_uChunkSize), "TMXLayer: the tiles map has been released");
     CCAssert(gid == 0 || gid >= m_pTileSet->m_uFirstGid, "TMXLayer: invalid gid" );
 
     ccTMXTileFlags currentFlags;
@@ -515,8 +586,15 @@ void CCTMXLayer::setTileGID(unsigned int gid, const CCPoint& pos, ccTMXTileFlags
     {
         unsigned gidAndFlags = gid | flags;
 
+        // the quad of the tile is rewritten, if its chunk is near the screen
+        if (m_uChunkSize)
+        {
+            unsigned int z = (unsigned int)(pos.x + pos.y * m_tLayerSize.width);
+            m_pTiles[z] = gid ? gidAndFlags : 0;
+            updateChunkTile((unsigned int)pos.x, (unsigned int)pos.y);
+        }
         // setting gid=0 is equal to remove the tile
-        if (gid == 0)
+        else if (gid == 0)
         {
             removeTileAt(pos);
         }
@@ -576,11 +654,16 @@ void CCTMXLayer::removeChild(CCNode* node, bool cleanup)
 void CCTMXLayer::removeTileAt(const CCPoint& pos)
 {
     CCAssert(pos.x < m_tLayerSize.width && pos.y < m_tLayerSize.height && pos.x >=0 && pos.y >=0, "TMXLayer: invalid position");
-    CCAssert(m_pTiles && m_pAtlasIndexArray, "TMXLayer: the tiles map has been released");
+    CCAssert(m_pTiles && (m_pAtlasIndexArray || m_uChunkSize), "TMXLayer: the tiles map has been released");
 
     unsigned int gid = tileGIDAt(pos);
 
-    if (gid) 
+    if (gid && m_uChunkSize)
+    {
+        m_pTiles[(unsigned int)(pos.x + pos.y * m_tLayerSize.width)] = 0;
+        updateChunkTile((unsigned int)pos.x, (unsigned int)pos.y);
+    }
+    else if (gid) 
     {
         unsigned int z = (unsigned int)(pos.x + pos.y * m_tLayerSize.width);
         unsigned int atlasIndex = atlasIndexForExistantZ(z);
@@ -622,6 +705,154 @@ void CCTMXLayer::removeTileAt(const CCPoint& pos)
     }
 }
 
+// CCTMXLayer - chunks
+void CCTMXLayer::draw()
+{
+    if (m_uChunkSize)
+    {
+        this->updateVisibleChunks();
+    }
+    CCSpriteBatchNode::draw();
+}
+
+void CCTMXLayer::updateVisibleChunks()
+{
+    // the screen in pixels of the layer
+    CCDirector *pDirector = CCDirector::sharedDirector();
+    CCPoint origin = pDirector->getVisibleOrigin();
+    CCSize size = pDirector->getVisibleSize();
+    CCRect rect = CCRectApplyAffineTransform(CCRectMake(origin.x, origin.y, size.width, size.height), worldToNodeTransform());
+    rect = CC_RECT_POINTS_TO_PIXELS(rect);
+
+    // tiles under the screen. The rows go down, see positionForOrthoAt()
+    float minX = floorf(rect.getMinX() / m_tMapTileSize.width);
+    float maxX = floorf(rect.getMaxX() / m_tMapTileSize.width);
+    float minY = m_tLayerSize.height - 1 - floorf(rect.getMaxY() / m_tMapTileSize.height);
+    float maxY = m_tLayerSize.height - 1 - floorf(rect.getMinY() / m_tMapTileSize.height);
+
+    unsigned int chunkMinX = 0, chunkMinY = 0, chunkMaxX = 0, chunkMaxY = 0;
+    if (maxX >= 0 && minX < m_tLayerSize.width && maxY >= 0 && minY < m_tLayerSize.height)
+    {
+        // one more chunk on each side, so the next chunks are ready before they are on the screen
+        chunkMinX = (unsigned int)MAX(minX, 0) / m_uChunkSize;
+        chunkMinY = (unsigned int)MAX(minY, 0) / m_uChunkSize;
+        chunkMaxX = (unsigned int)MIN(maxX, m_tLayerSize.width - 1) / m_uChunkSize + 2;
+        chunkMaxY = (unsigned int)MIN(maxY, m_tLayerSize.height - 1) / m_uChunkSize + 2;
+        chunkMinX = chunkMinX > 0 ? chunkMinX - 1 : 0;
+        chunkMinY = chunkMinY > 0 ? chunkMinY - 1 : 0;
+        chunkMaxX = MIN(chunkMaxX, m_uChunksWide);
+        chunkMaxY = MIN(chunkMaxY, m_uChunksHigh);
+    }
+
+    if (chunkMinX == m_uVisibleChunkMinX && chunkMinY == m_uVisibleChunkMinY
+        && chunkMaxX == m_uVisibleChunkMaxX && chunkMaxY == m_uVisibleChunkMaxY)
+    {
+        return;
+    }
+    m_uVisibleChunkMinX = chunkMinX;
+    m_uVisibleChunkMinY = chunkMinY;
+    m_uVisibleChunkMaxX = chunkMaxX;
+    m_uVisibleChunkMaxY = chunkMaxY;
+
+    unsigned int nextSlot = 0;
+    for (unsigned int cy = chunkMinY; cy < chunkMaxY; cy++)
+    {
+        for (unsigned int cx = chunkMinX; cx < chunkMaxX; cx++)
+        {
+            unsigned int chunk = cx + cy * m_uChunksWide;
+            if (m_tChunkSlots[chunk] >= 0)
+            {
+                continue;
+            }
+
+            // recycle the slot of a chunk that went away from the screen, or add one
+            unsigned int slotCount = m_tSlotChunks.size();
+            for (; nextSlot < slotCount; nextSlot++)
+            {
+                int other = m_tSlotChunks[nextSlot];
+                if (other < 0)
+                {
+                    break;
+                }
+                unsigned int ox = other % m_uChunksWide;
+                unsigned int oy = other / m_uChunksWide;
+                if (ox < chunkMinX || ox >= chunkMaxX || oy < chunkMinY || oy >= chunkMaxY)
+                {
+                    m_tChunkSlots[other] = -1;
+                    break;
+                }
+            }
+            if (nextSlot == slotCount)
+            {
+                m_tSlotChunks.push_back(-1);
+                unsigned int quadsNeeded = (slotCount + 1) * m_uChunkSize * m_uChunkSize;
+                if (m_pobTextureAtlas->getCapacity() < quadsNeeded)
+                {
+                    m_pobTextureAtlas->resizeCapacity(quadsNeeded);
+                }
+            }
+
+            this->buildChunk(chunk, nextSlot);
+            nextSlot++;
+        }
+    }
+}
+
+void CCTMXLayer::buildChunk(unsigned int chunk, unsigned int slot)
+{
+    m_tChunkSlots[chunk] = slot;
+    m_tSlotChunks[slot] = chunk;
+
+    unsigned int firstX = (chunk % m_uChunksWide) * m_uChunkSize;
+    unsigned int firstY = (chunk / m_uChunksWide) * m_uChunkSize;
+    unsigned int quadIndex = slot * m_uChunkSize * m_uChunkSize;
+    for (unsigned int y = firstY; y < firstY + m_uChunkSize; y++)
+    {
+        for (unsigned int x = firstX; x < firstX + m_uChunkSize; x++)
+        {
+            this->updateChunkQuad(x, y, quadIndex++);
+        }
+    }
+}
+
+void CCTMXLayer::updateChunkTile(unsigned int x, unsigned int y)
+{
+    unsigned int chunk = x / m_uChunkSize + (y / m_uChunkSize) * m_uChunksWide;
+    int slot = m_tChunkSlots.empty() ? -1 : m_tChunkSlots[chunk];
+    if (slot >= 0)
+    {
+        unsigned int quadIndex = slot * m_uChunkSize * m_uChunkSize + (y % m_uChunkSize) * m_uChunkSize + x % m_uChunkSize;
+        this->updateChunkQuad(x, y, quadIndex);
+    }
+}
+
+void CCTMXLayer::updateChunkQuad(unsigned int x, unsigned int y, unsigned int quadIndex)
+{
+    unsigned int gid = 0;
+    if (x < m_tLayerSize.width && y < m_tLayerSize.height)
+    {
+        gid = m_pTiles[(unsigned int)(x + y * m_tLayerSize.width)];
+    }
+
+    // the empty tiles, and the tiles past the edges of the layer, are degenerate quads
+    if ((gid & kCCFlippedMask) == 0)
+    {
+        ccV3F_C4B_T2F_Quad quad;
+        memset(&quad, 0, sizeof(quad));
+        m_pobTextureAtlas->updateQuad(&quad, quadIndex);
+        return;
+    }
+
+    CCRect rect = m_pTileSet->rectForGID(gid);
+    rect = CC_RECT_PIXELS_TO_POINTS(rect);
+
+    CCSprite *tile = reusedTileWithRect(rect);
+    setupTileSprite(tile, ccp(x, y), gid);
+    tile->setAtlasIndex(quadIndex);
+    tile->setDirty(true);
+    tile->updateTransform();
+}
+
 //CCTMXLayer - obtaining positions, offset
 CCPoint CCTMXLayer::calculateLayerOffset(const CCPoint& pos)
 {
@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include "base_nodes/CCAtlasNode.h"
 #include "sprite_nodes/CCSpriteBatchNode.h"
 #include "CCTMXXMLParser.h"
+#include <vector>
 NS_CC_BEGIN
 
 class CCTMXMapInfo;
@@ -61,6 +62,14 @@ glAlphaFunc( GL_GREATER, value )
 The value 0 should work for most cases, but if you have tiles that are semi-transparent, then you might want to use a different
 value, like 0.5.
 
+Very large orthogonal layers can be built in chunks. It is opt-in: the layers are built at once unless the layer has
+a "cc_chunk_size" property or CC_TMX_LAYER_CHUNK_SIZE isn't 0. A chunked layer is cut in square chunks of that many
+tiles per side, and only the chunks near the screen have quads in the texture atlas. The chunks are built when they
+come near the screen, in the place of the chunks that went away. setTileGID() and removeTileAt() only rewrite one quad,
+but tileAt() and releaseMap() aren't supported: they assert, and log an error and do nothing in release builds.
+Check isChunked() before using them. The isometric and hexagonal layers, and the layers whose tiles are bigger than
+the map's tiles (their overlapping tiles must be drawn in the order of the tiles), are built at once with a warning.
+
 For further information, please see the programming guide:
 
 http://www.cocos2d-iphone.org/wiki/doku.php/prog_guide:tiled_maps
@@ -98,6 +107,7 @@ public:
     /** dealloc the map that contains the tile position from memory.
     Unless you want to know at runtime the tiles positions, you can safely call this method.
     If you are going to call layer->tileGIDAt() then, don't release the map
+    Not supported by the chunked layers: it asserts.
     */
     void releaseMap();
 
@@ -107,6 +117,7 @@ public:
     You can remove either by calling:
     - layer->removeChild(sprite, cleanup);
     - or layer->removeTileAt(ccp(x,y));
+    Not supported by the chunked layers: it asserts, and returns NULL in release builds.
     */
     CCSprite* tileAt(const CCPoint& tileCoordinate);
 
@@ -157,6 +168,13 @@ public:
 
     inline const char* getLayerName(){ return m_sLayerName.c_str(); }
     inline void setLayerName(const char *layerName){ m_sLayerName = layerName; }
+
+    /** whether or not the layer is built in chunks, and the size of the chunks in tiles */
+    inline bool isChunked() { return m_uChunkSize != 0; }
+    inline unsigned int getChunkSize() { return m_uChunkSize; }
+
+    // super method
+    virtual void draw();
 private:
     CCPoint positionForIsoAt(const CCPoint& pos);
     CCPoint positionForOrthoAt(const CCPoint& pos);
@@ -178,6 +196,12 @@ private:
     // index
     unsigned int atlasIndexForExistantZ(unsigned int z);
     unsigned int atlasIndexForNewZ(int z);
+
+    // chunks
+    void updateVisibleChunks();
+    void buildChunk(unsigned int chunk, unsigned int slot);
+    void updateChunkTile(unsigned int x, unsigned int y);
+    void updateChunkQuad(unsigned int x, unsigned int y, unsigned int quadIndex);
 protected:
     //! name of the layer
     std::string m_sLayerName;
@@ -197,6 +221,20 @@ protected:
     
     // used for retina display
     float               m_fContentScaleFactor;            
+
+    //! Only used when the layer is built in chunks
+    unsigned int        m_uChunkSize;
+    unsigned int        m_uChunksWide;
+    unsigned int        m_uChunksHigh;
+    // slot of each chunk in the texture atlas, or -1
+    std::vector<int>    m_tChunkSlots;
+    // chunk in each slot, or -1. A slot is m_uChunkSize * m_uChunkSize quads
+    std::vector<int>    m_tSlotChunks;
+    // chunks near the screen at the last draw, the max are excluded
+    unsigned int        m_uVisibleChunkMinX;
+    unsigned int        m_uVisibleChunkMinY;
+    unsigned int        m_uVisibleChunkMaxX;
+    unsigned int        m_uVisibleChunkMaxY;
 };
 
 // end of tilemap_parallax_nodes group
@@ -28,6 +28,8 @@
 
 NS_CC_BEGIN
 
+CC_IMPLEMENT_OBJECT_POOL(CCTouch)
+
 // returns the current touch location in screen coordinates
 CCPoint CCTouch::getLocationInView() const 
 { 
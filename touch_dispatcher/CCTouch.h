@@ -27,6 +27,7 @@ THE SOFTWARE.
 
 #include "cocoa/CCObject.h"
 #include "cocoa/CCGeometry.h"
+#include "cocoa/CCObjectPool.h"
 
 NS_CC_BEGIN
 
@@ -82,6 +83,8 @@ private:
     CCPoint m_startPoint;
     CCPoint m_point;
     CCPoint m_prevPoint;
+
+    CC_DECLARE_OBJECT_POOL(CCTouch)
 };
 
 class CC_DLL CCEvent : public CCObject